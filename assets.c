@@ -0,0 +1,197 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - asynchronous asset loader and texture cache
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+**************************************************************************************************/
+
+#include <string.h>
+#include "assets.h"
+#include "rlgl.h"
+
+static void *LoaderThread (void *data);
+static void EvictAsset (Asset *asset); // Must hold the cache lock
+
+int AssetCacheInit (AssetCache *cache)
+{
+	memset (cache, 0, sizeof (*cache));
+	pthread_mutex_init (&cache->lock, NULL);
+	pthread_cond_init (&cache->wake, NULL);
+	cache->running = 1;
+	if (pthread_create (&cache->thread, NULL, LoaderThread, cache) != 0)
+	{
+		cache->running = 0;
+		return -1;
+	}
+	return 0;
+}
+
+const Texture2D *AssetGetTexture (AssetCache *cache, const char *path)
+{
+	const Texture2D *texture = NULL;
+	Asset *slot = NULL;
+
+	if (path == NULL || path[0] == '\0' || strlen (path) >= ASSET_PATH_LENGTH)
+		return NULL;
+
+	pthread_mutex_lock (&cache->lock);
+	for (int i = 0; i < ASSET_CACHE_SIZE; i++)
+	{
+		Asset *asset = &cache->entries[i];
+		if (asset->state != ASSET_EMPTY && strcmp (asset->path, path) == 0)
+		{
+			asset->last_used = cache->frame;
+			if (asset->state == ASSET_READY)
+				texture = &asset->texture;
+			pthread_mutex_unlock (&cache->lock);
+			return texture;
+		}
+		// Remember the best slot to reuse in case the path is not cached: empty, else least recently used
+		// Images being decoded belong to the loader thread and are never evicted
+		if (asset->state == ASSET_DECODING)
+			continue;
+		if (slot == NULL || (slot->state != ASSET_EMPTY && (asset->state == ASSET_EMPTY || asset->last_used < slot->last_used)))
+			slot = asset;
+	}
+	// No slot means every image is being decoded; try again next frame
+	if (slot != NULL)
+	{
+		EvictAsset (slot);
+		strcpy (slot->path, path);
+		slot->state = ASSET_QUEUED;
+		slot->last_used = cache->frame;
+		pthread_cond_signal (&cache->wake);
+	}
+	pthread_mutex_unlock (&cache->lock);
+	return NULL;
+}
+
+void AssetCacheUpdate (AssetCache *cache)
+{
+	int budget = ASSET_UPLOAD_BUDGET;
+
+	pthread_mutex_lock (&cache->lock);
+	cache->frame++;
+	for (int i = 0; i < ASSET_CACHE_SIZE && budget > 0; i++)
+	{
+		Asset *asset = &cache->entries[i];
+		if (asset->state != ASSET_DECODED && asset->state != ASSET_UPLOADING)
+			continue;
+
+		int width = asset->image.width;
+		int height = asset->image.height;
+		if (asset->state == ASSET_DECODED)
+		{
+			// Allocate storage only; the pixels follow in slices
+			asset->texture.id = rlLoadTexture (NULL, width, height, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8, 1);
+			asset->texture.width = width;
+			asset->texture.height = height;
+			asset->texture.mipmaps = 1;
+			asset->texture.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+			if (asset->texture.id == 0)
+			{
+				UnloadImage (asset->image);
+				asset->state = ASSET_FAILED;
+				continue;
+			}
+			asset->rows_uploaded = 0;
+			asset->state = ASSET_UPLOADING;
+		}
+
+		int rows = budget / (width * 4);
+		if (rows < 1)
+			rows = 1;
+		if (rows > height - asset->rows_uploaded)
+			rows = height - asset->rows_uploaded;
+		Rectangle slice = {0, (float) asset->rows_uploaded, (float) width, (float) rows};
+		UpdateTextureRec (asset->texture, slice, (unsigned char *) asset->image.data + (size_t) asset->rows_uploaded * width * 4);
+		asset->rows_uploaded += rows;
+		budget -= rows * width * 4;
+
+		if (asset->rows_uploaded >= height)
+		{
+			SetTextureFilter (asset->texture, TEXTURE_FILTER_BILINEAR);
+			UnloadImage (asset->image);
+			asset->image.data = NULL;
+			asset->state = ASSET_READY;
+		}
+	}
+	pthread_mutex_unlock (&cache->lock);
+}
+
+void AssetCacheClose (AssetCache *cache)
+{
+	if (cache->running)
+	{
+		pthread_mutex_lock (&cache->lock);
+		cache->running = 0;
+		pthread_cond_signal (&cache->wake);
+		pthread_mutex_unlock (&cache->lock);
+		pthread_join (cache->thread, NULL);
+	}
+	for (int i = 0; i < ASSET_CACHE_SIZE; i++)
+		EvictAsset (&cache->entries[i]);
+	pthread_cond_destroy (&cache->wake);
+	pthread_mutex_destroy (&cache->lock);
+}
+
+static void *LoaderThread (void *data)
+{
+	AssetCache *cache = data;
+	char path[ASSET_PATH_LENGTH];
+
+	pthread_mutex_lock (&cache->lock);
+	while (cache->running)
+	{
+		Asset *asset = NULL;
+		for (int i = 0; i < ASSET_CACHE_SIZE && asset == NULL; i++)
+			if (cache->entries[i].state == ASSET_QUEUED)
+				asset = &cache->entries[i];
+		if (asset == NULL)
+		{
+			pthread_cond_wait (&cache->wake, &cache->lock);
+			continue;
+		}
+		asset->state = ASSET_DECODING;
+		strcpy (path, asset->path);
+		pthread_mutex_unlock (&cache->lock);
+
+		// Decode and shrink without holding the lock so lookups on the render thread never wait
+		Image image = LoadImage (path);
+		if (image.data != NULL)
+		{
+			int largest = image.width > image.height ? image.width : image.height;
+			if (largest > ASSET_MAX_SIZE)
+				ImageResize (&image, image.width * ASSET_MAX_SIZE / largest, image.height * ASSET_MAX_SIZE / largest);
+			ImageFormat (&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+		}
+
+		pthread_mutex_lock (&cache->lock);
+		asset->image = image;
+		asset->state = image.data != NULL ? ASSET_DECODED : ASSET_FAILED;
+	}
+	pthread_mutex_unlock (&cache->lock);
+	return NULL;
+}
+
+static void EvictAsset (Asset *asset)
+{
+	if ((asset->state == ASSET_DECODED || asset->state == ASSET_UPLOADING) && asset->image.data != NULL)
+		UnloadImage (asset->image);
+	if ((asset->state == ASSET_UPLOADING || asset->state == ASSET_READY) && asset->texture.id != 0)
+		UnloadTexture (asset->texture);
+	memset (asset, 0, sizeof (*asset));
+}
@@ -0,0 +1,65 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - asynchronous asset loader and texture cache
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Images are decoded on a background thread and uploaded to the GPU a few rows at a time from
+AssetCacheUpdate (), which is called once per frame on the render thread. Nothing in here ever
+waits for a decode, so asking for a logo mid-game costs a table lookup until it is ready.
+
+**************************************************************************************************/
+
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <pthread.h>
+#include "raylib.h"
+
+#define ASSET_CACHE_SIZE 32 // Textures kept on the GPU, least recently used is evicted first
+#define ASSET_PATH_LENGTH 256
+#define ASSET_MAX_SIZE 512 // Decoded images are scaled down to fit in this many pixels
+#define ASSET_UPLOAD_BUDGET (256 * 1024) // Bytes uploaded to the GPU per frame
+
+typedef enum AssetState { ASSET_EMPTY = 0, ASSET_QUEUED, ASSET_DECODING, ASSET_DECODED, ASSET_UPLOADING, ASSET_READY, ASSET_FAILED } AssetState;
+
+typedef struct Asset
+{
+	char path[ASSET_PATH_LENGTH];
+	AssetState state;
+	Image image; // Decoded pixels, only valid while DECODED or UPLOADING
+	Texture2D texture; // Only valid while UPLOADING or READY
+	int rows_uploaded;
+	unsigned long last_used; // Frame number of the last lookup
+} Asset;
+
+typedef struct AssetCache
+{
+	Asset entries[ASSET_CACHE_SIZE];
+	unsigned long frame;
+	int running;
+	pthread_t thread;
+	pthread_mutex_t lock; // Guards state, path and image of every entry
+	pthread_cond_t wake;
+} AssetCache;
+
+int AssetCacheInit (AssetCache *cache); // Starts the loader thread, returns 0 on success
+const Texture2D *AssetGetTexture (AssetCache *cache, const char *path); // Queues the image if needed, NULL until it is ready
+void AssetCacheUpdate (AssetCache *cache); // Upload one slice of pending images, call once per frame
+void AssetCacheClose (AssetCache *cache);
+
+#endif
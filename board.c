@@ -0,0 +1,630 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - board logic
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+**************************************************************************************************/
+
+#include <string.h>
+#include "board.h"
+
+typedef struct CueTime { GameClock clock; int at; } CueTime; // Due once the clock is at or below at tenths
+
+static const CueTime cue_times[CUE_COUNT] =
+{
+	{GAME_CLOCK_MAIN, 599}, {GAME_CLOCK_MAIN, 0},
+	{GAME_CLOCK_SHOT, 99}, {GAME_CLOCK_SHOT, 0},
+	{GAME_CLOCK_TIMEOUT, 99}, {GAME_CLOCK_TIMEOUT, 150}, {GAME_CLOCK_TIMEOUT, 139}, {GAME_CLOCK_TIMEOUT, 0}
+};
+
+#define PASSED(board, cue) (((board)->cues_passed >> (cue)) & 1u)
+
+static void ScheduleClockCues (Board *board, GameClock clock);
+static void TickClock (Board *board, GameClock clock);
+static void GiveBack (Time *time, int64_t *elapsed, int64_t us);
+static Time *ClockTime (Board *board, GameClock clock);
+static void UpdateModes (Board *board);
+static void ApplyClockMode (Board *board, Action action);
+static void ApplyEditMode (Board *board, Action action);
+static void ReplaceDigit (Board *board, int replace_digit);
+
+void BoardInit (Board *board, int main_clock_start, int shot_clock_reset, int timeout_short, int timeout_long)
+{
+	memset (board, 0, sizeof (*board));
+	board->team = HOME;
+	board->change_type = SCORE;
+	board->mode = CLOCK;
+	board->main_clock_mode = NORMAL;
+	board->shot_clock_mode = NORMAL;
+	board->shot_clock_showing = 1;
+	board->shot_clock_enabled = 1;
+
+	board->shot_clock_reset = shot_clock_reset;
+	board->timeout_short = timeout_short;
+	board->timeout_long = timeout_long;
+
+	board->main_clock = IntToTime (main_clock_start);
+	board->shot_clock = IntToTime (shot_clock_reset);
+	board->timeout_clock = IntToTime (timeout_short);
+	board->tol[HOME] = 5;
+	board->tol[VISITOR] = 5;
+
+	board->main_clock_buffer = board->main_clock;
+	board->shot_clock_buffer = board->shot_clock;
+	board->selected_digit = 1;
+	for (int clock = 0; clock < GAME_CLOCK_COUNT; clock++)
+		WheelInit (&board->cue_wheels[clock]);
+	BoardScheduleCues (board);
+}
+
+void BoardAdvance (Board *board, int64_t elapsed_us)
+{
+	board->whistle_hold_us = board->whistle_hold_us > elapsed_us ? board->whistle_hold_us - elapsed_us : 0;
+
+	// Clocks can only be running in clock mode
+	if (board->mode != CLOCK)
+		return;
+
+	// Time is consumed up to the next tenth of whichever clock is due first, and the run conditions are
+	// checked again after every tenth. Advancing in one call or in many small ones gives the same result,
+	// which is what makes traces replay exactly no matter how the frames fell.
+	while (elapsed_us > 0)
+	{
+		// Update clocks only if neither has no time left
+		if (!PASSED (board, CUE_MAIN_OUT) && !PASSED (board, CUE_SHOT_OUT) && board->shot_clock_showing)
+		{
+			if (!board->main_clock_running && !board->shot_clock_running)
+				break;
+			int64_t step = elapsed_us;
+			if (board->main_clock_running && TENTH_SECOND_US - board->main_clock_elapsed < step)
+				step = TENTH_SECOND_US - board->main_clock_elapsed;
+			if (board->shot_clock_running && TENTH_SECOND_US - board->shot_clock_elapsed < step)
+				step = TENTH_SECOND_US - board->shot_clock_elapsed;
+			// Main clock, only if it is running
+			if (board->main_clock_running)
+			{
+				board->main_clock_run_us += step;
+				board->main_clock_elapsed += step;
+				if (board->main_clock_elapsed >= TENTH_SECOND_US)
+				{
+					board->main_clock = UpdateTime (board->main_clock);
+					board->main_clock_elapsed = 0;
+					TickClock (board, GAME_CLOCK_MAIN);
+				}
+			}
+			// Shot clock, only if it is running
+			if (board->shot_clock_running)
+			{
+				board->shot_clock_run_us += step;
+				board->shot_clock_elapsed += step;
+				if (board->shot_clock_elapsed >= TENTH_SECOND_US)
+				{
+					board->shot_clock = UpdateTime (board->shot_clock);
+					board->shot_clock_elapsed = 0;
+					TickClock (board, GAME_CLOCK_SHOT);
+				}
+			}
+			elapsed_us -= step;
+		}
+		// Timeout clock, only if it is running
+		else if (!PASSED (board, CUE_TIMEOUT_OUT) && !board->shot_clock_showing && board->shot_clock_running)
+		{
+			int64_t step = elapsed_us;
+			if (TENTH_SECOND_US - board->timeout_clock_elapsed < step)
+				step = TENTH_SECOND_US - board->timeout_clock_elapsed;
+			board->timeout_clock_elapsed += step;
+			if (board->timeout_clock_elapsed >= TENTH_SECOND_US)
+			{
+				board->timeout_clock = UpdateTime (board->timeout_clock);
+				board->timeout_clock_elapsed = 0;
+				TickClock (board, GAME_CLOCK_TIMEOUT);
+			}
+			elapsed_us -= step;
+		}
+		else
+			break;
+	}
+}
+
+void BoardApply (Board *board, Action action)
+{
+	// Just after a whistle stopped the clocks, the operator's stop out of habit would start them again
+	if (board->whistle_hold_us > 0 && board->mode == CLOCK && !board->main_clock_running && !board->shot_clock_running &&
+		(action == ACTION_START_STOP_CLOCKS || action == ACTION_START_STOP_MAIN_CLOCK || action == ACTION_START_STOP_SHOT_CLOCK))
+		return;
+
+	// Cues are scheduled again for any clock this sets
+	int before[GAME_CLOCK_COUNT];
+	for (int clock = 0; clock < GAME_CLOCK_COUNT; clock++)
+		before[clock] = TimeToInt (*ClockTime (board, clock));
+	int main_running = board->main_clock_running, shot_running = board->shot_clock_running;
+
+	switch (board->mode)
+	{
+		case CLOCK:
+			ApplyClockMode (board, action);
+			break;
+		case EDIT_MODE:
+			ApplyEditMode (board, action);
+			break;
+	}
+	for (int clock = 0; clock < GAME_CLOCK_COUNT; clock++)
+		if (TimeToInt (*ClockTime (board, clock)) != before[clock])
+			ScheduleClockCues (board, clock);
+	UpdateModes (board);
+
+	// A whistle only gives back what a clock ran since it was started, reset or set
+	int shot_reset = action == ACTION_EDIT_SAVE || (action == ACTION_RESET_SHOT_CLOCK && board->shot_clock_showing);
+	if ((board->main_clock_running && !main_running) || TimeToInt (board->main_clock) != before[GAME_CLOCK_MAIN] || action == ACTION_EDIT_SAVE)
+		board->main_clock_run_us = 0;
+	if ((board->shot_clock_running && !shot_running) || TimeToInt (board->shot_clock) != before[GAME_CLOCK_SHOT] || shot_reset)
+		board->shot_clock_run_us = 0;
+}
+
+int BoardStopClocksAt (Board *board, int64_t ago_us)
+{
+	// The game clocks only, as they run in BoardAdvance (); a timeout is left to the operator
+	if (board->mode != CLOCK || !board->shot_clock_showing || (!board->main_clock_running && !board->shot_clock_running))
+		return 0;
+
+	// Each ran all of ago_us unless it was started, reset or set since, or one ran out, which stopped them both at zero
+	if (ago_us > 0 && !PASSED (board, CUE_MAIN_OUT) && !PASSED (board, CUE_SHOT_OUT))
+	{
+		if (board->main_clock_running)
+		{
+			GiveBack (&board->main_clock, &board->main_clock_elapsed, ago_us < board->main_clock_run_us ? ago_us : board->main_clock_run_us);
+			ScheduleClockCues (board, GAME_CLOCK_MAIN);
+		}
+		if (board->shot_clock_running)
+		{
+			GiveBack (&board->shot_clock, &board->shot_clock_elapsed, ago_us < board->shot_clock_run_us ? ago_us : board->shot_clock_run_us);
+			ScheduleClockCues (board, GAME_CLOCK_SHOT);
+		}
+		UpdateModes (board);
+	}
+	board->main_clock_running = 0;
+	board->shot_clock_running = 0;
+	board->whistle_hold_us = WHISTLE_HOLD_US;
+	return 1;
+}
+
+void BoardScheduleCues (Board *board)
+{
+	// The clocks were set, so a whistle gives back nothing from before
+	board->main_clock_run_us = 0;
+	board->shot_clock_run_us = 0;
+	for (int clock = 0; clock < GAME_CLOCK_COUNT; clock++)
+		ScheduleClockCues (board, clock);
+	UpdateModes (board);
+}
+
+void BoardSetResetTimes (Board *board, int shot_clock_reset, int timeout_short, int timeout_long)
+{
+	board->shot_clock_reset = shot_clock_reset;
+	board->timeout_short = timeout_short;
+	board->timeout_long = timeout_long;
+}
+
+static void ScheduleClockCues (Board *board, GameClock clock)
+{
+	// Cues already due are passed, the rest fire when the clock gets down to them
+	int tenths = TimeToInt (*ClockTime (board, clock));
+	for (int cue = 0; cue < CUE_COUNT; cue++)
+		if (cue_times[cue].clock == clock)
+		{
+			if (tenths <= cue_times[cue].at)
+			{
+				WheelCancel (&board->cue_wheels[clock], cue);
+				board->cues_passed |= 1u << cue;
+			}
+			else
+			{
+				WheelSchedule (&board->cue_wheels[clock], cue, (uint32_t) (tenths - cue_times[cue].at));
+				board->cues_passed &= ~(1u << cue);
+			}
+		}
+}
+
+static void TickClock (Board *board, GameClock clock)
+{
+	int fired[WHEEL_TIMERS_MAX];
+	int count = WheelTick (&board->cue_wheels[clock], fired);
+	for (int i = 0; i < count; i++)
+		board->cues_passed |= 1u << fired[i];
+	if (count > 0)
+		UpdateModes (board);
+}
+
+static void GiveBack (Time *time, int64_t *elapsed, int64_t us)
+{
+	// Time left, then back into whole tenths and the part of a tenth already run
+	int64_t left = TimeToInt (*time) * (int64_t) TENTH_SECOND_US - *elapsed + us;
+	int tenths = (int) ((left + TENTH_SECOND_US - 1) / TENTH_SECOND_US);
+	*time = IntToTime (tenths);
+	*elapsed = tenths * (int64_t) TENTH_SECOND_US - left;
+}
+
+static Time *ClockTime (Board *board, GameClock clock)
+{
+	switch (clock)
+	{
+		case GAME_CLOCK_SHOT:
+			return &board->shot_clock;
+		case GAME_CLOCK_TIMEOUT:
+			return &board->timeout_clock;
+		default:
+			return &board->main_clock;
+	}
+}
+
+static void UpdateModes (Board *board)
+{
+	if (board->mode != CLOCK)
+		return;
+	// Tenths of seconds once the showing clocks are past their tenths cue
+	board->main_clock_mode = PASSED (board, CUE_MAIN_TENTHS) ? TENTH_SECONDS : NORMAL;
+	if (board->shot_clock_showing)
+		board->shot_clock_mode = PASSED (board, CUE_SHOT_TENTHS) ? TENTH_SECONDS : NORMAL;
+	else
+		board->shot_clock_mode = PASSED (board, CUE_TIMEOUT_TENTHS) ? TENTH_SECONDS : NORMAL;
+}
+
+int BoardBuzzerWanted (const Board *board)
+{
+	// One of the clocks has run out and is still "running", or the timeout clock is at 15 seconds
+	return (board->main_clock_running && PASSED (board, CUE_MAIN_OUT)) ||
+		(board->shot_clock_showing && board->shot_clock_running && PASSED (board, CUE_SHOT_OUT)) ||
+		(!board->shot_clock_showing && board->shot_clock_running && PASSED (board, CUE_TIMEOUT_OUT)) ||
+		(!board->shot_clock_showing && board->shot_clock_running && PASSED (board, CUE_TIMEOUT_WARNING) && !PASSED (board, CUE_TIMEOUT_WARNING_END));
+}
+
+int64_t BoardUntilClockOut (const Board *board)
+{
+	// Only while the game clocks run, see BoardAdvance ()
+	if (board->mode != CLOCK || !board->shot_clock_showing || TimeToInt (board->main_clock) == 0 || TimeToInt (board->shot_clock) == 0)
+		return -1;
+	int64_t until = -1;
+	if (board->main_clock_running)
+		until = TimeToInt (board->main_clock) * (int64_t) TENTH_SECOND_US - board->main_clock_elapsed;
+	if (board->shot_clock_running)
+	{
+		int64_t shot = TimeToInt (board->shot_clock) * (int64_t) TENTH_SECOND_US - board->shot_clock_elapsed;
+		if (until < 0 || shot < until)
+			until = shot;
+	}
+	return until;
+}
+
+static void ApplyClockMode (Board *board, Action action)
+{
+	int team = board->team;
+
+	switch (action)
+	{
+		// Switch between shot clock and timeout clock
+		case ACTION_SWITCH_SHOT_CLOCK:
+			if (!board->shot_clock_running && !board->main_clock_running)
+				board->shot_clock_showing = !board->shot_clock_showing;
+			break;
+		// Start/stop clocks individually
+		case ACTION_START_STOP_MAIN_CLOCK:
+			board->main_clock_running = !board->main_clock_running;
+			break;
+		case ACTION_START_STOP_SHOT_CLOCK:
+			board->shot_clock_running = !board->shot_clock_running;
+			break;
+		// When both clocks are stopped, set both to running; else, set both to stopped
+		case ACTION_START_STOP_CLOCKS:
+			if (!board->main_clock_running && !board->shot_clock_running)
+				board->main_clock_running = 1;
+			else
+				board->main_clock_running = 0;
+			board->shot_clock_running = board->main_clock_running;
+			break;
+		// Reset shot clock (35) or timeout clock (30/60)
+		case ACTION_RESET_SHOT_CLOCK:
+			if (board->shot_clock_showing)
+				board->shot_clock = IntToTime (board->shot_clock_reset);
+			else
+			{
+				if (TimeToInt (board->timeout_clock) == board->timeout_short)
+					board->timeout_clock = IntToTime (board->timeout_long);
+				else
+					board->timeout_clock = IntToTime (board->timeout_short);
+			}
+			break;
+
+		// Changing modes
+		// Home or visitor
+		case ACTION_SELECT_HOME:
+			board->team = HOME;
+			break;
+		case ACTION_SELECT_VISITOR:
+			board->team = VISITOR;
+			break;
+		// Score, fouls, TOL, period
+		case ACTION_SELECT_SCORE:
+			board->change_type = SCORE;
+			break;
+		case ACTION_SELECT_FOULS:
+			board->change_type = FOULS;
+			break;
+		case ACTION_SELECT_TOL:
+			board->change_type = TOL;
+			break;
+		case ACTION_SELECT_PERIOD:
+			board->change_type = PERIOD;
+			break;
+
+		// Change score, fouls, TOL
+		// Check change type: the same buttons will change different values based on this
+		case ACTION_ADD_ONE:
+		case ACTION_ADD_TWO:
+		case ACTION_ADD_THREE:
+		{
+			int points = action - ACTION_ADD_ONE + 1;
+			if (board->change_type == SCORE && board->score[team] + points < 200)
+				board->score[team] += points;
+			break;
+		}
+		case ACTION_INCREMENT:
+			switch (board->change_type)
+			{
+				case SCORE:
+					if (board->score[team] + 1 < 200)
+						board->score[team]++;
+					break;
+				case FOULS:
+					if (board->fouls[team] < 19)
+						board->fouls[team]++;
+					break;
+				case TOL:
+					if (board->tol[team] < 9)
+						board->tol[team]++;
+					break;
+				case PERIOD:
+					if (board->period < 9)
+						board->period++;
+					break;
+			}
+			break;
+		case ACTION_DECREMENT:
+			switch (board->change_type)
+			{
+				case SCORE:
+					if (board->score[team] > 0)
+						board->score[team]--;
+					break;
+				case FOULS:
+					if (board->fouls[team] > 0)
+						board->fouls[team]--;
+					break;
+				case TOL:
+					if (board->tol[team] > 0)
+						board->tol[team]--;
+					break;
+				case PERIOD:
+					if (board->period > -1)
+						board->period--;
+					break;
+			}
+			break;
+
+		// Update edit mode buffers, reset edit mode variables, and enter edit mode
+		case ACTION_ENTER_EDIT_MODE:
+			if (!board->main_clock_running && !board->shot_clock_running)
+			{
+				board->main_clock_buffer = board->main_clock;
+				if (board->shot_clock_showing)
+					board->shot_clock_buffer = board->shot_clock;
+				else
+					board->shot_clock_buffer = board->timeout_clock;
+				board->score_buffer[HOME] = board->score[HOME];
+				board->score_buffer[VISITOR] = board->score[VISITOR];
+				board->selected_digit = 1; // 1-4 = digits 1-4 of the main clock, 5-6 = digits 1-2 of the shot clock
+				board->shot_clock_enabled = 1;
+				board->mode = EDIT_MODE;
+			}
+			break;
+
+		default:
+			break;
+	}
+}
+
+static void ApplyEditMode (Board *board, Action action)
+{
+	switch (action)
+	{
+		// Discard changes and exit edit mode
+		case ACTION_EDIT_DISCARD:
+			board->mode = CLOCK;
+			break;
+		// Save changes by overwriting core variables with the buffers, and exit edit mode
+		case ACTION_EDIT_SAVE:
+			board->main_clock = board->main_clock_buffer;
+			if (board->shot_clock_showing)
+				board->shot_clock = board->shot_clock_buffer;
+			else
+				board->timeout_clock = board->shot_clock_buffer;
+			board->score[HOME] = board->score_buffer[HOME];
+			board->score[VISITOR] = board->score_buffer[VISITOR];
+			board->mode = CLOCK;
+			break;
+		// Switch selected digit left and right
+		case ACTION_EDIT_LEFT:
+			if (board->selected_digit > 1)
+				board->selected_digit--;
+			break;
+		case ACTION_EDIT_RIGHT:
+			if (board->selected_digit < 6)
+				board->selected_digit++;
+			break;
+		// Convenient keys to jump to shot or main clock quickly (first digit)
+		case ACTION_EDIT_MAIN_CLOCK:
+			board->selected_digit = 1;
+			break;
+		case ACTION_EDIT_SHOT_CLOCK:
+			board->selected_digit = 5;
+			break;
+		// Flip mode between normal and tenth seconds
+		// Digits 1-4 are main clock and digits 5-6 are shot clock
+		case ACTION_EDIT_TOGGLE_TENTHS:
+			if (board->selected_digit <= 4)
+				board->main_clock_mode = board->main_clock_mode == NORMAL ? TENTH_SECONDS : NORMAL;
+			else
+				board->shot_clock_mode = board->shot_clock_mode == NORMAL ? TENTH_SECONDS : NORMAL;
+			break;
+		default:
+			// Change numbers
+			if (action >= ACTION_EDIT_DIGIT_0 && action <= ACTION_EDIT_DIGIT_9)
+				ReplaceDigit (board, action - ACTION_EDIT_DIGIT_0);
+			break;
+	}
+}
+
+static void ReplaceDigit (Board *board, int replace_digit)
+{
+	// Move the selected number into the appropriate place in the edit mode buffers
+	// This if-switch-if-else-switch thing is really ugly (╯°□°)╯︵ ┻━┻
+	// TODO: make it look nicer maybe?
+	switch (board->selected_digit)
+	{
+		case 1:
+		case 2:
+		case 3:
+		case 4:
+			if (board->main_clock_mode == NORMAL)
+			{
+				switch (board->selected_digit)
+				{
+					case 1:
+						board->main_clock_buffer.ten_minutes = replace_digit;
+						break;
+					case 2:
+						board->main_clock_buffer.minutes = replace_digit;
+						break;
+					case 3:
+						if (replace_digit < 6)
+							board->main_clock_buffer.ten_seconds = replace_digit;
+						break;
+					case 4:
+						board->main_clock_buffer.seconds = replace_digit;
+						break;
+				}
+			}
+			else
+			{
+				switch (board->selected_digit)
+				{
+					case 1:
+						if (replace_digit < 6)
+							board->main_clock_buffer.ten_seconds = replace_digit;
+						break;
+					case 2:
+						board->main_clock_buffer.seconds = replace_digit;
+						break;
+					case 3:
+						board->main_clock_buffer.tenth_seconds = replace_digit;
+						break;
+					// No case 4: because when it is in tenth seconds mode, the last digit represents nothing
+				}
+			}
+			break;
+		case 5:
+		case 6:
+			if (board->shot_clock_mode == NORMAL)
+			{
+				switch (board->selected_digit)
+				{
+					case 5:
+						board->shot_clock_buffer.ten_seconds = replace_digit;
+						break;
+					case 6:
+						board->shot_clock_buffer.seconds = replace_digit;
+						break;
+				}
+			}
+			else
+			{
+				switch (board->selected_digit)
+				{
+					case 5:
+						board->shot_clock_buffer.seconds = replace_digit;
+						break;
+					case 6:
+						board->shot_clock_buffer.tenth_seconds = replace_digit;
+						break;
+				}
+			}
+			break;
+	}
+}
+
+int TimeToInt (Time time)
+{
+	int int_time = 0;
+	int_time += time.tenth_seconds;
+	int_time += time.seconds * 10;
+	int_time += time.ten_seconds * 100;
+	int_time += time.minutes * 600;
+	int_time += time.ten_minutes * 6000;
+	return int_time;
+}
+
+Time IntToTime (int tenths)
+{
+	Time time;
+	time.ten_minutes = tenths / 6000;
+	time.minutes = (tenths / 600) % 10;
+	time.ten_seconds = (tenths / 100) % 6;
+	time.seconds = (tenths / 10) % 10;
+	time.tenth_seconds = tenths % 10;
+	return time;
+}
+
+Time UpdateTime (Time time)
+{
+	if (time.ten_minutes == 0 && time.minutes == 0 && time.ten_seconds == 0 && time.seconds == 0 && time.tenth_seconds == 0)
+		return time;
+	else if (time.tenth_seconds == 0)
+	{
+		time.tenth_seconds = 9;
+		if (time.seconds == 0)
+		{
+			time.seconds = 9;
+			if (time.ten_seconds == 0)
+			{
+				time.ten_seconds = 5;
+				if (time.minutes == 0)
+				{
+					time.minutes = 9;
+					if (time.ten_minutes != 0)
+						time.ten_minutes--;
+				}
+				else
+					time.minutes--;
+			}
+			else
+				time.ten_seconds--;
+		}
+		else
+			time.seconds--;
+	}
+	else
+		time.tenth_seconds--;
+	return time;
+}
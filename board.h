@@ -0,0 +1,161 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - board logic
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Everything the scoreboard keeps track of, and the actions that change it. Nothing in here knows
+about raylib: input is turned into Actions by the binding table (input.h) and drawing only reads
+the board. The board only changes through BoardAdvance () and BoardApply (), so the same actions
+at the same times always give the same board (see trace.h). In clock mode both keep the
+tenth-second display modes up to date. Everything outside board.c, the scoreboard's own frame
+loop included, gets the board through libscoreboard.h, which keeps its interface stable however
+this one changes; the types and constants here are still shared.
+
+Everything that happens at a set time on a clock is a cue: a clock running out, the change to
+tenths of seconds, the warning horn 15 seconds into a timeout. Each clock has a timer wheel
+(wheel.h) that counts its tenths, and a clock's cues are scheduled on it whenever its time is set,
+so they fire on the exact tenth they are due and nothing checks the clocks every frame. A new cue
+is one more line in the cue table in board.c.
+
+**************************************************************************************************/
+
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <stdint.h>
+#include "wheel.h"
+
+#define HOME    0
+#define VISITOR 1
+
+#define TENTH_SECOND_US 100000 // Microseconds per tenth of a second
+#define WHISTLE_HOLD_US 1000000 // After a whistle stopped the clocks, start/stop presses are taken as a late stop
+
+typedef struct Time { int ten_minutes, minutes, ten_seconds, seconds, tenth_seconds; } Time;
+typedef enum ChangeType { SCORE = 0, FOULS, TOL, PERIOD } ChangeType;
+typedef enum TimerMode { NORMAL = 0, TENTH_SECONDS } TimerMode;
+typedef enum Mode { CLOCK = 0, EDIT_MODE } Mode;
+typedef enum GameClock { GAME_CLOCK_MAIN = 0, GAME_CLOCK_SHOT, GAME_CLOCK_TIMEOUT, GAME_CLOCK_COUNT } GameClock;
+
+// When they are due is in the cue table in board.c
+typedef enum Cue
+{
+	CUE_MAIN_TENTHS = 0, // Main clock under a minute
+	CUE_MAIN_OUT,
+	CUE_SHOT_TENTHS, // Shot clock under 10 seconds
+	CUE_SHOT_OUT,
+	CUE_TIMEOUT_TENTHS,
+	CUE_TIMEOUT_WARNING, // 15 seconds left, the horn sounds for a second
+	CUE_TIMEOUT_WARNING_END,
+	CUE_TIMEOUT_OUT,
+	CUE_COUNT
+} Cue;
+
+typedef enum Action
+{
+	ACTION_NONE = 0,
+	ACTION_TOGGLE_FULLSCREEN, // Handled by the window, not the board
+	// Clock mode
+	ACTION_START_STOP_CLOCKS,
+	ACTION_START_STOP_SHOT_CLOCK,
+	ACTION_START_STOP_MAIN_CLOCK,
+	ACTION_SWITCH_SHOT_CLOCK,
+	ACTION_RESET_SHOT_CLOCK,
+	ACTION_SELECT_HOME,
+	ACTION_SELECT_VISITOR,
+	ACTION_SELECT_SCORE,
+	ACTION_SELECT_FOULS,
+	ACTION_SELECT_TOL,
+	ACTION_SELECT_PERIOD,
+	ACTION_INCREMENT,
+	ACTION_DECREMENT,
+	ACTION_ADD_ONE,
+	ACTION_ADD_TWO,
+	ACTION_ADD_THREE,
+	ACTION_ENTER_EDIT_MODE,
+	// Edit mode
+	ACTION_EDIT_DISCARD,
+	ACTION_EDIT_SAVE,
+	ACTION_EDIT_LEFT,
+	ACTION_EDIT_RIGHT,
+	ACTION_EDIT_MAIN_CLOCK,
+	ACTION_EDIT_SHOT_CLOCK,
+	ACTION_EDIT_TOGGLE_TENTHS,
+	ACTION_EDIT_DIGIT_0, // ACTION_EDIT_DIGIT_0 + n replaces the selected digit with n
+	ACTION_EDIT_DIGIT_9 = ACTION_EDIT_DIGIT_0 + 9,
+	ACTION_COUNT
+} Action;
+
+typedef struct Board
+{
+	// Control variables
+	int team; // Selected team to change data
+	ChangeType change_type; // Selected type of data to change
+	Mode mode; // Scoreboard mode: clock or edit mode
+	TimerMode main_clock_mode; // Controls whether time is displayed as normal or tenth seconds
+	TimerMode shot_clock_mode;
+	int shot_clock_showing; // 0 = timeout clock showing; 1 = shot clock showing
+	int shot_clock_enabled; // Shot clock enabled - whether to display or not
+	int shot_clock_running; // Main/shot clock running - whether to update time
+	int main_clock_running;
+	int64_t shot_clock_elapsed; // Real time (us) since the clock last went down by 0.1 seconds
+	int64_t main_clock_elapsed;
+	int64_t timeout_clock_elapsed;
+	int64_t main_clock_run_us; // Real time run since the clock was last started or set, most BoardStopClocksAt () gives back
+	int64_t shot_clock_run_us;
+	int64_t whistle_hold_us; // Left of WHISTLE_HOLD_US
+
+	// Game data
+	Time main_clock; // Stores actual time for main/shot clocks
+	Time shot_clock; // Not directly displayed
+	Time timeout_clock; // For timeouts
+	int score[2];
+	int fouls[2]; // Stores actual score, fouls, timeouts left, period
+	int tol[2]; // Directly displayed on the board
+	int period;
+
+	// Edit mode buffers + pointer
+	Time main_clock_buffer; // Buffers for edit mode (user chooses to save or discard)
+	Time shot_clock_buffer;
+	int score_buffer[2]; // TODO: Currently unused, may be used in the future
+	int selected_digit; // Selected digit; 1-4 = main; 5-6 = shot
+
+	// Reset times in tenths of seconds (from the config file)
+	int shot_clock_reset;
+	int timeout_short;
+	int timeout_long;
+
+	// Cues, on one wheel per clock counting its tenths
+	TimerWheel cue_wheels[GAME_CLOCK_COUNT];
+	unsigned int cues_passed; // Bit (1 << cue) per cue whose time has come
+} Board;
+
+void BoardInit (Board *board, int main_clock_start, int shot_clock_reset, int timeout_short, int timeout_long);
+void BoardAdvance (Board *board, int64_t elapsed_us); // Run the clocks for elapsed_us of real time
+void BoardApply (Board *board, Action action); // Apply one operator action
+int BoardStopClocksAt (Board *board, int64_t ago_us); // Stop the game clocks as they were ago_us earlier, giving back what they ran since; returns 0 if neither was running
+void BoardSetResetTimes (Board *board, int shot_clock_reset, int timeout_short, int timeout_long);
+int BoardBuzzerWanted (const Board *board); // Whether a clock has run out or the timeout warning is due
+void BoardScheduleCues (Board *board); // After setting a clock directly instead of through BoardApply ()
+int64_t BoardUntilClockOut (const Board *board); // Real time (us) until the main or shot clock runs out, -1 = neither is running
+
+int TimeToInt (Time time); // Returns time in tenths of seconds (int)
+Time IntToTime (int tenths); // Inverse of TimeToInt
+Time UpdateTime (Time time); // Decrements time by one tenth second
+
+#endif
@@ -1 +1,18 @@
-gcc main.c -Wall -lraylib -lGL -lm -lpthread -ldl -lrt -lX11 -o scoreboard
+gcc libscoreboard.c board.c wheel.c -Wall -O2 -shared -fPIC -fvisibility=hidden -Wl,-soname,libscoreboard.so.1 -o libscoreboard.so.1 && ln -sf libscoreboard.so.1 libscoreboard.so
+gcc main.c hub75.c digit.c assets.c label.c config.c input.c trace.c stats.c shm.c pacing.c http.c sync.c evdev.c whistle.c serial.c framering.c capture.c metrics.c wall.c log.c watchdog.c -Wall -L. -lscoreboard -Wl,-rpath,'$ORIGIN' -lraylib -lGL -lm -lpthread -ldl -lrt -lX11 -o scoreboard
+gcc replay.c trace.c stats.c -Wall -O2 -L. -lscoreboard -Wl,-rpath,'$ORIGIN' -o replay
+gcc soak.c -Wall -O2 -L. -lscoreboard -Wl,-rpath,'$ORIGIN' -lpthread -o soak
+gcc season.c stats.c -Wall -O2 -o season
+gcc shmbench.c shm.c -Wall -O2 -lpthread -lrt -o shmbench
+gcc httpload.c http.c shm.c metrics.c -Wall -O2 -lpthread -lrt -o httpload
+gcc synctest.c sync.c -Wall -O2 -lpthread -o synctest
+gcc walltest.c wall.c -Wall -O2 -lpthread -o walltest
+gcc evdevdump.c evdev.c config.c input.c -Wall -O2 -L. -lscoreboard -Wl,-rpath,'$ORIGIN' -lpthread -o evdevdump
+gcc whistlebench.c whistle.c -Wall -O2 -lm -lpthread -o whistlebench
+gcc serialmon.c serial.c shm.c -Wall -O2 -lpthread -lrt -o serialmon
+gcc logbench.c log.c -Wall -O2 -lpthread -o logbench
+gcc stalltest.c watchdog.c shm.c log.c metrics.c -Wall -O2 -L. -lscoreboard -Wl,-rpath,'$ORIGIN' -lpthread -lrt -o stalltest
+gcc sdffont.c -Wall -O2 -lraylib -lGL -lm -lpthread -ldl -lrt -lX11 -o sdffont
+gcc ringbench.c framering.c -Wall -O2 -lpthread -o ringbench
+gcc hub75bench.c hub75.c -Wall -O2 -lm -lpthread -o hub75bench
+gcc termboard.c term.c digit.c shm.c -Wall -O2 -lpthread -lrt -o termboard
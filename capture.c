@@ -0,0 +1,148 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - asynchronous frame capture
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+**************************************************************************************************/
+
+#define GL_GLEXT_PROTOTYPES
+#include <string.h>
+#include <unistd.h>
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include "capture.h"
+#include "rlgl.h"
+
+static void Collect (Capture *capture);
+
+int CaptureInit (Capture *capture, FrameRing *ring, CaptureSink sink, void *sink_data)
+{
+	memset (capture, 0, sizeof (*capture));
+	capture->ring = ring;
+	capture->sink = sink;
+	capture->sink_data = sink_data;
+	for (int i = 0; i < CAPTURE_BUFFERS; i++)
+	{
+		glGenBuffers (1, &capture->buffers[i].pbo);
+		if (capture->buffers[i].pbo == 0)
+		{
+			CaptureClose (capture);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+void CaptureFrame (Capture *capture, int width, int height, int64_t time_us)
+{
+	Collect (capture);
+
+	CaptureBuffer *buffer = NULL;
+	for (int i = 0; i < CAPTURE_BUFFERS && buffer == NULL; i++)
+		if (capture->buffers[i].state == CAPTURE_FREE)
+			buffer = &capture->buffers[i];
+	if (buffer == NULL)
+	{
+		capture->skipped++;
+		return;
+	}
+
+	// What raylib still has batched has to be drawn before the copy
+	rlDrawRenderBatchActive ();
+	glBindBuffer (GL_PIXEL_PACK_BUFFER, buffer->pbo);
+	if (buffer->width != width || buffer->height != height)
+	{
+		glBufferData (GL_PIXEL_PACK_BUFFER, (GLsizeiptr) width * height * 4, NULL, GL_STREAM_READ);
+		buffer->width = width;
+		buffer->height = height;
+	}
+	glPixelStorei (GL_PACK_ALIGNMENT, 4);
+	glReadPixels (0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+	buffer->fence = glFenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	buffer->time_us = time_us;
+	buffer->state = CAPTURE_READING;
+}
+
+void CaptureClose (Capture *capture)
+{
+	for (int i = 0; i < CAPTURE_BUFFERS; i++)
+	{
+		CaptureBuffer *buffer = &capture->buffers[i];
+		if (buffer->state == CAPTURE_READING)
+			glDeleteSync ((GLsync) buffer->fence);
+		if (buffer->state == CAPTURE_MAPPED)
+		{
+			glBindBuffer (GL_PIXEL_PACK_BUFFER, buffer->pbo);
+			glUnmapBuffer (GL_PIXEL_PACK_BUFFER);
+		}
+		if (buffer->pbo)
+			glDeleteBuffers (1, &buffer->pbo);
+	}
+	glBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+	memset (capture->buffers, 0, sizeof (capture->buffers));
+}
+
+void CaptureRelease (Capture *capture)
+{
+	// The ring's and the sink's threads may still be reading mapped frames, they are done with them within a frame or two
+	for (int i = 0; i < CAPTURE_BUFFERS; i++)
+		while (capture->buffers[i].state == CAPTURE_MAPPED && !(atomic_load (&capture->buffers[i].done) && atomic_load (&capture->buffers[i].sink_done)))
+			usleep (1000);
+	CaptureClose (capture);
+}
+
+static void Collect (Capture *capture)
+{
+	for (int i = 0; i < CAPTURE_BUFFERS; i++)
+	{
+		CaptureBuffer *buffer = &capture->buffers[i];
+
+		// Compressed and sent, the buffer can take the next frame
+		if (buffer->state == CAPTURE_MAPPED && atomic_load (&buffer->done) && atomic_load (&buffer->sink_done))
+		{
+			glBindBuffer (GL_PIXEL_PACK_BUFFER, buffer->pbo);
+			glUnmapBuffer (GL_PIXEL_PACK_BUFFER);
+			buffer->state = CAPTURE_FREE;
+		}
+
+		// Copied, a timeout of 0 only asks whether the fence has passed
+		if (buffer->state == CAPTURE_READING && glClientWaitSync ((GLsync) buffer->fence, 0, 0) != GL_TIMEOUT_EXPIRED)
+		{
+			glDeleteSync ((GLsync) buffer->fence);
+			glBindBuffer (GL_PIXEL_PACK_BUFFER, buffer->pbo);
+			void *pixels = glMapBufferRange (GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr) buffer->width * buffer->height * 4, GL_MAP_READ_BIT);
+			buffer->state = CAPTURE_FREE;
+			if (pixels == NULL)
+				continue;
+			atomic_store (&buffer->sink_done, capture->sink == NULL);
+			if (capture->sink)
+				capture->sink (capture->sink_data, pixels, buffer->width, buffer->height, &buffer->sink_done);
+			atomic_store (&buffer->done, 0);
+			FrameRingJob job = {pixels, buffer->width, buffer->height, buffer->time_us, &buffer->done};
+			if (capture->ring && FrameRingSubmit (capture->ring, &job) == 0)
+				capture->captured++;
+			else
+				atomic_store (&buffer->done, 1);
+			// Unmapped here or on a later frame, once both are done with it
+			if (atomic_load (&buffer->done) && atomic_load (&buffer->sink_done))
+				glUnmapBuffer (GL_PIXEL_PACK_BUFFER);
+			else
+				buffer->state = CAPTURE_MAPPED;
+		}
+	}
+	glBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+}
@@ -0,0 +1,69 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - asynchronous frame capture
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Reads each finished frame back from the GPU for the replay ring (framering.h) and the HUB75 output
+(hub75.h) without waiting for it. CaptureFrame () is called just before EndDrawing (): it starts a
+copy of the back buffer into one of CAPTURE_BUFFERS pixel buffer objects and puts a fence behind
+it. A frame or two later the fence has passed and the buffer is mapped and handed to the sink, if
+any, and the ring's compressing thread. Both may keep the pixels past the call; once both have
+said they are done with them the buffer is unmapped and used again. Nothing here blocks on the
+GPU; when every buffer is still busy the frame is simply not captured and counted in skipped.
+
+**************************************************************************************************/
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "framering.h"
+
+#define CAPTURE_BUFFERS 4
+
+typedef void (*CaptureSink) (void *data, const unsigned char *rgba, int width, int height, _Atomic int *done); // Rows bottom-up, valid until *done is set, from any thread
+
+typedef enum CaptureState { CAPTURE_FREE = 0, CAPTURE_READING, CAPTURE_MAPPED } CaptureState;
+
+typedef struct CaptureBuffer
+{
+	unsigned int pbo;
+	void *fence; // GLsync while READING
+	CaptureState state;
+	int width, height; // Size of the storage and of the frame in it
+	int64_t time_us;
+	_Atomic int done; // Set by the ring when it has compressed the mapped pixels
+	_Atomic int sink_done; // Set by the sink when it has read them
+} CaptureBuffer;
+
+typedef struct Capture
+{
+	FrameRing *ring; // NULL = no replay, only the sink
+	CaptureSink sink; // NULL = only the ring
+	void *sink_data;
+	CaptureBuffer buffers[CAPTURE_BUFFERS];
+	unsigned long captured, skipped; // Frames that reached the ring, frames not read back
+} Capture;
+
+int CaptureInit (Capture *capture, FrameRing *ring, CaptureSink sink, void *sink_data); // Needs the window's GL context; returns 0 on success
+void CaptureFrame (Capture *capture, int width, int height, int64_t time_us); // Call before EndDrawing ()
+void CaptureClose (Capture *capture); // After FrameRingClose () and the sink has stopped, before the window closes
+void CaptureRelease (Capture *capture); // Like CaptureClose () with the ring and the sink still running, to rebuild the window
+
+#endif
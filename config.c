@@ -0,0 +1,442 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - configuration file and hot reload
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+**************************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include "config.h"
+#include "board.h"
+
+typedef struct KeyName { const char *name; int key; } KeyName;
+
+static const KeyName key_names[] =
+{
+	{"SPACE", KEY_SPACE}, {"ENTER", KEY_ENTER}, {"TAB", KEY_TAB}, {"BACKSPACE", KEY_BACKSPACE},
+	{"INSERT", KEY_INSERT}, {"DELETE", KEY_DELETE}, {"HOME", KEY_HOME}, {"END", KEY_END},
+	{"PAGE_UP", KEY_PAGE_UP}, {"PAGE_DOWN", KEY_PAGE_DOWN},
+	{"LEFT", KEY_LEFT}, {"RIGHT", KEY_RIGHT}, {"UP", KEY_UP}, {"DOWN", KEY_DOWN},
+	{"LEFT_SHIFT", KEY_LEFT_SHIFT}, {"LEFT_CONTROL", KEY_LEFT_CONTROL}, {"LEFT_ALT", KEY_LEFT_ALT},
+	{"RIGHT_SHIFT", KEY_RIGHT_SHIFT}, {"RIGHT_CONTROL", KEY_RIGHT_CONTROL}, {"RIGHT_ALT", KEY_RIGHT_ALT},
+	{"MINUS", KEY_MINUS}, {"EQUAL", KEY_EQUAL}, {"SLASH", KEY_SLASH}, {"BACKSLASH", KEY_BACKSLASH},
+	{"COMMA", KEY_COMMA}, {"PERIOD", KEY_PERIOD}, {"SEMICOLON", KEY_SEMICOLON}, {"APOSTROPHE", KEY_APOSTROPHE},
+	{"LEFT_BRACKET", KEY_LEFT_BRACKET}, {"RIGHT_BRACKET", KEY_RIGHT_BRACKET}, {"GRAVE", KEY_GRAVE},
+	{"F1", KEY_F1}, {"F2", KEY_F2}, {"F3", KEY_F3}, {"F4", KEY_F4}, {"F5", KEY_F5}, {"F6", KEY_F6},
+	{"F7", KEY_F7}, {"F8", KEY_F8}, {"F9", KEY_F9}, {"F10", KEY_F10}, {"F11", KEY_F11}, {"F12", KEY_F12},
+	{"KP_ADD", KEY_KP_ADD}, {"KP_SUBTRACT", KEY_KP_SUBTRACT}, {"KP_ENTER", KEY_KP_ENTER},
+	{NULL, 0}
+};
+
+static const char *binding_names[BIND_COUNT] =
+{
+	"key_toggle_fullscreen",
+	"key_start_stop_clocks",
+	"key_start_stop_shot_clock",
+	"key_start_stop_main_clock",
+	"key_switch_shot_clock",
+	"key_reset_shot_clock",
+	"key_sound_buzzer",
+	"key_changing_home",
+	"key_changing_visitor",
+	"key_change_mode_period",
+	"key_change_mode_score",
+	"key_change_mode_fouls",
+	"key_change_mode_tol",
+	"key_dump_replay"
+};
+
+// Actions a button can be set to; digits and edit mode moves are left to the keyboard
+typedef struct ActionName { const char *name; int action; } ActionName;
+
+static const ActionName action_names[] =
+{
+	{"start_stop_clocks", ACTION_START_STOP_CLOCKS}, {"start_stop_shot_clock", ACTION_START_STOP_SHOT_CLOCK},
+	{"start_stop_main_clock", ACTION_START_STOP_MAIN_CLOCK}, {"switch_shot_clock", ACTION_SWITCH_SHOT_CLOCK},
+	{"reset_shot_clock", ACTION_RESET_SHOT_CLOCK}, {"select_home", ACTION_SELECT_HOME},
+	{"select_visitor", ACTION_SELECT_VISITOR}, {"select_score", ACTION_SELECT_SCORE},
+	{"select_fouls", ACTION_SELECT_FOULS}, {"select_tol", ACTION_SELECT_TOL}, {"select_period", ACTION_SELECT_PERIOD},
+	{"increment", ACTION_INCREMENT}, {"decrement", ACTION_DECREMENT},
+	{"add_one", ACTION_ADD_ONE}, {"add_two", ACTION_ADD_TWO}, {"add_three", ACTION_ADD_THREE},
+	{"toggle_fullscreen", ACTION_TOGGLE_FULLSCREEN}, {"buzzer", CONFIG_BUTTON_BUZZER},
+	{NULL, 0}
+};
+
+static int ParseKey (const char *value, int *key);
+static int ParseButton (const char *value, unsigned char *actions);
+static void SetButton (Config *config, int button, int first, int second, int third);
+static int ParseColor (const char *value, Color *color);
+static int ParseTime (const char *value, int max_tenths, int *tenths);
+static void *WatchThread (void *data);
+
+void ConfigDefaults (Config *config)
+{
+	memset (config, 0, sizeof (*config));
+	config->keys[BIND_TOGGLE_FULLSCREEN] = KEY_F11;
+	config->keys[BIND_START_STOP_CLOCKS] = KEY_SPACE;
+	config->keys[BIND_START_STOP_SHOT_CLOCK] = KEY_LEFT_CONTROL;
+	config->keys[BIND_START_STOP_MAIN_CLOCK] = KEY_RIGHT_CONTROL;
+	config->keys[BIND_SWITCH_SHOT_CLOCK] = KEY_LEFT_ALT;
+	config->keys[BIND_RESET_SHOT_CLOCK] = KEY_LEFT_SHIFT;
+	config->keys[BIND_SOUND_BUZZER] = KEY_G;
+	config->keys[BIND_CHANGING_HOME] = KEY_H;
+	config->keys[BIND_CHANGING_VISITOR] = KEY_V;
+	config->keys[BIND_CHANGE_MODE_PERIOD] = KEY_P;
+	config->keys[BIND_CHANGE_MODE_SCORE] = KEY_S;
+	config->keys[BIND_CHANGE_MODE_FOULS] = KEY_F;
+	config->keys[BIND_CHANGE_MODE_TOL] = KEY_T;
+	config->keys[BIND_DUMP_REPLAY] = KEY_F9;
+	config->edit_color = (Color){130, 33, 55, 255};
+	config->edit_timeout_color = (Color){128, 101, 0, 255};
+	config->shot_clock_reset = 350;
+	config->timeout_short = 300;
+	config->timeout_long = 600;
+	config->main_clock_start = 4800;
+	config->target_fps = 0; // Follow the display refresh
+	strcpy (config->home_name, "HOME");
+	strcpy (config->visitor_name, "VISITOR");
+
+	// An eight button box: clocks and buzzer on top, baskets for each team below
+	SetButton (config, 1, ACTION_START_STOP_CLOCKS, ACTION_NONE, ACTION_NONE);
+	SetButton (config, 2, ACTION_START_STOP_SHOT_CLOCK, ACTION_NONE, ACTION_NONE);
+	SetButton (config, 3, ACTION_RESET_SHOT_CLOCK, ACTION_NONE, ACTION_NONE);
+	SetButton (config, 4, CONFIG_BUTTON_BUZZER, ACTION_NONE, ACTION_NONE);
+	SetButton (config, 5, ACTION_SELECT_HOME, ACTION_SELECT_SCORE, ACTION_ADD_TWO);
+	SetButton (config, 6, ACTION_SELECT_HOME, ACTION_SELECT_SCORE, ACTION_ADD_THREE);
+	SetButton (config, 7, ACTION_SELECT_VISITOR, ACTION_SELECT_SCORE, ACTION_ADD_TWO);
+	SetButton (config, 8, ACTION_SELECT_VISITOR, ACTION_SELECT_SCORE, ACTION_ADD_THREE);
+}
+
+int ConfigLoad (Config *config, const char *path)
+{
+	FILE *file = fopen (path, "r");
+	if (file == NULL)
+		return -1;
+
+	char line[512];
+	int line_number = 0;
+	while (fgets (line, sizeof (line), file) != NULL)
+	{
+		line_number++;
+		// Strip trailing whitespace, skip blank lines and comments ('#' only at the start, colours use it too)
+		char *end = line + strlen (line);
+		while (end > line && isspace ((unsigned char) end[-1]))
+			*--end = '\0';
+
+		char *name = line;
+		while (isspace ((unsigned char) *name))
+			name++;
+		if (*name == '\0' || *name == '#')
+			continue;
+		char *value = strchr (name, '=');
+		if (value == NULL)
+		{
+			fprintf (stderr, "%s:%d: expected 'name = value'\n", path, line_number);
+			continue;
+		}
+		end = value;
+		*value++ = '\0';
+		while (end > name && isspace ((unsigned char) end[-1]))
+			*--end = '\0';
+		while (isspace ((unsigned char) *value))
+			value++;
+
+		int ok = -1;
+		int binding = 0;
+		while (binding < BIND_COUNT && strcmp (name, binding_names[binding]) != 0)
+			binding++;
+		if (binding < BIND_COUNT)
+			ok = ParseKey (value, &config->keys[binding]);
+		else if (strcmp (name, "edit_color") == 0)
+			ok = ParseColor (value, &config->edit_color);
+		else if (strcmp (name, "edit_timeout_color") == 0)
+			ok = ParseColor (value, &config->edit_timeout_color);
+		else if (strcmp (name, "shot_clock_reset") == 0)
+			ok = ParseTime (value, CONFIG_SHOT_CLOCK_MAX, &config->shot_clock_reset);
+		else if (strcmp (name, "timeout_short") == 0)
+			ok = ParseTime (value, CONFIG_SHOT_CLOCK_MAX, &config->timeout_short);
+		else if (strcmp (name, "timeout_long") == 0)
+			ok = ParseTime (value, CONFIG_SHOT_CLOCK_MAX, &config->timeout_long);
+		else if (strcmp (name, "main_clock_start") == 0)
+			ok = ParseTime (value, CONFIG_MAIN_CLOCK_MAX, &config->main_clock_start);
+		else if (strcmp (name, "target_fps") == 0)
+		{
+			int fps = atoi (value);
+			if (fps >= 0 && fps <= 1000)
+			{
+				config->target_fps = fps;
+				ok = 0;
+			}
+		}
+		else if (strncmp (name, "button_", 7) == 0 && atoi (name + 7) >= 1 && atoi (name + 7) <= CONFIG_BUTTONS)
+			ok = ParseButton (value, config->buttons[atoi (name + 7) - 1]);
+		else if (strcmp (name, "home_name") == 0)
+			ok = snprintf (config->home_name, CONFIG_NAME_LENGTH, "%s", value) < CONFIG_NAME_LENGTH ? 0 : -1;
+		else if (strcmp (name, "visitor_name") == 0)
+			ok = snprintf (config->visitor_name, CONFIG_NAME_LENGTH, "%s", value) < CONFIG_NAME_LENGTH ? 0 : -1;
+		else if (strcmp (name, "home_logo") == 0)
+			ok = snprintf (config->home_logo, CONFIG_PATH_LENGTH, "%s", value) < CONFIG_PATH_LENGTH ? 0 : -1;
+		else if (strcmp (name, "visitor_logo") == 0)
+			ok = snprintf (config->visitor_logo, CONFIG_PATH_LENGTH, "%s", value) < CONFIG_PATH_LENGTH ? 0 : -1;
+		else
+		{
+			fprintf (stderr, "%s:%d: unknown setting '%s'\n", path, line_number, name);
+			continue;
+		}
+		if (ok != 0)
+			fprintf (stderr, "%s:%d: bad value '%s' for '%s'\n", path, line_number, value, name);
+	}
+	fclose (file);
+	return 0;
+}
+
+int ConfigWatchStart (ConfigWatcher *watcher, const char *path)
+{
+	char directory[CONFIG_PATH_LENGTH];
+
+	memset (watcher, 0, sizeof (*watcher));
+	atomic_init (&watcher->pending, NULL);
+	watcher->inotify_fd = -1;
+	watcher->stop_fd = -1;
+	if (snprintf (watcher->path, sizeof (watcher->path), "%s", path) >= (int) sizeof (watcher->path))
+		return -1;
+
+	// Watch the directory rather than the file: editors usually save by renaming a new file over the old one
+	strcpy (directory, watcher->path);
+	char *slash = strrchr (directory, '/');
+	if (slash == NULL)
+		strcpy (directory, ".");
+	else if (slash == directory)
+		slash[1] = '\0';
+	else
+		*slash = '\0';
+
+	watcher->inotify_fd = inotify_init1 (IN_CLOEXEC);
+	watcher->stop_fd = eventfd (0, EFD_CLOEXEC);
+	if (watcher->inotify_fd < 0 || watcher->stop_fd < 0 ||
+		inotify_add_watch (watcher->inotify_fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0 ||
+		pthread_create (&watcher->thread, NULL, WatchThread, watcher) != 0)
+	{
+		if (watcher->inotify_fd >= 0)
+			close (watcher->inotify_fd);
+		if (watcher->stop_fd >= 0)
+			close (watcher->stop_fd);
+		watcher->inotify_fd = -1;
+		watcher->stop_fd = -1;
+		return -1;
+	}
+	return 0;
+}
+
+Config *ConfigPoll (ConfigWatcher *watcher)
+{
+	// Cheap load first so the common case (nothing new) never writes the shared cache line
+	if (atomic_load_explicit (&watcher->pending, memory_order_relaxed) == NULL)
+		return NULL;
+	return atomic_exchange_explicit (&watcher->pending, NULL, memory_order_acquire);
+}
+
+void ConfigWatchStop (ConfigWatcher *watcher)
+{
+	if (watcher->stop_fd < 0)
+		return;
+	uint64_t one = 1;
+	if (write (watcher->stop_fd, &one, sizeof (one)) == sizeof (one))
+		pthread_join (watcher->thread, NULL);
+	close (watcher->inotify_fd);
+	close (watcher->stop_fd);
+	watcher->inotify_fd = -1;
+	watcher->stop_fd = -1;
+	free (atomic_exchange (&watcher->pending, NULL));
+}
+
+static void *WatchThread (void *data)
+{
+	ConfigWatcher *watcher = data;
+	const char *file_name = strrchr (watcher->path, '/');
+	file_name = file_name != NULL ? file_name + 1 : watcher->path;
+	// inotify_event is followed by a variable length name, keep the buffer aligned for it
+	char buffer[4096] __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+
+	while (1)
+	{
+		struct pollfd fds[2] = {{watcher->inotify_fd, POLLIN, 0}, {watcher->stop_fd, POLLIN, 0}};
+		if (poll (fds, 2, -1) < 0)
+			continue;
+		if (fds[1].revents)
+			break;
+
+		ssize_t length = read (watcher->inotify_fd, buffer, sizeof (buffer));
+		int changed = 0;
+		for (char *next = buffer; length > 0 && next < buffer + length; )
+		{
+			struct inotify_event *event = (struct inotify_event *) next;
+			if (event->len > 0 && strcmp (event->name, file_name) == 0)
+				changed = 1;
+			next += sizeof (struct inotify_event) + event->len;
+		}
+		if (!changed)
+			continue;
+
+		// Parse from defaults so deleting a line puts that setting back
+		Config *config = malloc (sizeof (Config));
+		if (config == NULL)
+			continue;
+		ConfigDefaults (config);
+		if (ConfigLoad (config, watcher->path) != 0)
+		{
+			free (config);
+			continue;
+		}
+		// If the render thread has not picked up the previous reload yet, it is simply replaced
+		free (atomic_exchange_explicit (&watcher->pending, config, memory_order_release));
+	}
+	return NULL;
+}
+
+const char *ConfigActionName (int action)
+{
+	for (int i = 0; action_names[i].name != NULL; i++)
+		if (action_names[i].action == action)
+			return action_names[i].name;
+	return NULL;
+}
+
+static void SetButton (Config *config, int button, int first, int second, int third)
+{
+	unsigned char *actions = config->buttons[button - 1];
+	actions[0] = (unsigned char) first;
+	actions[1] = (unsigned char) second;
+	actions[2] = (unsigned char) third;
+	actions[3] = ACTION_NONE;
+}
+
+// "action, action, ..." or "none"
+static int ParseButton (const char *value, unsigned char *actions)
+{
+	unsigned char parsed[CONFIG_BUTTON_ACTIONS] = {ACTION_NONE};
+	int count = 0;
+	if (strcasecmp (value, "none") != 0)
+	{
+		const char *start = value;
+		while (*start != '\0')
+		{
+			while (isspace ((unsigned char) *start))
+				start++;
+			size_t length = strcspn (start, ",");
+			size_t trimmed = length;
+			while (trimmed > 0 && isspace ((unsigned char) start[trimmed - 1]))
+				trimmed--;
+			int found = -1;
+			for (int i = 0; action_names[i].name != NULL; i++)
+				if (strlen (action_names[i].name) == trimmed && strncasecmp (start, action_names[i].name, trimmed) == 0)
+					found = action_names[i].action;
+			if (found < 0 || count == CONFIG_BUTTON_ACTIONS)
+				return -1;
+			parsed[count++] = (unsigned char) found;
+			start += length;
+			if (*start == ',')
+				start++;
+		}
+	}
+	memcpy (actions, parsed, sizeof (parsed));
+	return 0;
+}
+
+static int ParseKey (const char *value, int *key)
+{
+	// Single letters and digits map straight to their raylib codes
+	if (value[0] != '\0' && value[1] == '\0' && isalnum ((unsigned char) value[0]))
+	{
+		*key = toupper ((unsigned char) value[0]);
+		return 0;
+	}
+	for (int i = 0; key_names[i].name != NULL; i++)
+		if (strcasecmp (value, key_names[i].name) == 0)
+		{
+			*key = key_names[i].key;
+			return 0;
+		}
+	// Anything else can still be bound with its raw key code
+	char *end;
+	long code = strtol (value, &end, 10);
+	if (*end != '\0' || end == value || code <= 0 || code >= 512)
+		return -1;
+	*key = (int) code;
+	return 0;
+}
+
+static int ParseColor (const char *value, Color *color)
+{
+	unsigned int r, g, b, a = 255;
+	if (value[0] == '#')
+	{
+		if (strlen (value) != 7 || sscanf (value + 1, "%2x%2x%2x", &r, &g, &b) != 3)
+			return -1;
+	}
+	else if (sscanf (value, "%u , %u , %u , %u", &r, &g, &b, &a) < 3)
+		return -1;
+	if (r > 255 || g > 255 || b > 255 || a > 255)
+		return -1;
+	*color = (Color){(unsigned char) r, (unsigned char) g, (unsigned char) b, (unsigned char) a};
+	return 0;
+}
+
+static int ParseTime (const char *value, int max_tenths, int *tenths)
+{
+	// Accepts m:ss, m:ss.t, ss and ss.t, and nothing else after them
+	// %d would also take signs and spaces, so every number has to start with a digit, and
+	// no more digits than a time up to 99:59.9 has, so it can not overflow either
+	int minutes = 0, seconds = 0, tenth = 0, used = 0;
+	const char *colon = strchr (value, ':');
+	size_t digits = strspn (value, "0123456789");
+	if (digits == 0 || digits > (colon ? 2 : 4))
+		return -1;
+	if (colon && (!isdigit ((unsigned char) colon[1]) || strspn (colon + 1, "0123456789") > 2))
+		return -1;
+	if (colon)
+	{
+		if (sscanf (value, "%d:%d%n", &minutes, &seconds, &used) != 2 || seconds >= 60)
+			return -1;
+	}
+	else if (sscanf (value, "%d%n", &seconds, &used) != 1)
+		return -1;
+	if (value[used] == '.')
+	{
+		if (!isdigit ((unsigned char) value[used + 1]))
+			return -1;
+		tenth = value[used + 1] - '0';
+		used += 2;
+	}
+	if (value[used] != '\0')
+		return -1;
+	if (minutes < 0 || minutes > 99 || seconds < 0 || tenth < 0)
+		return -1;
+	int total = (minutes * 60 + seconds) * 10 + tenth;
+	if (total > max_tenths)
+		return -1;
+	*tenths = total;
+	return 0;
+}
@@ -0,0 +1,96 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - configuration file and hot reload
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+The config file is plain "name = value" lines, lines starting with '#' are comments. See 'scoreboard.conf'.
+A watcher thread waits on inotify for the file to be saved, parses it into a fresh Config and
+leaves it in a single pending slot. The render thread picks it up with ConfigPoll () between
+frames, so a reload is one pointer swap and never blocks a frame.
+
+**************************************************************************************************/
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "raylib.h"
+
+#define CONFIG_NAME_LENGTH 64
+#define CONFIG_PATH_LENGTH 256
+#define CONFIG_BUTTONS 32 // Button box buttons (evdev.h), button_1 to button_32
+#define CONFIG_BUTTON_ACTIONS 4 // Actions one button can apply, in order
+#define CONFIG_BUTTON_BUZZER 255 // Button sounds the buzzer while held, instead of an Action
+#define CONFIG_MAIN_CLOCK_MAX 59999 // Tenths of seconds, 99:59.9 on the main clock's four digits
+#define CONFIG_SHOT_CLOCK_MAX 999 // 99.9 on the two digits the shot and timeout clocks share
+
+// Rebindable keys, one per KEY_* action
+typedef enum Binding
+{
+	BIND_TOGGLE_FULLSCREEN = 0,
+	BIND_START_STOP_CLOCKS,
+	BIND_START_STOP_SHOT_CLOCK,
+	BIND_START_STOP_MAIN_CLOCK,
+	BIND_SWITCH_SHOT_CLOCK,
+	BIND_RESET_SHOT_CLOCK,
+	BIND_SOUND_BUZZER,
+	BIND_CHANGING_HOME,
+	BIND_CHANGING_VISITOR,
+	BIND_CHANGE_MODE_PERIOD,
+	BIND_CHANGE_MODE_SCORE,
+	BIND_CHANGE_MODE_FOULS,
+	BIND_CHANGE_MODE_TOL,
+	BIND_DUMP_REPLAY,
+	BIND_COUNT
+} Binding;
+
+typedef struct Config
+{
+	int keys[BIND_COUNT]; // raylib key codes
+	Color edit_color; // Selected main clock digit in edit mode
+	Color edit_timeout_color; // Selected timeout clock digit in edit mode
+	int shot_clock_reset; // Times in tenths of seconds
+	int timeout_short;
+	int timeout_long;
+	int main_clock_start;
+	int target_fps; // 0 = one frame per display refresh (VSync)
+	char home_name[CONFIG_NAME_LENGTH];
+	char visitor_name[CONFIG_NAME_LENGTH];
+	char home_logo[CONFIG_PATH_LENGTH];
+	char visitor_logo[CONFIG_PATH_LENGTH];
+	unsigned char buttons[CONFIG_BUTTONS][CONFIG_BUTTON_ACTIONS]; // Actions (board.h) per button, ACTION_NONE ends the list
+} Config;
+
+typedef struct ConfigWatcher
+{
+	char path[CONFIG_PATH_LENGTH];
+	_Atomic (Config *) pending; // Parsed but not yet picked up by the render thread
+	int inotify_fd;
+	int stop_fd; // eventfd used to wake the watcher on shutdown
+	pthread_t thread;
+} ConfigWatcher;
+
+void ConfigDefaults (Config *config);
+int ConfigLoad (Config *config, const char *path); // Parses over the current values, returns 0 on success
+int ConfigWatchStart (ConfigWatcher *watcher, const char *path); // Returns 0 on success
+Config *ConfigPoll (ConfigWatcher *watcher); // Newly reloaded config or NULL; caller owns it (free ())
+void ConfigWatchStop (ConfigWatcher *watcher);
+const char *ConfigActionName (int action); // Name used in button_N settings, NULL if it has none
+
+#endif
@@ -0,0 +1,66 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - seven-segment digit model
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+**************************************************************************************************/
+
+#include "digit.h"
+
+#define PART(part) (1u << (part))
+#define ALL_CORNERS (PART (DIGIT_TOP_LEFT_CORNER) | PART (DIGIT_MIDDLE_LEFT_CORNER) | PART (DIGIT_BOTTOM_LEFT_CORNER) | PART (DIGIT_TOP_RIGHT_CORNER) | PART (DIGIT_MIDDLE_RIGHT_CORNER) | PART (DIGIT_BOTTOM_RIGHT_CORNER))
+#define RIGHT_CORNERS (PART (DIGIT_TOP_RIGHT_CORNER) | PART (DIGIT_MIDDLE_RIGHT_CORNER) | PART (DIGIT_BOTTOM_RIGHT_CORNER))
+
+static const unsigned int lit_parts[10] =
+{
+	PART (DIGIT_TOP) | PART (DIGIT_BOTTOM) | PART (DIGIT_TOP_LEFT) | PART (DIGIT_BOTTOM_LEFT) | PART (DIGIT_TOP_RIGHT) | PART (DIGIT_BOTTOM_RIGHT) | ALL_CORNERS,
+	PART (DIGIT_TOP_RIGHT) | PART (DIGIT_BOTTOM_RIGHT) | RIGHT_CORNERS,
+	PART (DIGIT_TOP) | PART (DIGIT_MIDDLE) | PART (DIGIT_BOTTOM) | PART (DIGIT_BOTTOM_LEFT) | PART (DIGIT_TOP_RIGHT) | ALL_CORNERS,
+	PART (DIGIT_TOP) | PART (DIGIT_MIDDLE) | PART (DIGIT_BOTTOM) | PART (DIGIT_TOP_RIGHT) | PART (DIGIT_BOTTOM_RIGHT) | ALL_CORNERS,
+	PART (DIGIT_MIDDLE) | PART (DIGIT_TOP_LEFT) | PART (DIGIT_TOP_RIGHT) | PART (DIGIT_BOTTOM_RIGHT) | PART (DIGIT_TOP_LEFT_CORNER) | PART (DIGIT_MIDDLE_LEFT_CORNER) | RIGHT_CORNERS,
+	PART (DIGIT_TOP) | PART (DIGIT_MIDDLE) | PART (DIGIT_BOTTOM) | PART (DIGIT_TOP_LEFT) | PART (DIGIT_BOTTOM_RIGHT) | ALL_CORNERS,
+	PART (DIGIT_TOP) | PART (DIGIT_MIDDLE) | PART (DIGIT_BOTTOM) | PART (DIGIT_TOP_LEFT) | PART (DIGIT_BOTTOM_LEFT) | PART (DIGIT_BOTTOM_RIGHT) | ALL_CORNERS,
+	PART (DIGIT_TOP) | PART (DIGIT_TOP_RIGHT) | PART (DIGIT_BOTTOM_RIGHT) | PART (DIGIT_TOP_LEFT_CORNER) | RIGHT_CORNERS,
+	PART (DIGIT_TOP) | PART (DIGIT_MIDDLE) | PART (DIGIT_BOTTOM) | PART (DIGIT_TOP_LEFT) | PART (DIGIT_BOTTOM_LEFT) | PART (DIGIT_TOP_RIGHT) | PART (DIGIT_BOTTOM_RIGHT) | ALL_CORNERS,
+	PART (DIGIT_TOP) | PART (DIGIT_MIDDLE) | PART (DIGIT_BOTTOM) | PART (DIGIT_TOP_LEFT) | PART (DIGIT_TOP_RIGHT) | PART (DIGIT_BOTTOM_RIGHT) | ALL_CORNERS
+};
+
+static const DigitRect part_rects[DIGIT_PART_COUNT] =
+{
+	{1, 0, 3, 1}, {1, 4, 3, 1}, {1, 8, 3, 1}, // Top, middle, bottom
+	{0, 1, 1, 3}, {0, 5, 1, 3}, {4, 1, 1, 3}, {4, 5, 1, 3}, // Left and right sides
+	{0, 0, 1, 1}, {0, 4, 1, 1}, {0, 8, 1, 1}, {4, 0, 1, 1}, {4, 4, 1, 1}, {4, 8, 1, 1} // Corners
+};
+
+unsigned int DigitLitParts (int digit, int use_all)
+{
+	// A leading zero stays dark
+	if (digit < 0 || digit > 9 || (digit == 0 && !use_all))
+		return 0;
+	return lit_parts[digit];
+}
+
+int DigitPartShown (DigitPart part, int use_all)
+{
+	if (use_all)
+		return 1;
+	return part == DIGIT_TOP_RIGHT || part == DIGIT_BOTTOM_RIGHT || part == DIGIT_TOP_RIGHT_CORNER || part == DIGIT_MIDDLE_RIGHT_CORNER || part == DIGIT_BOTTOM_RIGHT_CORNER;
+}
+
+DigitRect DigitPartRect (DigitPart part)
+{
+	return part_rects[part];
+}
@@ -0,0 +1,66 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - seven-segment digit model
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+The digits on the board, shared by DrawDigit () (main.c) and the terminal board (term.h) so both
+light the same parts. A digit is 5 x 9 units, a unit being a fifth of its width: seven segments of
+3 x 1 or 1 x 3 units and six corner squares between them, lit or off (dark gray) per digit.
+
+	 c ----- c
+	 |       |
+	 c ----- c
+	 |       |
+	 c ----- c
+
+With use_all 0 only the right column is drawn, for a leading 1 squeezed in front of two digits.
+
+**************************************************************************************************/
+
+#ifndef DIGIT_H
+#define DIGIT_H
+
+#define DIGIT_UNITS_WIDE 5
+#define DIGIT_UNITS_HIGH 9
+
+// In the order DrawDigit () draws them
+typedef enum DigitPart
+{
+	DIGIT_TOP = 0,
+	DIGIT_MIDDLE,
+	DIGIT_BOTTOM,
+	DIGIT_TOP_LEFT,
+	DIGIT_BOTTOM_LEFT,
+	DIGIT_TOP_RIGHT,
+	DIGIT_BOTTOM_RIGHT,
+	DIGIT_TOP_LEFT_CORNER,
+	DIGIT_MIDDLE_LEFT_CORNER,
+	DIGIT_BOTTOM_LEFT_CORNER,
+	DIGIT_TOP_RIGHT_CORNER,
+	DIGIT_MIDDLE_RIGHT_CORNER,
+	DIGIT_BOTTOM_RIGHT_CORNER,
+	DIGIT_PART_COUNT
+} DigitPart;
+
+typedef struct DigitRect { int x, y, width, height; } DigitRect; // In units from the top left of the digit
+
+unsigned int DigitLitParts (int digit, int use_all); // Bit (1 << part) per lit part; anything but 0-9 lights nothing
+int DigitPartShown (DigitPart part, int use_all);
+DigitRect DigitPartRect (DigitPart part);
+
+#endif
@@ -0,0 +1,303 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - direct input devices
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+**************************************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <linux/input.h>
+#include "evdev.h"
+
+// raylib.h can not be included next to linux/input.h (both name their keys KEY_*), so the raylib
+// codes are written out; they are GLFW's, printable keys are their ASCII capitals
+static const short raylib_keys[KEY_CNT] =
+{
+	[KEY_APOSTROPHE] = 39, [KEY_COMMA] = 44, [KEY_MINUS] = 45, [KEY_DOT] = 46, [KEY_SLASH] = 47,
+	[KEY_0] = 48, [KEY_1] = 49, [KEY_2] = 50, [KEY_3] = 51, [KEY_4] = 52,
+	[KEY_5] = 53, [KEY_6] = 54, [KEY_7] = 55, [KEY_8] = 56, [KEY_9] = 57,
+	[KEY_SEMICOLON] = 59, [KEY_EQUAL] = 61,
+	[KEY_A] = 65, [KEY_B] = 66, [KEY_C] = 67, [KEY_D] = 68, [KEY_E] = 69, [KEY_F] = 70, [KEY_G] = 71,
+	[KEY_H] = 72, [KEY_I] = 73, [KEY_J] = 74, [KEY_K] = 75, [KEY_L] = 76, [KEY_M] = 77, [KEY_N] = 78,
+	[KEY_O] = 79, [KEY_P] = 80, [KEY_Q] = 81, [KEY_R] = 82, [KEY_S] = 83, [KEY_T] = 84, [KEY_U] = 85,
+	[KEY_V] = 86, [KEY_W] = 87, [KEY_X] = 88, [KEY_Y] = 89, [KEY_Z] = 90,
+	[KEY_LEFTBRACE] = 91, [KEY_BACKSLASH] = 92, [KEY_RIGHTBRACE] = 93, [KEY_GRAVE] = 96,
+	[KEY_SPACE] = 32, [KEY_ESC] = 256, [KEY_ENTER] = 257, [KEY_TAB] = 258, [KEY_BACKSPACE] = 259,
+	[KEY_INSERT] = 260, [KEY_DELETE] = 261, [KEY_RIGHT] = 262, [KEY_LEFT] = 263, [KEY_DOWN] = 264,
+	[KEY_UP] = 265, [KEY_PAGEUP] = 266, [KEY_PAGEDOWN] = 267, [KEY_HOME] = 268, [KEY_END] = 269,
+	[KEY_CAPSLOCK] = 280, [KEY_SCROLLLOCK] = 281, [KEY_NUMLOCK] = 282, [KEY_SYSRQ] = 283, [KEY_PAUSE] = 284,
+	[KEY_F1] = 290, [KEY_F2] = 291, [KEY_F3] = 292, [KEY_F4] = 293, [KEY_F5] = 294, [KEY_F6] = 295,
+	[KEY_F7] = 296, [KEY_F8] = 297, [KEY_F9] = 298, [KEY_F10] = 299, [KEY_F11] = 300, [KEY_F12] = 301,
+	[KEY_KP0] = 320, [KEY_KP1] = 321, [KEY_KP2] = 322, [KEY_KP3] = 323, [KEY_KP4] = 324,
+	[KEY_KP5] = 325, [KEY_KP6] = 326, [KEY_KP7] = 327, [KEY_KP8] = 328, [KEY_KP9] = 329,
+	[KEY_KPDOT] = 330, [KEY_KPSLASH] = 331, [KEY_KPASTERISK] = 332, [KEY_KPMINUS] = 333,
+	[KEY_KPPLUS] = 334, [KEY_KPENTER] = 335, [KEY_KPEQUAL] = 336,
+	[KEY_LEFTSHIFT] = 340, [KEY_LEFTCTRL] = 341, [KEY_LEFTALT] = 342, [KEY_LEFTMETA] = 343,
+	[KEY_RIGHTSHIFT] = 344, [KEY_RIGHTCTRL] = 345, [KEY_RIGHTALT] = 346, [KEY_RIGHTMETA] = 347,
+	[KEY_COMPOSE] = 348
+};
+
+typedef struct EvdevSource
+{
+	int fd;
+	int recorded; // A file played back, not a device
+	int64_t base_us; // Added to a recorded event's time to get when it plays
+	struct input_event next; // Recorded event waiting for its time
+	int has_next;
+} EvdevSource;
+
+static void *InputThread (void *data);
+static void Handle (EvdevInput *input, const struct input_event *event, int64_t time_us);
+static int ReadRecorded (EvdevSource *source);
+static int ButtonNumber (int code);
+static int64_t EventTime (const struct input_event *event);
+static int64_t Now (void);
+
+int EvdevStart (EvdevInput *input, const char *const *paths, int count)
+{
+	memset (input, 0, sizeof (*input));
+	input->stop_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+	input->sources = calloc (EVDEV_DEVICES_MAX, sizeof (EvdevSource));
+	if (input->stop_fd < 0 || input->sources == NULL)
+	{
+		EvdevStop (input);
+		return -1;
+	}
+
+	for (int i = 0; i < count && input->source_count < EVDEV_DEVICES_MAX; i++)
+	{
+		EvdevSource *source = &input->sources[input->source_count];
+		struct stat info;
+		source->fd = open (paths[i], O_RDONLY | O_CLOEXEC);
+		if (source->fd < 0 || fstat (source->fd, &info) != 0)
+		{
+			fprintf (stderr, "Could not open input device '%s': %s\n", paths[i], strerror (errno));
+			if (source->fd >= 0)
+				close (source->fd);
+			continue;
+		}
+		if (S_ISREG (info.st_mode))
+		{
+			// Recorded stream: the first event plays now, the rest keep their spacing
+			source->recorded = 1;
+			if (ReadRecorded (source) != 0)
+			{
+				fprintf (stderr, "Input recording '%s' is empty\n", paths[i]);
+				close (source->fd);
+				continue;
+			}
+			source->base_us = Now () - EventTime (&source->next);
+		}
+		else
+		{
+			// Kernel timestamps on the same clock as InputNow (), and keys only go here, not to X11
+			int clock = CLOCK_MONOTONIC;
+			fcntl (source->fd, F_SETFL, O_NONBLOCK);
+			if (ioctl (source->fd, EVIOCSCLOCKID, &clock) != 0)
+				fprintf (stderr, "Input device '%s' has no monotonic timestamps\n", paths[i]);
+			if (ioctl (source->fd, EVIOCGRAB, 1) != 0)
+				fprintf (stderr, "Could not grab input device '%s', its keys may arrive twice\n", paths[i]);
+		}
+		input->source_count++;
+	}
+	if (input->source_count == 0 || pthread_create (&input->thread, NULL, InputThread, input) != 0)
+	{
+		EvdevStop (input);
+		return -1;
+	}
+	return 0;
+}
+
+void EvdevStop (EvdevInput *input)
+{
+	if (input->thread)
+	{
+		uint64_t one = 1;
+		if (write (input->stop_fd, &one, sizeof (one)) == sizeof (one))
+			pthread_join (input->thread, NULL);
+		input->thread = 0;
+	}
+	for (int i = 0; i < input->source_count; i++)
+		if (input->sources[i].fd >= 0)
+		{
+			if (!input->sources[i].recorded)
+				ioctl (input->sources[i].fd, EVIOCGRAB, 0);
+			close (input->sources[i].fd);
+		}
+	if (input->stop_fd >= 0)
+		close (input->stop_fd);
+	free (input->sources);
+	input->sources = NULL;
+	input->source_count = 0;
+	input->stop_fd = -1;
+}
+
+int EvdevPoll (EvdevInput *input, EvdevEvent *event)
+{
+	unsigned int tail = atomic_load_explicit (&input->tail, memory_order_relaxed);
+	if (tail == atomic_load_explicit (&input->head, memory_order_acquire))
+		return 0;
+	*event = input->queue[tail % EVDEV_QUEUE];
+	atomic_store_explicit (&input->tail, tail + 1, memory_order_release);
+	return 1;
+}
+
+static void *InputThread (void *data)
+{
+	EvdevInput *input = data;
+	struct pollfd fds[EVDEV_DEVICES_MAX + 1];
+	struct input_event events[64];
+
+	while (1)
+	{
+		// Play recorded events that are due, and find out when the next one is
+		int64_t now = Now ();
+		int64_t next_us = -1;
+		int open_count = 0, fd_count = 0;
+		for (int i = 0; i < input->source_count; i++)
+		{
+			EvdevSource *source = &input->sources[i];
+			if (source->fd < 0)
+				continue;
+			open_count++;
+			if (!source->recorded)
+			{
+				fds[fd_count++] = (struct pollfd) {source->fd, POLLIN, 0};
+				continue;
+			}
+			while (source->has_next && source->base_us + EventTime (&source->next) <= now)
+			{
+				Handle (input, &source->next, source->base_us + EventTime (&source->next));
+				if (ReadRecorded (source) != 0)
+				{
+					close (source->fd);
+					source->fd = -1;
+					open_count--;
+				}
+			}
+			if (source->has_next && (next_us < 0 || source->base_us + EventTime (&source->next) < next_us))
+				next_us = source->base_us + EventTime (&source->next);
+		}
+		if (open_count == 0)
+		{
+			atomic_store (&input->finished, 1);
+			break;
+		}
+
+		fds[fd_count] = (struct pollfd) {input->stop_fd, POLLIN, 0};
+		int timeout = next_us < 0 ? -1 : (int) ((next_us - now + 999) / 1000);
+		if (poll (fds, (nfds_t) fd_count + 1, timeout) < 0 && errno != EINTR)
+			break;
+		if (fds[fd_count].revents)
+			break;
+
+		for (int i = 0, f = 0; i < input->source_count; i++)
+		{
+			EvdevSource *source = &input->sources[i];
+			if (source->fd < 0 || source->recorded)
+				continue;
+			short revents = fds[f++].revents;
+			if (revents & (POLLERR | POLLHUP | POLLNVAL))
+			{
+				// Unplugged
+				fprintf (stderr, "Input device unplugged\n");
+				close (source->fd);
+				source->fd = -1;
+				continue;
+			}
+			if (!(revents & POLLIN))
+				continue;
+			ssize_t got;
+			while ((got = read (source->fd, events, sizeof (events))) > 0)
+				for (size_t e = 0; e < (size_t) got / sizeof (events[0]); e++)
+					Handle (input, &events[e], EventTime (&events[e]));
+		}
+	}
+	return NULL;
+}
+
+static void Handle (EvdevInput *input, const struct input_event *event, int64_t time_us)
+{
+	// Presses and releases only; the board has no use for auto-repeat
+	if (event->type != EV_KEY || (event->value != 0 && event->value != 1))
+		return;
+
+	EvdevEvent out = {.time_us = time_us, .down = event->value};
+	int button = ButtonNumber (event->code);
+	if (button > 0)
+	{
+		out.kind = EVDEV_BUTTON;
+		out.code = button;
+	}
+	else if (event->code < KEY_CNT && raylib_keys[event->code] != 0)
+	{
+		out.kind = EVDEV_KEY;
+		out.code = raylib_keys[event->code];
+	}
+	else
+		return;
+
+	unsigned int head = atomic_load_explicit (&input->head, memory_order_relaxed);
+	if (head - atomic_load_explicit (&input->tail, memory_order_acquire) >= EVDEV_QUEUE)
+	{
+		atomic_fetch_add (&input->dropped, 1);
+		return;
+	}
+	input->queue[head % EVDEV_QUEUE] = out;
+	atomic_store_explicit (&input->head, head + 1, memory_order_release);
+}
+
+static int ReadRecorded (EvdevSource *source)
+{
+	source->has_next = read (source->fd, &source->next, sizeof (source->next)) == sizeof (source->next);
+	return source->has_next ? 0 : -1;
+}
+
+// Button boxes show up as BTN_0.., joystick (BTN_TRIGGER..) or gamepad (BTN_SOUTH..) buttons, all
+// counted from 1, and encoders with more than 16 buttons go on with BTN_TRIGGER_HAPPY
+static int ButtonNumber (int code)
+{
+	int button = 0;
+	if ((code >= BTN_MISC && code < BTN_MISC + 16) || (code >= BTN_JOYSTICK && code < BTN_JOYSTICK + 16) ||
+		(code >= BTN_GAMEPAD && code < BTN_GAMEPAD + 16))
+		button = (code & 0x0f) + 1;
+	else if (code >= BTN_TRIGGER_HAPPY && code <= BTN_TRIGGER_HAPPY40)
+		button = code - BTN_TRIGGER_HAPPY + 17;
+	return button <= EVDEV_BUTTONS ? button : 0;
+}
+
+static int64_t EventTime (const struct input_event *event)
+{
+	return (int64_t) event->input_event_sec * 1000000 + event->input_event_usec;
+}
+
+static int64_t Now (void)
+{
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
@@ -0,0 +1,76 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - direct input devices
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Reads keyboards and USB button boxes straight from /dev/input/event* (--evdev PATH), on its own
+thread, without X11 or the window having focus. Devices are grabbed so their keys do not also
+arrive through raylib. Every press keeps the kernel's CLOCK_MONOTONIC timestamp (the same clock as
+InputNow ()), so the render loop can apply it at the moment it happened instead of at the frame.
+
+Keyboard keys come out as raylib key codes and go through the usual bindings (input.h). Buttons
+(BTN_0.., joystick and gamepad buttons, then BTN_TRIGGER_HAPPY for the 17th on) come out numbered
+from 1 and are mapped to actions by the button_N settings in the config file.
+
+A path that is a regular file instead of a device is a recorded event stream (raw struct
+input_event, e.g. 'cat /dev/input/event3 > box.events'); it is played back in real time as if the
+device was plugged in, so input can be tested without one.
+
+Events go to the render thread through a single producer, single consumer ring.
+
+**************************************************************************************************/
+
+#ifndef EVDEV_H
+#define EVDEV_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define EVDEV_DEVICES_MAX 8
+#define EVDEV_QUEUE 256 // Power of two
+#define EVDEV_BUTTONS 32 // Buttons past this are ignored
+
+typedef enum EvdevKind { EVDEV_KEY, EVDEV_BUTTON } EvdevKind;
+
+typedef struct EvdevEvent
+{
+	int64_t time_us; // Kernel timestamp, CLOCK_MONOTONIC
+	EvdevKind kind;
+	int code; // raylib key code, or button number from 1
+	int down; // 1 pressed, 0 released
+} EvdevEvent;
+
+typedef struct EvdevInput
+{
+	pthread_t thread;
+	int stop_fd;
+	struct EvdevSource *sources;
+	int source_count;
+	EvdevEvent queue[EVDEV_QUEUE];
+	_Atomic unsigned int head; // Written by the input thread
+	_Atomic unsigned int tail; // Written by the render thread
+	_Atomic unsigned long dropped; // Queue was full
+	_Atomic int finished; // Every source is closed or played to the end
+} EvdevInput;
+
+int EvdevStart (EvdevInput *input, const char *const *paths, int count); // Returns 0 if any source opened
+int EvdevPoll (EvdevInput *input, EvdevEvent *event); // Takes the oldest event, returns 0 if there is none
+void EvdevStop (EvdevInput *input);
+
+#endif
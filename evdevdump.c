@@ -0,0 +1,169 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - direct input test
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Reads input devices or recorded event streams the way --evdev does (evdev.h) and prints every key
+and button with the actions it maps to, applying them to a board so a recorded game can be checked
+without a window. Also the way to find out which number each button of a new button box has.
+
+	evdevdump [--config PATH] [--quiet] DEVICE|RECORDING...
+
+Stops at the end of the recordings, or with Ctrl-C for devices.
+
+**************************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <getopt.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include "libscoreboard.h"
+#include "config.h"
+#include "input.h"
+#include "evdev.h"
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void Apply (Scoreboard *board, const BindingTable *bindings, const Config *config, const EvdevEvent *event, int quiet);
+static void OnInterrupt (int signal_number);
+
+int main (int argc, char *argv[])
+{
+	const char *config_path = "scoreboard.conf";
+	int quiet = 0;
+	static struct option long_options[] =
+	{
+		{"config", required_argument, 0, 'c'},
+		{"quiet", no_argument, 0, 'q'},
+		{0, 0, 0, 0}
+	};
+
+	int c;
+	while ((c = getopt_long (argc, argv, "", long_options, NULL)) != -1)
+	{
+		switch (c)
+		{
+			case 'c': config_path = optarg; break;
+			case 'q': quiet = 1; break;
+			default:
+				fprintf (stderr, "usage: %s [--config PATH] [--quiet] DEVICE|RECORDING...\n", argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+	if (optind == argc)
+	{
+		fprintf (stderr, "usage: %s [--config PATH] [--quiet] DEVICE|RECORDING...\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	Config config;
+	ConfigDefaults (&config);
+	ConfigLoad (&config, config_path);
+	BindingTable bindings;
+	BindingsBuild (&bindings, &config);
+	Scoreboard *board = ScoreboardNew (config.main_clock_start, config.shot_clock_reset, config.timeout_short, config.timeout_long);
+	if (board == NULL)
+		return EXIT_FAILURE;
+
+	EvdevInput input;
+	if (EvdevStart (&input, (const char *const *) argv + optind, argc - optind) != 0)
+		return EXIT_FAILURE;
+	signal (SIGINT, OnInterrupt);
+
+	// The board runs on the event times, like the render loop does
+	int64_t start_us = InputNow ();
+	int64_t board_us = start_us;
+	long events = 0;
+	int64_t latency_sum = 0, latency_max = 0;
+	while (!interrupted)
+	{
+		EvdevEvent event;
+		if (!EvdevPoll (&input, &event))
+		{
+			if (atomic_load (&input.finished) && !EvdevPoll (&input, &event))
+				break;
+			usleep (1000);
+			continue;
+		}
+		int64_t latency = InputNow () - event.time_us;
+		latency_sum += latency;
+		if (latency > latency_max)
+			latency_max = latency;
+		events++;
+		if (event.time_us > board_us)
+		{
+			ScoreboardStep (board, event.time_us - board_us, SCOREBOARD_ACTION_NONE);
+			board_us = event.time_us;
+		}
+		if (!quiet)
+			printf ("%9.3f  +%5.3f ms  %-6s %3d %-4s", (event.time_us - start_us) / 1e6, latency / 1000.0,
+				event.kind == EVDEV_KEY ? "key" : "button", event.code, event.down ? "down" : "up");
+		Apply (board, &bindings, &config, &event, quiet);
+	}
+	ScoreboardStep (board, InputNow () - board_us, SCOREBOARD_ACTION_NONE);
+	ScoreboardView view;
+	ScoreboardRead (board, &view);
+	ScoreboardFree (board);
+	unsigned long dropped = atomic_load (&input.dropped);
+	EvdevStop (&input);
+
+	int main_clock = view.main_clock, shot_clock = view.shot_clock;
+	printf ("%ld events, %lu dropped, read %.3f ms after the kernel on average, %.3f ms at most\n", events, dropped,
+		events ? latency_sum / 1000.0 / events : 0.0, latency_max / 1000.0);
+	printf ("score %d-%d, fouls %d-%d, TOL %d-%d, period %d, main clock %d:%02d.%d, shot clock %d.%d\n",
+		view.score[HOME], view.score[VISITOR], view.fouls[HOME], view.fouls[VISITOR], view.tol[HOME], view.tol[VISITOR],
+		view.period, main_clock / 600, main_clock / 10 % 60, main_clock % 10, shot_clock / 10, shot_clock % 10);
+	return EXIT_SUCCESS;
+}
+
+static void Apply (Scoreboard *board, const BindingTable *bindings, const Config *config, const EvdevEvent *event, int quiet)
+{
+	ScoreboardView view;
+	ScoreboardRead (board, &view);
+	unsigned char actions[CONFIG_BUTTON_ACTIONS] = {ACTION_NONE};
+	if (event->kind == EVDEV_BUTTON)
+		for (int i = 0; i < CONFIG_BUTTON_ACTIONS; i++)
+			actions[i] = config->buttons[event->code - 1][i];
+	else if (event->code == config->keys[BIND_SOUND_BUZZER])
+		actions[0] = CONFIG_BUTTON_BUZZER;
+	else if (event->down)
+		actions[0] = (unsigned char) BindingLookup (bindings, (Mode) view.mode, event->code);
+
+	for (int i = 0; i < CONFIG_BUTTON_ACTIONS && actions[i] != ACTION_NONE; i++)
+	{
+		if (!event->down && actions[i] != CONFIG_BUTTON_BUZZER)
+			continue;
+		const char *name = ConfigActionName (actions[i]);
+		if (!quiet && name)
+			printf (" %s", name);
+		else if (!quiet)
+			printf (" action %d", actions[i]);
+		if (event->down && actions[i] != CONFIG_BUTTON_BUZZER && actions[i] != ACTION_TOGGLE_FULLSCREEN)
+			ScoreboardStep (board, 0, actions[i]);
+	}
+	if (!quiet)
+		putchar ('\n');
+}
+
+static void OnInterrupt (int signal_number)
+{
+	(void) signal_number;
+	interrupted = 1;
+}
@@ -0,0 +1,461 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - replay ring of rendered frames
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+**************************************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include "framering.h"
+
+#define MIN_RUN 3 // Shorter runs are cheaper as literals
+
+typedef struct FrameRingFrame
+{
+	struct FrameRingFrame *next;
+	int64_t time_us;
+	int width, height;
+	int key;
+	size_t size;
+	unsigned char data[];
+} FrameRingFrame;
+
+static void *CompressThread (void *data);
+static void *DumpThread (void *data);
+static void Compress (FrameRing *ring, const FrameRingJob *job);
+static void Evict (FrameRing *ring);
+static int WriteY4m (FILE *file, const uint32_t *pixels, int width, int height, int scale, unsigned char *planes);
+static unsigned char *PutVarint (unsigned char *p, uint64_t value);
+static int64_t Now (void);
+
+int FrameRingInit (FrameRing *ring, size_t max_bytes, int64_t max_age_us)
+{
+	memset (ring, 0, sizeof (*ring));
+	ring->max_bytes = max_bytes;
+	ring->max_age_us = max_age_us;
+	pthread_mutex_init (&ring->lock, NULL);
+	pthread_cond_init (&ring->wake, NULL);
+	if (pthread_create (&ring->thread, NULL, CompressThread, ring) != 0)
+	{
+		pthread_cond_destroy (&ring->wake);
+		pthread_mutex_destroy (&ring->lock);
+		return -1;
+	}
+	return 0;
+}
+
+int FrameRingSubmit (FrameRing *ring, const FrameRingJob *job)
+{
+	pthread_mutex_lock (&ring->lock);
+	if (ring->queued == FRAME_RING_QUEUE)
+	{
+		ring->skipped++;
+		pthread_mutex_unlock (&ring->lock);
+		return -1;
+	}
+	ring->queue[ring->queued++] = *job;
+	pthread_cond_signal (&ring->wake);
+	pthread_mutex_unlock (&ring->lock);
+	return 0;
+}
+
+int FrameRingDump (FrameRing *ring, const char *path)
+{
+	if (atomic_exchange (&ring->dumping, 1))
+		return -1;
+	if (ring->dump_joinable)
+		pthread_join (ring->dump_thread, NULL);
+	snprintf (ring->dump_path, sizeof (ring->dump_path), "%s", path);
+	ring->dump_joinable = (pthread_create (&ring->dump_thread, NULL, DumpThread, ring) == 0);
+	if (!ring->dump_joinable)
+	{
+		atomic_store (&ring->dumping, 0);
+		return -1;
+	}
+	return 0;
+}
+
+int FrameRingSeconds (FrameRing *ring)
+{
+	pthread_mutex_lock (&ring->lock);
+	int seconds = ring->oldest ? (int) ((ring->newest->time_us - ring->oldest->time_us) / 1000000) : 0;
+	pthread_mutex_unlock (&ring->lock);
+	return seconds;
+}
+
+void FrameRingClose (FrameRing *ring)
+{
+	// Frames still queued are compressed first so their buffers are handed back
+	pthread_mutex_lock (&ring->lock);
+	ring->stopping = 1;
+	pthread_cond_signal (&ring->wake);
+	pthread_mutex_unlock (&ring->lock);
+	pthread_join (ring->thread, NULL);
+	if (ring->dump_joinable)
+		pthread_join (ring->dump_thread, NULL);
+
+	while (ring->oldest)
+	{
+		FrameRingFrame *next = ring->oldest->next;
+		free (ring->oldest);
+		ring->oldest = next;
+	}
+	free (ring->previous);
+	free (ring->scratch);
+	pthread_cond_destroy (&ring->wake);
+	pthread_mutex_destroy (&ring->lock);
+}
+
+size_t FrameRingEncode (const uint32_t *pixels, const uint32_t *previous, size_t count, unsigned char *out)
+{
+	unsigned char *p = out;
+	size_t i = 0, literal_start = 0;
+	while (i < count)
+	{
+		// Length of the run of equal (XORed) pixels starting here
+		uint32_t value = previous ? pixels[i] ^ previous[i] : pixels[i];
+		size_t run = 1;
+		while (i + run < count && (previous ? pixels[i + run] ^ previous[i + run] : pixels[i + run]) == value)
+			run++;
+		if (run < MIN_RUN && i + run < count)
+		{
+			i += run;
+			continue;
+		}
+		if (run < MIN_RUN)
+		{
+			i = count;
+			run = 0;
+		}
+
+		// Literals collected so far, then the run
+		if (i > literal_start)
+		{
+			p = PutVarint (p, (uint64_t) (i - literal_start - 1) << 1 | 1);
+			for (size_t j = literal_start; j < i; j++)
+			{
+				uint32_t literal = previous ? pixels[j] ^ previous[j] : pixels[j];
+				memcpy (p, &literal, 4);
+				p += 4;
+			}
+		}
+		if (run > 0)
+		{
+			p = PutVarint (p, (uint64_t) (run - 1) << 1);
+			memcpy (p, &value, 4);
+			p += 4;
+			i += run;
+		}
+		literal_start = i;
+	}
+	return (size_t) (p - out);
+}
+
+int FrameRingDecode (const unsigned char *data, size_t size, uint32_t *pixels, size_t count)
+{
+	const unsigned char *p = data, *end = data + size;
+	size_t i = 0;
+	while (p < end)
+	{
+		uint64_t token = 0;
+		int shift = 0;
+		do
+		{
+			if (p == end || shift > 63)
+				return -1;
+			token |= (uint64_t) (*p & 0x7f) << shift;
+			shift += 7;
+		} while (*p++ & 0x80);
+
+		uint64_t length = (token >> 1) + 1;
+		if (length > count - i)
+			return -1;
+		if (token & 1)
+		{
+			if ((uint64_t) (end - p) < length * 4)
+				return -1;
+			for (uint64_t j = 0; j < length; j++, p += 4)
+			{
+				uint32_t value;
+				memcpy (&value, p, 4);
+				pixels[i++] ^= value;
+			}
+		}
+		else
+		{
+			if (end - p < 4)
+				return -1;
+			uint32_t value;
+			memcpy (&value, p, 4);
+			p += 4;
+			if (value != 0)
+				for (uint64_t j = 0; j < length; j++)
+					pixels[i + j] ^= value;
+			i += length;
+		}
+	}
+	return i == count ? 0 : -1;
+}
+
+static void *CompressThread (void *data)
+{
+	FrameRing *ring = data;
+	pthread_mutex_lock (&ring->lock);
+	while (1)
+	{
+		while (ring->queued == 0 && !ring->stopping)
+			pthread_cond_wait (&ring->wake, &ring->lock);
+		if (ring->queued == 0)
+			break;
+		FrameRingJob job = ring->queue[0];
+		pthread_mutex_unlock (&ring->lock);
+
+		Compress (ring, &job);
+
+		pthread_mutex_lock (&ring->lock);
+		memmove (ring->queue, ring->queue + 1, (size_t) (ring->queued - 1) * sizeof (FrameRingJob));
+		ring->queued--;
+	}
+	pthread_mutex_unlock (&ring->lock);
+	return NULL;
+}
+
+static void Compress (FrameRing *ring, const FrameRingJob *job)
+{
+	int64_t start = Now ();
+	size_t count = (size_t) job->width * job->height;
+	int key = ring->previous == NULL || job->width != ring->width || job->height != ring->height || job->time_us - ring->key_us >= FRAME_RING_KEY_US;
+	if (job->width != ring->width || job->height != ring->height)
+	{
+		free (ring->previous);
+		free (ring->scratch);
+		ring->scratch_size = count * 4 + count / 64 + 16;
+		ring->previous = malloc (count * 4);
+		ring->scratch = malloc (ring->scratch_size);
+		ring->width = ring->height = 0;
+		if (ring->previous == NULL || ring->scratch == NULL)
+		{
+			free (ring->previous);
+			free (ring->scratch);
+			ring->previous = ring->scratch = NULL;
+			atomic_store (job->done, 1);
+			return;
+		}
+		ring->width = job->width;
+		ring->height = job->height;
+	}
+
+	size_t size = FrameRingEncode ((const uint32_t *) job->rgba, key ? NULL : (const uint32_t *) ring->previous, count, ring->scratch);
+	memcpy (ring->previous, job->rgba, count * 4);
+	atomic_store (job->done, 1);
+	if (key)
+		ring->key_us = job->time_us;
+
+	FrameRingFrame *frame = malloc (sizeof (FrameRingFrame) + size);
+	if (frame == NULL)
+	{
+		// Not kept, so the next frame has to be a keyframe
+		ring->key_us = job->time_us - FRAME_RING_KEY_US;
+		return;
+	}
+	frame->next = NULL;
+	frame->time_us = job->time_us;
+	frame->width = job->width;
+	frame->height = job->height;
+	frame->key = key;
+	frame->size = size;
+	memcpy (frame->data, ring->scratch, size);
+
+	pthread_mutex_lock (&ring->lock);
+	if (ring->newest)
+		ring->newest->next = frame;
+	else
+		ring->oldest = frame;
+	ring->newest = frame;
+	ring->bytes += sizeof (FrameRingFrame) + size;
+	ring->frames++;
+	ring->keyframes += key;
+	ring->raw_bytes += count * 4;
+	ring->compress_us += Now () - start;
+	Evict (ring);
+	pthread_mutex_unlock (&ring->lock);
+}
+
+static void Evict (FrameRing *ring)
+{
+	// A keyframe interval at a time, oldest first, never the newest one
+	while (ring->bytes > ring->max_bytes || ring->newest->time_us - ring->oldest->time_us > ring->max_age_us)
+	{
+		FrameRingFrame *next = ring->oldest->next;
+		while (next && !next->key)
+			next = next->next;
+		if (next == NULL)
+			break;
+		while (ring->oldest != next)
+		{
+			FrameRingFrame *old = ring->oldest;
+			ring->oldest = old->next;
+			ring->bytes -= sizeof (FrameRingFrame) + old->size;
+			ring->evicted++;
+			free (old);
+		}
+	}
+}
+
+static void *DumpThread (void *data)
+{
+	FrameRing *ring = data;
+
+	// Copy the frames out from the keyframe before the dump starts, so the ring keeps going meanwhile
+	pthread_mutex_lock (&ring->lock);
+	FrameRingFrame *begin = NULL;
+	int width = ring->newest ? ring->newest->width : 0, height = ring->newest ? ring->newest->height : 0;
+	int64_t end_us = ring->newest ? ring->newest->time_us : 0;
+	int64_t start_us = end_us - (int64_t) FRAME_RING_DUMP_SECONDS * 1000000;
+	for (FrameRingFrame *frame = ring->oldest; frame; frame = frame->next)
+	{
+		if (frame->width != width || frame->height != height)
+			begin = NULL;
+		else if (frame->key && (begin == NULL || frame->time_us <= start_us))
+			begin = frame;
+	}
+	size_t total = 0;
+	int count = 0;
+	for (FrameRingFrame *frame = begin; frame; frame = frame->next)
+	{
+		total += sizeof (FrameRingFrame) + frame->size;
+		count++;
+	}
+	unsigned char *copy = count ? malloc (total) : NULL;
+	if (copy)
+	{
+		unsigned char *p = copy;
+		for (FrameRingFrame *frame = begin; frame; frame = frame->next)
+		{
+			memcpy (p, frame, sizeof (FrameRingFrame) + frame->size);
+			p += sizeof (FrameRingFrame) + frame->size;
+		}
+	}
+	pthread_mutex_unlock (&ring->lock);
+
+	if (copy == NULL)
+	{
+		fprintf (stderr, "Nothing to write to '%s'\n", ring->dump_path);
+		atomic_store (&ring->dumping, 0);
+		return NULL;
+	}
+
+	// Halved when large, rounded down to even sizes for 4:2:0
+	int scale = width > FRAME_RING_DUMP_MAX_WIDTH ? 2 : 1;
+	int out_width = width / scale & ~1, out_height = height / scale & ~1;
+	uint32_t *pixels = calloc ((size_t) width * height, 4);
+	unsigned char *planes = malloc ((size_t) out_width * out_height * 3 / 2);
+	FILE *file = fopen (ring->dump_path, "wb");
+	int written = 0, failed = (pixels == NULL || planes == NULL || file == NULL || out_width == 0 || out_height == 0);
+	if (!failed)
+	{
+		fprintf (file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", out_width, out_height, FRAME_RING_DUMP_FPS);
+
+		// One video frame every 1/FRAME_RING_DUMP_FPS, showing the last frame drawn by then
+		const unsigned char *p = copy, *copy_end = copy + total;
+		const FrameRingFrame *frame = (const FrameRingFrame *) p;
+		int64_t time_us = frame->time_us > start_us ? frame->time_us : start_us;
+		for (int i = 0; !failed; i++)
+		{
+			int64_t video_us = time_us + (int64_t) i * 1000000 / FRAME_RING_DUMP_FPS;
+			if (video_us > end_us)
+				break;
+			while (p < copy_end && ((const FrameRingFrame *) p)->time_us <= video_us)
+			{
+				frame = (const FrameRingFrame *) p;
+				if (frame->key)
+					memset (pixels, 0, (size_t) width * height * 4);
+				failed = FrameRingDecode (frame->data, frame->size, pixels, (size_t) width * height) != 0;
+				p += sizeof (FrameRingFrame) + frame->size;
+			}
+			if (!failed)
+				failed = WriteY4m (file, pixels, width, height, scale, planes) != 0;
+			written++;
+		}
+	}
+	if (file && fclose (file) != 0)
+		failed = 1;
+	if (failed)
+		fprintf (stderr, "Could not write the replay to '%s'\n", ring->dump_path);
+	else
+		printf ("Replay of the last %.1f s written to '%s'\n", (double) written / FRAME_RING_DUMP_FPS, ring->dump_path);
+	free (copy);
+	free (pixels);
+	free (planes);
+	atomic_store (&ring->dumping, 0);
+	return NULL;
+}
+
+static int WriteY4m (FILE *file, const uint32_t *pixels, int width, int height, int scale, unsigned char *planes)
+{
+	// Full range BT.601, as C420jpeg says; rows are read bottom-up, the way OpenGL returns them
+	int out_width = width / scale & ~1, out_height = height / scale & ~1;
+	unsigned char *y_plane = planes, *cb_plane = planes + out_width * out_height, *cr_plane = cb_plane + out_width * out_height / 4;
+	for (int y = 0; y < out_height; y += 2)
+	{
+		const unsigned char *rows[2] =
+		{
+			(const unsigned char *) (pixels + (size_t) (height - 1 - y * scale) * width),
+			(const unsigned char *) (pixels + (size_t) (height - 1 - (y + 1) * scale) * width)
+		};
+		for (int x = 0; x < out_width; x += 2)
+		{
+			int r = 0, g = 0, b = 0;
+			for (int dy = 0; dy < 2; dy++)
+				for (int dx = 0; dx < 2; dx++)
+				{
+					const unsigned char *rgba = rows[dy] + (size_t) (x + dx) * scale * 4;
+					y_plane[(y + dy) * out_width + x + dx] = (unsigned char) ((77 * rgba[0] + 150 * rgba[1] + 29 * rgba[2] + 128) >> 8);
+					r += rgba[0];
+					g += rgba[1];
+					b += rgba[2];
+				}
+			int cb = ((-43 * r - 85 * g + 128 * b) / 4 + 128 * 256 + 128) >> 8;
+			int cr = ((128 * r - 107 * g - 21 * b) / 4 + 128 * 256 + 128) >> 8;
+			cb_plane[y / 2 * out_width / 2 + x / 2] = (unsigned char) (cb > 255 ? 255 : cb);
+			cr_plane[y / 2 * out_width / 2 + x / 2] = (unsigned char) (cr > 255 ? 255 : cr);
+		}
+	}
+	if (fputs ("FRAME\n", file) == EOF || fwrite (planes, 1, (size_t) out_width * out_height * 3 / 2, file) != (size_t) out_width * out_height * 3 / 2)
+		return -1;
+	return 0;
+}
+
+static unsigned char *PutVarint (unsigned char *p, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		*p++ = (unsigned char) (value | 0x80);
+		value >>= 7;
+	}
+	*p++ = (unsigned char) value;
+	return p;
+}
+
+static int64_t Now (void)
+{
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
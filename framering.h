@@ -0,0 +1,100 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - replay ring of rendered frames
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Keeps the last few minutes of what the board showed, for disputed calls at the end of a period.
+Frames come in as RGBA (capture.h reads them back from the GPU) and are compressed on a thread of
+their own, so the render loop only hands over a pointer.
+
+The board hardly changes from one frame to the next, so every frame is XORed with the one before
+and the result run-length coded: a frame where only the tenths digit changed is a few kilobytes,
+an unchanged one a few bytes. Every FRAME_RING_KEY_US there is a keyframe, coded on its own, so
+the oldest frames can be dropped a keyframe interval at a time when the ring is over its memory
+cap or older than its time limit.
+
+Run-length code, over 32-bit pixels: a varint n, then if n is even n / 2 + 1 copies of the next
+pixel, if odd n / 2 + 1 pixels as they are.
+
+FrameRingDump () writes the last seconds to a YUV4MPEG2 (.y4m) file, which ffmpeg, mpv and VLC
+play as they are, at a steady FRAME_RING_DUMP_FPS; each video frame shows what was on the screen
+at that moment. The dump runs on a thread too.
+
+**************************************************************************************************/
+
+#ifndef FRAMERING_H
+#define FRAMERING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define FRAME_RING_QUEUE 4 // Frames waiting to be compressed
+#define FRAME_RING_KEY_US 2000000 // Between keyframes
+#define FRAME_RING_DUMP_FPS 30
+#define FRAME_RING_DUMP_SECONDS 60 // How far back a dump goes
+#define FRAME_RING_DUMP_MAX_WIDTH 1280 // Wider frames are halved in the dump
+
+typedef struct FrameRingJob
+{
+	const unsigned char *rgba; // Rows bottom-up, as read from OpenGL
+	int width, height;
+	int64_t time_us;
+	_Atomic int *done; // Set once rgba is no longer needed
+} FrameRingJob;
+
+typedef struct FrameRing
+{
+	pthread_t thread, dump_thread;
+	pthread_mutex_t lock; // Guards the queue, the frame list and the counters
+	pthread_cond_t wake;
+	int stopping;
+	FrameRingJob queue[FRAME_RING_QUEUE];
+	int queued;
+
+	struct FrameRingFrame *oldest, *newest; // Compressed frames, oldest first
+	size_t bytes, max_bytes;
+	int64_t max_age_us;
+
+	// Owned by the compressing thread
+	unsigned char *previous; // Last frame, what the next one is XORed with
+	int width, height;
+	int64_t key_us; // Time of the last keyframe
+	unsigned char *scratch;
+	size_t scratch_size;
+
+	_Atomic int dumping;
+	int dump_joinable; // dump_thread has been started and not joined
+	char dump_path[256];
+
+	unsigned long frames, keyframes, skipped, evicted;
+	uint64_t raw_bytes; // Before compression
+	int64_t compress_us; // Time spent compressing
+} FrameRing;
+
+int FrameRingInit (FrameRing *ring, size_t max_bytes, int64_t max_age_us); // Returns 0 on success
+int FrameRingSubmit (FrameRing *ring, const FrameRingJob *job); // Returns 0 if queued, -1 if the queue is full
+int FrameRingDump (FrameRing *ring, const char *path); // Starts writing a .y4m; -1 if a dump is already running
+int FrameRingSeconds (FrameRing *ring); // Seconds of frames held
+void FrameRingClose (FrameRing *ring); // Waits for a running dump
+
+size_t FrameRingEncode (const uint32_t *pixels, const uint32_t *previous, size_t count, unsigned char *out); // previous NULL = keyframe; out needs count * 4 + count / 64 + 16 bytes
+int FrameRingDecode (const unsigned char *data, size_t size, uint32_t *pixels, size_t count); // XORs into pixels (zeroed for a keyframe); 0 on success
+
+#endif
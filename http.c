@@ -0,0 +1,651 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - spectator web server
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+**************************************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include "http.h"
+
+#define REQUEST_MAX 2048 // Longest request head accepted
+#define STREAM_BACKLOG_MAX 16384 // Unsent bytes a stream may have before it is marked behind
+#define JSON_MAX 1024
+#define EPOLL_EVENTS 256
+#define SWEEP_MS 1000 // How often connections are checked against HTTP_REQUEST_TIMEOUT_MS
+
+typedef struct HttpClient
+{
+	int fd;
+	int streaming; // On /events
+	int closing; // Close once the output is sent
+	int behind; // Missed changes, gets the whole state once its backlog is sent
+	int want_write; // EPOLLOUT is on
+	int closed; // Events for it may still be in the batch being handled
+	int64_t accepted_us;
+	char request[REQUEST_MAX];
+	size_t request_length;
+	char *output;
+	size_t output_length, output_sent, output_capacity;
+	struct HttpClient *prev, *next;
+} HttpClient;
+
+// Numbers in the JSON state, in the order they are written
+typedef struct Field { const char *name; size_t offset; } Field;
+static const Field fields[] =
+{
+	{"main_clock", offsetof (ScoreboardState, main_clock)},
+	{"shot_clock", offsetof (ScoreboardState, shot_clock)},
+	{"timeout_clock", offsetof (ScoreboardState, timeout_clock)},
+	{"main_clock_running", offsetof (ScoreboardState, main_clock_running)},
+	{"shot_clock_running", offsetof (ScoreboardState, shot_clock_running)},
+	{"shot_clock_showing", offsetof (ScoreboardState, shot_clock_showing)},
+	{"shot_clock_enabled", offsetof (ScoreboardState, shot_clock_enabled)},
+	{"main_clock_tenths", offsetof (ScoreboardState, main_clock_tenths)},
+	{"shot_clock_tenths", offsetof (ScoreboardState, shot_clock_tenths)},
+	{"mode", offsetof (ScoreboardState, mode)},
+	{"buzzer", offsetof (ScoreboardState, buzzer)},
+	{"home_score", offsetof (ScoreboardState, score[0])},
+	{"visitor_score", offsetof (ScoreboardState, score[1])},
+	{"home_fouls", offsetof (ScoreboardState, fouls[0])},
+	{"visitor_fouls", offsetof (ScoreboardState, fouls[1])},
+	{"home_tol", offsetof (ScoreboardState, tol[0])},
+	{"visitor_tol", offsetof (ScoreboardState, tol[1])},
+	{"period", offsetof (ScoreboardState, period)},
+};
+#define FIELD_COUNT (int) (sizeof (fields) / sizeof (fields[0]))
+
+static const char page[] =
+"<!DOCTYPE html>\n"
+"<html><head><meta charset=\"utf-8\"><meta name=\"viewport\" content=\"width=device-width, initial-scale=1\">\n"
+"<title>Scoreboard</title>\n"
+"<style>\n"
+"body{background:#000;color:#fff;font-family:sans-serif;text-align:center;margin:0}\n"
+".row{display:flex;justify-content:space-around;align-items:center;margin:4vh 0}\n"
+".big{font:bold 18vw monospace}.mid{font:bold 10vw monospace}.label{font-size:5vw;color:#aaa}\n"
+"#main{color:#e62937}#shot{color:#00e430}.score{color:#ffcb00}\n"
+"</style></head><body>\n"
+"<div class=\"big\" id=\"main\">-</div>\n"
+"<div class=\"row\"><div><div class=\"label\" id=\"home_name\">HOME</div><div class=\"big score\" id=\"home_score\">0</div>"
+"<div class=\"label\">fouls <span id=\"home_fouls\">0</span> &middot; TOL <span id=\"home_tol\">0</span></div></div>\n"
+"<div><div class=\"label\">period</div><div class=\"mid\" id=\"period\">0</div><div class=\"mid\" id=\"shot\">-</div></div>\n"
+"<div><div class=\"label\" id=\"visitor_name\">VISITOR</div><div class=\"big score\" id=\"visitor_score\">0</div>"
+"<div class=\"label\">fouls <span id=\"visitor_fouls\">0</span> &middot; TOL <span id=\"visitor_tol\">0</span></div></div></div>\n"
+"<script>\n"
+"var s={};\n"
+"function clock(t,tenths){var m=Math.floor(t/600),sec=Math.floor(t/10)%60;"
+"return tenths?(m*60+sec)+'.'+(t%10):m+':'+(sec<10?'0':'')+sec;}\n"
+"function show(){\n"
+" document.getElementById('main').textContent=clock(s.main_clock,s.main_clock_tenths);\n"
+" var shot=s.shot_clock_showing?s.shot_clock:s.timeout_clock;\n"
+" document.getElementById('shot').textContent=s.shot_clock_enabled?(s.shot_clock_tenths?clock(shot,1):Math.ceil(shot/10)):'';\n"
+" document.getElementById('shot').style.color=s.shot_clock_showing?'#00e430':'#ffcb00';\n"
+" ['home_score','visitor_score','home_fouls','visitor_fouls','home_tol','visitor_tol','period','home_name','visitor_name']"
+".forEach(function(k){document.getElementById(k).textContent=s[k];});\n"
+"}\n"
+"var events=new EventSource('/events');\n"
+"events.onmessage=function(e){var d=JSON.parse(e.data);for(var k in d)s[k]=d[k];show();};\n"
+"</script></body></html>\n";
+
+static void *ServerThread (void *data);
+static void Tick (HttpServer *server);
+static void Sweep (HttpServer *server);
+static void Accept (HttpServer *server);
+static void Receive (HttpServer *server, HttpClient *client);
+static void Respond (HttpServer *server, HttpClient *client);
+static int Queue (HttpClient *client, const char *data, size_t length);
+static void Flush (HttpServer *server, HttpClient *client);
+static void SendWhole (HttpServer *server, HttpClient *client);
+static void CloseClient (HttpServer *server, HttpClient *client);
+static void FreeClosed (HttpServer *server);
+static size_t WriteJson (char *buffer, const ScoreboardState *state, const ScoreboardState *previous);
+static size_t WriteString (char *buffer, const char *text);
+static int64_t Now (void);
+
+int HttpStart (HttpServer *server, const ShmPublisher *publisher, const Metrics *metrics, int port)
+{
+	memset (server, 0, sizeof (*server));
+	server->metrics = metrics;
+	server->listen_fd = server->epoll_fd = server->timer_fd = server->stop_fd = -1;
+	if (ShmReaderAttach (&server->reader, publisher) != 0)
+		return -1;
+
+	// Thousands of phones means thousands of sockets
+	struct rlimit limit;
+	if (getrlimit (RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+	{
+		limit.rlim_cur = limit.rlim_max;
+		setrlimit (RLIMIT_NOFILE, &limit);
+	}
+
+	struct sockaddr_in address;
+	memset (&address, 0, sizeof (address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl (INADDR_ANY);
+	address.sin_port = htons ((uint16_t) port);
+	int on = 1;
+	struct itimerspec tick = {{0, HTTP_TICK_MS * 1000000L}, {0, HTTP_TICK_MS * 1000000L}};
+
+	server->listen_fd = socket (AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	server->epoll_fd = epoll_create1 (EPOLL_CLOEXEC);
+	server->timer_fd = timerfd_create (CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	server->stop_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (server->listen_fd < 0 || server->epoll_fd < 0 || server->timer_fd < 0 || server->stop_fd < 0 ||
+		setsockopt (server->listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof (on)) != 0 ||
+		bind (server->listen_fd, (struct sockaddr *) &address, sizeof (address)) != 0 ||
+		listen (server->listen_fd, 1024) != 0 ||
+		timerfd_settime (server->timer_fd, 0, &tick, NULL) != 0)
+	{
+		HttpStop (server);
+		return -1;
+	}
+
+	// The listening socket, timer and stop event are told apart from clients by their data pointer
+	struct epoll_event event = {.events = EPOLLIN};
+	event.data.ptr = &server->listen_fd;
+	epoll_ctl (server->epoll_fd, EPOLL_CTL_ADD, server->listen_fd, &event);
+	event.data.ptr = &server->timer_fd;
+	epoll_ctl (server->epoll_fd, EPOLL_CTL_ADD, server->timer_fd, &event);
+	event.data.ptr = &server->stop_fd;
+	epoll_ctl (server->epoll_fd, EPOLL_CTL_ADD, server->stop_fd, &event);
+
+	server->heartbeat_us = Now ();
+	server->sweep_us = server->heartbeat_us;
+	if (pthread_create (&server->thread, NULL, ServerThread, server) != 0)
+	{
+		HttpStop (server);
+		return -1;
+	}
+	return 0;
+}
+
+void HttpStop (HttpServer *server)
+{
+	if (server->thread)
+	{
+		uint64_t one = 1;
+		if (write (server->stop_fd, &one, sizeof (one)) == sizeof (one))
+			pthread_join (server->thread, NULL);
+		server->thread = 0;
+	}
+	if (server->listen_fd >= 0)
+		close (server->listen_fd);
+	if (server->epoll_fd >= 0)
+		close (server->epoll_fd);
+	if (server->timer_fd >= 0)
+		close (server->timer_fd);
+	if (server->stop_fd >= 0)
+		close (server->stop_fd);
+	server->listen_fd = server->epoll_fd = server->timer_fd = server->stop_fd = -1;
+	ShmReaderClose (&server->reader);
+}
+
+static void *ServerThread (void *data)
+{
+	HttpServer *server = data;
+	struct epoll_event events[EPOLL_EVENTS];
+	int running = 1;
+
+	while (running)
+	{
+		int count = epoll_wait (server->epoll_fd, events, EPOLL_EVENTS, -1);
+		if (count < 0 && errno != EINTR)
+			break;
+		for (int i = 0; i < count; i++)
+		{
+			void *source = events[i].data.ptr;
+			if (source == &server->stop_fd)
+				running = 0;
+			else if (source == &server->timer_fd)
+			{
+				uint64_t expirations;
+				if (read (server->timer_fd, &expirations, sizeof (expirations)) > 0)
+				{
+					Tick (server);
+					Sweep (server);
+				}
+			}
+			else if (source == &server->listen_fd)
+				Accept (server);
+			else
+			{
+				HttpClient *client = source;
+				if (client->closed)
+					continue;
+				if (events[i].events & (EPOLLERR | EPOLLHUP))
+					CloseClient (server, client);
+				else if (events[i].events & EPOLLIN)
+					Receive (server, client);
+				else if (events[i].events & EPOLLOUT)
+					Flush (server, client);
+			}
+		}
+		FreeClosed (server);
+	}
+
+	while (server->clients)
+		CloseClient (server, server->clients);
+	FreeClosed (server);
+	return NULL;
+}
+
+static void Tick (HttpServer *server)
+{
+	ScoreboardState state;
+	char message[JSON_MAX + 16];
+	int64_t now = Now ();
+
+	if (ShmRead (&server->reader, &state) != 0)
+		return;
+
+	// One message with just what changed, the same bytes for every stream
+	size_t length = 0;
+	if (server->have_sent)
+	{
+		char json[JSON_MAX];
+		size_t json_length = WriteJson (json, &state, &server->sent);
+		if (json_length)
+			length = (size_t) snprintf (message, sizeof (message), "data: %s\n\n", json);
+	}
+	server->sent = state;
+	server->have_sent = 1;
+	if (length == 0 && now - server->heartbeat_us >= (int64_t) HTTP_HEARTBEAT_MS * 1000)
+		length = (size_t) snprintf (message, sizeof (message), ": heartbeat\n\n");
+	if (length == 0)
+		return;
+	server->heartbeat_us = now;
+	server->events++;
+
+	HttpClient *next;
+	for (HttpClient *client = server->clients; client != NULL; client = next)
+	{
+		next = client->next;
+		if (!client->streaming || client->behind)
+			continue;
+		if (Queue (client, message, length) != 0)
+		{
+			client->behind = 1;
+			server->dropped++;
+			continue;
+		}
+		Flush (server, client);
+	}
+}
+
+static void Sweep (HttpServer *server)
+{
+	int64_t now = Now ();
+	if (now - server->sweep_us < (int64_t) SWEEP_MS * 1000)
+		return;
+	server->sweep_us = now;
+
+	// Still reading the request head: neither answered (closing) nor a stream yet
+	HttpClient *next;
+	for (HttpClient *client = server->clients; client != NULL; client = next)
+	{
+		next = client->next;
+		if (!client->streaming && !client->closing && now - client->accepted_us >= (int64_t) HTTP_REQUEST_TIMEOUT_MS * 1000)
+		{
+			server->timed_out++;
+			CloseClient (server, client);
+		}
+	}
+}
+
+static void Accept (HttpServer *server)
+{
+	while (1)
+	{
+		int fd = accept4 (server->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd < 0)
+		{
+			// Out of descriptors: stop accepting until a client goes away, or the loop would spin
+			if (errno == EMFILE || errno == ENFILE)
+			{
+				struct epoll_event event = {.events = 0};
+				event.data.ptr = &server->listen_fd;
+				epoll_ctl (server->epoll_fd, EPOLL_CTL_MOD, server->listen_fd, &event);
+				server->accept_paused = 1;
+			}
+			return;
+		}
+		HttpClient *client = calloc (1, sizeof (HttpClient));
+		if (client == NULL)
+		{
+			close (fd);
+			continue;
+		}
+		client->fd = fd;
+		client->accepted_us = Now ();
+		struct epoll_event event = {.events = EPOLLIN | EPOLLRDHUP};
+		event.data.ptr = client;
+		if (epoll_ctl (server->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0)
+		{
+			close (fd);
+			free (client);
+			continue;
+		}
+		client->next = server->clients;
+		if (server->clients)
+			server->clients->prev = client;
+		server->clients = client;
+		server->client_count++;
+	}
+}
+
+static void Receive (HttpServer *server, HttpClient *client)
+{
+	while (1)
+	{
+		char discard[512];
+		char *into = client->streaming ? discard : client->request + client->request_length;
+		size_t room = client->streaming ? sizeof (discard) : sizeof (client->request) - 1 - client->request_length;
+		if (room == 0)
+		{
+			CloseClient (server, client);
+			return;
+		}
+		ssize_t got = read (client->fd, into, room);
+		if (got == 0)
+		{
+			CloseClient (server, client);
+			return;
+		}
+		if (got < 0)
+		{
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				CloseClient (server, client);
+			return;
+		}
+		// Streams have nothing more to say; anything they send is ignored
+		if (client->streaming)
+			continue;
+		client->request_length += (size_t) got;
+		client->request[client->request_length] = '\0';
+		if (strstr (client->request, "\r\n\r\n") || strstr (client->request, "\n\n"))
+		{
+			Respond (server, client);
+			return;
+		}
+	}
+}
+
+static void Respond (HttpServer *server, HttpClient *client)
+{
+	char method[8], path[256], header[256];
+	server->requests++;
+	client->closing = 1;
+
+	if (sscanf (client->request, "%7s %255s", method, path) != 2)
+	{
+		const char *bad = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+		Queue (client, bad, strlen (bad));
+	}
+	else if (strcmp (method, "GET") != 0)
+	{
+		const char *not_allowed = "HTTP/1.1 405 Method Not Allowed\r\nAllow: GET\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+		Queue (client, not_allowed, strlen (not_allowed));
+	}
+	else
+	{
+		char *query = strchr (path, '?');
+		if (query)
+			*query = '\0';
+		if (strcmp (path, "/") == 0)
+		{
+			int length = snprintf (header, sizeof (header), "HTTP/1.1 200 OK\r\nContent-Type: text/html; charset=utf-8\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n", sizeof (page) - 1);
+			Queue (client, header, (size_t) length);
+			Queue (client, page, sizeof (page) - 1);
+		}
+		else if (strcmp (path, "/state") == 0)
+		{
+			ScoreboardState state;
+			char json[JSON_MAX];
+			size_t json_length = ShmRead (&server->reader, &state) == 0 ? WriteJson (json, &state, NULL) : (size_t) snprintf (json, sizeof (json), "{}");
+			int length = snprintf (header, sizeof (header), "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %zu\r\nAccess-Control-Allow-Origin: *\r\nConnection: close\r\n\r\n", json_length);
+			Queue (client, header, (size_t) length);
+			Queue (client, json, json_length);
+		}
+		else if (strcmp (path, "/events") == 0)
+		{
+			const char *stream = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\nAccess-Control-Allow-Origin: *\r\nConnection: keep-alive\r\n\r\nretry: 2000\n\n";
+			Queue (client, stream, strlen (stream));
+			client->closing = 0;
+			client->streaming = 1;
+			server->stream_count++;
+			SendWhole (server, client);
+		}
+		else if (strcmp (path, "/metrics") == 0 && server->metrics)
+		{
+			// The server's own counters are read on the thread that writes them
+			static char text[METRICS_TEXT_MAX + 1024];
+			size_t text_length = MetricsWrite (server->metrics, text, METRICS_TEXT_MAX);
+			text_length += (size_t) snprintf (text + text_length, sizeof (text) - text_length,
+				"# HELP scoreboard_http_requests_total Requests answered by the web server.\n# TYPE scoreboard_http_requests_total counter\nscoreboard_http_requests_total %lu\n"
+				"# HELP scoreboard_http_streams Clients following /events.\n# TYPE scoreboard_http_streams gauge\nscoreboard_http_streams %d\n"
+				"# HELP scoreboard_http_dropped_total Change messages not sent to clients that could not keep up.\n# TYPE scoreboard_http_dropped_total counter\nscoreboard_http_dropped_total %lu\n"
+				"# HELP scoreboard_http_timeouts_total Connections closed for not sending a request in time.\n# TYPE scoreboard_http_timeouts_total counter\nscoreboard_http_timeouts_total %lu\n",
+				server->requests, server->stream_count, server->dropped, server->timed_out);
+			int length = snprintf (header, sizeof (header), "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n", text_length);
+			Queue (client, header, (size_t) length);
+			Queue (client, text, text_length);
+		}
+		else
+		{
+			const char *not_found = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+			Queue (client, not_found, strlen (not_found));
+		}
+	}
+	Flush (server, client);
+}
+
+static int Queue (HttpClient *client, const char *data, size_t length)
+{
+	// Streams that are too far behind get nothing more until they catch up
+	if (client->streaming && client->output_length - client->output_sent + length > STREAM_BACKLOG_MAX)
+		return -1;
+	if (client->output_sent == client->output_length)
+		client->output_sent = client->output_length = 0;
+	if (client->output_length + length > client->output_capacity)
+	{
+		// Move what is left to the front before growing
+		memmove (client->output, client->output + client->output_sent, client->output_length - client->output_sent);
+		client->output_length -= client->output_sent;
+		client->output_sent = 0;
+		if (client->output_length + length > client->output_capacity)
+		{
+			size_t capacity = (client->output_length + length) * 2;
+			char *output = realloc (client->output, capacity);
+			if (output == NULL)
+				return -1;
+			client->output = output;
+			client->output_capacity = capacity;
+		}
+	}
+	memcpy (client->output + client->output_length, data, length);
+	client->output_length += length;
+	return 0;
+}
+
+static void Flush (HttpServer *server, HttpClient *client)
+{
+	while (1)
+	{
+		if (client->output_sent == client->output_length)
+		{
+			// A stream that fell behind starts over from the whole state once it is caught up
+			if (!client->behind)
+				break;
+			client->behind = 0;
+			SendWhole (server, client);
+			continue;
+		}
+		ssize_t sent = send (client->fd, client->output + client->output_sent, client->output_length - client->output_sent, MSG_NOSIGNAL);
+		if (sent < 0)
+		{
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				// Wait until the socket can take more
+				if (!client->want_write)
+				{
+					struct epoll_event event = {.events = EPOLLIN | EPOLLRDHUP | EPOLLOUT};
+					event.data.ptr = client;
+					epoll_ctl (server->epoll_fd, EPOLL_CTL_MOD, client->fd, &event);
+					client->want_write = 1;
+				}
+				return;
+			}
+			CloseClient (server, client);
+			return;
+		}
+		client->output_sent += (size_t) sent;
+	}
+
+	// Everything is out
+	if (client->want_write)
+	{
+		struct epoll_event event = {.events = EPOLLIN | EPOLLRDHUP};
+		event.data.ptr = client;
+		epoll_ctl (server->epoll_fd, EPOLL_CTL_MOD, client->fd, &event);
+		client->want_write = 0;
+	}
+	if (client->closing)
+		CloseClient (server, client);
+}
+
+static void SendWhole (HttpServer *server, HttpClient *client)
+{
+	ScoreboardState state;
+	char json[JSON_MAX], message[JSON_MAX + 16];
+
+	// The last state sent to everyone, so the changes that follow apply to it
+	if (server->have_sent)
+		state = server->sent;
+	else if (ShmRead (&server->reader, &state) != 0)
+		return;
+	WriteJson (json, &state, NULL);
+	int length = snprintf (message, sizeof (message), "data: %s\n\n", json);
+	Queue (client, message, (size_t) length);
+}
+
+static void CloseClient (HttpServer *server, HttpClient *client)
+{
+	if (client->closed)
+		return;
+	if (client->prev)
+		client->prev->next = client->next;
+	else
+		server->clients = client->next;
+	if (client->next)
+		client->next->prev = client->prev;
+	if (client->streaming)
+		server->stream_count--;
+
+	// A descriptor is free again, so accepting can go on if it had stopped
+	if (server->accept_paused)
+	{
+		struct epoll_event event = {.events = EPOLLIN};
+		event.data.ptr = &server->listen_fd;
+		epoll_ctl (server->epoll_fd, EPOLL_CTL_MOD, server->listen_fd, &event);
+		server->accept_paused = 0;
+	}
+
+	close (client->fd);
+	server->client_count--;
+	client->closed = 1;
+	client->next = server->closed;
+	server->closed = client;
+}
+
+static void FreeClosed (HttpServer *server)
+{
+	while (server->closed)
+	{
+		HttpClient *client = server->closed;
+		server->closed = client->next;
+		free (client->output);
+		free (client);
+	}
+}
+
+static size_t WriteJson (char *buffer, const ScoreboardState *state, const ScoreboardState *previous)
+{
+	size_t length = 0;
+	int changed = 0;
+
+	length += (size_t) sprintf (buffer, "{\"t\":%lld", (long long) state->time_us);
+	for (int i = 0; i < FIELD_COUNT; i++)
+	{
+		int32_t value = *(const int32_t *) ((const char *) state + fields[i].offset);
+		if (previous && value == *(const int32_t *) ((const char *) previous + fields[i].offset))
+			continue;
+		length += (size_t) sprintf (buffer + length, ",\"%s\":%d", fields[i].name, value);
+		changed = 1;
+	}
+	for (int team = 0; team < 2; team++)
+	{
+		if (previous && strncmp (state->team_names[team], previous->team_names[team], SHM_NAME_LENGTH) == 0)
+			continue;
+		length += (size_t) sprintf (buffer + length, ",\"%s\":", team == 0 ? "home_name" : "visitor_name");
+		length += WriteString (buffer + length, state->team_names[team]);
+		changed = 1;
+	}
+	buffer[length++] = '}';
+	buffer[length] = '\0';
+	// Only the time changed: nothing worth sending
+	return changed ? length : 0;
+}
+
+static size_t WriteString (char *buffer, const char *text)
+{
+	size_t length = 0;
+	buffer[length++] = '"';
+	for (int i = 0; i < SHM_NAME_LENGTH && text[i]; i++)
+	{
+		unsigned char c = (unsigned char) text[i];
+		if (c == '"' || c == '\\')
+		{
+			buffer[length++] = '\\';
+			buffer[length++] = (char) c;
+		}
+		else if (c < 0x20)
+			length += (size_t) sprintf (buffer + length, "\\u%04x", c);
+		else
+			buffer[length++] = (char) c;
+	}
+	buffer[length++] = '"';
+	return length;
+}
+
+static int64_t Now (void)
+{
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
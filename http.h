@@ -0,0 +1,73 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - spectator web server
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+A small HTTP server (--http PORT) so phones on the venue network can follow the board. It runs on
+its own thread around one non-blocking epoll loop and only reads the published state (shm.h), so
+the render loop never waits for it.
+
+	/         a page that shows the board
+	/state    the whole state as JSON
+	/events   server-sent events: the whole state first, then only the fields that changed
+	/metrics  health metrics for Prometheus (metrics.h), if the server was given them
+
+Changes are gathered and sent at most every HTTP_TICK_MS, one message for all clients. A client
+that can not keep up gets no more changes while its backlog is over STREAM_BACKLOG_MAX bytes;
+what is already queued is still sent, and once it has all gone out the client gets the whole
+state again and carries on from there.
+
+A connection has HTTP_REQUEST_TIMEOUT_MS to send its whole request head, or it is closed, so
+clients that connect and go quiet can not use up the file descriptors one by one.
+
+**************************************************************************************************/
+
+#ifndef HTTP_H
+#define HTTP_H
+
+#include <pthread.h>
+#include "shm.h"
+#include "metrics.h"
+
+#define HTTP_TICK_MS 100 // How often changes are sent, once per tenth of a second
+#define HTTP_HEARTBEAT_MS 15000 // Comment line sent to idle streams so proxies keep them open
+#define HTTP_REQUEST_TIMEOUT_MS 10000 // How long a connection may take to send its request head
+
+typedef struct HttpServer
+{
+	int listen_fd, epoll_fd, timer_fd, stop_fd;
+	pthread_t thread;
+	ShmReader reader;
+	const Metrics *metrics; // NULL = no /metrics
+	ScoreboardState sent; // What clients were last sent
+	int have_sent;
+	struct HttpClient *clients; // Every open connection
+	struct HttpClient *closed; // Freed once the current batch of events is handled
+	int client_count, stream_count;
+	int accept_paused; // Out of file descriptors
+	int64_t heartbeat_us;
+	int64_t sweep_us; // Last look for connections past HTTP_REQUEST_TIMEOUT_MS
+
+	// Counters, only written by the server thread
+	unsigned long requests, events, dropped, timed_out;
+} HttpServer;
+
+int HttpStart (HttpServer *server, const ShmPublisher *publisher, const Metrics *metrics, int port); // metrics NULL = no /metrics; returns 0 on success
+void HttpStop (HttpServer *server);
+
+#endif
@@ -0,0 +1,326 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - web server load test
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Opens many /events streams at once against the spectator web server (http.h) and measures what
+they get.
+
+	httpload [--clients N] [--seconds S] [--host ADDRESS] [--port P] [--serve]
+
+--serve starts a server in this process on --port, fed by a simulated game published 30 times a
+second, so no window is needed. Every message carries the time the state was published ("t",
+CLOCK_MONOTONIC microseconds), which gives the delay from publish to arrival on this machine.
+
+**************************************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include "http.h"
+
+#define LINE_MAX 1024
+#define LATENCY_BUCKETS 2001 // 1 ms buckets, the last one is everything longer
+
+typedef struct LoadClient
+{
+	int fd;
+	int connected;
+	long events;
+	long whole_states; // Messages with the team names, sent on connect and after falling behind
+	char line[LINE_MAX];
+	size_t line_length;
+} LoadClient;
+
+static ShmPublisher publisher;
+static _Atomic int publishing = 1;
+static long latency[LATENCY_BUCKETS];
+static long latency_samples;
+static int64_t latency_max;
+
+static void *GameThread (void *data);
+static void Receive (LoadClient *client, const char *data, size_t length);
+static int64_t Now (void);
+static int64_t Percentile (double fraction);
+
+int main (int argc, char *argv[])
+{
+	int client_count = 1000;
+	double seconds = 10;
+	const char *host = "127.0.0.1";
+	int port = 8080;
+	int serve = 0;
+	static struct option long_options[] =
+	{
+		{"clients", required_argument, 0, 'c'},
+		{"seconds", required_argument, 0, 's'},
+		{"host", required_argument, 0, 'h'},
+		{"port", required_argument, 0, 'p'},
+		{"serve", no_argument, 0, 'S'},
+		{0, 0, 0, 0}
+	};
+
+	int c;
+	while ((c = getopt_long (argc, argv, "", long_options, NULL)) != -1)
+	{
+		switch (c)
+		{
+			case 'c': client_count = atoi (optarg); break;
+			case 's': seconds = atof (optarg); break;
+			case 'h': host = optarg; break;
+			case 'p': port = atoi (optarg); break;
+			case 'S': serve = 1; break;
+			default:
+				fprintf (stderr, "usage: %s [--clients N] [--seconds S] [--host ADDRESS] [--port P] [--serve]\n", argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+	if (client_count < 1 || seconds <= 0)
+	{
+		fprintf (stderr, "%s: bad option value\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	struct rlimit limit;
+	if (getrlimit (RLIMIT_NOFILE, &limit) == 0)
+	{
+		limit.rlim_cur = limit.rlim_max;
+		setrlimit (RLIMIT_NOFILE, &limit);
+		if ((rlim_t) client_count * (serve ? 2 : 1) + 64 > limit.rlim_cur)
+			fprintf (stderr, "%s: warning: only %llu file descriptors allowed\n", argv[0], (unsigned long long) limit.rlim_cur);
+	}
+
+	HttpServer server;
+	pthread_t game;
+	if (serve)
+	{
+		if (ShmPublisherOpen (&publisher, NULL) != 0 || HttpStart (&server, &publisher, NULL, port) != 0)
+		{
+			fprintf (stderr, "%s: could not start a server on port %d\n", argv[0], port);
+			return EXIT_FAILURE;
+		}
+		pthread_create (&game, NULL, GameThread, NULL);
+	}
+
+	struct sockaddr_in address;
+	memset (&address, 0, sizeof (address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons ((uint16_t) port);
+	if (inet_pton (AF_INET, host, &address.sin_addr) != 1)
+	{
+		fprintf (stderr, "%s: bad address '%s'\n", argv[0], host);
+		return EXIT_FAILURE;
+	}
+
+	// Every client connects at once, like a crowd opening the page at tip-off
+	int epoll_fd = epoll_create1 (0);
+	LoadClient *clients = calloc ((size_t) client_count, sizeof (LoadClient));
+	long failed = 0;
+	for (int i = 0; i < client_count; i++)
+	{
+		clients[i].fd = socket (AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+		if (clients[i].fd < 0 || (connect (clients[i].fd, (struct sockaddr *) &address, sizeof (address)) != 0 && errno != EINPROGRESS))
+		{
+			if (clients[i].fd >= 0)
+				close (clients[i].fd);
+			clients[i].fd = -1;
+			failed++;
+			continue;
+		}
+		struct epoll_event event = {.events = EPOLLOUT | EPOLLIN};
+		event.data.ptr = &clients[i];
+		epoll_ctl (epoll_fd, EPOLL_CTL_ADD, clients[i].fd, &event);
+	}
+
+	const char *request = "GET /events HTTP/1.1\r\nHost: scoreboard\r\nAccept: text/event-stream\r\n\r\n";
+	struct epoll_event events[256];
+	char buffer[8192];
+	long long bytes = 0;
+	long disconnected = 0;
+	int64_t start = Now ();
+	int64_t end = start + (int64_t) (seconds * 1e6);
+	while (Now () < end)
+	{
+		int count = epoll_wait (epoll_fd, events, 256, 100);
+		for (int i = 0; i < count; i++)
+		{
+			LoadClient *client = events[i].data.ptr;
+			if (client->fd < 0)
+				continue;
+			if (!client->connected && (events[i].events & EPOLLOUT))
+			{
+				int error = 0;
+				socklen_t size = sizeof (error);
+				getsockopt (client->fd, SOL_SOCKET, SO_ERROR, &error, &size);
+				if (error != 0 || write (client->fd, request, strlen (request)) != (ssize_t) strlen (request))
+				{
+					close (client->fd);
+					client->fd = -1;
+					failed++;
+					continue;
+				}
+				client->connected = 1;
+				struct epoll_event event = {.events = EPOLLIN};
+				event.data.ptr = client;
+				epoll_ctl (epoll_fd, EPOLL_CTL_MOD, client->fd, &event);
+				continue;
+			}
+			if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+			{
+				ssize_t got = read (client->fd, buffer, sizeof (buffer));
+				if (got <= 0)
+				{
+					if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+						continue;
+					close (client->fd);
+					client->fd = -1;
+					disconnected++;
+					continue;
+				}
+				bytes += got;
+				Receive (client, buffer, (size_t) got);
+			}
+		}
+	}
+
+	long connected = 0, total_events = 0, least_events = -1, resends = 0;
+	for (int i = 0; i < client_count; i++)
+	{
+		if (clients[i].connected)
+			connected++;
+		total_events += clients[i].events;
+		if (clients[i].fd >= 0 && (least_events < 0 || clients[i].events < least_events))
+			least_events = clients[i].events;
+		if (clients[i].whole_states > 1)
+			resends += clients[i].whole_states - 1;
+		if (clients[i].fd >= 0)
+			close (clients[i].fd);
+	}
+	free (clients);
+	close (epoll_fd);
+
+	if (serve)
+	{
+		atomic_store (&publishing, 0);
+		pthread_join (game, NULL);
+		HttpStop (&server);
+		ShmPublisherClose (&publisher);
+		printf ("server: %lu requests, %lu messages, %lu times a stream fell behind\n", server.requests, server.events, server.dropped);
+	}
+
+	printf ("%d clients: %ld connected, %ld failed, %ld disconnected early\n", client_count, connected, failed, disconnected);
+	printf ("%ld messages (%.1f per client, fewest %ld), %.1f MB, %ld whole states resent to slow clients\n",
+		total_events, connected ? (double) total_events / connected : 0.0, least_events < 0 ? 0 : least_events, bytes / 1e6, resends);
+	if (latency_samples)
+		printf ("publish to arrival: p50 %lld ms, p99 %lld ms, max %.1f ms\n",
+			(long long) Percentile (0.5), (long long) Percentile (0.99), latency_max / 1000.0);
+	return failed == 0 && disconnected == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void Receive (LoadClient *client, const char *data, size_t length)
+{
+	for (size_t i = 0; i < length; i++)
+	{
+		if (data[i] != '\n')
+		{
+			if (client->line_length < LINE_MAX - 1)
+				client->line[client->line_length++] = data[i];
+			continue;
+		}
+		client->line[client->line_length] = '\0';
+		client->line_length = 0;
+		if (strncmp (client->line, "data: ", 6) != 0)
+			continue;
+
+		client->events++;
+		if (strstr (client->line, "\"home_name\""))
+			client->whole_states++;
+		const char *t = strstr (client->line, "\"t\":");
+		if (t == NULL)
+			continue;
+		int64_t delay = Now () - strtoll (t + 4, NULL, 10);
+		long bucket = (long) (delay / 1000);
+		latency[bucket < 0 ? 0 : bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1]++;
+		latency_samples++;
+		if (delay > latency_max)
+			latency_max = delay;
+	}
+}
+
+static void *GameThread (void *data)
+{
+	(void) data;
+	ScoreboardState state;
+	memset (&state, 0, sizeof (state));
+	state.main_clock = 4800;
+	state.shot_clock = 350;
+	state.timeout_clock = 300;
+	state.main_clock_running = state.shot_clock_running = 1;
+	state.shot_clock_showing = state.shot_clock_enabled = 1;
+	state.tol[0] = state.tol[1] = 5;
+	state.period = 1;
+	strcpy (state.team_names[0], "HOME");
+	strcpy (state.team_names[1], "VISITOR");
+
+	// A frame every 1/30 s, the clocks going down a tenth every 100 ms and a basket now and then
+	int64_t start = Now ();
+	for (long frame = 0; atomic_load (&publishing); frame++)
+	{
+		int64_t tenths = (Now () - start) / 100000;
+		state.main_clock = (int32_t) (4800 - tenths % 4800);
+		state.shot_clock = (int32_t) (350 - tenths % 350);
+		state.main_clock_tenths = state.main_clock < 600;
+		state.shot_clock_tenths = state.shot_clock < 100;
+		if (frame % 150 == 0)
+			state.score[frame / 150 % 2] += 2;
+		ShmPublish (&publisher, &state);
+		usleep (33333);
+	}
+	return NULL;
+}
+
+static int64_t Percentile (double fraction)
+{
+	long seen = 0;
+	for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+	{
+		seen += latency[bucket];
+		if (seen > (long) (latency_samples * fraction))
+			return bucket + 1;
+	}
+	return LATENCY_BUCKETS;
+}
+
+static int64_t Now (void)
+{
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
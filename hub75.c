@@ -0,0 +1,331 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - HUB75 LED matrix frame encoder
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+**************************************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include "hub75.h"
+
+static int WriteFrame (Hub75Encoder *encoder, const unsigned char *data, size_t length);
+static void *SendThread (void *data);
+
+int Hub75Init (Hub75Encoder *encoder, const char *path, int width, int height, int depth, float gamma)
+{
+	memset (encoder, 0, sizeof (*encoder));
+	encoder->fd = -1;
+	if (width <= 0 || height <= 0 || height % 2 != 0 || depth < 1 || depth > HUB75_MAX_DEPTH || gamma <= 0)
+		return -1;
+	// A row address is one byte and can't be the frame end; a row's length is two bytes
+	if (height / 2 > HUB75_MAX_ROWS || (long) depth * width > HUB75_MAX_LENGTH)
+		return -1;
+
+	encoder->width = width;
+	encoder->height = height;
+	encoder->depth = depth;
+	encoder->full_refresh = 1;
+
+	// Fold gamma correction and plane splitting into one table per output line, so encoding a
+	// pixel is six lookups OR'd together no matter how many planes there are
+	int max_level = (1 << depth) - 1;
+	for (int value = 0; value < 256; value++)
+	{
+		int level = (int) lroundf (powf ((float) value / 255.0f, gamma) * (float) max_level);
+		for (int line = 0; line < 6; line++)
+		{
+			uint64_t bits = 0;
+			for (int plane = 0; plane < depth; plane++)
+				if (level & (1 << plane))
+					bits |= (uint64_t) (1 << line) << (plane * 8);
+			encoder->spread[line][value] = bits;
+		}
+	}
+
+	size_t plane_size = (size_t) (height / 2) * depth * width;
+	encoder->pixels = calloc ((size_t) width * height * 3, 1);
+	encoder->planes = calloc (plane_size, 1);
+	encoder->previous = calloc (plane_size, 1);
+	encoder->packet = malloc (plane_size + (size_t) (height / 2 + 1) * 4);
+	encoder->span_x = malloc (sizeof (int) * (width + 1));
+	encoder->span_y = malloc (sizeof (int) * (height + 1));
+	encoder->path = strdup (path);
+	if (!encoder->pixels || !encoder->planes || !encoder->previous || !encoder->packet || !encoder->span_x || !encoder->span_y || !encoder->path)
+	{
+		Hub75Close (encoder);
+		return -1;
+	}
+
+	// A pipe nobody reads yet fails with ENXIO instead of blocking, and is opened with the first frame it can take
+	encoder->fd = open (path, O_WRONLY | O_CREAT | O_TRUNC | O_NONBLOCK | O_CLOEXEC, 0644);
+	if (encoder->fd < 0 && errno != ENXIO)
+	{
+		Hub75Close (encoder);
+		return -1;
+	}
+	return 0;
+}
+
+void Hub75Downsample (Hub75Encoder *encoder, const unsigned char *rgba, int source_width, int source_height)
+{
+	int width = encoder->width;
+	int height = encoder->height;
+
+	// Spans only change when the window is resized
+	if (source_width != encoder->source_width || source_height != encoder->source_height)
+	{
+		for (int x = 0; x <= width; x++)
+			encoder->span_x[x] = (int) ((long) x * source_width / width);
+		for (int y = 0; y <= height; y++)
+			encoder->span_y[y] = (int) ((long) y * source_height / height);
+		encoder->source_width = source_width;
+		encoder->source_height = source_height;
+	}
+
+	// Box filter: thin features such as clock borders survive the downscale instead of aliasing away
+	for (int y = 0; y < height; y++)
+	{
+		int y0 = encoder->span_y[y];
+		int y1 = encoder->span_y[y + 1] > y0 ? encoder->span_y[y + 1] : y0 + 1;
+		unsigned char *out = encoder->pixels + (size_t) y * width * 3;
+		for (int x = 0; x < width; x++)
+		{
+			int x0 = encoder->span_x[x];
+			int x1 = encoder->span_x[x + 1] > x0 ? encoder->span_x[x + 1] : x0 + 1;
+			uint32_t r = 0, g = 0, b = 0;
+			for (int sy = y0; sy < y1; sy++)
+			{
+				const unsigned char *in = rgba + ((size_t) (source_height - 1 - sy) * source_width + x0) * 4; // Stored bottom-up
+				for (int sx = x0; sx < x1; sx++, in += 4)
+				{
+					r += in[0];
+					g += in[1];
+					b += in[2];
+				}
+			}
+			uint32_t count = (uint32_t) ((y1 - y0) * (x1 - x0));
+			out[x * 3 + 0] = (unsigned char) (r / count);
+			out[x * 3 + 1] = (unsigned char) (g / count);
+			out[x * 3 + 2] = (unsigned char) (b / count);
+		}
+	}
+}
+
+void Hub75Encode (Hub75Encoder *encoder)
+{
+	int width = encoder->width;
+	int depth = encoder->depth;
+	int scan_rows = encoder->height / 2;
+
+	for (int row = 0; row < scan_rows; row++)
+	{
+		const unsigned char *top = encoder->pixels + (size_t) row * width * 3;
+		const unsigned char *bottom = encoder->pixels + (size_t) (row + scan_rows) * width * 3;
+		unsigned char *out = encoder->planes + (size_t) row * depth * width;
+		for (int x = 0; x < width; x++, top += 3, bottom += 3)
+		{
+			uint64_t bits = encoder->spread[0][top[0]] | encoder->spread[1][top[1]] | encoder->spread[2][top[2]] |
+				encoder->spread[3][bottom[0]] | encoder->spread[4][bottom[1]] | encoder->spread[5][bottom[2]];
+			for (int plane = 0; plane < depth; plane++)
+				out[plane * width + x] = (unsigned char) (bits >> (plane * 8));
+		}
+	}
+}
+
+int Hub75SendChangedRows (Hub75Encoder *encoder)
+{
+	size_t row_size = (size_t) encoder->depth * encoder->width;
+	int scan_rows = encoder->height / 2;
+	unsigned char *packet = encoder->packet;
+	size_t length = 0;
+	int rows_sent = 0;
+
+	for (int row = 0; row < scan_rows; row++)
+	{
+		unsigned char *current = encoder->planes + row * row_size;
+		unsigned char *previous = encoder->previous + row * row_size;
+		if (!encoder->full_refresh && memcmp (current, previous, row_size) == 0)
+			continue;
+		packet[length++] = HUB75_PACKET_MAGIC;
+		packet[length++] = (unsigned char) row;
+		packet[length++] = (unsigned char) (row_size & 0xFF);
+		packet[length++] = (unsigned char) (row_size >> 8);
+		memcpy (packet + length, current, row_size);
+		memcpy (previous, current, row_size);
+		length += row_size;
+		rows_sent++;
+	}
+	// Nothing changed, nothing to latch
+	if (rows_sent == 0)
+		return 0;
+	packet[length++] = HUB75_PACKET_MAGIC;
+	packet[length++] = HUB75_FRAME_END;
+	packet[length++] = 0;
+	packet[length++] = 0;
+
+	if (WriteFrame (encoder, packet, length) != 0)
+	{
+		// The receiver missed this frame, so resend everything next time
+		encoder->full_refresh = 1;
+		return -1;
+	}
+	encoder->full_refresh = 0;
+	return rows_sent;
+}
+
+void Hub75Close (Hub75Encoder *encoder)
+{
+	if (encoder->fd >= 0)
+		close (encoder->fd);
+	free (encoder->pixels);
+	free (encoder->planes);
+	free (encoder->previous);
+	free (encoder->packet);
+	free (encoder->span_x);
+	free (encoder->span_y);
+	free (encoder->path);
+	memset (encoder, 0, sizeof (*encoder));
+	encoder->fd = -1;
+}
+
+int Hub75Start (Hub75Output *output, const char *path, int width, int height, int depth, float gamma)
+{
+	memset (output, 0, sizeof (*output));
+	if (Hub75Init (&output->encoder, path, width, height, depth, gamma) != 0)
+		return -1;
+	pthread_mutex_init (&output->lock, NULL);
+	pthread_cond_init (&output->wake, NULL);
+	if (pthread_create (&output->thread, NULL, SendThread, output) != 0)
+	{
+		pthread_cond_destroy (&output->wake);
+		pthread_mutex_destroy (&output->lock);
+		Hub75Close (&output->encoder);
+		return -1;
+	}
+	return 0;
+}
+
+void Hub75Submit (Hub75Output *output, const Hub75Job *job)
+{
+	pthread_mutex_lock (&output->lock);
+	if (output->queued == HUB75_QUEUE)
+	{
+		atomic_store (output->queue[0].done, 1);
+		memmove (output->queue, output->queue + 1, (size_t) (HUB75_QUEUE - 1) * sizeof (Hub75Job));
+		output->queued--;
+		output->dropped++;
+	}
+	output->queue[output->queued++] = *job;
+	pthread_cond_signal (&output->wake);
+	pthread_mutex_unlock (&output->lock);
+}
+
+void Hub75Stop (Hub75Output *output)
+{
+	pthread_mutex_lock (&output->lock);
+	output->stopping = 1;
+	pthread_cond_signal (&output->wake);
+	pthread_mutex_unlock (&output->lock);
+	pthread_join (output->thread, NULL);
+
+	// Frames still waiting are not sent
+	for (int i = 0; i < output->queued; i++)
+		atomic_store (output->queue[i].done, 1);
+	pthread_cond_destroy (&output->wake);
+	pthread_mutex_destroy (&output->lock);
+	Hub75Close (&output->encoder);
+}
+
+static void *SendThread (void *data)
+{
+	Hub75Output *output = data;
+
+	// A reader that went away is a write error for this thread, not a SIGPIPE that ends the program
+	sigset_t pipe_signal;
+	sigemptyset (&pipe_signal);
+	sigaddset (&pipe_signal, SIGPIPE);
+	pthread_sigmask (SIG_BLOCK, &pipe_signal, NULL);
+
+	pthread_mutex_lock (&output->lock);
+	while (1)
+	{
+		while (output->queued == 0 && !output->stopping)
+			pthread_cond_wait (&output->wake, &output->lock);
+		if (output->stopping)
+			break;
+		// Off the queue while it is worked on, so Hub75Submit () only ever drops frames not started
+		Hub75Job job = output->queue[0];
+		memmove (output->queue, output->queue + 1, (size_t) (output->queued - 1) * sizeof (Hub75Job));
+		output->queued--;
+		pthread_mutex_unlock (&output->lock);
+
+		Hub75Downsample (&output->encoder, job.rgba, job.width, job.height);
+		atomic_store (job.done, 1);
+		Hub75Encode (&output->encoder);
+		int rows = Hub75SendChangedRows (&output->encoder);
+
+		pthread_mutex_lock (&output->lock);
+		if (rows < 0)
+			output->dropped++;
+		else if (rows > 0)
+			output->frames++;
+	}
+	pthread_mutex_unlock (&output->lock);
+	return NULL;
+}
+
+static int WriteFrame (Hub75Encoder *encoder, const unsigned char *data, size_t length)
+{
+	// Not open: a pipe nobody was reading, or an output given up on
+	if (encoder->fd < 0)
+	{
+		encoder->fd = open (encoder->path, O_WRONLY | O_APPEND | O_NONBLOCK | O_CLOEXEC);
+		if (encoder->fd < 0)
+			return -1;
+	}
+
+	size_t sent = 0;
+	while (sent < length)
+	{
+		ssize_t written = write (encoder->fd, data + sent, length - sent);
+		if (written >= 0)
+		{
+			sent += (size_t) written;
+			continue;
+		}
+		if (errno == EINTR)
+			continue;
+		// No room: the frame is dropped if none of it went out
+		if (errno == EAGAIN && sent == 0)
+			return -1;
+		// Part of it did, and the rest has to follow or the stream is out of step
+		struct pollfd room = {encoder->fd, POLLOUT, 0};
+		if (errno == EAGAIN && poll (&room, 1, HUB75_WRITE_WAIT_MS) > 0 && !(room.revents & (POLLERR | POLLHUP)))
+			continue;
+		// Gone, or stuck halfway through a frame: the reader gets a new stream from the next open
+		close (encoder->fd);
+		encoder->fd = -1;
+		return -1;
+	}
+	return 0;
+}
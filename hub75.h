@@ -0,0 +1,104 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - HUB75 LED matrix frame encoder
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+HUB75 panels are driven two rows at a time: row r and row r + height / 2 share a row address and
+are shifted out together on the R1 G1 B1 and R2 G2 B2 lines. Colour depth comes from binary code
+modulation, so each row address is sent once per bit plane and the controller shows plane p for
+2^p time units.
+
+Output stream (all packets start with HUB75_PACKET_MAGIC):
+	[magic] [row address] [length lo] [length hi] [depth planes * width bytes]
+	[magic] [HUB75_FRAME_END] [0] [0]
+Every data byte is one column of one plane: bit 0-2 = R1 G1 B1, bit 3-5 = R2 G2 B2.
+Only row addresses that changed since the last frame are sent.
+
+Nothing waits on the reader. The output is opened and written without blocking: a pipe nobody
+has opened yet is tried again every frame, and a frame the reader has no room for is dropped and
+everything sent again with the next one. Only a frame already partly written is given up to
+HUB75_WRITE_WAIT_MS to finish, so the stream stays in step; after that the output is opened again.
+Hub75Start () runs the encoder on a thread of its own that Hub75Submit () hands frames to, so
+the render loop pays for none of it. The panel only ever needs the newest frame, so one that is
+still waiting when the next comes is dropped.
+
+**************************************************************************************************/
+
+#ifndef HUB75_H
+#define HUB75_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define HUB75_PACKET_MAGIC 0xA5
+#define HUB75_FRAME_END    0xFF
+#define HUB75_MAX_DEPTH    8
+#define HUB75_MAX_ROWS     255 // Row addresses below HUB75_FRAME_END, so height / 2 at most this
+#define HUB75_MAX_LENGTH   0xFFFF // depth * width has to fit the 16-bit length
+#define HUB75_QUEUE        1 // Frames waiting for the thread, a newer one pushes the oldest out
+#define HUB75_WRITE_WAIT_MS 100 // For the rest of a frame the reader took part of
+
+typedef struct Hub75Encoder
+{
+	int fd; // Output file or pipe, -1 = not open (yet)
+	char *path; // To open it again
+	int width, height; // Panel (or chained panels) resolution in pixels
+	int depth; // Bit planes per colour channel (1-8)
+	int full_refresh; // Send every row on the next frame
+
+	uint64_t spread[6][256]; // 8-bit channel value -> gamma corrected bit planes, one byte per plane
+	unsigned char *pixels; // Downsampled RGB frame at panel resolution
+	unsigned char *planes; // Encoded frame: [row address][plane][column]
+	unsigned char *previous; // Last frame that was sent
+	unsigned char *packet; // Output buffer for one frame
+
+	int source_width, source_height; // Box filter spans for the last source size
+	int *span_x, *span_y;
+} Hub75Encoder;
+
+typedef struct Hub75Job
+{
+	const unsigned char *rgba; // Rows bottom-up, as read from OpenGL
+	int width, height;
+	_Atomic int *done; // Set once rgba is no longer needed
+} Hub75Job;
+
+typedef struct Hub75Output
+{
+	Hub75Encoder encoder; // Owned by the thread
+	pthread_t thread;
+	pthread_mutex_t lock; // Guards the queue and the counters
+	pthread_cond_t wake;
+	int stopping;
+	Hub75Job queue[HUB75_QUEUE];
+	int queued;
+	unsigned long frames, dropped; // Frames sent; frames pushed out of the queue or not written
+} Hub75Output;
+
+int Hub75Init (Hub75Encoder *encoder, const char *path, int width, int height, int depth, float gamma); // Returns 0 on success
+void Hub75Downsample (Hub75Encoder *encoder, const unsigned char *rgba, int source_width, int source_height); // Box filter an RGBA frame to panel resolution; rows bottom-up, as read from OpenGL
+void Hub75Encode (Hub75Encoder *encoder); // Build bit planes from the downsampled frame
+int Hub75SendChangedRows (Hub75Encoder *encoder); // Returns number of rows sent, -1 if the frame was not written (all rows go again next time)
+void Hub75Close (Hub75Encoder *encoder);
+
+int Hub75Start (Hub75Output *output, const char *path, int width, int height, int depth, float gamma); // Hub75Init () and the thread; returns 0 on success
+void Hub75Submit (Hub75Output *output, const Hub75Job *job); // Never blocks; sets the done flag of a frame it pushes out
+void Hub75Stop (Hub75Output *output); // Before the frames' pixels go away
+
+#endif
@@ -0,0 +1,419 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - HUB75 encoder benchmark
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Feeds simulated board frames through the HUB75 encoder (hub75.h) as fast as it takes them and
+reports what each step costs per frame: the box filter down to panel size, the bit planes, and
+sending the changed rows, with how many rows and bytes that was.
+
+	hub75bench [--size WxH] [--panel WxH] [--depth N] [--gamma G] [--seconds S] [--fps N] [--out PATH]
+
+The stream goes through a pipe to a thread that reads it the way a panel controller would, and
+after every frame what it holds is compared with what was encoded. --out writes the stream to
+PATH instead and checks nothing. Also reported is what the copies GetScreenData () made of every
+frame cost, which the scoreboard no longer pays since frames come back through capture.h; the
+wait for glReadPixels () it did as well needs a GPU and is not counted.
+
+Then the same frames go through Hub75Start () and Hub75Submit (), as the scoreboard sends them,
+to a FIFO: first with nobody reading it, then with a reader that opened it and never reads.
+Fails if starting, a submit or stopping took long enough to hold up a frame. Submits are timed
+in the calling thread's CPU time as well, since on a single CPU the clock on the wall also counts
+the output's thread running in between.
+
+The frames are the ones ringbench draws: white border, blue background, black boxes,
+seven-segment digits for the clocks changing every tenth of a second and the scores now and then.
+
+**************************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "hub75.h"
+
+#define STUCK_LIMIT_NS 1000000 // A submit this long would be a missed frame at high refresh rates
+
+typedef struct Receiver
+{
+	int fd;
+	int scan_rows;
+	size_t row_size;
+	unsigned char *shown; // What the panel holds: [row address][plane][column]
+	_Atomic long frames; // Frame ends read
+	_Atomic long bad; // Packets with a wrong magic, row address or length
+} Receiver;
+
+static void *Receive (void *data);
+static int StuckReaders (int width, int height, int panel_width, int panel_height, int depth, float gamma, int fps);
+static int ReadAll (int fd, unsigned char *data, size_t length);
+static void DrawBoard (uint32_t *pixels, int width, int height, int64_t time_us);
+static void FillRect (uint32_t *pixels, int width, int height, int x, int y, int w, int h, uint32_t color);
+static void DrawDigit (uint32_t *pixels, int width, int height, int digit, int x, int y, int size, uint32_t color);
+static uint32_t Rgb (int r, int g, int b);
+static int64_t NowNs (void);
+static int64_t CpuNs (void);
+
+int main (int argc, char *argv[])
+{
+	int width = 1920, height = 1080, panel_width = 64, panel_height = 32, depth = 8, fps = 60;
+	double seconds = 60, gamma = 2.2;
+	const char *out_path = NULL;
+	static struct option long_options[] =
+	{
+		{"size", required_argument, 0, 'S'},
+		{"panel", required_argument, 0, 'P'},
+		{"depth", required_argument, 0, 'd'},
+		{"gamma", required_argument, 0, 'g'},
+		{"seconds", required_argument, 0, 's'},
+		{"fps", required_argument, 0, 'f'},
+		{"out", required_argument, 0, 'o'},
+		{0, 0, 0, 0}
+	};
+
+	int c;
+	while ((c = getopt_long (argc, argv, "", long_options, NULL)) != -1)
+	{
+		switch (c)
+		{
+			case 'S':
+				if (sscanf (optarg, "%dx%d", &width, &height) != 2)
+					width = 0;
+				break;
+			case 'P':
+				if (sscanf (optarg, "%dx%d", &panel_width, &panel_height) != 2)
+					panel_width = 0;
+				break;
+			case 'd': depth = atoi (optarg); break;
+			case 'g': gamma = atof (optarg); break;
+			case 's': seconds = atof (optarg); break;
+			case 'f': fps = atoi (optarg); break;
+			case 'o': out_path = optarg; break;
+			default:
+				fprintf (stderr, "usage: %s [--size WxH] [--panel WxH] [--depth N] [--gamma G] [--seconds S] [--fps N] [--out PATH]\n", argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+	if (width < 64 || height < 64 || panel_width <= 0 || panel_height <= 0 || seconds <= 0 || fps <= 0)
+	{
+		fprintf (stderr, "usage: %s [--size WxH] [--panel WxH] [--depth N] [--gamma G] [--seconds S] [--fps N] [--out PATH]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	// Without --out the stream goes to the receiving thread
+	int fds[2] = {-1, -1};
+	char path[64];
+	if (out_path == NULL)
+	{
+		if (pipe (fds) != 0)
+			return EXIT_FAILURE;
+		snprintf (path, sizeof (path), "/dev/fd/%d", fds[1]);
+	}
+	Hub75Encoder encoder;
+	if (Hub75Init (&encoder, out_path ? out_path : path, panel_width, panel_height, depth, (float) gamma) != 0)
+	{
+		fprintf (stderr, "%s: could not start a %dx%d panel at depth %d (height even, up to %d rows, depth x width up to %d)\n",
+			argv[0], panel_width, panel_height, depth, HUB75_MAX_ROWS * 2, HUB75_MAX_LENGTH);
+		return EXIT_FAILURE;
+	}
+	Receiver receiver = {fds[0], panel_height / 2, (size_t) depth * panel_width, NULL, 0, 0};
+	pthread_t thread;
+	if (out_path == NULL)
+	{
+		// Opened again by Hub75Init (), this end is not needed
+		close (fds[1]);
+		receiver.shown = calloc ((size_t) receiver.scan_rows * receiver.row_size, 1);
+		if (receiver.shown == NULL || pthread_create (&thread, NULL, Receive, &receiver) != 0)
+			return EXIT_FAILURE;
+	}
+
+	size_t count = (size_t) width * height;
+	uint32_t *frame = malloc (count * 4);
+	if (frame == NULL)
+		return EXIT_FAILURE;
+
+	long total = (long) (seconds * fps), frames_sent = 0, rows_sent = 0, mismatches = 0, errors = 0;
+	int64_t downsample_ns = 0, encode_ns = 0, send_ns = 0, copy_ns = 0;
+	for (long i = 0; i < total; i++)
+	{
+		DrawBoard (frame, width, height, i * 1000000 / fps);
+
+		// What GetScreenData () did on top of the read: a buffer to read into, a second one turned
+		// upright, the first freed, and the second freed once the frame was sent
+		int64_t start = NowNs ();
+		unsigned char *read = malloc (count * 4);
+		unsigned char *upright = malloc (count * 4);
+		if (read == NULL || upright == NULL)
+			return EXIT_FAILURE;
+		memcpy (read, frame, count * 4);
+		for (int y = 0; y < height; y++)
+			memcpy (upright + (size_t) (height - 1 - y) * width * 4, read + (size_t) y * width * 4, (size_t) width * 4);
+		free (read);
+		free (upright);
+		copy_ns += NowNs () - start;
+
+		start = NowNs ();
+		Hub75Downsample (&encoder, (const unsigned char *) frame, width, height);
+		int64_t downsampled = NowNs ();
+		Hub75Encode (&encoder);
+		int64_t encoded = NowNs ();
+		int rows = Hub75SendChangedRows (&encoder);
+		int64_t sent = NowNs ();
+		downsample_ns += downsampled - start;
+		encode_ns += encoded - downsampled;
+		send_ns += sent - encoded;
+		if (rows < 0)
+		{
+			errors++;
+			continue;
+		}
+		if (rows == 0)
+			continue;
+		rows_sent += rows;
+		frames_sent++;
+
+		// The receiver holds the frame once it has read its end
+		if (out_path == NULL)
+		{
+			while (atomic_load (&receiver.frames) < frames_sent)
+				usleep (50);
+			if (memcmp (receiver.shown, encoder.planes, (size_t) receiver.scan_rows * receiver.row_size) != 0)
+				mismatches++;
+		}
+	}
+
+	Hub75Close (&encoder);
+	if (out_path == NULL)
+	{
+		pthread_join (thread, NULL);
+		close (fds[0]);
+	}
+
+	size_t row_bytes = (size_t) depth * panel_width + 4;
+	double frame_bytes = frames_sent ? (double) rows_sent * row_bytes / frames_sent + 4 : 0;
+	printf ("%ld frames of %dx%d to a %dx%d panel at depth %d, %ld sent\n", total, width, height, panel_width, panel_height, depth, frames_sent);
+	printf ("downsample %.3f ms, encode %.3f ms, send %.3f ms per frame\n", downsample_ns / 1e6 / total, encode_ns / 1e6 / total, send_ns / 1e6 / total);
+	printf ("%.1f of %d rows and %.1f KB per frame sent, %.1f KB/s at %d fps\n", frames_sent ? (double) rows_sent / frames_sent : 0.0, panel_height / 2,
+		frame_bytes / 1024, frame_bytes * frames_sent / 1024 / (total / (double) fps), fps);
+	printf ("GetScreenData () copies no longer made: %.3f ms per frame\n", copy_ns / 1e6 / total);
+	if (out_path == NULL)
+		printf ("%ld frames did not match what was encoded, %ld bad packets, %ld write errors\n", mismatches, atomic_load (&receiver.bad), errors);
+
+	free (frame);
+	free (receiver.shown);
+	int stuck_ok = StuckReaders (width, height, panel_width, panel_height, depth, (float) gamma, fps) == 0;
+	return mismatches || errors || atomic_load (&receiver.bad) || !stuck_ok ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static int StuckReaders (int width, int height, int panel_width, int panel_height, int depth, float gamma, int fps)
+{
+	char dir[] = "/tmp/hub75bench.XXXXXX", fifo[64];
+	if (mkdtemp (dir) == NULL)
+		return -1;
+	snprintf (fifo, sizeof (fifo), "%s/fifo", dir);
+	if (mkfifo (fifo, 0600) != 0)
+	{
+		rmdir (dir);
+		return -1;
+	}
+
+	// Two frames, one drawn while the thread may still be reading the other
+	uint32_t *frames[2] = {malloc ((size_t) width * height * 4), malloc ((size_t) width * height * 4)};
+	_Atomic int done[2] = {1, 1};
+	Hub75Output output;
+	int64_t start = NowNs ();
+	int started = frames[0] && frames[1] && Hub75Start (&output, fifo, panel_width, panel_height, depth, gamma) == 0;
+	int64_t start_ns = NowNs () - start, worst_ns = 0, worst_cpu_ns = 0, stop_ns = 0;
+	int reader = -1;
+	long submitted = 0;
+	if (started)
+	{
+		// A second with nobody reading, then a second with a reader that never does
+		for (int phase = 0; phase < 2; phase++)
+		{
+			if (phase == 1)
+				reader = open (fifo, O_RDONLY | O_NONBLOCK);
+			for (int i = 0; i < fps; i++, submitted++)
+			{
+				int slot = (int) (submitted % 2);
+				while (!atomic_load (&done[slot]))
+					usleep (100);
+				DrawBoard (frames[slot], width, height, submitted * 1000000 / fps);
+				atomic_store (&done[slot], 0);
+				Hub75Job job = {(const unsigned char *) frames[slot], width, height, &done[slot]};
+				start = NowNs ();
+				int64_t cpu = CpuNs ();
+				Hub75Submit (&output, &job);
+				int64_t took_ns = NowNs () - start, took_cpu_ns = CpuNs () - cpu;
+				if (took_ns > worst_ns)
+					worst_ns = took_ns;
+				if (took_cpu_ns > worst_cpu_ns)
+					worst_cpu_ns = took_cpu_ns;
+				usleep ((useconds_t) (1000000 / fps));
+			}
+		}
+		start = NowNs ();
+		Hub75Stop (&output);
+		stop_ns = NowNs () - start;
+	}
+	if (reader >= 0)
+		close (reader);
+	unlink (fifo);
+	rmdir (dir);
+	free (frames[0]);
+	free (frames[1]);
+	if (!started)
+	{
+		printf ("could not start the output thread on a FIFO\n");
+		return -1;
+	}
+
+	printf ("to a FIFO nobody read: start %.3f ms, submit at most %.3f ms (%.3f ms CPU), stop %.3f ms; %lu of %ld frames sent, %lu dropped\n",
+		start_ns / 1e6, worst_ns / 1e6, worst_cpu_ns / 1e6, stop_ns / 1e6, output.frames, submitted, output.dropped);
+	// Stopping may wait out one frame the reader took part of
+	return start_ns < STUCK_LIMIT_NS && worst_cpu_ns < STUCK_LIMIT_NS && stop_ns < (HUB75_WRITE_WAIT_MS + 100) * 1000000LL ? 0 : -1;
+}
+
+static void *Receive (void *data)
+{
+	Receiver *receiver = data;
+	unsigned char header[4];
+
+	// Until Hub75Close () closes the other end
+	while (ReadAll (receiver->fd, header, sizeof (header)) == 0)
+	{
+		size_t length = (size_t) header[2] | (size_t) header[3] << 8;
+		if (header[0] != HUB75_PACKET_MAGIC)
+		{
+			atomic_fetch_add (&receiver->bad, 1);
+			break;
+		}
+		if (header[1] == HUB75_FRAME_END)
+		{
+			atomic_fetch_add (&receiver->frames, 1);
+			continue;
+		}
+		if (header[1] >= receiver->scan_rows || length != receiver->row_size)
+		{
+			atomic_fetch_add (&receiver->bad, 1);
+			break;
+		}
+		if (ReadAll (receiver->fd, receiver->shown + header[1] * receiver->row_size, length) != 0)
+			break;
+	}
+	return NULL;
+}
+
+static int ReadAll (int fd, unsigned char *data, size_t length)
+{
+	while (length > 0)
+	{
+		ssize_t got = read (fd, data, length);
+		if (got < 0 && errno == EINTR)
+			continue;
+		if (got <= 0)
+			return -1;
+		data += got;
+		length -= (size_t) got;
+	}
+	return 0;
+}
+
+static void DrawBoard (uint32_t *pixels, int width, int height, int64_t time_us)
+{
+	int border = width / 96;
+	FillRect (pixels, width, height, 0, 0, width, height, Rgb (255, 255, 255));
+	FillRect (pixels, width, height, border, border, width - border * 2, height - border * 2, Rgb (0, 82, 172));
+
+	// Main clock counting down from 8:00, shot clock from 35, scores every 30 s
+	int tenths = (int) (4800 - time_us / 100000 % 4800);
+	int shot = (int) (350 - time_us / 100000 % 350);
+	int score = (int) (time_us / 30000000);
+	int main_digits[4] = {tenths / 600, tenths / 10 % 60 / 10, tenths / 10 % 10, tenths % 10};
+	int shot_digits[2] = {shot / 100, shot / 10 % 10};
+	int score_digits[2][2] = {{score * 2 / 10 % 10, score * 2 % 10}, {score * 3 / 10 % 10, score * 3 % 10}};
+
+	int x = width / 2 - border * 15, y = border * 4;
+	FillRect (pixels, width, height, x - border, y - border, border * 31, border * 13, Rgb (255, 255, 255));
+	FillRect (pixels, width, height, x, y, border * 29, border * 11, 0xff000000);
+	for (int i = 0; i < 4; i++)
+		DrawDigit (pixels, width, height, main_digits[i], x + border + i * border * 7, y + border, border * 5, Rgb (253, 249, 0));
+
+	y = height / 2;
+	FillRect (pixels, width, height, x + border * 7, y, border * 15, border * 11, 0xff000000);
+	for (int i = 0; i < 2; i++)
+		DrawDigit (pixels, width, height, shot_digits[i], x + border * 8 + i * border * 7, y + border, border * 5, Rgb (230, 41, 55));
+	for (int team = 0; team < 2; team++)
+	{
+		int box_x = team == 0 ? border * 6 : width - border * 22;
+		FillRect (pixels, width, height, box_x, y, border * 15, border * 11, 0xff000000);
+		for (int i = 0; i < 2; i++)
+			DrawDigit (pixels, width, height, score_digits[team][i], box_x + border + i * border * 7, y + border, border * 5, Rgb (253, 249, 0));
+	}
+}
+
+static void DrawDigit (uint32_t *pixels, int width, int height, int digit, int x, int y, int size, uint32_t color)
+{
+	// Segments a-g, the same layout DrawDigit () in main.c uses
+	static const unsigned char segments[10] = {0x3f, 0x06, 0x5b, 0x4f, 0x66, 0x6d, 0x7d, 0x07, 0x7f, 0x6f};
+	int t = size / 5 > 0 ? size / 5 : 1;
+	int rects[7][4] =
+	{
+		{x, y, size, t}, {x + size - t, y, t, size}, {x + size - t, y + size, t, size},
+		{x, y + size * 2 - t, size, t}, {x, y + size, t, size}, {x, y, t, size}, {x, y + size - t / 2, size, t}
+	};
+	for (int i = 0; i < 7; i++)
+		FillRect (pixels, width, height, rects[i][0], rects[i][1], rects[i][2], rects[i][3], segments[digit] & (1 << i) ? color : Rgb (40, 40, 40));
+}
+
+static void FillRect (uint32_t *pixels, int width, int height, int x, int y, int w, int h, uint32_t color)
+{
+	for (int row = y < 0 ? 0 : y; row < y + h && row < height; row++)
+		for (int column = x < 0 ? 0 : x; column < x + w && column < width; column++)
+			pixels[(size_t) row * width + column] = color;
+}
+
+static uint32_t Rgb (int r, int g, int b)
+{
+	// Bytes in memory R, G, B, A, as glReadPixels returns them
+	unsigned char rgba[4] = {(unsigned char) r, (unsigned char) g, (unsigned char) b, 255};
+	uint32_t pixel;
+	memcpy (&pixel, rgba, 4);
+	return pixel;
+}
+
+static int64_t NowNs (void)
+{
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static int64_t CpuNs (void)
+{
+	struct timespec now;
+	clock_gettime (CLOCK_THREAD_CPUTIME_ID, &now);
+	return (int64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
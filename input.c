@@ -0,0 +1,96 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - input bindings
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+**************************************************************************************************/
+
+#include <string.h>
+#include <time.h>
+#include "input.h"
+
+static void Bind (unsigned char *table, int key, Action action);
+
+void BindingsBuild (BindingTable *table, const Config *config)
+{
+	memset (table, ACTION_NONE, sizeof (*table));
+
+	// Fixed keys first so a config binding on the same key wins
+	// Clock mode: increment, decrement, score +1/2/3, enter edit mode
+	Bind (table->clock, KEY_EQUAL, ACTION_INCREMENT);
+	Bind (table->clock, KEY_KP_ADD, ACTION_INCREMENT);
+	Bind (table->clock, KEY_MINUS, ACTION_DECREMENT);
+	Bind (table->clock, KEY_KP_SUBTRACT, ACTION_DECREMENT);
+	Bind (table->clock, KEY_ONE, ACTION_ADD_ONE);
+	Bind (table->clock, KEY_KP_1, ACTION_ADD_ONE);
+	Bind (table->clock, KEY_TWO, ACTION_ADD_TWO);
+	Bind (table->clock, KEY_KP_2, ACTION_ADD_TWO);
+	Bind (table->clock, KEY_THREE, ACTION_ADD_THREE);
+	Bind (table->clock, KEY_KP_3, ACTION_ADD_THREE);
+	Bind (table->clock, KEY_SLASH, ACTION_ENTER_EDIT_MODE);
+	Bind (table->clock, KEY_BACKSLASH, ACTION_ENTER_EDIT_MODE);
+
+	// Edit mode
+	Bind (table->edit, KEY_BACKSPACE, ACTION_EDIT_DISCARD);
+	Bind (table->edit, KEY_ENTER, ACTION_EDIT_SAVE);
+	Bind (table->edit, KEY_LEFT, ACTION_EDIT_LEFT);
+	Bind (table->edit, KEY_RIGHT, ACTION_EDIT_RIGHT);
+	Bind (table->edit, KEY_UP, ACTION_EDIT_MAIN_CLOCK);
+	Bind (table->edit, KEY_DOWN, ACTION_EDIT_SHOT_CLOCK);
+	Bind (table->edit, KEY_LEFT_SHIFT, ACTION_EDIT_TOGGLE_TENTHS);
+	for (int digit = 0; digit <= 9; digit++)
+	{
+		Bind (table->edit, KEY_ZERO + digit, ACTION_EDIT_DIGIT_0 + digit);
+		Bind (table->edit, KEY_KP_0 + digit, ACTION_EDIT_DIGIT_0 + digit);
+	}
+
+	// Config file keys
+	Bind (table->clock, config->keys[BIND_START_STOP_CLOCKS], ACTION_START_STOP_CLOCKS);
+	Bind (table->clock, config->keys[BIND_START_STOP_SHOT_CLOCK], ACTION_START_STOP_SHOT_CLOCK);
+	Bind (table->clock, config->keys[BIND_START_STOP_MAIN_CLOCK], ACTION_START_STOP_MAIN_CLOCK);
+	Bind (table->clock, config->keys[BIND_SWITCH_SHOT_CLOCK], ACTION_SWITCH_SHOT_CLOCK);
+	Bind (table->clock, config->keys[BIND_RESET_SHOT_CLOCK], ACTION_RESET_SHOT_CLOCK);
+	Bind (table->clock, config->keys[BIND_CHANGING_HOME], ACTION_SELECT_HOME);
+	Bind (table->clock, config->keys[BIND_CHANGING_VISITOR], ACTION_SELECT_VISITOR);
+	Bind (table->clock, config->keys[BIND_CHANGE_MODE_SCORE], ACTION_SELECT_SCORE);
+	Bind (table->clock, config->keys[BIND_CHANGE_MODE_FOULS], ACTION_SELECT_FOULS);
+	Bind (table->clock, config->keys[BIND_CHANGE_MODE_TOL], ACTION_SELECT_TOL);
+	Bind (table->clock, config->keys[BIND_CHANGE_MODE_PERIOD], ACTION_SELECT_PERIOD);
+	// The buzzer sounds while its key is held, so it is checked with IsKeyDown () instead of bound
+	// Fullscreen works in both modes
+	Bind (table->clock, config->keys[BIND_TOGGLE_FULLSCREEN], ACTION_TOGGLE_FULLSCREEN);
+	Bind (table->edit, config->keys[BIND_TOGGLE_FULLSCREEN], ACTION_TOGGLE_FULLSCREEN);
+}
+
+Action BindingLookup (const BindingTable *table, Mode mode, int key)
+{
+	if (key <= 0 || key >= KEY_CODE_COUNT)
+		return ACTION_NONE;
+	return (Action) (mode == CLOCK ? table->clock[key] : table->edit[key]);
+}
+
+int64_t InputNow (void)
+{
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static void Bind (unsigned char *table, int key, Action action)
+{
+	if (key > 0 && key < KEY_CODE_COUNT)
+		table[key] = (unsigned char) action;
+}
@@ -0,0 +1,45 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - input bindings
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Keys are turned into Actions through one lookup table per mode, so handling a key press costs the
+same no matter how many bindings there are. The tables are rebuilt when the config is reloaded.
+
+**************************************************************************************************/
+
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdint.h>
+#include "board.h"
+#include "config.h"
+
+#define KEY_CODE_COUNT 512 // raylib key codes are all below this
+
+typedef struct BindingTable
+{
+	unsigned char clock[KEY_CODE_COUNT]; // Key code -> Action in clock mode
+	unsigned char edit[KEY_CODE_COUNT]; // Key code -> Action in edit mode
+} BindingTable;
+
+void BindingsBuild (BindingTable *table, const Config *config);
+Action BindingLookup (const BindingTable *table, Mode mode, int key);
+int64_t InputNow (void); // Monotonic time in microseconds
+
+#endif
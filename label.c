@@ -0,0 +1,224 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - text labels
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+**************************************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "label.h"
+#include "rlgl.h"
+
+// The distance is 0.5 on the edge of a glyph (sdffont.c); the edge is blended over one screen pixel
+#if defined (GRAPHICS_API_OPENGL_ES2)
+static const char *sdf_shader =
+	"#version 100\n"
+	"#extension GL_OES_standard_derivatives : enable\n"
+	"precision mediump float;\n"
+	"varying vec2 fragTexCoord;\n"
+	"varying vec4 fragColor;\n"
+	"uniform sampler2D texture0;\n"
+	"uniform vec4 colDiffuse;\n"
+	"void main ()\n"
+	"{\n"
+	"	float distance = texture2D (texture0, fragTexCoord).a - 0.5;\n"
+	"	float pixel = length (vec2 (dFdx (distance), dFdy (distance)));\n"
+	"	gl_FragColor = vec4 (fragColor.rgb, fragColor.a * smoothstep (-pixel, pixel, distance)) * colDiffuse;\n"
+	"}\n";
+#else
+static const char *sdf_shader =
+	"#version 330\n"
+	"in vec2 fragTexCoord;\n"
+	"in vec4 fragColor;\n"
+	"uniform sampler2D texture0;\n"
+	"uniform vec4 colDiffuse;\n"
+	"out vec4 finalColor;\n"
+	"void main ()\n"
+	"{\n"
+	"	float distance = texture (texture0, fragTexCoord).a - 0.5;\n"
+	"	float pixel = length (vec2 (dFdx (distance), dFdy (distance)));\n"
+	"	finalColor = vec4 (fragColor.rgb, fragColor.a * smoothstep (-pixel, pixel, distance)) * colDiffuse;\n"
+	"}\n";
+#endif
+
+static int LoadGlyphs (LabelFont *font, const char *path);
+
+int LabelFontLoad (LabelFont *font)
+{
+	memset (font, 0, sizeof (*font));
+	if (!FileExists (LABEL_FONT_NAME ".png"))
+		return -1;
+	font->atlas = LoadTexture (LABEL_FONT_NAME ".png");
+	if (font->atlas.id == 0)
+		return -1;
+	if (LoadGlyphs (font, LABEL_FONT_NAME ".glyphs") != 0)
+	{
+		fprintf (stderr, "Could not read '%s', drawing labels with the default font\n", LABEL_FONT_NAME ".glyphs");
+		UnloadTexture (font->atlas);
+		return -1;
+	}
+	font->shader = LoadShaderFromMemory (NULL, sdf_shader);
+	if (font->shader.id == 0)
+	{
+		UnloadTexture (font->atlas);
+		return -1;
+	}
+	SetTextureFilter (font->atlas, TEXTURE_FILTER_BILINEAR);
+	font->loaded = 1;
+	return 0;
+}
+
+float LabelSet (Label *label, const LabelFont *font, const char *text, float size)
+{
+	// Laid out already
+	if (label->size == size && label->atlas == font->loaded && strncmp (label->text, text, LABEL_TEXT_LENGTH - 1) == 0)
+		return label->width;
+
+	snprintf (label->text, sizeof (label->text), "%s", text);
+	label->size = size;
+	label->atlas = font->loaded;
+	label->length = (int) strlen (label->text);
+	if (!font->loaded)
+	{
+		label->width = (float) MeasureText (label->text, (int) size);
+		return label->width;
+	}
+
+	float scale = size / font->base_size, pen = 0;
+	for (int i = 0; i < label->length; i++)
+	{
+		int c = (unsigned char) label->text[i];
+		int index = c >= LABEL_FIRST_CHAR && c < LABEL_FIRST_CHAR + LABEL_CHAR_COUNT ? c - LABEL_FIRST_CHAR : '?' - LABEL_FIRST_CHAR;
+		const LabelGlyph *glyph = &font->glyphs[index];
+		label->glyphs[i] = (unsigned char) index;
+		label->quads[i] = (Rectangle){pen + glyph->offset_x * scale, glyph->offset_y * scale, glyph->width * scale, glyph->height * scale};
+		pen += glyph->advance * scale;
+	}
+	label->width = pen;
+	return label->width;
+}
+
+void LabelQueue (LabelFont *font, const Label *label, float x, float y, Color color)
+{
+	if (font->queued < LABEL_QUEUE_MAX)
+		font->queue[font->queued++] = (LabelQueued){label, {x, y}, color};
+}
+
+void LabelFlush (LabelFont *font)
+{
+	if (font->queued == 0)
+		return;
+	if (!font->loaded)
+	{
+		for (int i = 0; i < font->queued; i++)
+		{
+			const LabelQueued *queued = &font->queue[i];
+			DrawText (queued->label->text, (int) queued->position.x, (int) queued->position.y, (int) queued->label->size, queued->color);
+		}
+		font->queued = 0;
+		return;
+	}
+
+	// Every glyph of every label as quads of one texture under one shader, drawn when the shader is switched back
+	int quads = 0;
+	for (int i = 0; i < font->queued; i++)
+		quads += font->queue[i].label->length;
+	rlCheckRenderBatchLimit (quads * 4);
+	BeginShaderMode (font->shader);
+	rlSetTexture (font->atlas.id);
+	rlBegin (RL_QUADS);
+	rlNormal3f (0, 0, 1);
+	for (int i = 0; i < font->queued; i++)
+	{
+		const LabelQueued *queued = &font->queue[i];
+		const Label *label = queued->label;
+		rlColor4ub (queued->color.r, queued->color.g, queued->color.b, queued->color.a);
+		for (int j = 0; j < label->length; j++)
+		{
+			Rectangle source = font->glyphs[label->glyphs[j]].source;
+			float left = queued->position.x + label->quads[j].x, top = queued->position.y + label->quads[j].y;
+			float right = left + label->quads[j].width, bottom = top + label->quads[j].height;
+			rlTexCoord2f (source.x, source.y);
+			rlVertex2f (left, top);
+			rlTexCoord2f (source.x, source.y + source.height);
+			rlVertex2f (left, bottom);
+			rlTexCoord2f (source.x + source.width, source.y + source.height);
+			rlVertex2f (right, bottom);
+			rlTexCoord2f (source.x + source.width, source.y);
+			rlVertex2f (right, top);
+		}
+	}
+	rlEnd ();
+	rlSetTexture (0);
+	EndShaderMode ();
+	font->queued = 0;
+}
+
+void LabelFontUnload (LabelFont *font)
+{
+	if (font->loaded)
+	{
+		UnloadShader (font->shader);
+		UnloadTexture (font->atlas);
+	}
+	font->loaded = 0;
+	font->queued = 0;
+}
+
+static int LoadGlyphs (LabelFont *font, const char *path)
+{
+	/**********************************************************************************************
+
+	Written by sdffont next to the atlas: the size the glyphs were made at, then one line per
+	character with its rectangle in the atlas, where it goes from the pen position and how far
+	it moves the pen, all in atlas pixels:
+
+		sdffont 64
+		65 130 4 43 52 -3 9 38
+		...
+
+	**********************************************************************************************/
+
+	FILE *file = fopen (path, "r");
+	if (file == NULL)
+		return -1;
+	int base_size, found = 0;
+	if (fscanf (file, "sdffont %d", &base_size) != 1 || base_size <= 0)
+	{
+		fclose (file);
+		return -1;
+	}
+	font->base_size = (float) base_size;
+
+	int c;
+	float x, y, width, height, offset_x, offset_y, advance;
+	while (fscanf (file, "%d %f %f %f %f %f %f %f", &c, &x, &y, &width, &height, &offset_x, &offset_y, &advance) == 8)
+	{
+		if (c < LABEL_FIRST_CHAR || c >= LABEL_FIRST_CHAR + LABEL_CHAR_COUNT || width < 0 || height < 0)
+			continue;
+		LabelGlyph *glyph = &font->glyphs[c - LABEL_FIRST_CHAR];
+		glyph->source = (Rectangle){x / font->atlas.width, y / font->atlas.height, width / font->atlas.width, height / font->atlas.height};
+		glyph->offset_x = offset_x;
+		glyph->offset_y = offset_y;
+		glyph->width = width;
+		glyph->height = height;
+		glyph->advance = advance;
+		found++;
+	}
+	fclose (file);
+	return found > 0 ? 0 : -1;
+}
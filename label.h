@@ -0,0 +1,92 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - text labels
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+The words on the board (team names, PERIOD, FOULS, T.O.L.), drawn from a signed distance field
+glyph atlas so they stay sharp at any size. The atlas is made once from a TrueType font by the
+sdffont tool and loaded from LABEL_FONT_NAME.png and LABEL_FONT_NAME.glyphs; every texel holds how
+far it is from the edge of a glyph, and a small shader turns that back into an edge one pixel wide
+at whatever size the glyph is drawn.
+
+Each label keeps its layout: LabelSet () only works out the glyph quads again when the text or
+size changes, which on a board is when the window is resized or a team is renamed. LabelQueue ()
+puts a laid out label on the list for the frame and LabelFlush () draws the whole list as one
+batch, one texture and one shader, so all the labels on the board are a single draw call.
+
+Without an atlas (or a GPU the shader does not build on) labels fall back to raylib's default
+font, still measured only when they change.
+
+**************************************************************************************************/
+
+#ifndef LABEL_H
+#define LABEL_H
+
+#include "raylib.h"
+
+#define LABEL_FONT_NAME "labels"
+#define LABEL_FIRST_CHAR 32 // The atlas has printable ASCII, anything else is drawn as '?'
+#define LABEL_CHAR_COUNT 95
+#define LABEL_TEXT_LENGTH 64 // Longer text is cut off
+#define LABEL_QUEUE_MAX 16 // Labels drawn per frame, all of them together fit in one rlgl batch
+
+typedef struct LabelGlyph
+{
+	Rectangle source; // Texture coordinates in the atlas, padding included
+	float offset_x, offset_y; // From the pen position to the top left of the glyph, in atlas pixels
+	float width, height;
+	float advance;
+} LabelGlyph;
+
+typedef struct Label
+{
+	char text[LABEL_TEXT_LENGTH];
+	float size; // Line height in pixels
+	float width;
+	int atlas; // Laid out for the atlas, 0 = for the default font
+	int length;
+	Rectangle quads[LABEL_TEXT_LENGTH]; // Per glyph, from the label's top left
+	unsigned char glyphs[LABEL_TEXT_LENGTH];
+} Label;
+
+typedef struct LabelQueued
+{
+	const Label *label;
+	Vector2 position;
+	Color color;
+} LabelQueued;
+
+typedef struct LabelFont
+{
+	int loaded; // 0 = drawing with the default font
+	Texture2D atlas;
+	Shader shader;
+	float base_size; // Pixel size the atlas was made at
+	LabelGlyph glyphs[LABEL_CHAR_COUNT];
+
+	LabelQueued queue[LABEL_QUEUE_MAX]; // This frame's
+	int queued;
+} LabelFont;
+
+int LabelFontLoad (LabelFont *font); // Returns 0 with the atlas loaded, -1 when falling back to the default font
+float LabelSet (Label *label, const LabelFont *font, const char *text, float size); // Returns the width
+void LabelQueue (LabelFont *font, const Label *label, float x, float y, Color color);
+void LabelFlush (LabelFont *font); // Draws and empties the queue, call once per frame after the rest of the board
+void LabelFontUnload (LabelFont *font);
+
+#endif
@@ -0,0 +1,211 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - core library
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+**************************************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "libscoreboard.h"
+#include "board.h"
+
+struct Scoreboard
+{
+	Board board;
+};
+
+// The library's numbers are the board's, so nothing is translated; a change to board.h that moves one fails here
+#define SAME(name) _Static_assert ((int) SCOREBOARD_##name == (int) name, #name " moved")
+SAME (ACTION_NONE);
+SAME (ACTION_TOGGLE_FULLSCREEN);
+SAME (ACTION_START_STOP_CLOCKS);
+SAME (ACTION_START_STOP_SHOT_CLOCK);
+SAME (ACTION_START_STOP_MAIN_CLOCK);
+SAME (ACTION_SWITCH_SHOT_CLOCK);
+SAME (ACTION_RESET_SHOT_CLOCK);
+SAME (ACTION_SELECT_HOME);
+SAME (ACTION_SELECT_VISITOR);
+SAME (ACTION_SELECT_SCORE);
+SAME (ACTION_SELECT_FOULS);
+SAME (ACTION_SELECT_TOL);
+SAME (ACTION_SELECT_PERIOD);
+SAME (ACTION_INCREMENT);
+SAME (ACTION_DECREMENT);
+SAME (ACTION_ADD_ONE);
+SAME (ACTION_ADD_TWO);
+SAME (ACTION_ADD_THREE);
+SAME (ACTION_ENTER_EDIT_MODE);
+SAME (ACTION_EDIT_DISCARD);
+SAME (ACTION_EDIT_SAVE);
+SAME (ACTION_EDIT_LEFT);
+SAME (ACTION_EDIT_RIGHT);
+SAME (ACTION_EDIT_MAIN_CLOCK);
+SAME (ACTION_EDIT_SHOT_CLOCK);
+SAME (ACTION_EDIT_TOGGLE_TENTHS);
+SAME (ACTION_EDIT_DIGIT_0);
+SAME (ACTION_EDIT_DIGIT_9);
+SAME (ACTION_COUNT);
+_Static_assert ((int) SCOREBOARD_CLOCK_MAIN == GAME_CLOCK_MAIN && (int) SCOREBOARD_CLOCK_SHOT == GAME_CLOCK_SHOT && (int) SCOREBOARD_CLOCK_TIMEOUT == GAME_CLOCK_TIMEOUT, "clocks moved");
+_Static_assert ((int) SCOREBOARD_MODE_CLOCK == CLOCK && (int) SCOREBOARD_MODE_EDIT == EDIT_MODE, "modes moved");
+_Static_assert ((int) SCOREBOARD_SELECTED_SCORE == SCORE && (int) SCOREBOARD_SELECTED_FOULS == FOULS && (int) SCOREBOARD_SELECTED_TOL == TOL && (int) SCOREBOARD_SELECTED_PERIOD == PERIOD, "change types moved");
+_Static_assert (sizeof (ScoreboardView) == 64, "ScoreboardView is one cache line");
+
+static int32_t Clamp (int32_t tenths);
+static int64_t ClampElapsed (int32_t elapsed_us);
+
+uint32_t ScoreboardAbiVersion (void)
+{
+	return SCOREBOARD_ABI_VERSION;
+}
+
+size_t ScoreboardSize (void)
+{
+	return sizeof (Scoreboard);
+}
+
+Scoreboard *ScoreboardInit (void *memory, int32_t main_clock_start, int32_t shot_clock_reset, int32_t timeout_short, int32_t timeout_long)
+{
+	Scoreboard *board = memory;
+	BoardInit (&board->board, main_clock_start, shot_clock_reset, timeout_short, timeout_long);
+	return board;
+}
+
+Scoreboard *ScoreboardNew (int32_t main_clock_start, int32_t shot_clock_reset, int32_t timeout_short, int32_t timeout_long)
+{
+	void *memory = malloc (sizeof (Scoreboard));
+	if (memory == NULL)
+		return NULL;
+	return ScoreboardInit (memory, main_clock_start, shot_clock_reset, timeout_short, timeout_long);
+}
+
+void ScoreboardFree (Scoreboard *board)
+{
+	free (board);
+}
+
+void ScoreboardCopy (Scoreboard *to, const Scoreboard *from)
+{
+	// The cue wheels are linked by index, so a copy is a value like any other (wheel.h)
+	memcpy (to, from, sizeof (*to));
+}
+
+void ScoreboardStep (Scoreboard *board, int64_t elapsed_us, int32_t action)
+{
+	// Same order as the frame loop: run the clocks up to the input, then apply it
+	if (elapsed_us > 0)
+		BoardAdvance (&board->board, elapsed_us);
+	if (action > ACTION_NONE && action < ACTION_COUNT && action != ACTION_TOGGLE_FULLSCREEN)
+		BoardApply (&board->board, (Action) action);
+}
+
+int32_t ScoreboardStopClocksAt (Scoreboard *board, int64_t ago_us)
+{
+	return BoardStopClocksAt (&board->board, ago_us);
+}
+
+void ScoreboardSetClock (Scoreboard *board, int32_t clock, int32_t tenths)
+{
+	Board *b = &board->board;
+	Time *times[] = {&b->main_clock, &b->shot_clock, &b->timeout_clock};
+	if (clock < 0 || clock >= GAME_CLOCK_COUNT || tenths < 0 || tenths > SCOREBOARD_CLOCK_MAX)
+		return;
+	// Only the clock that was set loses what a whistle could give back
+	int64_t main_run_us = b->main_clock_run_us, shot_run_us = b->shot_clock_run_us;
+	*times[clock] = IntToTime (tenths);
+	BoardScheduleCues (b);
+	if (clock != GAME_CLOCK_MAIN)
+		b->main_clock_run_us = main_run_us;
+	if (clock != GAME_CLOCK_SHOT)
+		b->shot_clock_run_us = shot_run_us;
+}
+
+void ScoreboardSetResetTimes (Scoreboard *board, int32_t shot_clock_reset, int32_t timeout_short, int32_t timeout_long)
+{
+	BoardSetResetTimes (&board->board, shot_clock_reset, timeout_short, timeout_long);
+}
+
+void ScoreboardRead (const Scoreboard *board, ScoreboardView *view)
+{
+	const Board *b = &board->board;
+	memset (view, 0, sizeof (*view));
+	view->main_clock = TimeToInt (b->main_clock);
+	view->shot_clock = TimeToInt (b->shot_clock);
+	view->timeout_clock = TimeToInt (b->timeout_clock);
+	view->main_clock_elapsed_us = (int32_t) b->main_clock_elapsed;
+	view->shot_clock_elapsed_us = (int32_t) b->shot_clock_elapsed;
+	view->timeout_clock_elapsed_us = (int32_t) b->timeout_clock_elapsed;
+	view->main_clock_edit = TimeToInt (b->main_clock_buffer);
+	view->shot_clock_edit = TimeToInt (b->shot_clock_buffer);
+	view->flags = (b->main_clock_running ? SCOREBOARD_MAIN_RUNNING : 0) | (b->shot_clock_running ? SCOREBOARD_SHOT_RUNNING : 0) |
+		(b->shot_clock_showing ? SCOREBOARD_SHOT_SHOWING : 0) | (b->shot_clock_enabled ? SCOREBOARD_SHOT_ENABLED : 0) |
+		(b->main_clock_mode == TENTH_SECONDS ? SCOREBOARD_MAIN_TENTHS : 0) | (b->shot_clock_mode == TENTH_SECONDS ? SCOREBOARD_SHOT_TENTHS : 0) |
+		(BoardBuzzerWanted (b) ? SCOREBOARD_BUZZER : 0);
+	for (int team = HOME; team <= VISITOR; team++)
+	{
+		view->score[team] = (int16_t) b->score[team];
+		view->fouls[team] = (uint8_t) b->fouls[team];
+		view->tol[team] = (uint8_t) b->tol[team];
+	}
+	view->period = (int8_t) b->period;
+	view->mode = (uint8_t) b->mode;
+	view->team = (uint8_t) b->team;
+	view->selected = (uint8_t) b->change_type;
+	view->edit_digit = (uint8_t) b->selected_digit;
+}
+
+void ScoreboardLoad (Scoreboard *board, const ScoreboardView *view)
+{
+	Board *b = &board->board;
+	b->mode = CLOCK;
+	b->main_clock = IntToTime (Clamp (view->main_clock));
+	b->shot_clock = IntToTime (Clamp (view->shot_clock));
+	b->timeout_clock = IntToTime (Clamp (view->timeout_clock));
+	b->main_clock_elapsed = ClampElapsed (view->main_clock_elapsed_us);
+	b->shot_clock_elapsed = ClampElapsed (view->shot_clock_elapsed_us);
+	b->timeout_clock_elapsed = ClampElapsed (view->timeout_clock_elapsed_us);
+	b->main_clock_running = (view->flags & SCOREBOARD_MAIN_RUNNING) != 0;
+	b->shot_clock_running = (view->flags & SCOREBOARD_SHOT_RUNNING) != 0;
+	b->shot_clock_showing = (view->flags & SCOREBOARD_SHOT_SHOWING) != 0;
+	b->shot_clock_enabled = (view->flags & SCOREBOARD_SHOT_ENABLED) != 0;
+	BoardScheduleCues (b);
+	// After the cues, which set the modes from the times; the view's are what was shown
+	b->main_clock_mode = view->flags & SCOREBOARD_MAIN_TENTHS ? TENTH_SECONDS : NORMAL;
+	b->shot_clock_mode = view->flags & SCOREBOARD_SHOT_TENTHS ? TENTH_SECONDS : NORMAL;
+	for (int team = HOME; team <= VISITOR; team++)
+	{
+		b->score[team] = view->score[team];
+		b->fouls[team] = view->fouls[team];
+		b->tol[team] = view->tol[team];
+	}
+	b->period = view->period;
+}
+
+int64_t ScoreboardUntilClockOut (const Scoreboard *board)
+{
+	return BoardUntilClockOut (&board->board);
+}
+
+static int32_t Clamp (int32_t tenths)
+{
+	return tenths < 0 ? 0 : tenths > SCOREBOARD_CLOCK_MAX ? SCOREBOARD_CLOCK_MAX : tenths;
+}
+
+static int64_t ClampElapsed (int32_t elapsed_us)
+{
+	// Part of a tenth, or the waits worked out from it go negative or past a tenth
+	return elapsed_us < 0 ? 0 : elapsed_us >= TENTH_SECOND_US ? TENTH_SECOND_US - 1 : elapsed_us;
+}
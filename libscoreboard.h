@@ -0,0 +1,145 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - core library
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+The board logic (board.h) for other programs, as libscoreboard.so: the clocks, score, fouls, TOL,
+period and edit mode, with no window, no threads and no globals, so a program can run as many
+boards as it likes. This header is all a program needs; it does not include board.h.
+
+A Scoreboard is opaque. The game goes on through ScoreboardStep (), which runs the clocks for some
+real time and then applies one action, so the same steps always give the same board, exactly as
+the scoreboard's own frame loop and the 'replay' tool do; the few other changes are functions of
+their own. A Scoreboard holds no pointers, so it can be placed anywhere (ScoreboardInit ()) and
+copied to keep a board as it was.
+
+ScoreboardRead () copies the board out into a ScoreboardView: one 64-byte cache line of fixed
+width fields, everything a display needs. ScoreboardLoad () goes the other way, for a board that
+shows another one's, e.g. a tile of a video wall.
+
+	Scoreboard *board = ScoreboardNew (4800, 350, 300, 600);
+	ScoreboardStep (board, 0, SCOREBOARD_ACTION_START_STOP_CLOCKS);
+	ScoreboardStep (board, 2500000, SCOREBOARD_ACTION_NONE);
+	ScoreboardView view;
+	ScoreboardRead (board, &view);
+	printf ("%d.%d\n", view.main_clock / 10, view.main_clock % 10); // 477.5
+	ScoreboardFree (board);
+
+The interface is kept compatible: action and clock numbers are never reused, the view only
+changes by using reserved bytes, and functions are only added. Anything else bumps
+SCOREBOARD_ABI_VERSION and the library's soname. A program built against this header can check
+ScoreboardAbiVersion () == SCOREBOARD_ABI_VERSION before using it.
+
+**************************************************************************************************/
+
+#ifndef LIBSCOREBOARD_H
+#define LIBSCOREBOARD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SCOREBOARD_ABI_VERSION 1
+#define SCOREBOARD_CLOCK_MAX 59999 // 99:59.9 in tenths, the most four digits show
+
+#define SCOREBOARD_API __attribute__ ((visibility ("default")))
+
+// Action numbers, the same as in --record traces (trace.h)
+typedef enum ScoreboardAction
+{
+	SCOREBOARD_ACTION_NONE = 0, // Only run the clocks
+	SCOREBOARD_ACTION_TOGGLE_FULLSCREEN = 1, // A window's, ignored
+	// Clock mode
+	SCOREBOARD_ACTION_START_STOP_CLOCKS = 2,
+	SCOREBOARD_ACTION_START_STOP_SHOT_CLOCK = 3,
+	SCOREBOARD_ACTION_START_STOP_MAIN_CLOCK = 4,
+	SCOREBOARD_ACTION_SWITCH_SHOT_CLOCK = 5,
+	SCOREBOARD_ACTION_RESET_SHOT_CLOCK = 6,
+	SCOREBOARD_ACTION_SELECT_HOME = 7,
+	SCOREBOARD_ACTION_SELECT_VISITOR = 8,
+	SCOREBOARD_ACTION_SELECT_SCORE = 9,
+	SCOREBOARD_ACTION_SELECT_FOULS = 10,
+	SCOREBOARD_ACTION_SELECT_TOL = 11,
+	SCOREBOARD_ACTION_SELECT_PERIOD = 12,
+	SCOREBOARD_ACTION_INCREMENT = 13,
+	SCOREBOARD_ACTION_DECREMENT = 14,
+	SCOREBOARD_ACTION_ADD_ONE = 15,
+	SCOREBOARD_ACTION_ADD_TWO = 16,
+	SCOREBOARD_ACTION_ADD_THREE = 17,
+	SCOREBOARD_ACTION_ENTER_EDIT_MODE = 18,
+	// Edit mode
+	SCOREBOARD_ACTION_EDIT_DISCARD = 19,
+	SCOREBOARD_ACTION_EDIT_SAVE = 20,
+	SCOREBOARD_ACTION_EDIT_LEFT = 21,
+	SCOREBOARD_ACTION_EDIT_RIGHT = 22,
+	SCOREBOARD_ACTION_EDIT_MAIN_CLOCK = 23,
+	SCOREBOARD_ACTION_EDIT_SHOT_CLOCK = 24,
+	SCOREBOARD_ACTION_EDIT_TOGGLE_TENTHS = 25,
+	SCOREBOARD_ACTION_EDIT_DIGIT_0 = 26, // + n replaces the selected digit with n
+	SCOREBOARD_ACTION_EDIT_DIGIT_9 = 35,
+	SCOREBOARD_ACTION_COUNT = 36
+} ScoreboardAction;
+
+typedef enum ScoreboardClock { SCOREBOARD_CLOCK_MAIN = 0, SCOREBOARD_CLOCK_SHOT = 1, SCOREBOARD_CLOCK_TIMEOUT = 2 } ScoreboardClock;
+typedef enum ScoreboardMode { SCOREBOARD_MODE_CLOCK = 0, SCOREBOARD_MODE_EDIT = 1 } ScoreboardMode;
+typedef enum ScoreboardSelected { SCOREBOARD_SELECTED_SCORE = 0, SCOREBOARD_SELECTED_FOULS = 1, SCOREBOARD_SELECTED_TOL = 2, SCOREBOARD_SELECTED_PERIOD = 3 } ScoreboardSelected;
+
+// ScoreboardView flags
+#define SCOREBOARD_MAIN_RUNNING   (1u << 0)
+#define SCOREBOARD_SHOT_RUNNING   (1u << 1) // Runs the timeout clock while that one is showing
+#define SCOREBOARD_SHOT_SHOWING   (1u << 2) // Otherwise the timeout clock is
+#define SCOREBOARD_SHOT_ENABLED   (1u << 3)
+#define SCOREBOARD_MAIN_TENTHS    (1u << 4) // Shown with tenths of seconds
+#define SCOREBOARD_SHOT_TENTHS    (1u << 5)
+#define SCOREBOARD_BUZZER         (1u << 6) // A clock has run out or the timeout warning is due
+
+typedef struct Scoreboard Scoreboard;
+
+// The board as it stands; all clocks are in tenths of seconds
+typedef struct __attribute__ ((aligned (64))) ScoreboardView
+{
+	int32_t main_clock, shot_clock, timeout_clock;
+	int32_t main_clock_elapsed_us, shot_clock_elapsed_us, timeout_clock_elapsed_us; // Into the current tenth
+	int32_t main_clock_edit, shot_clock_edit; // Being typed in edit mode
+	uint32_t flags; // SCOREBOARD_MAIN_RUNNING...
+	int16_t score[2]; // Home, visitor
+	uint8_t fouls[2], tol[2];
+	int8_t period; // -1 = before the game
+	uint8_t mode; // ScoreboardMode
+	uint8_t team; // Selected for INCREMENT and DECREMENT: 0 = home, 1 = visitor
+	uint8_t selected; // ScoreboardSelected
+	uint8_t edit_digit; // 1-4 = main clock, 5-6 = shot clock
+	uint8_t reserved[15];
+} ScoreboardView;
+
+SCOREBOARD_API uint32_t ScoreboardAbiVersion (void); // SCOREBOARD_ABI_VERSION the library was built with
+SCOREBOARD_API size_t ScoreboardSize (void); // Bytes a Scoreboard takes, for ScoreboardInit ()
+SCOREBOARD_API Scoreboard *ScoreboardInit (void *memory, int32_t main_clock_start, int32_t shot_clock_reset, int32_t timeout_short, int32_t timeout_long); // A new game in ScoreboardSize () bytes aligned to 8; times in tenths
+SCOREBOARD_API Scoreboard *ScoreboardNew (int32_t main_clock_start, int32_t shot_clock_reset, int32_t timeout_short, int32_t timeout_long); // NULL if out of memory
+SCOREBOARD_API void ScoreboardFree (Scoreboard *board); // Only for ScoreboardNew ()
+SCOREBOARD_API void ScoreboardCopy (Scoreboard *to, const Scoreboard *from);
+
+SCOREBOARD_API void ScoreboardStep (Scoreboard *board, int64_t elapsed_us, int32_t action); // Run the clocks for elapsed_us of real time, then apply the action; unknown actions are ignored
+SCOREBOARD_API int32_t ScoreboardStopClocksAt (Scoreboard *board, int64_t ago_us); // Stop the game clocks as they were ago_us earlier, e.g. at a whistle; returns 0 if neither was running
+SCOREBOARD_API void ScoreboardSetClock (Scoreboard *board, int32_t clock, int32_t tenths); // Set a ScoreboardClock directly instead of through edit mode; tenths outside 0 to SCOREBOARD_CLOCK_MAX are ignored; what ScoreboardStopClocksAt () could give back is kept for the other clocks
+SCOREBOARD_API void ScoreboardSetResetTimes (Scoreboard *board, int32_t shot_clock_reset, int32_t timeout_short, int32_t timeout_long);
+
+SCOREBOARD_API void ScoreboardRead (const Scoreboard *board, ScoreboardView *view);
+SCOREBOARD_API void ScoreboardLoad (Scoreboard *board, const ScoreboardView *view); // Take the clocks, their flags, score, fouls, TOL and period from a view, clocks clamped to what a board can hold; back in clock mode, the rest is kept
+SCOREBOARD_API int64_t ScoreboardUntilClockOut (const Scoreboard *board); // Real time (us) until the main or shot clock runs out, -1 = neither is running
+
+#endif
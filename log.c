@@ -0,0 +1,303 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - game log
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+**************************************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include "log.h"
+
+#define RING_MASK (LOG_RING_RECORDS - 1)
+#define TEXT_MAX 65536 // Written out when this fills up, and at the end of every batch
+#define LINE_LENGTH_MAX 256 // Longest line, without the newline
+
+typedef struct LogField
+{
+	const char *key; // NULL = the event has no more values
+	const char *const *names; // Printed by name, NULL = as a number
+	int name_count;
+} LogField;
+
+typedef struct LogEventInfo { const char *name; LogField fields[LOG_VALUES]; } LogEventInfo;
+
+static const char *const mode_names[] = {"clock", "edit"}; // Mode, board.h
+static const char *const clock_names[] = {"main", "shot", "timeout"}; // GameClock, board.h
+static const char *const team_names[] = {"home", "visitor"};
+static const char *const showing_names[] = {"timeout", "shot"};
+static const char *const cause_names[] = {"button", "clock"}; // LogBuzzerCause
+
+#define NAMES(names) names, (int) (sizeof (names) / sizeof (names[0]))
+
+static const LogEventInfo event_info[LOG_EVENT_COUNT] =
+{
+	{"start", {{0}}},
+	{"stop", {{0}}},
+	{"config_reload", {{0}}},
+	{"mode", {{"mode", NAMES (mode_names)}}},
+	{"clock_start", {{"clock", NAMES (clock_names)}, {"tenths", NULL, 0}}},
+	{"clock_stop", {{"clock", NAMES (clock_names)}, {"tenths", NULL, 0}}},
+	{"clock_set", {{"clock", NAMES (clock_names)}, {"from", NULL, 0}, {"to", NULL, 0}}},
+	{"clock_switch", {{"showing", NAMES (showing_names)}}},
+	{"score", {{"team", NAMES (team_names)}, {"from", NULL, 0}, {"to", NULL, 0}}},
+	{"fouls", {{"team", NAMES (team_names)}, {"from", NULL, 0}, {"to", NULL, 0}}},
+	{"tol", {{"team", NAMES (team_names)}, {"from", NULL, 0}, {"to", NULL, 0}}},
+	{"period", {{"from", NULL, 0}, {"to", NULL, 0}}},
+	{"buzzer_start", {{"cause", NAMES (cause_names)}}},
+	{"buzzer_stop", {{0}}},
+	{"render_stall", {{"ms", NULL, 0}}},
+	{"render_resume", {{"ms", NULL, 0}}},
+	{"renderer_rebuild", {{"ms", NULL, 0}}},
+	{"whistle", {{"ms", NULL, 0}}}
+};
+
+typedef struct Batch
+{
+	char text[TEXT_MAX];
+	size_t length;
+} Batch;
+
+static void *DrainThread (void *data);
+static void Drain (Logger *logger, Batch *batch);
+static void FormatRecord (Batch *batch, FILE *file, const char *thread_name, const LogRecord *record);
+static size_t FormatStart (char *line, int64_t time_us, const char *thread_name);
+static void Print (char *line, size_t *length, const char *format, ...);
+static void Append (Batch *batch, FILE *file, const char *line, size_t length);
+static void Flush (Batch *batch, FILE *file);
+
+int LogOpen (Logger *logger, const char *path)
+{
+	memset (logger, 0, sizeof (*logger));
+	logger->stop_fd = -1;
+	if (pthread_mutex_init (&logger->lock, NULL) != 0)
+		return -1;
+	logger->file = fopen (path, "a");
+	if (logger->file == NULL)
+	{
+		pthread_mutex_destroy (&logger->lock);
+		return -1;
+	}
+	logger->stop_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (logger->stop_fd < 0 || pthread_create (&logger->thread, NULL, DrainThread, logger) != 0)
+	{
+		if (logger->stop_fd >= 0)
+			close (logger->stop_fd);
+		fclose (logger->file);
+		pthread_mutex_destroy (&logger->lock);
+		return -1;
+	}
+	return 0;
+}
+
+LogRing *LogRingAdd (Logger *logger, const char *thread_name)
+{
+	// Head and tail on cache lines of their own, so the two threads never write the same line
+	LogRing *ring = aligned_alloc (64, (sizeof (LogRing) + 63) / 64 * 64);
+	if (ring == NULL)
+		return NULL;
+	memset (ring, 0, sizeof (*ring));
+	strncpy (ring->name, thread_name, sizeof (ring->name) - 1);
+
+	pthread_mutex_lock (&logger->lock);
+	int count = atomic_load (&logger->ring_count);
+	if (count == LOG_RINGS_MAX)
+	{
+		pthread_mutex_unlock (&logger->lock);
+		free (ring);
+		return NULL;
+	}
+	logger->rings[count] = ring;
+	atomic_store (&logger->ring_count, count + 1); // The drain sees the ring only once it is there
+	pthread_mutex_unlock (&logger->lock);
+	return ring;
+}
+
+void LogWrite (LogRing *ring, LogEvent event, int value0, int value1, int value2)
+{
+	uint64_t head = atomic_load_explicit (&ring->head, memory_order_relaxed);
+	if (head - ring->tail_seen == LOG_RING_RECORDS)
+	{
+		// Looks full: see how far the drain has got since it was last looked at
+		ring->tail_seen = atomic_load_explicit (&ring->tail, memory_order_acquire);
+		if (head - ring->tail_seen == LOG_RING_RECORDS)
+		{
+			atomic_store_explicit (&ring->dropped, atomic_load_explicit (&ring->dropped, memory_order_relaxed) + 1, memory_order_relaxed);
+			return;
+		}
+	}
+
+	struct timespec now;
+	clock_gettime (CLOCK_REALTIME, &now);
+	LogRecord *record = &ring->records[head & RING_MASK];
+	record->time_us = (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+	record->event = event;
+	record->values[0] = value0;
+	record->values[1] = value1;
+	record->values[2] = value2;
+	atomic_store_explicit (&ring->head, head + 1, memory_order_release); // The record is complete before the drain can see it
+}
+
+void LogClose (Logger *logger)
+{
+	uint64_t one = 1;
+	if (write (logger->stop_fd, &one, sizeof (one)) == sizeof (one))
+		pthread_join (logger->thread, NULL);
+	close (logger->stop_fd);
+	fclose (logger->file);
+	int ring_count = atomic_load (&logger->ring_count);
+	for (int i = 0; i < ring_count; i++)
+		free (logger->rings[i]);
+	atomic_store (&logger->ring_count, 0);
+	pthread_mutex_destroy (&logger->lock);
+}
+
+static void *DrainThread (void *data)
+{
+	Logger *logger = data;
+	static Batch batch;
+
+	// Once more after the stop, for whatever was logged on the way out
+	int stopping = 0;
+	while (!stopping)
+	{
+		struct pollfd stop = {logger->stop_fd, POLLIN, 0};
+		stopping = poll (&stop, 1, LOG_DRAIN_MS) > 0;
+		Drain (logger, &batch);
+	}
+	return NULL;
+}
+
+static void Drain (Logger *logger, Batch *batch)
+{
+	// What each ring holds right now; anything logged after this waits for the next batch
+	int ring_count = atomic_load (&logger->ring_count);
+	uint64_t tails[LOG_RINGS_MAX], heads[LOG_RINGS_MAX];
+	for (int i = 0; i < ring_count; i++)
+	{
+		tails[i] = atomic_load_explicit (&logger->rings[i]->tail, memory_order_relaxed);
+		heads[i] = atomic_load_explicit (&logger->rings[i]->head, memory_order_acquire);
+	}
+
+	// Each ring is in time order already, so the oldest of their next records is the next line
+	while (1)
+	{
+		int oldest = -1;
+		for (int i = 0; i < ring_count; i++)
+			if (tails[i] != heads[i] && (oldest < 0 ||
+				logger->rings[i]->records[tails[i] & RING_MASK].time_us < logger->rings[oldest]->records[tails[oldest] & RING_MASK].time_us))
+				oldest = i;
+		if (oldest < 0)
+			break;
+		LogRing *ring = logger->rings[oldest];
+		FormatRecord (batch, logger->file, ring->name, &ring->records[tails[oldest] & RING_MASK]);
+		tails[oldest]++;
+		// Handed back as it goes, so a long batch frees space early
+		if ((tails[oldest] & 255) == 0)
+			atomic_store_explicit (&ring->tail, tails[oldest], memory_order_release);
+	}
+
+	for (int i = 0; i < ring_count; i++)
+	{
+		LogRing *ring = logger->rings[i];
+		atomic_store_explicit (&ring->tail, tails[i], memory_order_release);
+		uint64_t dropped = atomic_load_explicit (&ring->dropped, memory_order_relaxed);
+		if (dropped != ring->dropped_logged)
+		{
+			struct timespec now;
+			char line[LINE_LENGTH_MAX];
+			clock_gettime (CLOCK_REALTIME, &now);
+			size_t length = FormatStart (line, (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000, ring->name);
+			Print (line, &length, " event=dropped count=%llu", (unsigned long long) (dropped - ring->dropped_logged));
+			Append (batch, logger->file, line, length);
+			ring->dropped_logged = dropped;
+		}
+	}
+	Flush (batch, logger->file);
+}
+
+static void FormatRecord (Batch *batch, FILE *file, const char *thread_name, const LogRecord *record)
+{
+	char line[LINE_LENGTH_MAX];
+	size_t length = FormatStart (line, record->time_us, thread_name);
+	const LogEventInfo *info = record->event >= 0 && record->event < LOG_EVENT_COUNT ? &event_info[record->event] : NULL;
+	if (info == NULL)
+	{
+		Print (line, &length, " event=%d", record->event);
+		Append (batch, file, line, length);
+		return;
+	}
+	Print (line, &length, " event=%s", info->name);
+	for (int i = 0; i < LOG_VALUES && info->fields[i].key; i++)
+	{
+		const LogField *field = &info->fields[i];
+		int value = record->values[i];
+		if (field->names && value >= 0 && value < field->name_count)
+			Print (line, &length, " %s=%s", field->key, field->names[value]);
+		else
+			Print (line, &length, " %s=%d", field->key, value);
+	}
+	Append (batch, file, line, length);
+}
+
+static size_t FormatStart (char *line, int64_t time_us, const char *thread_name)
+{
+	// Local time, to the microsecond
+	time_t seconds = (time_t) (time_us / 1000000);
+	struct tm local;
+	size_t length = 0;
+	localtime_r (&seconds, &local);
+	length = strftime (line, LINE_LENGTH_MAX, "time=%Y-%m-%dT%H:%M:%S", &local);
+	Print (line, &length, ".%06d thread=%s", (int) (time_us % 1000000), thread_name);
+	return length;
+}
+
+static void Print (char *line, size_t *length, const char *format, ...)
+{
+	// Stops at the end of the line, whatever did not fit is left out
+	if (*length + 1 >= LINE_LENGTH_MAX)
+		return;
+	va_list arguments;
+	va_start (arguments, format);
+	int printed = vsnprintf (line + *length, LINE_LENGTH_MAX - *length, format, arguments);
+	va_end (arguments);
+	if (printed > 0)
+		*length += (size_t) printed < LINE_LENGTH_MAX - *length ? (size_t) printed : LINE_LENGTH_MAX - *length - 1;
+}
+
+static void Append (Batch *batch, FILE *file, const char *line, size_t length)
+{
+	// Whole lines only, the batch is written out first if this one would not fit
+	if (batch->length + length + 1 > sizeof (batch->text))
+		Flush (batch, file);
+	memcpy (batch->text + batch->length, line, length);
+	batch->text[batch->length + length] = '\n';
+	batch->length += length + 1;
+}
+
+static void Flush (Batch *batch, FILE *file)
+{
+	if (batch->length == 0)
+		return;
+	fwrite (batch->text, 1, batch->length, file);
+	fflush (file);
+	batch->length = 0;
+}
@@ -0,0 +1,110 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - game log
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+A log of what happened during a game (--log PATH), to look at afterwards: mode changes, clocks
+started, stopped and set, scores, fouls, the buzzer and render stalls. One line per event, as key=value pairs:
+
+	time=2021-03-06T19:42:10.104233 thread=render event=clock_stop clock=main tenths=3127
+
+Every thread that logs gets its own ring from LogRingAdd (), once. Only that thread writes it and
+only the drain thread reads it, so LogWrite () is a clock read and a few stores: no lock, no
+locked instruction, no system call, and it never waits on the disk. The drain thread empties the
+rings every LOG_DRAIN_MS, merges them in time order and writes the batch with one fwrite (). If a
+ring fills up before it is drained, new events are dropped and counted, and the count is logged.
+
+**************************************************************************************************/
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define LOG_RINGS_MAX 8 // Threads that can log
+#define LOG_RING_RECORDS 4096 // Events a ring holds, a power of two
+#define LOG_VALUES 3 // Values an event carries
+#define LOG_DRAIN_MS 250 // How often the rings are written out
+
+// What the values are is in the event table in log.c
+typedef enum LogEvent
+{
+	LOG_START = 0,
+	LOG_STOP,
+	LOG_CONFIG_RELOAD,
+	LOG_MODE, // Mode (board.h)
+	LOG_CLOCK_START, // Clock (GameClock, board.h), tenths left
+	LOG_CLOCK_STOP, // Clock, tenths left
+	LOG_CLOCK_SET, // Clock, tenths before, tenths after
+	LOG_CLOCK_SWITCH, // 1 = shot clock showing, 0 = timeout clock
+	LOG_SCORE, // Team, before, after
+	LOG_FOULS, // Team, before, after
+	LOG_TOL, // Team, before, after
+	LOG_PERIOD, // Before, after
+	LOG_BUZZER_START, // LogBuzzerCause
+	LOG_BUZZER_STOP,
+	LOG_RENDER_STALL, // Milliseconds since the last frame (watchdog.h)
+	LOG_RENDER_RESUME, // Milliseconds it was stalled
+	LOG_RENDERER_REBUILD, // Milliseconds the rebuild took
+	LOG_WHISTLE, // Milliseconds the clocks were given back (whistle.h)
+	LOG_EVENT_COUNT
+} LogEvent;
+
+typedef enum LogBuzzerCause { LOG_BUZZER_BUTTON = 0, LOG_BUZZER_CLOCK } LogBuzzerCause;
+
+typedef struct LogRecord
+{
+	int64_t time_us; // Wall clock, microseconds since the epoch
+	int32_t event;
+	int32_t values[LOG_VALUES];
+} LogRecord;
+
+typedef struct LogRing
+{
+	// Written by the logging thread
+	_Alignas (64) _Atomic uint64_t head; // Records written so far
+	uint64_t tail_seen; // Drain position as last read, so a full check rarely touches the drain's line
+	_Atomic uint64_t dropped;
+
+	// Written by the drain thread
+	_Alignas (64) _Atomic uint64_t tail; // Records drained so far
+	uint64_t dropped_logged;
+
+	char name[16];
+	LogRecord records[LOG_RING_RECORDS];
+} LogRing;
+
+typedef struct Logger
+{
+	pthread_mutex_t lock; // Only for adding rings
+	LogRing *rings[LOG_RINGS_MAX];
+	_Atomic int ring_count;
+	FILE *file;
+	pthread_t thread;
+	int stop_fd;
+} Logger;
+
+int LogOpen (Logger *logger, const char *path); // Appends to path and starts the drain thread; returns 0 on success
+LogRing *LogRingAdd (Logger *logger, const char *thread_name); // For the calling thread only; NULL if all are taken
+void LogWrite (LogRing *ring, LogEvent event, int value0, int value1, int value2);
+void LogClose (Logger *logger); // Writes out what is left in the rings
+
+#endif
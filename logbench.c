@@ -0,0 +1,234 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - game log benchmark
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Logs from several threads at once through the game log (log.h) and reports what a LogWrite ()
+costs the thread calling it, then reads the log back and checks it.
+
+	logbench [--threads N] [--seconds S] [--rate N] [--path PATH]
+
+Each thread logs --rate events a second (default 1000, 0 = as fast as it can), every one
+numbered, and times every call; calls after a sleep run on a cold cache, as they do between the
+render thread's frames. The log is written to --path (default logbench.log, replaced). Fails if an
+event came out twice, out of order, or was neither written nor counted as dropped.
+
+**************************************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <pthread.h>
+#include "log.h"
+
+#define THREADS_MAX LOG_RINGS_MAX
+#define SAMPLES_MAX 1000000 // Call times kept per thread
+
+typedef struct BenchThread
+{
+	pthread_t thread;
+	int index;
+	Logger *logger;
+	long written;
+	int64_t *samples_ns;
+	long sample_count;
+} BenchThread;
+
+static double seconds = 5;
+static int rate = 1000;
+
+static void *BenchThreadMain (void *data);
+static int CompareTimes (const void *a, const void *b);
+static int64_t NowNs (void);
+
+int main (int argc, char *argv[])
+{
+	int thread_count = 4;
+	const char *path = "logbench.log";
+	static struct option long_options[] =
+	{
+		{"threads", required_argument, 0, 't'},
+		{"seconds", required_argument, 0, 's'},
+		{"rate", required_argument, 0, 'r'},
+		{"path", required_argument, 0, 'p'},
+		{0, 0, 0, 0}
+	};
+
+	int c;
+	while ((c = getopt_long (argc, argv, "", long_options, NULL)) != -1)
+	{
+		switch (c)
+		{
+			case 't': thread_count = atoi (optarg); break;
+			case 's': seconds = atof (optarg); break;
+			case 'r': rate = atoi (optarg); break;
+			case 'p': path = optarg; break;
+			default:
+				fprintf (stderr, "usage: %s [--threads N] [--seconds S] [--rate N] [--path PATH]\n", argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+	if (optind < argc || thread_count < 1 || thread_count > THREADS_MAX || seconds <= 0 || rate < 0)
+	{
+		fprintf (stderr, "usage: %s [--threads N] [--seconds S] [--rate N] [--path PATH]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	remove (path);
+	Logger logger;
+	if (LogOpen (&logger, path) != 0)
+	{
+		fprintf (stderr, "%s: could not open '%s'\n", argv[0], path);
+		return EXIT_FAILURE;
+	}
+	static BenchThread threads[THREADS_MAX];
+	for (int i = 0; i < thread_count; i++)
+	{
+		threads[i].index = i;
+		threads[i].logger = &logger;
+		threads[i].samples_ns = malloc (SAMPLES_MAX * sizeof (int64_t));
+		pthread_create (&threads[i].thread, NULL, BenchThreadMain, &threads[i]);
+	}
+	for (int i = 0; i < thread_count; i++)
+		pthread_join (threads[i].thread, NULL);
+	LogClose (&logger);
+
+	// What a call costs, less what timing it costs
+	int64_t overhead_ns = INT64_MAX;
+	for (int i = 0; i < 1000; i++)
+	{
+		int64_t start = NowNs (), took = NowNs () - start;
+		if (took < overhead_ns)
+			overhead_ns = took;
+	}
+	long sample_count = 0, written = 0;
+	for (int i = 0; i < thread_count; i++)
+	{
+		sample_count += threads[i].sample_count;
+		written += threads[i].written;
+	}
+	int64_t *samples_ns = malloc ((size_t) sample_count * sizeof (int64_t));
+	long n = 0;
+	for (int i = 0; i < thread_count; i++)
+		for (long j = 0; j < threads[i].sample_count; j++)
+			samples_ns[n++] = threads[i].samples_ns[j] > overhead_ns ? threads[i].samples_ns[j] - overhead_ns : 0;
+	qsort (samples_ns, (size_t) n, sizeof (int64_t), CompareTimes);
+	if (n > 0)
+		printf ("LogWrite: median %lld ns, 99%% %lld ns, 99.99%% %lld ns, worst %lld ns (%ld calls, %lld ns spent timing each)\n",
+			(long long) samples_ns[n / 2], (long long) samples_ns[n * 99 / 100], (long long) samples_ns[n * 9999 / 10000],
+			(long long) samples_ns[n - 1], n, (long long) overhead_ns);
+
+	// Every event once and in order per thread, or counted as dropped
+	FILE *file = fopen (path, "r");
+	if (file == NULL)
+	{
+		fprintf (stderr, "%s: could not read '%s' back\n", argv[0], path);
+		return EXIT_FAILURE;
+	}
+	long seen[THREADS_MAX], dropped[THREADS_MAX], bad = 0, lines = 0;
+	long next[THREADS_MAX];
+	memset (seen, 0, sizeof (seen));
+	memset (dropped, 0, sizeof (dropped));
+	memset (next, 0, sizeof (next));
+	char line[512];
+	while (fgets (line, sizeof (line), file))
+	{
+		lines++;
+		int thread;
+		long from, to, count;
+		char *fields = strstr (line, " thread=t");
+		if (fields && sscanf (fields, " thread=t%d event=score team=home from=%ld to=%ld", &thread, &from, &to) == 3 && thread >= 0 && thread < thread_count)
+		{
+			long number = from * 1000000 + to;
+			if (number < next[thread])
+				bad++;
+			next[thread] = number + 1;
+			seen[thread]++;
+		}
+		else if (fields && sscanf (fields, " thread=t%d event=dropped count=%ld", &thread, &count) == 2 && thread >= 0 && thread < thread_count)
+			dropped[thread] += count;
+		else
+			bad++;
+	}
+	fclose (file);
+	long total_seen = 0, total_dropped = 0;
+	for (int i = 0; i < thread_count; i++)
+	{
+		if (seen[i] + dropped[i] != threads[i].written)
+			bad++;
+		total_seen += seen[i];
+		total_dropped += dropped[i];
+	}
+	printf ("%d threads, %ld events logged: %ld written, %ld dropped, %ld lines, %ld wrong\n",
+		thread_count, written, total_seen, total_dropped, lines, bad);
+
+	for (int i = 0; i < thread_count; i++)
+		free (threads[i].samples_ns);
+	free (samples_ns);
+	return bad == 0 && total_seen > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void *BenchThreadMain (void *data)
+{
+	BenchThread *thread = data;
+	char name[16];
+	snprintf (name, sizeof (name), "t%d", thread->index);
+	LogRing *ring = LogRingAdd (thread->logger, name);
+	if (ring == NULL)
+		return NULL;
+
+	// Numbered in two values, as an event only carries ints
+	int64_t start = NowNs (), end = start + (int64_t) (seconds * 1e9);
+	int64_t period_ns = rate > 0 ? 1000000000 / rate : 0;
+	for (long number = 0; ; number++)
+	{
+		int64_t before = NowNs ();
+		if (before >= end)
+			break;
+		LogWrite (ring, LOG_SCORE, 0, (int) (number / 1000000), (int) (number % 1000000));
+		int64_t took = NowNs () - before;
+		if (thread->sample_count < SAMPLES_MAX)
+			thread->samples_ns[thread->sample_count++] = took;
+		else
+			thread->samples_ns[number % SAMPLES_MAX] = took;
+		thread->written++;
+		if (period_ns > 0)
+		{
+			int64_t due = start + (number + 1) * period_ns;
+			struct timespec until = {(time_t) (due / 1000000000), (long) (due % 1000000000)};
+			clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL);
+		}
+	}
+	return NULL;
+}
+
+static int CompareTimes (const void *a, const void *b)
+{
+	int64_t x = *(const int64_t *) a, y = *(const int64_t *) b;
+	return (x > y) - (x < y);
+}
+
+static int64_t NowNs (void)
+{
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
@@ -28,8 +28,10 @@ Made with raylib, by raysan5 <https://github.com/raysan5/raylib>
 | # Initialization             |
 | # Loop                       |
 |     ## Update board logic    |
+|         ### Input            |
 |         ### Clock mode       |
 |         ### Edit mode        |
+|     ## Renderer rebuild      |
 |     ## Drawing               |
 |         ### Main clock       |
 |         ### Shot clock       |
@@ -37,6 +39,8 @@ Made with raylib, by raysan5 <https://github.com/raysan5/raylib>
 |         ### Score displays   |
 |         ### Foul displays    |
 |         ### TOL displays     |
+|     ## HUB75 output          |
+|     ## Replay capture        |
 | # De-initialization          |
 |------------------------------|
 
@@ -44,49 +48,91 @@ Made with raylib, by raysan5 <https://github.com/raysan5/raylib>
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <getopt.h>
+#include <time.h>
 #include "raylib.h"
+#include "hub75.h"
+#include "digit.h"
+#include "assets.h"
+#include "label.h"
+#include "config.h"
+#include "board.h"
+#include "libscoreboard.h"
+#include "input.h"
+#include "trace.h"
+#include "stats.h"
+#include "shm.h"
+#include "pacing.h"
+#include "http.h"
+#include "sync.h"
+#include "evdev.h"
+#include "whistle.h"
+#include "serial.h"
+#include "framering.h"
+#include "capture.h"
+#include "metrics.h"
+#include "wall.h"
+#include "log.h"
+#include "watchdog.h"
 
 #define NAME "Basketball Scoreboard"
 #define VERSION "version 4"
 #define COPYRIGHT "Copyright (c) 2021 Cyrus Lee"
 
-// Input keys
-#define KEY_TOGGLE_FULLSCREEN      KEY_F11
-#define KEY_START_STOP_CLOCKS      KEY_SPACE
-#define KEY_START_STOP_SHOT_CLOCK  KEY_LEFT_CONTROL
-#define KEY_START_STOP_MAIN_CLOCK  KEY_RIGHT_CONTROL
-#define KEY_SWITCH_SHOT_CLOCK      KEY_LEFT_ALT
-#define KEY_DISABLE_MAIN_CLOCK     KEY_RIGHT_ALT     // NOT USED
-#define KEY_RESET_SHOT_CLOCK       KEY_LEFT_SHIFT
-#define KEY_SOUND_BUZZER           KEY_G
-#define KEY_CHANGING_HOME          KEY_H
-#define KEY_CHANGING_VISITOR       KEY_V
-#define KEY_CHANGE_MODE_PERIOD     KEY_P
-#define KEY_CHANGE_MODE_SCORE      KEY_S
-#define KEY_CHANGE_MODE_FOULS      KEY_F
-#define KEY_CHANGE_MODE_TOL        KEY_T
-// Increment, decrement, score +1/2/3 keybinds are under [Change score, fouls, TOL]
-// Edit mode keybinds are under [Edit mode]
-
-#define HOME    0
-#define VISITOR 1
+// Input keys are set in the config file, defaults are in ConfigDefaults () (config.c)
+// Fixed keys (increment, decrement, score +1/2/3, edit mode) are in BindingsBuild () (input.c)
+
+#define SYNC_WAIT_MS 3000 // How long a secondary waits for the primary at start
+#define REPLAY_MAX_SECONDS 180 // Frames older than this are dropped from the replay ring
 
 #define DARKDARKGRAY (Color){25, 25, 25, 255}
-#define DARKRED (Color){130, 33, 55, 255}
-#define DARKGOLD (Color){128, 101, 0, 255}
 
-typedef struct Time { int ten_minutes, minutes, ten_seconds, seconds, tenth_seconds; } Time;
 typedef struct DisplayBox { float x, y, width, height; } DisplayBox;
-typedef enum ChangeType { SCORE = 0, FOULS, TOL, PERIOD } ChangeType;
-typedef enum TimerMode { NORMAL = 0, TENTH_SECONDS } TimerMode;
-typedef enum Mode { CLOCK = 0, EDIT_MODE } Mode;
+typedef enum LongOption { OPTION_HUB75 = 256, OPTION_HUB75_SIZE, OPTION_HUB75_DEPTH, OPTION_HUB75_GAMMA, OPTION_HOME_NAME, OPTION_VISITOR_NAME, OPTION_HOME_LOGO, OPTION_VISITOR_LOGO, OPTION_CONFIG, OPTION_RECORD, OPTION_STATS, OPTION_SHM, OPTION_HTTP, OPTION_SYNC_SERVE, OPTION_SYNC, OPTION_EVDEV, OPTION_SERIAL, OPTION_SERIAL_BAUD, OPTION_REPLAY_MB, OPTION_METRICS_FILE, OPTION_WALL_LEAD, OPTION_WALL, OPTION_WALL_GRID, OPTION_WALL_TILE, OPTION_LOG, OPTION_WHISTLE } LongOption; // Options with no short form
 
-int TimeToInt (Time time); // Returns time in tenths of seconds (int)
-Time UpdateTime (Time time); // Increments time by one tenth second
 void DrawDigit (int digit, float posX, float posY, float width, Color color, int use_all); // Draw a digit on the scoreboard
+void DrawTeamLabel (LabelFont *font, Label *label, const char *name, const Texture2D *logo, float centerX, int posY, int fontSize, float border); // Draw a team name with its logo (if loaded) to the left
+void ApplyFrameRate (int target_fps, const PacingStats *pacing); // target_fps 0 = one frame per refresh, paced by VSync
+void ApplyDirectInput (const EvdevEvent *event, Scoreboard *board, const BindingTable *bindings, const Config *config, TraceWriter *trace, LogRing *game_log, int64_t time_us, int *buzzer_held); // Apply a key or button from an input device; trace NULL = not recording
+void ApplyAction (Scoreboard *board, Action action, LogRing *game_log); // ScoreboardStep (), logging what it changed; game_log NULL = not logging
+void LogBoardChanges (LogRing *game_log, const ScoreboardView *before, const ScoreboardView *after);
+void SoundBuzzer (int on, void *data); // For the watchdog, data is the buzzer Sound; only while this thread is stalled
+void SendHub75 (void *data, const unsigned char *rgba, int width, int height, _Atomic int *done); // For the frame capture, data is the Hub75Output
+void FillState (ScoreboardState *state, const ScoreboardView *view, const char *home_name, const char *visitor_name, int buzzer); // Copy the board into a published state
+void ApplyState (Scoreboard *board, const ScoreboardState *state); // Show a published state, e.g. the wall lead's, on the board
+Time ClockDigits (int tenths); // The digits a clock in tenths shows
 
 static int version_flag;
+static int pacing_flag; // Print frame pacing statistics every few seconds
+static const char *hub75_path = NULL; // LED matrix output file or pipe, NULL = disabled
+static int hub75_width = 64;
+static int hub75_height = 32;
+static int hub75_depth = 8; // Bit planes per colour
+static float hub75_gamma = 2.2f;
+static const char *config_path = "scoreboard.conf";
+static const char *record_path = NULL; // Input trace to write, NULL = not recording
+static const char *stats_dir = NULL; // Season statistics store, NULL = not saving
+static const char *shm_name = NULL; // Shared memory segment for overlays, NULL = private
+static int http_port = 0; // Spectator web server, 0 = off
+static int sync_serve_port = 0; // Answer clock sync requests as the primary, 0 = off
+static char sync_host[256] = ""; // Primary to take the time from, empty = own clock
+static int sync_port = 0;
+static const char *evdev_paths[EVDEV_DEVICES_MAX]; // Input devices or recorded event streams read directly
+static int evdev_count = 0;
+static const char *whistle_path = NULL; // Microphone pipe or recording to hear the referee's whistle on, NULL = off
+static const char *serial_path = NULL; // Hardware scoreboard controller port, NULL = off
+static int serial_baud = 19200;
+static int replay_mb = 256; // Memory for the replay ring of shown frames, 0 = off
+static const char *metrics_path = NULL; // Health metrics file for node_exporter, NULL = not written
+static const char *log_path = NULL; // Game log, NULL = not logging
+static int wall_lead_port = 0; // Lead a video wall of tiles, 0 = off
+static char wall_host[256] = ""; // Wall lead to follow, empty = not a tile
+static int wall_port = 0;
+static int wall_columns = 1, wall_rows = 1; // Screens in the whole wall
+static int wall_column = 0, wall_row = 0; // This one, from the top left
+static const char *team_names[] = {NULL, NULL}; // Override the config file, NULL = use config
+static const char *team_logos[] = {NULL, NULL}; // PNG paths
 
 int main (int argc, char* argv[])
 {
@@ -98,6 +144,33 @@ int main (int argc, char* argv[])
 		static struct option long_options[] =
 		{
 			{"version", no_argument, &version_flag, 1},
+			{"pacing", no_argument, &pacing_flag, 1},
+			{"hub75", required_argument, 0, OPTION_HUB75},
+			{"hub75-size", required_argument, 0, OPTION_HUB75_SIZE},
+			{"hub75-depth", required_argument, 0, OPTION_HUB75_DEPTH},
+			{"hub75-gamma", required_argument, 0, OPTION_HUB75_GAMMA},
+			{"home-name", required_argument, 0, OPTION_HOME_NAME},
+			{"visitor-name", required_argument, 0, OPTION_VISITOR_NAME},
+			{"home-logo", required_argument, 0, OPTION_HOME_LOGO},
+			{"visitor-logo", required_argument, 0, OPTION_VISITOR_LOGO},
+			{"config", required_argument, 0, OPTION_CONFIG},
+			{"record", required_argument, 0, OPTION_RECORD},
+			{"stats", required_argument, 0, OPTION_STATS},
+			{"shm", required_argument, 0, OPTION_SHM},
+			{"http", required_argument, 0, OPTION_HTTP},
+			{"sync-serve", required_argument, 0, OPTION_SYNC_SERVE},
+			{"sync", required_argument, 0, OPTION_SYNC},
+			{"evdev", required_argument, 0, OPTION_EVDEV},
+			{"serial", required_argument, 0, OPTION_SERIAL},
+			{"serial-baud", required_argument, 0, OPTION_SERIAL_BAUD},
+			{"replay-mb", required_argument, 0, OPTION_REPLAY_MB},
+			{"metrics-file", required_argument, 0, OPTION_METRICS_FILE},
+			{"wall-lead", required_argument, 0, OPTION_WALL_LEAD},
+			{"wall", required_argument, 0, OPTION_WALL},
+			{"wall-grid", required_argument, 0, OPTION_WALL_GRID},
+			{"wall-tile", required_argument, 0, OPTION_WALL_TILE},
+			{"log", required_argument, 0, OPTION_LOG},
+			{"whistle", required_argument, 0, OPTION_WHISTLE},
 			{0, 0, 0, 0}
 		};
 
@@ -113,6 +186,119 @@ int main (int argc, char* argv[])
 			case 0:
 			case '?':
 				break;
+			case OPTION_HUB75:
+				hub75_path = optarg;
+				break;
+			case OPTION_HUB75_SIZE:
+				if (sscanf (optarg, "%dx%d", &hub75_width, &hub75_height) != 2)
+				{
+					fprintf (stderr, "%s: --hub75-size must look like 64x32\n", argv[0]);
+					return EXIT_FAILURE;
+				}
+				break;
+			case OPTION_HUB75_DEPTH:
+				hub75_depth = atoi (optarg);
+				break;
+			case OPTION_HUB75_GAMMA:
+				hub75_gamma = (float) atof (optarg);
+				break;
+			case OPTION_HOME_NAME:
+				team_names[HOME] = optarg;
+				break;
+			case OPTION_VISITOR_NAME:
+				team_names[VISITOR] = optarg;
+				break;
+			case OPTION_HOME_LOGO:
+				team_logos[HOME] = optarg;
+				break;
+			case OPTION_VISITOR_LOGO:
+				team_logos[VISITOR] = optarg;
+				break;
+			case OPTION_CONFIG:
+				config_path = optarg;
+				break;
+			case OPTION_RECORD:
+				record_path = optarg;
+				break;
+			case OPTION_STATS:
+				stats_dir = optarg;
+				break;
+			case OPTION_SHM:
+				shm_name = optarg;
+				break;
+			case OPTION_HTTP:
+				http_port = atoi (optarg);
+				break;
+			case OPTION_SYNC_SERVE:
+				sync_serve_port = atoi (optarg);
+				break;
+			case OPTION_SYNC:
+				{
+					const char *colon = strrchr (optarg, ':');
+					if (colon == NULL || colon == optarg || (size_t) (colon - optarg) >= sizeof (sync_host) || atoi (colon + 1) <= 0)
+					{
+						fprintf (stderr, "Invalid --sync '%s', expected HOST:PORT\n", optarg);
+						return EXIT_FAILURE;
+					}
+					memcpy (sync_host, optarg, (size_t) (colon - optarg));
+					sync_host[colon - optarg] = '\0';
+					sync_port = atoi (colon + 1);
+				}
+				break;
+			case OPTION_EVDEV:
+				if (evdev_count < EVDEV_DEVICES_MAX)
+					evdev_paths[evdev_count++] = optarg;
+				else
+					fprintf (stderr, "Only %d --evdev devices can be used, ignoring '%s'\n", EVDEV_DEVICES_MAX, optarg);
+				break;
+			case OPTION_SERIAL:
+				serial_path = optarg;
+				break;
+			case OPTION_SERIAL_BAUD:
+				serial_baud = atoi (optarg);
+				break;
+			case OPTION_REPLAY_MB:
+				replay_mb = atoi (optarg);
+				break;
+			case OPTION_METRICS_FILE:
+				metrics_path = optarg;
+				break;
+			case OPTION_WALL_LEAD:
+				wall_lead_port = atoi (optarg);
+				break;
+			case OPTION_WALL:
+				{
+					const char *colon = strrchr (optarg, ':');
+					if (colon == NULL || colon == optarg || (size_t) (colon - optarg) >= sizeof (wall_host) || atoi (colon + 1) <= 0)
+					{
+						fprintf (stderr, "Invalid --wall '%s', expected HOST:PORT\n", optarg);
+						return EXIT_FAILURE;
+					}
+					memcpy (wall_host, optarg, (size_t) (colon - optarg));
+					wall_host[colon - optarg] = '\0';
+					wall_port = atoi (colon + 1);
+				}
+				break;
+			case OPTION_WALL_GRID:
+				if (sscanf (optarg, "%dx%d", &wall_columns, &wall_rows) != 2 || wall_columns < 1 || wall_rows < 1)
+				{
+					fprintf (stderr, "%s: --wall-grid must look like 4x2\n", argv[0]);
+					return EXIT_FAILURE;
+				}
+				break;
+			case OPTION_WALL_TILE:
+				if (sscanf (optarg, "%d,%d", &wall_column, &wall_row) != 2 || wall_column < 0 || wall_row < 0)
+				{
+					fprintf (stderr, "%s: --wall-tile must look like 0,1\n", argv[0]);
+					return EXIT_FAILURE;
+				}
+				break;
+			case OPTION_LOG:
+				log_path = optarg;
+				break;
+			case OPTION_WHISTLE:
+				whistle_path = optarg;
+				break;
 			default:
 				abort ();
 		}
@@ -149,10 +335,69 @@ Made with raylib, by raysan5 <https://github.com/raysan5/raylib>\n\
 	// # Initialization
 	//---------------------------------------------------------------------------------------------
 
+	// Config file, reloaded whenever it is saved
+	Config *config = malloc (sizeof (Config));
+	if (config == NULL)
+		return EXIT_FAILURE;
+	ConfigDefaults (config);
+	ConfigLoad (config, config_path); // A missing file just means defaults
+	ConfigWatcher config_watcher;
+	int config_watching = (ConfigWatchStart (&config_watcher, config_path) == 0);
+
+	// Clock sync between instances (sync.h), before anything starts counting time
+	SyncServer sync_server;
+	if (sync_serve_port && SyncServerStart (&sync_server, sync_serve_port, NULL, NULL) != 0)
+	{
+		fprintf (stderr, "Could not answer clock sync on port %d\n", sync_serve_port);
+		sync_serve_port = 0;
+	}
+	SyncClient sync_client;
+	int syncing = 0; // Frames run on the primary's time
+	if (sync_host[0])
+	{
+		if (SyncClientStart (&sync_client, sync_host, sync_port, NULL, NULL) != 0)
+			fprintf (stderr, "Could not sync to '%s'\n", sync_host);
+		else if (SyncWait (&sync_client, SYNC_WAIT_MS) != 0)
+		{
+			fprintf (stderr, "No clock sync from %s:%d, running on this clock\n", sync_host, sync_port);
+			SyncClientStop (&sync_client);
+		}
+		else
+			syncing = 1;
+	}
+
+	// Video wall (wall.h): the lead sends what each frame shows, tiles draw their part of it
+	if (wall_column >= wall_columns || wall_row >= wall_rows)
+	{
+		fprintf (stderr, "--wall-tile %d,%d is outside the %dx%d --wall-grid\n", wall_column, wall_row, wall_columns, wall_rows);
+		return EXIT_FAILURE;
+	}
+	WallLead wall_lead;
+	int wall_leading = 0;
+	if (wall_lead_port && WallLeadStart (&wall_lead, wall_lead_port) != 0)
+		fprintf (stderr, "Could not lead the wall on port %d\n", wall_lead_port);
+	else if (wall_lead_port)
+		wall_leading = 1;
+	WallTile wall_tile;
+	int wall_following = 0;
+	if (wall_host[0] && WallTileStart (&wall_tile, wall_host, wall_port) != 0)
+		fprintf (stderr, "Could not follow the wall lead at '%s'\n", wall_host);
+	else if (wall_host[0])
+		wall_following = 1;
+	ScoreboardState wall_state; // Team names are shown from here on a tile
+
 	// Window
 	SetConfigFlags (FLAG_WINDOW_RESIZABLE);
 	InitWindow (1920, 1080, "Basketball Scoreboard");
-	SetTargetFPS (30);
+
+	// Frame pacing, following the display refresh unless the config sets a frame rate (pacing.h)
+	PacingStats pacing;
+	PacingInit (&pacing, GetMonitorRefreshRate (GetCurrentMonitor ()));
+	ApplyFrameRate (config->target_fps, &pacing);
+	int vsync_checked = 0;
+	int64_t refresh_checked_us = 0;
+	int64_t pacing_report_us = 0;
+	int64_t last_swap_us = 0;
 
 	// Window icon
 	Image window_icon = LoadImage ("icon.png");
@@ -162,54 +407,152 @@ Made with raylib, by raysan5 <https://github.com/raysan5/raylib>\n\
 	float screen_width, screen_height, border;
 	int fontSize, period_label_y, hvlabel_y, fouls_label_y;
 
+	// Labels, drawn from the signed distance field atlas if there is one (label.h) and laid out again only when they change
+	LabelFont label_font;
+	LabelFontLoad (&label_font);
+	Label period_label = {0}, fouls_label = {0}, tol_label = {0}, team_labels[2];
+	memset (team_labels, 0, sizeof (team_labels));
+	float label_width;
+
 	// Display boxes for storing width, height, x, y values of each box on the scoreboard
 	DisplayBox main_clock_box, shot_clock_box, period_box;
 	DisplayBox home_score_box, home_fouls_box, home_tol_box;
 	DisplayBox visitor_score_box, visitor_fouls_box, visitor_tol_box;
 
-	// Control variables
-	int team = HOME; // Selected team to change data
-	ChangeType change_type = SCORE; // Selected type of data to change
-	Mode scoreboard_mode = CLOCK; // Scoreboard mode: clock or edit mode
-	TimerMode main_clock_mode = NORMAL; // Controls whether time is displayed as normal or tenth seconds
-	TimerMode shot_clock_mode = NORMAL;
-	int shot_clock_showing = 1; // 0 = timeout clock showing; 1 = shot clock showing
-	int shot_clock_enabled = 1;
-	int main_clock_enabled = 1; // Main/shot clock enabled - whether to display or not
-	int shot_clock_running = 0; // Main/shot clock running - whether to update time every frame
-	int main_clock_running = 0;
-	int shot_clock_add_tenth_second = 1; // Every 3 frames (30 FPS) update time by 0.1 seconds
-	int main_clock_add_tenth_second = 1;
-	int timeout_clock_add_tenth_second = 1;
-
-	// Game data
-	Time main_clock = {0, 8, 0, 0, 0}; // Stores actual time for main/shot clocks
-	Time shot_clock = {0, 0, 3, 5, 0}; // Not directly displayed
-	Time timeout_clock = {0, 0, 3, 0, 0}; // For timeouts (unused)
-	int score[] = {0, 0};
-	int fouls[] = {0, 0}; // Stores actual score, fouls, timeouts left, period
-	int tol[] = {5, 5}; // Directly displayed on the board
-	int period = 0;
+	// Board: clocks, score, fouls, TOL, period, edit mode (libscoreboard.h), read into view after each change
+	// shown is a copy run on to the time a frame is seen
+	Scoreboard *board = ScoreboardNew (config->main_clock_start, config->shot_clock_reset, config->timeout_short, config->timeout_long);
+	Scoreboard *shown = ScoreboardNew (config->main_clock_start, config->shot_clock_reset, config->timeout_short, config->timeout_long);
+	if (board == NULL || shown == NULL)
+	{
+		CloseWindow ();
+		return EXIT_FAILURE;
+	}
+	ScoreboardView view;
+	ScoreboardRead (board, &view);
+	int64_t last_frame_us = syncing ? SyncTime (&sync_client, InputNow ()) : InputNow ();
 
 	// Display times
-	Time main_clock_display = main_clock; // What is actually displayed for clocks is stored here
-	Time shot_clock_display = shot_clock;
+	Time main_clock_display = ClockDigits (view.main_clock); // What is actually displayed for clocks is stored here
+	Time shot_clock_display = ClockDigits (view.shot_clock);
+	int main_clock_tenths_display = 0; // Shown with tenths of seconds
+	int shot_clock_tenths_display = 0;
+	int last_shown_tenths = view.main_clock;
+
+	// Key bindings, one lookup table per mode
+	BindingTable bindings;
+	BindingsBuild (&bindings, config);
+
+	// Input trace, for replaying the game later
+	TraceWriter trace;
+	if (record_path && TraceOpen (&trace, record_path, config->main_clock_start, config->shot_clock_reset, config->timeout_short, config->timeout_long, last_frame_us) != 0)
+	{
+		fprintf (stderr, "Could not record input trace to '%s'\n", record_path);
+		record_path = NULL;
+	}
 
-	// Edit mode buffers + pointer
-	Time main_clock_buffer = main_clock; // Buffers for edit mode (user chooses to save or discard)
-	Time shot_clock_buffer = shot_clock;
-	int score_buffer[] = {0, 0}; // TODO: Currently unused, may be used in the future
-	int selected_digit = 1; // Selected digit; 1-4 = main; 5-6 = shot
-	int replace_digit = -1; // What digit to replace the selected one with; -1 indicates no replacement
+	// Keyboards and button boxes read directly, applied at the time the kernel saw them
+	EvdevInput evdev;
+	int evdev_enabled = evdev_count > 0 && EvdevStart (&evdev, evdev_paths, evdev_count) == 0;
+	if (evdev_count > 0 && !evdev_enabled)
+		fprintf (stderr, "No --evdev input could be opened, only the window's keyboard is used\n");
+	int evdev_buzzer = 0; // Buzzer held on one of them
+	int64_t evdev_buzzer_us = 0; // When it was pressed
+
+	// The referee's whistle stops the clocks; a tile only shows the lead's
+	WhistleInput whistle;
+	int whistle_enabled = whistle_path && !wall_following && WhistleStart (&whistle, whistle_path) == 0;
+
+	// Season statistics, saved when the window closes
+	StatsGame game;
+	StatsGameStart (&game, time (NULL));
+	StatsGameTrack (&game, &view);
+
+	// Published state, for overlay processes (shm.h); kept in private memory without --shm
+	ShmPublisher publisher;
+	if (ShmPublisherOpen (&publisher, shm_name) != 0)
+	{
+		if (shm_name)
+			fprintf (stderr, "Could not publish to shared memory '%s'\n", shm_name);
+		ShmPublisherOpen (&publisher, NULL);
+	}
+
+	// Health metrics, recorded by this thread and read by the web server or the file writer
+	Metrics metrics;
+	int metrics_enabled = (MetricsInit (&metrics) == 0);
+	MetricsShard *render_metrics = metrics_enabled ? MetricsShardAdd (&metrics) : NULL; // NULL = not recording
+	if (metrics_path && (!metrics_enabled || MetricsFileStart (&metrics, metrics_path) != 0))
+		fprintf (stderr, "Could not write metrics to '%s'\n", metrics_path);
+
+	// Game log, written to disk by its own thread
+	Logger logger;
+	int log_enabled = log_path && LogOpen (&logger, log_path) == 0;
+	LogRing *render_log = log_enabled ? LogRingAdd (&logger, "render") : NULL; // NULL = not logging
+	if (log_path && !log_enabled)
+		fprintf (stderr, "Could not write the game log to '%s'\n", log_path);
+	if (render_log)
+		LogWrite (render_log, LOG_START, 0, 0, 0);
+
+	// Spectator web server, on its own thread reading the published state
+	HttpServer http;
+	if (http_port && HttpStart (&http, &publisher, metrics_enabled ? &metrics : NULL, http_port) != 0)
+	{
+		fprintf (stderr, "Could not start the web server on port %d\n", http_port);
+		http_port = 0;
+	}
 
-	// Constant time variables to reset shot clock
-	const Time time_30 = {0, 0, 3, 0, 0};
-	const Time time_35 = {0, 0, 3, 5, 0};
-	const Time time_60 = {0, 0, 6, 0, 0};
+	// Hardware scoreboard controller, on its own thread reading the published state
+	SerialOutput serial;
+	if (serial_path && SerialStart (&serial, &publisher, serial_path, serial_baud) != 0)
+	{
+		fprintf (stderr, "Could not send to the scoreboard controller on '%s' at %d baud\n", serial_path, serial_baud);
+		serial_path = NULL;
+	}
 
 	// Audio
 	InitAudioDevice ();
 	Sound buzzer_sound = LoadSound ("buzzer.ogg");
+	int buzzer_wanted = 0, buzzer_was_wanted = 0; // This frame and the last
+
+	// Watchdog, runs the clocks, the published state and the buzzer on its own thread if this one stalls
+	// Tiles of a wall leave the sound to the lead
+	Watchdog watchdog;
+	int watchdog_enabled = publisher.segment && WatchdogStart (&watchdog, &publisher, wall_following ? NULL : SoundBuzzer, &buzzer_sound,
+		log_enabled ? &logger : NULL, metrics_enabled ? &metrics : NULL) == 0;
+
+	// Team logos, decoded in the background and uploaded a slice per frame
+	AssetCache assets;
+	int assets_enabled = (AssetCacheInit (&assets) == 0);
+
+	// LED matrix output, encoded and written on its own thread
+	Hub75Output hub75;
+	if (hub75_path && Hub75Start (&hub75, hub75_path, hub75_width, hub75_height, hub75_depth, hub75_gamma) != 0)
+	{
+		fprintf (stderr, "Could not start HUB75 output to '%s' (%dx%d, depth %d)\n", hub75_path, hub75_width, hub75_height, hub75_depth);
+		hub75_path = NULL;
+	}
+
+	// Replay of the last minutes shown, compressed without holding up the frame
+	FrameRing replay;
+	int replay_enabled = replay_mb > 0 && FrameRingInit (&replay, (size_t) replay_mb << 20, (int64_t) REPLAY_MAX_SECONDS * 1000000) == 0;
+
+	// Finished frames read back for the replay ring and the LED matrix, a frame or two behind the window
+	Capture capture;
+	int capture_enabled = (replay_enabled || hub75_path) &&
+		CaptureInit (&capture, replay_enabled ? &replay : NULL, hub75_path ? SendHub75 : NULL, &hub75) == 0;
+	if (!capture_enabled && hub75_path)
+	{
+		fprintf (stderr, "Could not read frames back, no HUB75 output\n");
+		Hub75Stop (&hub75);
+		hub75_path = NULL;
+	}
+	if (!capture_enabled && replay_enabled)
+	{
+		FrameRingClose (&replay);
+		replay_enabled = 0;
+	}
+	if (replay_mb > 0 && !replay_enabled)
+		fprintf (stderr, "Could not start the replay ring, no replays can be saved\n");
 
 	//---------------------------------------------------------------------------------------------
 
@@ -220,357 +563,320 @@ Made with raylib, by raysan5 <https://github.com/raysan5/raylib>\n\
 	{
 		// ## Update board logic
 		//-----------------------------------------------------------------------------------------
-		// Toggle fullscreen
-		if (IsKeyPressed (KEY_TOGGLE_FULLSCREEN))
-			ToggleFullscreen ();
+		// Take the sound back from the watchdog before anything here touches it; a horn it left sounding is ours now
+		if (watchdog_enabled && WatchdogResume (&watchdog))
+			buzzer_was_wanted = 1;
 
-		switch (scoreboard_mode)
+		// Swap in a reloaded config between frames
+		if (config_watching)
 		{
-			// ### Clock mode
-			//-------------------------------------------------------------------------------------
-			case CLOCK:
-				// Switch between shot clock and timeout clock
-				if (IsKeyPressed (KEY_SWITCH_SHOT_CLOCK) && !shot_clock_running && !main_clock_running)
-					shot_clock_showing = !shot_clock_showing;
-				// Start/stop clocks individually
-				if (IsKeyPressed (KEY_START_STOP_MAIN_CLOCK))
-					main_clock_running = !main_clock_running;
-				if (IsKeyPressed (KEY_START_STOP_SHOT_CLOCK))
-					shot_clock_running = !shot_clock_running;
-				// When both clocks are stopped, set both to running; else, set both to stopped
-				if (IsKeyPressed (KEY_START_STOP_CLOCKS))
-				{
-					if (!main_clock_running && !shot_clock_running)
-						main_clock_running = 1;
-					else
-						main_clock_running = 0;
-					shot_clock_running = main_clock_running;
-				}
-				// Update clocks only if neither has no time left
-				if (TimeToInt (main_clock) != 0 && TimeToInt (shot_clock) != 0 && shot_clock_showing)
-				{
-					// Main clock, only if it is running
-					if (main_clock_running)
-					{
-						if (main_clock_add_tenth_second == 0)
-							main_clock = UpdateTime (main_clock);
-						main_clock_add_tenth_second++;
-						if (main_clock_add_tenth_second > 2)
-							main_clock_add_tenth_second = 0;
-					}
-					// Shot clock, only if it is running
-					if (shot_clock_running)
-					{
-						if (shot_clock_add_tenth_second == 0)
-							shot_clock = UpdateTime (shot_clock);
-						shot_clock_add_tenth_second++;
-						if (shot_clock_add_tenth_second > 2)
-							shot_clock_add_tenth_second = 0;
-					}
-				}
-				// Timeout clock, only if it is running
-				else if (TimeToInt (timeout_clock) != 0 && !shot_clock_showing && shot_clock_running)
-				{
-					if (timeout_clock_add_tenth_second == 0)
-						timeout_clock = UpdateTime (timeout_clock);
-					timeout_clock_add_tenth_second++;
-					if (timeout_clock_add_tenth_second > 2)
-						timeout_clock_add_tenth_second = 0;
-				}
-				// Reset shot clock (35) or timeout clock (30/60)
-				if (IsKeyPressed (KEY_RESET_SHOT_CLOCK))
-				{
-					if (shot_clock_showing)
-						shot_clock = time_35;
-					else
-					{
-						if (TimeToInt (timeout_clock) == 300)
-							timeout_clock = time_60;
-						else
-							timeout_clock = time_30;
-					}
-				}
-				// Check if either clock should be set to tenth_seconds mode
-				if (TimeToInt (main_clock) < 600)
-					main_clock_mode = TENTH_SECONDS;
-				else
-					main_clock_mode = NORMAL;
-				if (shot_clock_showing)
-				{
-					if (TimeToInt (shot_clock) < 100)
-						shot_clock_mode = TENTH_SECONDS;
-					else
-						shot_clock_mode = NORMAL;
-				}
-				else
+			Config *reloaded = ConfigPoll (&config_watcher);
+			if (reloaded != NULL)
+			{
+				if (reloaded->target_fps != config->target_fps)
 				{
-					if (TimeToInt (timeout_clock) < 100)
-						shot_clock_mode = TENTH_SECONDS;
-					else
-						shot_clock_mode = NORMAL;
+					PacingCheckVsync (&pacing);
+					vsync_checked = 0;
+					ApplyFrameRate (reloaded->target_fps, &pacing);
 				}
+				free (config);
+				config = reloaded;
+				BindingsBuild (&bindings, config);
+				ScoreboardSetResetTimes (board, config->shot_clock_reset, config->timeout_short, config->timeout_long);
+				if (record_path)
+					TraceRecordResetTimes (&trace, last_frame_us, config->shot_clock_reset, config->timeout_short, config->timeout_long);
+				if (render_log)
+					LogWrite (render_log, LOG_CONFIG_RELOAD, 0, 0, 0);
+			}
+		}
 
-				// Changing modes
-				// Home or visitor
-				if (IsKeyPressed (KEY_CHANGING_HOME))
-					team = HOME;
-				if (IsKeyPressed (KEY_CHANGING_VISITOR))
-					team = VISITOR;
-				// Score, fouls, TOL, period
-				if (IsKeyPressed (KEY_CHANGE_MODE_SCORE))
-					change_type = SCORE;
-				if (IsKeyPressed (KEY_CHANGE_MODE_FOULS))
-					change_type = FOULS;
-				if (IsKeyPressed (KEY_CHANGE_MODE_TOL))
-					change_type = TOL;
-				if (IsKeyPressed (KEY_CHANGE_MODE_PERIOD))
-					change_type = PERIOD;
-
-				// Change score, fouls, TOL
-				// Check change type: the same buttons will change different values based on this
-				switch (change_type)
+		// Run the clocks up to now, before this frame's keys are applied
+		// A secondary's frames are on the primary's time, vblanks stay on this machine's
+		int64_t local_us = InputNow ();
+		int64_t frame_us = syncing ? SyncTime (&sync_client, local_us) : local_us;
+
+		// Direct input first: the clocks are run up to each press and it is applied right there
+		EvdevEvent direct;
+		while (evdev_enabled && EvdevPoll (&evdev, &direct))
+		{
+			int64_t event_us = frame_us - (local_us - direct.time_us);
+			if (event_us > frame_us)
+				event_us = frame_us;
+			if (event_us > last_frame_us)
+			{
+				ScoreboardStep (board, event_us - last_frame_us, SCOREBOARD_ACTION_NONE);
+				last_frame_us = event_us;
+			}
+			int buzzer_held = evdev_buzzer;
+			ApplyDirectInput (&direct, board, &bindings, config, record_path ? &trace : NULL, render_log, last_frame_us, &evdev_buzzer);
+			if (evdev_buzzer && !buzzer_held)
+				evdev_buzzer_us = direct.time_us;
+			if (render_metrics)
+				MetricsObserve (render_metrics, METRIC_INPUT_LATENCY, InputNow () - direct.time_us);
+		}
+
+		// Whistles stop the clocks where they started, given back if the frame ran past
+		WhistleEvent blown;
+		while (whistle_enabled && WhistlePoll (&whistle, &blown))
+		{
+			int64_t onset_us = frame_us - (local_us - blown.onset_us);
+			int64_t ago_us = 0;
+			if (onset_us > frame_us)
+				onset_us = frame_us;
+			if (onset_us > last_frame_us)
+			{
+				ScoreboardStep (board, onset_us - last_frame_us, SCOREBOARD_ACTION_NONE);
+				last_frame_us = onset_us;
+			}
+			else
+				ago_us = last_frame_us - onset_us;
+			if (ago_us > WHISTLE_LOOKBACK_MS * 1000)
+				ago_us = WHISTLE_LOOKBACK_MS * 1000;
+			ScoreboardView before;
+			ScoreboardRead (board, &before);
+			if (ScoreboardStopClocksAt (board, ago_us))
+			{
+				if (record_path)
+					TraceRecordWhistle (&trace, last_frame_us, (int) ago_us);
+				if (render_log)
 				{
-					case SCORE:
-						if ((IsKeyPressed (KEY_ONE) || IsKeyPressed (KEY_KP_1)) && score[team] + 1 < 200)
-							score[team] += 1;
-						if ((IsKeyPressed (KEY_TWO) || IsKeyPressed (KEY_KP_2)) && score[team] + 2 < 200)
-							score[team] += 2;
-						if ((IsKeyPressed (KEY_THREE) || IsKeyPressed (KEY_KP_3)) && score[team] + 3 < 200)
-							score[team] += 3;
-						if ((IsKeyPressed (KEY_EQUAL) || IsKeyPressed (KEY_KP_ADD)) && score[team] + 1 < 200)
-							score[team]++;
-						if ((IsKeyPressed (KEY_MINUS) || IsKeyPressed (KEY_KP_SUBTRACT)) && score[team] > 0)
-							score[team]--;
-						break;
-					case FOULS:
-						if ((IsKeyPressed (KEY_EQUAL) || IsKeyPressed (KEY_KP_ADD)) && fouls[team] < 19)
-							fouls[team]++;
-						if ((IsKeyPressed (KEY_MINUS) || IsKeyPressed (KEY_KP_SUBTRACT)) && fouls[team] > 0)
-							fouls[team]--;
-						break;
-					case TOL:
-						if ((IsKeyPressed (KEY_EQUAL) || IsKeyPressed (KEY_KP_ADD)) && tol[team] < 9)
-							tol[team]++;
-						if ((IsKeyPressed (KEY_MINUS) || IsKeyPressed (KEY_KP_SUBTRACT)) && tol[team] > 0)
-							tol[team]--;
-						break;
-					case PERIOD:
-						if ((IsKeyPressed (KEY_EQUAL) || IsKeyPressed (KEY_KP_ADD)) && period < 9)
-							period++;
-						if ((IsKeyPressed (KEY_MINUS) || IsKeyPressed (KEY_KP_SUBTRACT)) && period > -1)
-							period--;
-						break;
+					ScoreboardRead (board, &view);
+					LogWrite (render_log, LOG_WHISTLE, (int) (ago_us / 1000), 0, 0);
+					LogBoardChanges (render_log, &before, &view);
 				}
+			}
+		}
+
+		// Where in this frame a clock runs out, on this machine's clock, for the buzzer latency
+		int64_t clock_out_us = ScoreboardUntilClockOut (board);
+		if (clock_out_us >= 0 && clock_out_us <= frame_us - last_frame_us)
+			clock_out_us = local_us - (frame_us - last_frame_us - clock_out_us);
+		else
+			clock_out_us = -1;
+
+		ScoreboardStep (board, frame_us - last_frame_us, SCOREBOARD_ACTION_NONE);
+		last_frame_us = frame_us;
+
+		// The window may have moved to a monitor with another refresh rate
+		if (frame_us - refresh_checked_us >= 1000000)
+		{
+			int refresh_hz = GetMonitorRefreshRate (GetCurrentMonitor ());
+			if (refresh_hz > 0 && refresh_hz != pacing.refresh_hz)
+			{
+				PacingSetRefresh (&pacing, refresh_hz);
+				PacingCheckVsync (&pacing);
+				vsync_checked = 0;
+				ApplyFrameRate (config->target_fps, &pacing);
+			}
+			refresh_checked_us = frame_us;
+		}
+
+		// ### Input
+		//-----------------------------------------------------------------------------------------
+		// Drain raylib's key queue once, in the order the keys were pressed
+		int key;
+		while ((key = GetKeyPressed ()) != 0)
+		{
+			ScoreboardRead (board, &view);
+			Action action = BindingLookup (&bindings, (Mode) view.mode, key);
+			if (action == ACTION_TOGGLE_FULLSCREEN)
+				ToggleFullscreen ();
+			else if (action != ACTION_NONE)
+			{
+				ApplyAction (board, action, render_log);
+				if (record_path)
+					TraceRecord (&trace, frame_us, action);
+			}
+			if (record_path && key == config->keys[BIND_SOUND_BUZZER])
+				TraceRecord (&trace, frame_us, TRACE_BUZZER_DOWN);
+		}
+		if (record_path && IsKeyReleased (config->keys[BIND_SOUND_BUZZER]))
+			TraceRecord (&trace, frame_us, TRACE_BUZZER_UP);
 
+		// Save what the board showed, for a disputed call, written on its own thread
+		if (replay_enabled && IsKeyPressed (config->keys[BIND_DUMP_REPLAY]))
+		{
+			char replay_path[64];
+			time_t now = time (NULL);
+			strftime (replay_path, sizeof (replay_path), "replay-%Y%m%d-%H%M%S.y4m", localtime (&now));
+			if (FrameRingDump (&replay, replay_path) != 0)
+				fprintf (stderr, "Still writing the last replay, '%s' not saved\n", replay_path);
+		}
+		ScoreboardRead (board, &view);
+		StatsGameTrack (&game, &view);
+		//-----------------------------------------------------------------------------------------
+
+		// A tile shows the lead's board as it is this frame, already at the vblank
+		int wall_drawing = wall_following && WallTileState (&wall_tile, &wall_state) == 0;
+		if (wall_drawing)
+		{
+			ApplyState (board, &wall_state);
+			ScoreboardRead (board, &view);
+			team_names[HOME] = wall_state.team_names[HOME];
+			team_names[VISITOR] = wall_state.team_names[VISITOR];
+		}
+
+		ScoreboardView drawn = view; // What this frame shows
+		switch (view.mode)
+		{
+			// ### Clock mode
+			//-------------------------------------------------------------------------------------
+			case SCOREBOARD_MODE_CLOCK:
 				// Game buzzer sound
-				// Play when key is pressed, if not then play when one of the clocks has run out and is still "running", else stop sound
-				if ((IsKeyDown (KEY_SOUND_BUZZER)) ||
-					(main_clock_running && TimeToInt (main_clock) == 0) ||
-					(shot_clock_showing && shot_clock_running && TimeToInt (shot_clock) == 0) ||
-					(!shot_clock_showing && shot_clock_running && TimeToInt (timeout_clock) == 0) ||
-					(!shot_clock_showing && shot_clock_running && TimeToInt (timeout_clock) <= 150 && TimeToInt (timeout_clock) >= 140))
+				// Play when key is held, if not then play when one of the clocks has run out and is still "running", else stop sound
+				// Tiles of a wall leave the sound to the lead
+				buzzer_wanted = !wall_following && (IsKeyDown (config->keys[BIND_SOUND_BUZZER]) || evdev_buzzer || (view.flags & SCOREBOARD_BUZZER));
+				if (render_log && buzzer_wanted != buzzer_was_wanted)
+				{
+					if (buzzer_wanted)
+						LogWrite (render_log, LOG_BUZZER_START, IsKeyDown (config->keys[BIND_SOUND_BUZZER]) || evdev_buzzer ? LOG_BUZZER_BUTTON : LOG_BUZZER_CLOCK, 0, 0);
+					else
+						LogWrite (render_log, LOG_BUZZER_STOP, 0, 0, 0);
+				}
+				if (buzzer_wanted)
 				{
 					if (!IsSoundPlaying (buzzer_sound))
+					{
 						PlaySound (buzzer_sound);
+						// Timed from the button's event, the clock running out, or this frame for the window's keyboard
+						if (render_metrics && !buzzer_was_wanted)
+						{
+							int64_t cause_us = evdev_buzzer ? evdev_buzzer_us : clock_out_us >= 0 ? clock_out_us : local_us;
+							MetricsObserve (render_metrics, METRIC_BUZZER_LATENCY, InputNow () - cause_us);
+						}
+						if (render_metrics)
+							MetricsCount (render_metrics, METRIC_BUZZERS, 1);
+					}
 				}
 				else
 					StopSound (buzzer_sound);
+				buzzer_was_wanted = buzzer_wanted;
 
-				// Update edit mode buffers, reset edit mode variables, and enter edit mode
-				if (!main_clock_running && !shot_clock_running && (IsKeyPressed (KEY_SLASH) || IsKeyPressed (KEY_BACKSLASH)))
+				// Set clock displays to actual time every frame
+				// Following the display, that is the time at the vblank the frame will be shown on, from a copy so the board itself is not touched
+				if (config->target_fps == 0 && !wall_drawing)
 				{
-					main_clock_buffer = main_clock;
-					if (shot_clock_showing)
-						shot_clock_buffer = shot_clock;
-					else
-						shot_clock_buffer = timeout_clock;
-					score_buffer[HOME] = score[HOME];
-					score_buffer[VISITOR] = score[VISITOR];
-					selected_digit = 1; // 1-4 = digits 1-4 of the main clock, 5-6 = digits 1-2 of the shot clock
-					replace_digit = -1;
-					shot_clock_enabled = 1;
-					scoreboard_mode = EDIT_MODE;
+					ScoreboardCopy (shown, board);
+					ScoreboardStep (shown, PacingDisplayTime (&pacing, local_us) - local_us, SCOREBOARD_ACTION_NONE);
+					ScoreboardRead (shown, &drawn);
 				}
-
-				// Set clock displays to actual time every frame
-				main_clock_display = main_clock;
-				if (shot_clock_showing)
-					shot_clock_display = shot_clock;
+				// How long the main clock's new tenth has been down by the time it is shown
+				if (render_metrics && (drawn.flags & SCOREBOARD_MAIN_RUNNING) && drawn.main_clock == last_shown_tenths - 1)
+					MetricsObserve (render_metrics, METRIC_TICK_LATENESS, drawn.main_clock_elapsed_us);
+				last_shown_tenths = drawn.main_clock;
+				main_clock_display = ClockDigits (drawn.main_clock);
+				if (drawn.flags & SCOREBOARD_SHOT_SHOWING)
+					shot_clock_display = ClockDigits (drawn.shot_clock);
 				else
-					shot_clock_display = timeout_clock;
+					shot_clock_display = ClockDigits (drawn.timeout_clock);
+				main_clock_tenths_display = (drawn.flags & SCOREBOARD_MAIN_TENTHS) != 0;
+				shot_clock_tenths_display = (drawn.flags & SCOREBOARD_SHOT_TENTHS) != 0;
 				break;
 				//---------------------------------------------------------------------------------
-			case EDIT_MODE:
+			case SCOREBOARD_MODE_EDIT:
 				// ### Edit mode
 				//---------------------------------------------------------------------------------
-				// Discard changes and exit edit mode
-				if (IsKeyPressed (KEY_BACKSPACE))
-					scoreboard_mode = CLOCK;
-				// Save changes by overwriting core variables with the buffers, and exit edit mode
-				if (IsKeyPressed (KEY_ENTER))
-				{
-					main_clock = main_clock_buffer;
-					if (shot_clock_showing)
-						shot_clock = shot_clock_buffer;
-					else
-						timeout_clock = shot_clock_buffer;
-					score[HOME] = score_buffer[HOME];
-					score[VISITOR] = score_buffer[VISITOR];
-					scoreboard_mode = CLOCK;
-				}
-				// Switch selected digit left and right
-				if (IsKeyPressed (KEY_LEFT) && selected_digit > 1)
-					selected_digit--;
-				if (IsKeyPressed (KEY_RIGHT) && selected_digit < 6)
-					selected_digit++;
-				// Convenient keys to jump to shot or main clock quickly (first digit)
-				if (IsKeyPressed (KEY_UP))
-					selected_digit = 1;
-				if (IsKeyPressed (KEY_DOWN))
-					selected_digit = 5;
-				// Flip mode between normal and tenth seconds
-				if (IsKeyPressed (KEY_LEFT_SHIFT))
-				{
-					// Digits 1-4 are main clock and digits 5-6 are shot clock
-					switch (selected_digit)
-					{
-						case 1:
-						case 2:
-						case 3:
-						case 4:
-							if (main_clock_mode == NORMAL)
-								main_clock_mode = TENTH_SECONDS;
-							else
-								main_clock_mode = NORMAL;
-							break;
-						case 5:
-						case 6:
-							if (shot_clock_mode == NORMAL)
-								shot_clock_mode = TENTH_SECONDS;
-							else
-								shot_clock_mode = NORMAL;
-							break;
-					}
-				}
-				// Change numbers - TODO: probably make this an array
-				if (IsKeyPressed (KEY_ONE) || IsKeyPressed (KEY_KP_1))
-					replace_digit = 1;
-				else if (IsKeyPressed (KEY_TWO) || IsKeyPressed (KEY_KP_2))
-					replace_digit = 2;
-				else if (IsKeyPressed (KEY_THREE) || IsKeyPressed (KEY_KP_3))
-					replace_digit = 3;
-				else if (IsKeyPressed (KEY_FOUR) || IsKeyPressed (KEY_KP_4))
-					replace_digit = 4;
-				else if (IsKeyPressed (KEY_FIVE) || IsKeyPressed (KEY_KP_5))
-					replace_digit = 5;
-				else if (IsKeyPressed (KEY_SIX) || IsKeyPressed (KEY_KP_6))
-					replace_digit = 6;
-				else if (IsKeyPressed (KEY_SEVEN) || IsKeyPressed (KEY_KP_7))
-					replace_digit = 7;
-				else if (IsKeyPressed (KEY_EIGHT) || IsKeyPressed (KEY_KP_8))
-					replace_digit = 8;
-				else if (IsKeyPressed (KEY_NINE) || IsKeyPressed (KEY_KP_9))
-					replace_digit = 9;
-				else if (IsKeyPressed (KEY_ZERO) || IsKeyPressed (KEY_KP_0))
-					replace_digit = 0;
-				else
-					replace_digit = -1;
-				// Move the selected number into the appropriate place in the edit mode buffers
-				// This if-switch-if-else-switch thing is really ugly (╯°□°)╯︵ ┻━┻
-				// TODO: make it look nicer maybe?
-				if (replace_digit != -1)
-				{
-					switch (selected_digit)
-					{
-						case 1:
-						case 2:
-						case 3:
-						case 4:
-							if (main_clock_mode == NORMAL)
-							{
-								switch (selected_digit)
-								{
-									case 1:
-										main_clock_buffer.ten_minutes = replace_digit;
-										break;
-									case 2:
-										main_clock_buffer.minutes = replace_digit;
-										break;
-									case 3:
-										if (replace_digit < 6)
-											main_clock_buffer.ten_seconds = replace_digit;
-										break;
-									case 4:
-										main_clock_buffer.seconds = replace_digit;
-										break;
-								}
-							}
-							else
-							{
-								switch (selected_digit)
-								{
-									case 1:
-										if (replace_digit < 6)
-											main_clock_buffer.ten_seconds = replace_digit;
-										break;
-									case 2:
-										main_clock_buffer.seconds = replace_digit;
-										break;
-									case 3:
-										main_clock_buffer.tenth_seconds = replace_digit;
-										break;
-									// No case 4: because when it is in tenth seconds mode, the last digit represents nothing
-								}
-							}
-							break;
-						case 5:
-						case 6:
-							if (shot_clock_mode == NORMAL)
-							{
-								switch (selected_digit)
-								{
-									case 5:
-										shot_clock_buffer.ten_seconds = replace_digit;
-										break;
-									case 6:
-										shot_clock_buffer.seconds = replace_digit;
-										break;
-								}
-							}
-							else
-							{
-								switch (selected_digit)
-								{
-									case 5:
-										shot_clock_buffer.seconds = replace_digit;
-										break;
-									case 6:
-										shot_clock_buffer.tenth_seconds = replace_digit;
-										break;
-								}
-							}
-							break;
-					}
-				}
 				// Set display time to edit mode buffer instead of actual value
-				main_clock_display = main_clock_buffer;
-				shot_clock_display = shot_clock_buffer;
+				main_clock_display = ClockDigits (view.main_clock_edit);
+				shot_clock_display = ClockDigits (view.shot_clock_edit);
+				main_clock_tenths_display = (view.flags & SCOREBOARD_MAIN_TENTHS) != 0;
+				shot_clock_tenths_display = (view.flags & SCOREBOARD_SHOT_TENTHS) != 0;
 				break;
 				//---------------------------------------------------------------------------------
 		}
+
+		// The wall's tiles draw what this frame shows
+		if (wall_leading)
+		{
+			FillState
+			(
+				&wall_state,
+				&drawn,
+				team_names[HOME] ? team_names[HOME] : config->home_name,
+				team_names[VISITOR] ? team_names[VISITOR] : config->visitor_name,
+				IsSoundPlaying (buzzer_sound)
+			);
+			WallLeadSend (&wall_lead, &wall_state);
+		}
+
+		// Publish the board after this frame's changes, through the watchdog, which says how long this thread was stalled
+		int64_t stalled_us = 0;
+		if (publisher.segment)
+		{
+			ScoreboardState state;
+			FillState
+			(
+				&state,
+				&view,
+				team_names[HOME] ? team_names[HOME] : config->home_name,
+				team_names[VISITOR] ? team_names[VISITOR] : config->visitor_name,
+				IsSoundPlaying (buzzer_sound)
+			);
+			if (watchdog_enabled)
+				stalled_us = WatchdogPublish (&watchdog, board, frame_us, local_us, &state);
+			else
+				ShmPublish (&publisher, &state);
+		}
+		//-----------------------------------------------------------------------------------------
+
+
+		// ## Renderer rebuild
+		//-----------------------------------------------------------------------------------------
+		// After a long stall the GL context is not trusted: the window and everything on the GPU are made again
+		// The game is all in board, which is not touched
+		if (stalled_us >= (int64_t) WATCHDOG_REBUILD_MS * 1000)
+		{
+			int64_t rebuild_us = InputNow ();
+			int window_width = GetScreenWidth (), window_height = GetScreenHeight (), fullscreen = IsWindowFullscreen ();
+			if (capture_enabled)
+				CaptureRelease (&capture);
+			if (assets_enabled)
+				AssetCacheClose (&assets);
+			LabelFontUnload (&label_font);
+			CloseWindow ();
+
+			SetConfigFlags (FLAG_WINDOW_RESIZABLE);
+			InitWindow (window_width, window_height, "Basketball Scoreboard");
+			SetWindowIcon (window_icon);
+			if (fullscreen)
+				ToggleFullscreen ();
+			PacingCheckVsync (&pacing);
+			vsync_checked = 0;
+			ApplyFrameRate (config->target_fps, &pacing);
+			assets_enabled = (AssetCacheInit (&assets) == 0);
+			LabelFontLoad (&label_font);
+			if (capture_enabled && CaptureInit (&capture, replay_enabled ? &replay : NULL, hub75_path ? SendHub75 : NULL, &hub75) != 0)
+			{
+				if (replay_enabled)
+					FrameRingClose (&replay);
+				if (hub75_path)
+					Hub75Stop (&hub75);
+				capture_enabled = replay_enabled = 0;
+				hub75_path = NULL;
+			}
+			if (render_log)
+				LogWrite (render_log, LOG_RENDERER_REBUILD, (int) ((InputNow () - rebuild_us) / 1000), 0, 0);
+		}
 		//-----------------------------------------------------------------------------------------
 
 
 		// ## Drawing
 		//-----------------------------------------------------------------------------------------
 
+		// Continue any texture uploads before drawing so finished logos show up this frame
+		if (assets_enabled)
+			AssetCacheUpdate (&assets);
+
 		BeginDrawing ();
 
 			// Update core display variables
-			screen_width = (float) GetScreenWidth ();
-			screen_height = (float) GetScreenHeight ();
+			// On a wall the board is laid out over all of its screens and moved so this one's part is in the window
+			screen_width = (float) GetScreenWidth () * wall_columns;
+			screen_height = (float) GetScreenHeight () * wall_rows;
 			border = screen_width / 96;
 			fontSize = (int) border * 6;
+			Camera2D wall_camera = {{-(float) GetScreenWidth () * wall_column, -(float) GetScreenHeight () * wall_row}, {0, 0}, 0, 1};
+			BeginMode2D (wall_camera);
 			// Draw background rectangle + outline
 			ClearBackground (WHITE);
 			DrawRectangle (border, border, screen_width - (border * 2), screen_height - (border * 2), DARKBLUE);
@@ -583,32 +889,32 @@ Made with raylib, by raysan5 <https://github.com/raysan5/raylib>\n\
 			main_clock_box.x = (screen_width / 2) - (main_clock_box.width / 2);
 			main_clock_box.y = border;
 			// Draw boxes
-			if (main_clock_running)
+			if (view.flags & SCOREBOARD_MAIN_RUNNING)
 				DrawRectangle (main_clock_box.x - border, main_clock_box.y - border, main_clock_box.width + (border * 2), main_clock_box.height + (border * 2), WHITE);
 			else
 				DrawRectangle (main_clock_box.x - border, main_clock_box.y - border, main_clock_box.width + (border * 2), main_clock_box.height + (border * 2), RED);
 			DrawRectangle (main_clock_box.x, main_clock_box.y, main_clock_box.width, main_clock_box.height, BLACK);
 			// Edit mode
-			if (scoreboard_mode == EDIT_MODE)
+			if (view.mode == SCOREBOARD_MODE_EDIT)
 			{
-				switch (selected_digit)
+				switch (view.edit_digit)
 				{
 					case 1:
-						DrawRectangle (main_clock_box.x, border, border * 7, border * 11, DARKRED);
+						DrawRectangle (main_clock_box.x, border, border * 7, border * 11, config->edit_color);
 						break;
 					case 2:
-						DrawRectangle (main_clock_box.x + (border * 6.5f), border, border * 7, border * 11, DARKRED);
+						DrawRectangle (main_clock_box.x + (border * 6.5f), border, border * 7, border * 11, config->edit_color);
 						break;
 					case 3:
-						DrawRectangle (main_clock_box.x + (border * 15.5f), border, border * 7, border * 11, DARKRED);
+						DrawRectangle (main_clock_box.x + (border * 15.5f), border, border * 7, border * 11, config->edit_color);
 						break;
 					case 4:
-						DrawRectangle (main_clock_box.x + (border * 22), border, border * 7, border * 11, DARKRED);
+						DrawRectangle (main_clock_box.x + (border * 22), border, border * 7, border * 11, config->edit_color);
 						break;
 				}
 			}
 			// Draw digits
-			if (main_clock_mode == TENTH_SECONDS)
+			if (main_clock_tenths_display)
 			{
 				// Less than one minute
 				if (main_clock_display.ten_seconds == 0)
@@ -644,43 +950,43 @@ Made with raylib, by raysan5 <https://github.com/raysan5/raylib>\n\
 			shot_clock_box.x = (screen_width / 2) - (shot_clock_box.width / 2);
 			shot_clock_box.y = screen_height - shot_clock_box.height - (border * 5);
 			// Draw boxes
-			if (shot_clock_running)
+			if (view.flags & SCOREBOARD_SHOT_RUNNING)
 				DrawRectangle (shot_clock_box.x - border, shot_clock_box.y - border, shot_clock_box.width + (border * 2), shot_clock_box.height + (border * 2), WHITE);
-			else if (shot_clock_showing)
+			else if (view.flags & SCOREBOARD_SHOT_SHOWING)
 				DrawRectangle (shot_clock_box.x - border, shot_clock_box.y - border, shot_clock_box.width + (border * 2), shot_clock_box.height + (border * 2), GREEN);
 			else
 				DrawRectangle (shot_clock_box.x - border, shot_clock_box.y - border, shot_clock_box.width + (border * 2), shot_clock_box.height + (border * 2), GOLD);
 			DrawRectangle (shot_clock_box.x, shot_clock_box.y, shot_clock_box.width, shot_clock_box.height, BLACK);
 			// Edit mode
-			if (scoreboard_mode == EDIT_MODE)
+			if (view.mode == SCOREBOARD_MODE_EDIT)
 			{
-				switch (selected_digit)
+				switch (view.edit_digit)
 				{
 					case 5:
-						if (shot_clock_showing)
+						if (view.flags & SCOREBOARD_SHOT_SHOWING)
 							DrawRectangle (shot_clock_box.x, shot_clock_box.y, border * 7, border * 11, DARKGREEN);
 						else
-							DrawRectangle (shot_clock_box.x, shot_clock_box.y, border * 7, border * 11, DARKGOLD);
+							DrawRectangle (shot_clock_box.x, shot_clock_box.y, border * 7, border * 11, config->edit_timeout_color);
 						break;
 					case 6:
-						if (shot_clock_showing)
+						if (view.flags & SCOREBOARD_SHOT_SHOWING)
 							DrawRectangle (shot_clock_box.x + (border * 7), shot_clock_box.y, border * 7, border * 11, DARKGREEN);
 						else
-							DrawRectangle (shot_clock_box.x + (border * 7), shot_clock_box.y, border * 7, border * 11, DARKGOLD);
+							DrawRectangle (shot_clock_box.x + (border * 7), shot_clock_box.y, border * 7, border * 11, config->edit_timeout_color);
 						break;
 				}
 			}
 			// Draw digits
-			if (!shot_clock_enabled)
+			if (!(view.flags & SCOREBOARD_SHOT_ENABLED))
 			{
 				DrawDigit (-1, shot_clock_box.x + border, shot_clock_box.y + border, border * 5, GREEN, 1);
 				DrawDigit (-1, shot_clock_box.x + (border * 8), shot_clock_box.y + border, border * 5, GREEN, 1);
 				DrawRectangle (shot_clock_box.x + (border * 6.5f), shot_clock_box.y + (border * 7.5f), border, border, DARKDARKGRAY);
 			}
-			else if (shot_clock_mode == TENTH_SECONDS)
+			else if (shot_clock_tenths_display)
 			{
 				// Less than ten seconds
-				if (shot_clock_showing)
+				if (view.flags & SCOREBOARD_SHOT_SHOWING)
 				{
 					DrawDigit (shot_clock_display.seconds, shot_clock_box.x + border, shot_clock_box.y + border, border * 5, GREEN, 1);
 					DrawDigit (shot_clock_display.tenth_seconds, shot_clock_box.x + (border * 8), shot_clock_box.y + border, border * 5, GREEN, 1);
@@ -696,7 +1002,7 @@ Made with raylib, by raysan5 <https://github.com/raysan5/raylib>\n\
 			else
 			{
 				// More than ten seconds
-				if (shot_clock_showing)
+				if (view.flags & SCOREBOARD_SHOT_SHOWING)
 				{
 					DrawDigit (shot_clock_display.ten_seconds, shot_clock_box.x + border, shot_clock_box.y + border, border * 5, GREEN, 1);
 					DrawDigit (shot_clock_display.seconds, shot_clock_box.x + (border * 8), shot_clock_box.y + border, border * 5, GREEN, 1);
@@ -719,19 +1025,13 @@ Made with raylib, by raysan5 <https://github.com/raysan5/raylib>\n\
 			period_box.x = (screen_width / 2) - (period_box.width / 2);
 			period_box.y = (float) period_label_y + (fontSize / 3) + border;
 			// Draw label
-			DrawText
-			(
-				"PERIOD",
-				(int) ((period_box.x + (period_box.width / 2)) - ((float) MeasureText ("PERIOD", fontSize / 3) / 2)),
-				period_label_y,
-				fontSize / 3,
-				WHITE
-			);
+			label_width = LabelSet (&period_label, &label_font, "PERIOD", (float) (fontSize / 3));
+			LabelQueue (&label_font, &period_label, (period_box.x + (period_box.width / 2)) - (label_width / 2), (float) period_label_y, WHITE);
 			// Draw boxes
 			DrawRectangle (period_box.x - border, period_box.y - border, period_box.width + (border * 2), period_box.height + (border * 2), WHITE);
 			DrawRectangle (period_box.x, period_box.y, period_box.width, period_box.height, BLACK);
 			// Draw digit
-			DrawDigit (period, period_box.x + border, period_box.y + border, border * 5, ORANGE, 1);
+			DrawDigit (view.period, period_box.x + border, period_box.y + border, border * 5, ORANGE, 1);
 			//-------------------------------------------------------------------------------------
 
 			// ### Score displays
@@ -740,13 +1040,16 @@ Made with raylib, by raysan5 <https://github.com/raysan5/raylib>\n\
 			hvlabel_y = (int) ((((border * 2) + main_clock_box.y + main_clock_box.height) / 2) - (fontSize / 2));
 
 			// Home label
-			DrawText
+			DrawTeamLabel
 			(
-				"HOME",
-				(int) ((main_clock_box.x / 2) - ((float) MeasureText ("HOME", fontSize) / 2)),
+				&label_font,
+				&team_labels[HOME],
+				team_names[HOME] ? team_names[HOME] : config->home_name,
+				assets_enabled ? AssetGetTexture (&assets, team_logos[HOME] ? team_logos[HOME] : config->home_logo) : NULL,
+				main_clock_box.x / 2,
 				hvlabel_y,
 				fontSize,
-				WHITE
+				border
 			);
 			// Update home score box
 			home_score_box.width = border * 16;
@@ -757,21 +1060,24 @@ Made with raylib, by raysan5 <https://github.com/raysan5/raylib>\n\
 			DrawRectangle (home_score_box.x - border, home_score_box.y - border, home_score_box.width + (border * 2), home_score_box.height + (border * 2), WHITE);
 			DrawRectangle (home_score_box.x, home_score_box.y, home_score_box.width, home_score_box.height, BLACK);
 			// Draw home score digits
-			DrawDigit (score[HOME] / 100, home_score_box.x - (border * 3), home_score_box.y + border, border * 5, GOLD, 0);
-			if (score[HOME] < 10)
+			DrawDigit (view.score[HOME] / 100, home_score_box.x - (border * 3), home_score_box.y + border, border * 5, GOLD, 0);
+			if (view.score[HOME] < 10)
 				DrawDigit (-1, home_score_box.x + (border * 3.5f), home_score_box.y + border, border * 5, GOLD, 1);
 			else
-				DrawDigit ((score[HOME] % 100) / 10, home_score_box.x + (border * 3.5f), home_score_box.y + border, border * 5, GOLD, 1);
-			DrawDigit (score[HOME] % 10, home_score_box.x + (border * 10), home_score_box.y + border, border * 5, GOLD, 1);
+				DrawDigit ((view.score[HOME] % 100) / 10, home_score_box.x + (border * 3.5f), home_score_box.y + border, border * 5, GOLD, 1);
+			DrawDigit (view.score[HOME] % 10, home_score_box.x + (border * 10), home_score_box.y + border, border * 5, GOLD, 1);
 
 			// Visitor label
-			DrawText
+			DrawTeamLabel
 			(
-				"VISITOR",
-				(int) ((((screen_width - border) + (main_clock_box.x + main_clock_box.width + border)) / 2) - ((float) MeasureText ("VISITOR", fontSize) / 2)),
+				&label_font,
+				&team_labels[VISITOR],
+				team_names[VISITOR] ? team_names[VISITOR] : config->visitor_name,
+				assets_enabled ? AssetGetTexture (&assets, team_logos[VISITOR] ? team_logos[VISITOR] : config->visitor_logo) : NULL,
+				((screen_width - border) + (main_clock_box.x + main_clock_box.width + border)) / 2,
 				hvlabel_y,
 				fontSize,
-				WHITE
+				border
 			);
 			// Update visitor score box
 			visitor_score_box.width = border * 16;
@@ -782,12 +1088,12 @@ Made with raylib, by raysan5 <https://github.com/raysan5/raylib>\n\
 			DrawRectangle (visitor_score_box.x - border, visitor_score_box.y - border, visitor_score_box.width + (border * 2), visitor_score_box.height + (border * 2), WHITE);
 			DrawRectangle (visitor_score_box.x, visitor_score_box.y, visitor_score_box.width, visitor_score_box.height, BLACK);
 			// Draw visitor score digits
-			DrawDigit (score[VISITOR] / 100, visitor_score_box.x - (border * 3), visitor_score_box.y + border, border * 5, GOLD, 0);
-			if (score[VISITOR] < 10)
+			DrawDigit (view.score[VISITOR] / 100, visitor_score_box.x - (border * 3), visitor_score_box.y + border, border * 5, GOLD, 0);
+			if (view.score[VISITOR] < 10)
 				DrawDigit (-1, visitor_score_box.x + (border * 3.5f), visitor_score_box.y + border, border * 5, GOLD, 1);
 			else
-				DrawDigit ((score[VISITOR] % 100) / 10, visitor_score_box.x + (border * 3.5f), visitor_score_box.y + border, border * 5, GOLD, 1);
-			DrawDigit (score[VISITOR] % 10, visitor_score_box.x + (border * 10), visitor_score_box.y + border, border * 5, GOLD, 1);
+				DrawDigit ((view.score[VISITOR] % 100) / 10, visitor_score_box.x + (border * 3.5f), visitor_score_box.y + border, border * 5, GOLD, 1);
+			DrawDigit (view.score[VISITOR] % 10, visitor_score_box.x + (border * 10), visitor_score_box.y + border, border * 5, GOLD, 1);
 			//-------------------------------------------------------------------------------------
 
 
@@ -802,23 +1108,17 @@ Made with raylib, by raysan5 <https://github.com/raysan5/raylib>\n\
 			home_fouls_box.x = home_score_box.x;
 			home_fouls_box.y = (float) fouls_label_y + (fontSize / 2) + (border * 2);
 			// Home fouls label
-			DrawText
-			(
-				"FOULS",
-				(int) ((home_fouls_box.x + (home_fouls_box.width / 2)) - ((float) MeasureText ("FOULS", fontSize / 2) / 2)),
-				fouls_label_y,
-				fontSize / 2,
-				WHITE
-			);
+			label_width = LabelSet (&fouls_label, &label_font, "FOULS", (float) (fontSize / 2));
+			LabelQueue (&label_font, &fouls_label, (home_fouls_box.x + (home_fouls_box.width / 2)) - (label_width / 2), (float) fouls_label_y, WHITE);
 			// Draw home fouls box
 			DrawRectangle (home_fouls_box.x - border, home_fouls_box.y - border, home_fouls_box.width + (border * 2), home_fouls_box.height + (border * 2), WHITE);
 			DrawRectangle (home_fouls_box.x, home_fouls_box.y, home_fouls_box.width, home_fouls_box.height, BLACK);
 			// Draw home fouls digits
-			if (fouls[HOME] < 10)
+			if (view.fouls[HOME] < 10)
 				DrawDigit (-1, home_fouls_box.x - (border * 3), home_fouls_box.y + border, border * 5, YELLOW, 0);
 			else
-				DrawDigit ((fouls[HOME] % 100) / 10, home_fouls_box.x - (border * 3), home_fouls_box.y + border, border * 5, YELLOW, 0);
-			DrawDigit (fouls[HOME] % 10, home_fouls_box.x + (border * 3.5f), home_fouls_box.y + border, border * 5, YELLOW, 1);
+				DrawDigit ((view.fouls[HOME] % 100) / 10, home_fouls_box.x - (border * 3), home_fouls_box.y + border, border * 5, YELLOW, 0);
+			DrawDigit (view.fouls[HOME] % 10, home_fouls_box.x + (border * 3.5f), home_fouls_box.y + border, border * 5, YELLOW, 1);
 			
 			// Update visitor fouls box
 			visitor_fouls_box.width = border * 10;
@@ -826,23 +1126,17 @@ Made with raylib, by raysan5 <https://github.com/raysan5/raylib>\n\
 			visitor_fouls_box.x = (visitor_score_box.x + visitor_score_box.width) - visitor_fouls_box.width;
 			visitor_fouls_box.y = (float) fouls_label_y + (fontSize / 2) + (border * 2);
 			// Home fouls label
-			DrawText
-			(
-				"FOULS",
-				(int) ((visitor_fouls_box.x + (visitor_fouls_box.width / 2)) - ((float) MeasureText ("FOULS", fontSize / 2) / 2)),
-				fouls_label_y,
-				fontSize / 2,
-				WHITE
-			);
+			label_width = LabelSet (&fouls_label, &label_font, "FOULS", (float) (fontSize / 2));
+			LabelQueue (&label_font, &fouls_label, (visitor_fouls_box.x + (visitor_fouls_box.width / 2)) - (label_width / 2), (float) fouls_label_y, WHITE);
 			// Draw visitor fouls box
 			DrawRectangle (visitor_fouls_box.x - border, visitor_fouls_box.y - border, visitor_fouls_box.width + (border * 2), visitor_fouls_box.height + (border * 2), WHITE);
 			DrawRectangle (visitor_fouls_box.x, visitor_fouls_box.y, visitor_fouls_box.width, visitor_fouls_box.height, BLACK);
 			// Draw visitor fouls digits
-			if (fouls[VISITOR] < 10)
+			if (view.fouls[VISITOR] < 10)
 				DrawDigit (-1, visitor_fouls_box.x - (border * 3), visitor_fouls_box.y + border, border * 5, YELLOW, 0);
 			else
-				DrawDigit ((fouls[VISITOR] % 100) / 10, visitor_fouls_box.x - (border * 3), visitor_fouls_box.y + border, border * 5, YELLOW, 0);
-			DrawDigit (fouls[VISITOR] % 10, visitor_fouls_box.x + (border * 3.5f), visitor_fouls_box.y + border, border * 5, YELLOW, 1);
+				DrawDigit ((view.fouls[VISITOR] % 100) / 10, visitor_fouls_box.x - (border * 3), visitor_fouls_box.y + border, border * 5, YELLOW, 0);
+			DrawDigit (view.fouls[VISITOR] % 10, visitor_fouls_box.x + (border * 3.5f), visitor_fouls_box.y + border, border * 5, YELLOW, 1);
 			//-------------------------------------------------------------------------------------
 
 
@@ -855,19 +1149,13 @@ Made with raylib, by raysan5 <https://github.com/raysan5/raylib>\n\
 			home_tol_box.x = home_fouls_box.x + home_fouls_box.width + (border * 5);
 			home_tol_box.y = home_fouls_box.y;
 			// Home TOL label
-			DrawText
-			(
-				"T.O.L.",
-				(int) ((home_tol_box.x + (home_tol_box.width / 2)) - ((float) MeasureText ("T.O.L.", fontSize / 2) / 2)),
-				fouls_label_y,
-				fontSize / 2,
-				WHITE
-			);
+			label_width = LabelSet (&tol_label, &label_font, "T.O.L.", (float) (fontSize / 2));
+			LabelQueue (&label_font, &tol_label, (home_tol_box.x + (home_tol_box.width / 2)) - (label_width / 2), (float) fouls_label_y, WHITE);
 			// Draw home TOL box
 			DrawRectangle (home_tol_box.x - border, home_tol_box.y - border, home_tol_box.width + (border * 2), home_tol_box.height + (border * 2), WHITE);
 			DrawRectangle (home_tol_box.x, home_tol_box.y, home_tol_box.width, home_tol_box.height, BLACK);
 			// Draw home TOL digit
-			DrawDigit (tol[HOME], home_tol_box.x + border, home_tol_box.y + border, border * 5, YELLOW, 1);
+			DrawDigit (view.tol[HOME], home_tol_box.x + border, home_tol_box.y + border, border * 5, YELLOW, 1);
 
 			// Update visitor TOL box
 			visitor_tol_box.width = border * 7;
@@ -875,24 +1163,73 @@ Made with raylib, by raysan5 <https://github.com/raysan5/raylib>\n\
 			visitor_tol_box.x = visitor_fouls_box.x - visitor_tol_box.width - (border * 5);
 			visitor_tol_box.y = visitor_fouls_box.y;
 			// Home TOL label
-			DrawText
-			(
-				"T.O.L.",
-				(int) ((visitor_tol_box.x + (visitor_tol_box.width / 2)) - ((float) MeasureText ("T.O.L.", fontSize / 2) / 2)),
-				fouls_label_y,
-				fontSize / 2,
-				WHITE
-			);
+			label_width = LabelSet (&tol_label, &label_font, "T.O.L.", (float) (fontSize / 2));
+			LabelQueue (&label_font, &tol_label, (visitor_tol_box.x + (visitor_tol_box.width / 2)) - (label_width / 2), (float) fouls_label_y, WHITE);
 			// Draw visitor TOL box
 			DrawRectangle (visitor_tol_box.x - border, visitor_tol_box.y - border, visitor_tol_box.width + (border * 2), visitor_tol_box.height + (border * 2), WHITE);
 			DrawRectangle (visitor_tol_box.x, visitor_tol_box.y, visitor_tol_box.width, visitor_tol_box.height, BLACK);
 			// Draw visitor TOL digit
-			DrawDigit (tol[VISITOR], visitor_tol_box.x + border, visitor_tol_box.y + border, border * 5, YELLOW, 1);
+			DrawDigit (view.tol[VISITOR], visitor_tol_box.x + border, visitor_tol_box.y + border, border * 5, YELLOW, 1);
+
+			//-------------------------------------------------------------------------------------
 
+			// All the labels queued above in one draw, none of them overlap a box
+			LabelFlush (&label_font);
+
+			EndMode2D ();
+
+			// ## Frame capture
+			//-------------------------------------------------------------------------------------
+			// Start copying the finished frame back, it is picked up a frame or two later
+			// Frames read back since the last one go to the LED matrix (SendHub75 ()) and the replay ring
+			if (capture_enabled)
+				CaptureFrame (&capture, GetScreenWidth (), GetScreenHeight (), local_us);
 			//-------------------------------------------------------------------------------------
 
+		// Swap together with the rest of the wall
+		if (wall_leading)
+			WallLeadBarrier (&wall_lead);
+		else if (wall_following)
+			WallTileBarrier (&wall_tile);
 		EndDrawing ();
 
+		// Frame pacing, timed from when the swap came back
+		int64_t swap_us = InputNow ();
+		long missed = pacing.missed;
+		PacingFrame (&pacing, swap_us);
+		if (render_metrics && last_swap_us != 0)
+		{
+			MetricsObserve (render_metrics, METRIC_FRAME_TIME, swap_us - last_swap_us);
+			MetricsCount (render_metrics, METRIC_MISSED_REFRESHES, (uint64_t) (pacing.missed - missed));
+		}
+		last_swap_us = swap_us;
+		if (!vsync_checked && pacing.vsync_checked)
+		{
+			vsync_checked = 1;
+			if (config->target_fps == 0 && !pacing.vsync_working)
+			{
+				fprintf (stderr, "VSync is not working, limiting to %d FPS instead\n", pacing.refresh_hz);
+				ApplyFrameRate (config->target_fps, &pacing);
+			}
+		}
+		if (pacing_flag && swap_us - pacing_report_us >= 5000000)
+		{
+			PacingReport (&pacing, stdout);
+			if (syncing)
+			{
+				SyncStatus sync = SyncGetStatus (&sync_client);
+				printf ("clock sync: %.3f ms from this clock, drift %+.2f ppm, round trip %.3f ms, %lu exchanges, %lu lost\n",
+					sync.offset_us / 1000.0, sync.drift_ppm, sync.delay_us / 1000.0, sync.exchanges, sync.lost);
+			}
+			if (wall_leading)
+				printf ("wall: %d tiles, %lu frames, %lu times a tile was not ready in time\n", WallLeadTiles (&wall_lead), wall_lead.frames, wall_lead.late);
+			if (wall_following)
+				printf ("wall: %lu frames from the lead, %lu without, %lu swapped without the others\n", wall_tile.frames, wall_tile.stale, wall_tile.unlocked);
+			if (replay_enabled)
+				printf ("replay: %d s held, %lu frames captured, %lu skipped\n", FrameRingSeconds (&replay), capture.captured, capture.skipped);
+			pacing_report_us = swap_us;
+		}
+
 		//-----------------------------------------------------------------------------------------
 
 	}
@@ -902,61 +1239,104 @@ Made with raylib, by raysan5 <https://github.com/raysan5/raylib>\n\
 	// # De-initialization
 	//---------------------------------------------------------------------------------------------
 
+	// Watchdog first, it publishes, logs and sounds the buzzer
+	if (watchdog_enabled)
+		WatchdogStop (&watchdog);
+
+	// Input trace, ends with the final board so replays can check themselves
+	ScoreboardRead (board, &view);
+	if (record_path)
+		TraceClose (&trace, &view, last_frame_us);
+
+	// Board, once nothing runs it
+	ScoreboardFree (board);
+	ScoreboardFree (shown);
+
+	// Season statistics, only for games where someone scored
+	if (stats_dir && StatsGamePlayed (&game) && StatsAppendGame (stats_dir, &game) != 0)
+		fprintf (stderr, "Could not save the game to season statistics in '%s'\n", stats_dir);
+
+	// Web server and controller output, then the state they read
+	if (http_port)
+		HttpStop (&http);
+	if (serial_path)
+		SerialStop (&serial);
+	ShmPublisherClose (&publisher);
+
+	// Metrics, once nothing reads them; the file is written a last time
+	if (metrics_enabled)
+		MetricsClose (&metrics);
+
+	// Game log, whatever is still in the rings is written out
+	if (log_enabled)
+	{
+		if (render_log)
+			LogWrite (render_log, LOG_STOP, 0, 0, 0);
+		LogClose (&logger);
+	}
+
+	// Direct input, devices are let go so X11 gets them back
+	if (evdev_enabled)
+		EvdevStop (&evdev);
+	if (whistle_enabled)
+		WhistleStop (&whistle);
+
+	// Video wall
+	if (wall_leading)
+		WallLeadStop (&wall_lead);
+	if (wall_following)
+		WallTileStop (&wall_tile);
+
+	// Clock sync
+	if (syncing)
+		SyncClientStop (&sync_client);
+	if (sync_serve_port)
+		SyncServerStop (&sync_server);
+
 	// Audio
 	UnloadSound (buzzer_sound);
 	CloseAudioDevice ();
 
+	// Replay ring and LED matrix output, frames still being read back are compressed or dropped before their buffers go
+	if (replay_enabled)
+		FrameRingClose (&replay);
+	if (hub75_path)
+		Hub75Stop (&hub75);
+	if (capture_enabled)
+		CaptureClose (&capture);
+
+	// Team logos
+	if (assets_enabled)
+		AssetCacheClose (&assets);
+
+	// Label atlas
+	LabelFontUnload (&label_font);
+
 	// Window icon
 	UnloadImage (window_icon);
 
 	// Window
 	CloseWindow ();
 
+	// Config
+	if (config_watching)
+		ConfigWatchStop (&config_watcher);
+	free (config);
+
 	return EXIT_SUCCESS;
 }
 
-int TimeToInt (Time time)
+void DrawTeamLabel (LabelFont *font, Label *label, const char *name, const Texture2D *logo, float centerX, int posY, int fontSize, float border)
 {
-	int int_time = 0;
-	int_time += time.tenth_seconds;
-	int_time += time.seconds * 10;
-	int_time += time.ten_seconds * 100;
-	int_time += time.minutes * 600;
-	int_time += time.ten_minutes * 6000;
-	return int_time;
-}
-
-Time UpdateTime (Time time)
-{
-	if (time.ten_minutes == 0 && time.minutes == 0 && time.ten_seconds == 0 && time.seconds == 0 && time.tenth_seconds == 0)
-		return time;
-	else if (time.tenth_seconds == 0)
-	{
-		time.tenth_seconds = 9;
-		if (time.seconds == 0)
-		{
-			time.seconds = 9;
-			if (time.ten_seconds == 0)
-			{
-				time.ten_seconds = 5;
-				if (time.minutes == 0)
-				{
-					time.minutes = 9;
-					if (time.ten_minutes != 0)
-						time.ten_minutes--;
-				}
-				else
-					time.minutes--;
-			}
-			else
-				time.ten_seconds--;
-		}
-		else
-			time.seconds--;
-	}
-	else
-		time.tenth_seconds--;
-	return time;
+	// Logos are scaled to the label height and the name + logo pair is centered together
+	float text_width = LabelSet (label, font, name, (float) fontSize);
+	float logo_width = 0;
+	if (logo != NULL)
+		logo_width = (float) logo->width * fontSize / logo->height + border;
+	float posX = centerX - ((text_width + logo_width) / 2);
+	if (logo != NULL)
+		DrawTextureEx (*logo, (Vector2){posX, (float) posY}, 0, (float) fontSize / logo->height, WHITE);
+	LabelQueue (font, label, posX + logo_width, (float) posY, WHITE);
 }
 
 void DrawDigit (int digit, float posX, float posY, float width, Color color, int use_all)
@@ -995,209 +1375,210 @@ void DrawDigit (int digit, float posX, float posY, float width, Color color, int
 	|-----|---------------|-----|
 
 	**********************************************************************************************/
-	// Rectangle dimensions (vertical)
+	// Which parts are lit comes from the shared digit model (digit.h)
 	float rect_width = width / 5;
-	float rect_height = rect_width * 3;
-	// Rectangles
-	Rectangle top = {posX + rect_width, posY, rect_height, rect_width};
-	Rectangle middle = {posX + rect_width, posY + rect_width + rect_height, rect_height, rect_width};
-	Rectangle bottom = {posX + rect_width, posY + (rect_width * 2) + (rect_height * 2), rect_height, rect_width};
-	Rectangle top_left = {posX, posY + rect_width, rect_width, rect_height};
-	Rectangle bottom_left = {posX, posY + (rect_width * 2) + rect_height, rect_width, rect_height};
-	Rectangle top_right = {posX + rect_width + rect_height, posY + rect_width, rect_width, rect_height};
-	Rectangle bottom_right = {posX + rect_width + rect_height, posY + (rect_width * 2) + rect_height, rect_width, rect_height};
-	// Corners
-	Rectangle top_left_corner = {posX, posY, rect_width, rect_width};
-	Rectangle middle_left_corner = {posX, posY + rect_width + rect_height, rect_width, rect_width};
-	Rectangle bottom_left_corner = {posX, posY + (rect_width * 2) + (rect_height * 2), rect_width, rect_width};
-	Rectangle top_right_corner = {posX + rect_width + rect_height, posY, rect_width, rect_width};
-	Rectangle middle_right_corner = {posX + rect_width + rect_height, posY + rect_width + rect_height, rect_width, rect_width};
-	Rectangle bottom_right_corner = {posX + rect_width + rect_height, posY + (rect_width * 2) + (rect_height * 2), rect_width, rect_width};
-	// Rectangle colors set to gray (off)
-	Color top_color = DARKDARKGRAY;
-	Color middle_color = DARKDARKGRAY;
-	Color bottom_color = DARKDARKGRAY;
-	Color top_left_color = DARKDARKGRAY;
-	Color bottom_left_color = DARKDARKGRAY;
-	Color top_right_color = DARKDARKGRAY;
-	Color bottom_right_color = DARKDARKGRAY;
-	// Corner colors set to gray (off)
-	Color top_left_corner_color = DARKDARKGRAY;
-	Color middle_left_corner_color = DARKDARKGRAY;
-	Color bottom_left_corner_color = DARKDARKGRAY;
-	Color top_right_corner_color = DARKDARKGRAY;
-	Color middle_right_corner_color = DARKDARKGRAY;
-	Color bottom_right_corner_color = DARKDARKGRAY;
-	// Set rectangles on for each digit
-	switch (digit)
+	unsigned int lit = DigitLitParts (digit, use_all);
+	for (int part = 0; part < DIGIT_PART_COUNT; part++)
 	{
-		case 0:
-			if (use_all)
-			{
-				// Rectangles
-				top_color = color;
-				bottom_color = color;
-				top_left_color = color;
-				bottom_left_color = color;
-				top_right_color = color;
-				bottom_right_color = color;
-				// Corners
-				top_left_corner_color = color;
-				middle_left_corner_color = color;
-				bottom_left_corner_color = color;
-				top_right_corner_color = color;
-				middle_right_corner_color = color;
-				bottom_right_corner_color = color;
-			}
-			break;
-		case 1:
-			// Rectangles
-			top_right_color = color;
-			bottom_right_color = color;
-			// Corners
-			top_right_corner_color = color;
-			middle_right_corner_color = color;
-			bottom_right_corner_color = color;
-			break;
-		case 2:
-			// Rectangles
-			top_color = color;
-			middle_color = color;
-			bottom_color = color;
-			bottom_left_color = color;
-			top_right_color = color;
-			// Corners
-			top_left_corner_color = color;
-			middle_left_corner_color = color;
-			bottom_left_corner_color = color;
-			top_right_corner_color = color;
-			middle_right_corner_color = color;
-			bottom_right_corner_color = color;
-			break;
-		case 3:
-			// Rectangles
-			top_color = color;
-			middle_color = color;
-			bottom_color = color;
-			top_right_color = color;
-			bottom_right_color = color;
-			// Corners
-			top_left_corner_color = color;
-			middle_left_corner_color = color;
-			bottom_left_corner_color = color;
-			top_right_corner_color = color;
-			middle_right_corner_color = color;
-			bottom_right_corner_color = color;
-			break;
-		case 4:
-			// Rectangles
-			middle_color = color;
-			top_left_color = color;
-			top_right_color = color;
-			bottom_right_color = color;
-			// Corners
-			top_left_corner_color = color;
-			middle_left_corner_color = color;
-			top_right_corner_color = color;
-			middle_right_corner_color = color;
-			bottom_right_corner_color = color;
-			break;
-		case 5:
-			// Rectangles
-			top_color = color;
-			middle_color = color;
-			bottom_color = color;
-			top_left_color = color;
-			bottom_right_color = color;
-			// Corners
-			top_left_corner_color = color;
-			middle_left_corner_color = color;
-			bottom_left_corner_color = color;
-			top_right_corner_color = color;
-			middle_right_corner_color = color;
-			bottom_right_corner_color = color;
-			break;
-		case 6:
-			// Rectangles
-			top_color = color;
-			middle_color = color;
-			bottom_color = color;
-			top_left_color = color;
-			bottom_left_color = color;
-			bottom_right_color = color;
-			// Corners
-			top_left_corner_color = color;
-			middle_left_corner_color = color;
-			bottom_left_corner_color = color;
-			top_right_corner_color = color;
-			middle_right_corner_color = color;
-			bottom_right_corner_color = color;
-			break;
-		case 7:
-			// Rectangles
-			top_color = color;
-			top_right_color = color;
-			bottom_right_color = color;
-			// Corners
-			top_left_corner_color = color;
-			top_right_corner_color = color;
-			middle_right_corner_color = color;
-			bottom_right_corner_color = color;
-			break;
-		case 8:
-			// Rectangles
-			top_color = color;
-			middle_color = color;
-			bottom_color = color;
-			top_left_color = color;
-			bottom_left_color = color;
-			top_right_color = color;
-			bottom_right_color = color;
-			// Corners
-			top_left_corner_color = color;
-			middle_left_corner_color = color;
-			bottom_left_corner_color = color;
-			top_right_corner_color = color;
-			middle_right_corner_color = color;
-			bottom_right_corner_color = color;
-			break;
-		case 9:
-			// Rectangles
-			top_color = color;
-			middle_color = color;
-			bottom_color = color;
-			top_left_color = color;
-			top_right_color = color;
-			bottom_right_color = color;
-			// Corners
-			top_left_corner_color = color;
-			middle_left_corner_color = color;
-			bottom_left_corner_color = color;
-			top_right_corner_color = color;
-			middle_right_corner_color = color;
-			bottom_right_corner_color = color;
-			break;
+		if (!DigitPartShown (part, use_all))
+			continue;
+		DigitRect rect = DigitPartRect (part);
+		Rectangle drawn = {posX + (rect.x * rect_width), posY + (rect.y * rect_width), rect.width * rect_width, rect.height * rect_width};
+		DrawRectangleRec (drawn, (lit & (1u << part)) ? color : DARKDARKGRAY);
 	}
-	// Draw Rectangles
-	if (use_all)
+}
+
+void ApplyFrameRate (int target_fps, const PacingStats *pacing)
+{
+	if (target_fps == 0)
 	{
-		DrawRectangleRec (top, top_color);
-		DrawRectangleRec (middle, middle_color);
-		DrawRectangleRec (bottom, bottom_color);
-		DrawRectangleRec (top_left, top_left_color);
-		DrawRectangleRec (bottom_left, bottom_left_color);
+		// Swaps wait for the vblank, so raylib does not have to wait too; unless the driver ignores VSync
+		SetWindowState (FLAG_VSYNC_HINT);
+		SetTargetFPS (pacing->vsync_checked && !pacing->vsync_working ? pacing->refresh_hz : 0);
 	}
-	DrawRectangleRec (top_right, top_right_color);
-	DrawRectangleRec (bottom_right, bottom_right_color);
-	// Draw Corners
-	if (use_all)
+	else
 	{
-		DrawRectangleRec (top_left_corner, top_left_corner_color);
-		DrawRectangleRec (middle_left_corner, middle_left_corner_color);
-		DrawRectangleRec (bottom_left_corner, bottom_left_corner_color);
+		ClearWindowState (FLAG_VSYNC_HINT);
+		SetTargetFPS (target_fps);
 	}
-	DrawRectangleRec (top_right_corner, top_right_corner_color);
-	DrawRectangleRec (middle_right_corner, middle_right_corner_color);
-	DrawRectangleRec (bottom_right_corner, bottom_right_corner_color);
 }
 
+void FillState (ScoreboardState *state, const ScoreboardView *view, const char *home_name, const char *visitor_name, int buzzer)
+{
+	memset (state, 0, sizeof (*state));
+	state->main_clock = view->main_clock;
+	state->shot_clock = view->shot_clock;
+	state->timeout_clock = view->timeout_clock;
+	state->main_clock_elapsed_us = view->main_clock_elapsed_us;
+	state->shot_clock_elapsed_us = view->shot_clock_elapsed_us;
+	state->timeout_clock_elapsed_us = view->timeout_clock_elapsed_us;
+	state->main_clock_running = (view->flags & SCOREBOARD_MAIN_RUNNING) != 0;
+	state->shot_clock_running = (view->flags & SCOREBOARD_SHOT_RUNNING) != 0;
+	state->shot_clock_showing = (view->flags & SCOREBOARD_SHOT_SHOWING) != 0;
+	state->shot_clock_enabled = (view->flags & SCOREBOARD_SHOT_ENABLED) != 0;
+	state->main_clock_tenths = (view->flags & SCOREBOARD_MAIN_TENTHS) != 0;
+	state->shot_clock_tenths = (view->flags & SCOREBOARD_SHOT_TENTHS) != 0;
+	state->mode = view->mode;
+	state->buzzer = buzzer;
+	for (int team = HOME; team <= VISITOR; team++)
+	{
+		state->score[team] = view->score[team];
+		state->fouls[team] = view->fouls[team];
+		state->tol[team] = view->tol[team];
+	}
+	state->period = view->period;
+	// Names are cut to fit, always leaving the terminating zero
+	strncpy (state->team_names[HOME], home_name, SHM_NAME_LENGTH - 1);
+	strncpy (state->team_names[VISITOR], visitor_name, SHM_NAME_LENGTH - 1);
+}
+
+void ApplyState (Scoreboard *board, const ScoreboardState *state)
+{
+	// The game as it stands, never the operator's edit mode (ScoreboardLoad () leaves it)
+	ScoreboardView view;
+	memset (&view, 0, sizeof (view));
+	view.main_clock = state->main_clock;
+	view.shot_clock = state->shot_clock;
+	view.timeout_clock = state->timeout_clock;
+	view.main_clock_elapsed_us = state->main_clock_elapsed_us;
+	view.shot_clock_elapsed_us = state->shot_clock_elapsed_us;
+	view.timeout_clock_elapsed_us = state->timeout_clock_elapsed_us;
+	view.flags = (state->main_clock_running ? SCOREBOARD_MAIN_RUNNING : 0) | (state->shot_clock_running ? SCOREBOARD_SHOT_RUNNING : 0) |
+		(state->shot_clock_showing ? SCOREBOARD_SHOT_SHOWING : 0) | (state->shot_clock_enabled ? SCOREBOARD_SHOT_ENABLED : 0) |
+		(state->main_clock_tenths ? SCOREBOARD_MAIN_TENTHS : 0) | (state->shot_clock_tenths ? SCOREBOARD_SHOT_TENTHS : 0);
+	for (int team = HOME; team <= VISITOR; team++)
+	{
+		view.score[team] = (int16_t) state->score[team];
+		view.fouls[team] = (uint8_t) state->fouls[team];
+		view.tol[team] = (uint8_t) state->tol[team];
+	}
+	view.period = (int8_t) state->period;
+	ScoreboardLoad (board, &view);
+}
+
+Time ClockDigits (int tenths)
+{
+	Time time;
+	time.ten_minutes = tenths / 6000;
+	time.minutes = (tenths / 600) % 10;
+	time.ten_seconds = (tenths / 100) % 6;
+	time.seconds = (tenths / 10) % 10;
+	time.tenth_seconds = tenths % 10;
+	return time;
+}
+
+void ApplyDirectInput (const EvdevEvent *event, Scoreboard *board, const BindingTable *bindings, const Config *config, TraceWriter *trace, LogRing *game_log, int64_t time_us, int *buzzer_held)
+{
+	// Keyboards go through the same bindings as the window's keys
+	if (event->kind == EVDEV_KEY)
+	{
+		if (event->code == config->keys[BIND_SOUND_BUZZER])
+		{
+			*buzzer_held = event->down;
+			if (trace)
+				TraceRecord (trace, time_us, event->down ? TRACE_BUZZER_DOWN : TRACE_BUZZER_UP);
+		}
+		if (!event->down)
+			return;
+		ScoreboardView view;
+		ScoreboardRead (board, &view);
+		Action action = BindingLookup (bindings, (Mode) view.mode, event->code);
+		if (action == ACTION_TOGGLE_FULLSCREEN)
+			ToggleFullscreen ();
+		else if (action != ACTION_NONE)
+		{
+			ApplyAction (board, action, game_log);
+			if (trace)
+				TraceRecord (trace, time_us, action);
+		}
+		return;
+	}
+
+	// Buttons apply their list of actions from the config file
+	const unsigned char *actions = config->buttons[event->code - 1];
+	for (int i = 0; i < CONFIG_BUTTON_ACTIONS && actions[i] != ACTION_NONE; i++)
+	{
+		if (actions[i] == CONFIG_BUTTON_BUZZER)
+		{
+			*buzzer_held = event->down;
+			if (trace)
+				TraceRecord (trace, time_us, event->down ? TRACE_BUZZER_DOWN : TRACE_BUZZER_UP);
+		}
+		else if (!event->down)
+			continue;
+		else if (actions[i] == ACTION_TOGGLE_FULLSCREEN)
+			ToggleFullscreen ();
+		else
+		{
+			ApplyAction (board, (Action) actions[i], game_log);
+			if (trace)
+				TraceRecord (trace, time_us, actions[i]);
+		}
+	}
+}
+
+void ApplyAction (Scoreboard *board, Action action, LogRing *game_log)
+{
+	if (game_log == NULL)
+	{
+		ScoreboardStep (board, 0, action);
+		return;
+	}
+	ScoreboardView before, after;
+	ScoreboardRead (board, &before);
+	ScoreboardStep (board, 0, action);
+	ScoreboardRead (board, &after);
+	LogBoardChanges (game_log, &before, &after);
+}
+
+void LogBoardChanges (LogRing *game_log, const ScoreboardView *before, const ScoreboardView *after)
+{
+	if (after->mode != before->mode)
+		LogWrite (game_log, LOG_MODE, after->mode, 0, 0);
+
+	// The shot clock's run flag runs the timeout clock while that one is showing
+	int showing_before = (before->flags & SCOREBOARD_SHOT_SHOWING) != 0, showing_after = (after->flags & SCOREBOARD_SHOT_SHOWING) != 0;
+	GameClock shot_after = showing_after ? GAME_CLOCK_SHOT : GAME_CLOCK_TIMEOUT;
+	if ((after->flags ^ before->flags) & SCOREBOARD_MAIN_RUNNING)
+		LogWrite (game_log, after->flags & SCOREBOARD_MAIN_RUNNING ? LOG_CLOCK_START : LOG_CLOCK_STOP, GAME_CLOCK_MAIN, after->main_clock, 0);
+	if (showing_after != showing_before)
+		LogWrite (game_log, LOG_CLOCK_SWITCH, showing_after, 0, 0);
+	if ((after->flags ^ before->flags) & SCOREBOARD_SHOT_RUNNING)
+		LogWrite (game_log, after->flags & SCOREBOARD_SHOT_RUNNING ? LOG_CLOCK_START : LOG_CLOCK_STOP, shot_after,
+			shot_after == GAME_CLOCK_SHOT ? after->shot_clock : after->timeout_clock, 0);
+
+	// Set by a reset or an edit, not by running
+	const int32_t clocks_before[] = {before->main_clock, before->shot_clock, before->timeout_clock};
+	const int32_t clocks_after[] = {after->main_clock, after->shot_clock, after->timeout_clock};
+	for (int clock = 0; clock < GAME_CLOCK_COUNT; clock++)
+		if (clocks_after[clock] != clocks_before[clock])
+			LogWrite (game_log, LOG_CLOCK_SET, clock, clocks_before[clock], clocks_after[clock]);
+
+	for (int team = HOME; team <= VISITOR; team++)
+	{
+		if (after->score[team] != before->score[team])
+			LogWrite (game_log, LOG_SCORE, team, before->score[team], after->score[team]);
+		if (after->fouls[team] != before->fouls[team])
+			LogWrite (game_log, LOG_FOULS, team, before->fouls[team], after->fouls[team]);
+		if (after->tol[team] != before->tol[team])
+			LogWrite (game_log, LOG_TOL, team, before->tol[team], after->tol[team]);
+	}
+	if (after->period != before->period)
+		LogWrite (game_log, LOG_PERIOD, before->period, after->period, 0);
+}
+
+void SoundBuzzer (int on, void *data)
+{
+	// raylib only flags the sound for its mixer thread, and the render thread is stalled meanwhile
+	if (on)
+		PlaySound (*(Sound *) data);
+	else
+		StopSound (*(Sound *) data);
+}
+
+void SendHub75 (void *data, const unsigned char *rgba, int width, int height, _Atomic int *done)
+{
+	// Only queued here, the filter, encoding and writing are on the output's thread
+	Hub75Job job = {rgba, width, height, done};
+	Hub75Submit (data, &job);
+}
@@ -0,0 +1,221 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - health metrics
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+**************************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include "metrics.h"
+
+typedef struct MetricInfo { const char *name, *help; } MetricInfo;
+
+static const MetricInfo counter_info[METRIC_COUNTER_COUNT] =
+{
+	{"scoreboard_missed_refreshes_total", "Display refreshes that showed the previous frame again."},
+	{"scoreboard_buzzers_total", "Times the buzzer sound was started."},
+	{"scoreboard_render_stalls_total", "Times the render thread stalled and the watchdog kept the clocks going."}
+};
+
+static const MetricInfo histogram_info[METRIC_HISTOGRAM_COUNT] =
+{
+	{"scoreboard_frame_seconds", "Time from one buffer swap to the next."},
+	{"scoreboard_tick_lateness_seconds", "Time from a tenth going down on the main clock to the frame that shows it."},
+	{"scoreboard_buzzer_latency_seconds", "Time from a clock running out or the buzzer button to the sound starting."},
+	{"scoreboard_input_latency_seconds", "Time from a key or button event to it being applied to the board."}
+};
+
+// Upper bounds in microseconds, around the refresh periods of 144, 60 and 30 Hz displays
+static const int64_t bucket_bounds_us[METRICS_BUCKETS - 1] =
+{
+	100, 250, 500, 1000, 2500, 5000, 10000, 16667, 25000, 33333, 50000, 100000, 250000
+};
+
+static void *FileThread (void *data);
+static void Print (char *buffer, size_t size, size_t *length, const char *format, ...);
+
+int MetricsInit (Metrics *metrics)
+{
+	memset (metrics, 0, sizeof (*metrics));
+	metrics->stop_fd = -1;
+	if (pthread_mutex_init (&metrics->lock, NULL) != 0)
+		return -1;
+	return 0;
+}
+
+MetricsShard *MetricsShardAdd (Metrics *metrics)
+{
+	// A cache line of its own, so two threads recording never write the same line
+	MetricsShard *shard = aligned_alloc (64, (sizeof (MetricsShard) + 63) / 64 * 64);
+	if (shard == NULL)
+		return NULL;
+	memset (shard, 0, sizeof (*shard));
+
+	pthread_mutex_lock (&metrics->lock);
+	int count = atomic_load (&metrics->shard_count);
+	if (count == METRICS_SHARDS_MAX)
+	{
+		pthread_mutex_unlock (&metrics->lock);
+		free (shard);
+		return NULL;
+	}
+	metrics->shards[count] = shard;
+	atomic_store (&metrics->shard_count, count + 1); // Readers see the shard only once it is there
+	pthread_mutex_unlock (&metrics->lock);
+	return shard;
+}
+
+void MetricsCount (MetricsShard *shard, MetricCounter counter, uint64_t amount)
+{
+	// Only this thread writes the shard: a load and a store, no read-modify-write needed
+	uint64_t value = atomic_load_explicit (&shard->counters[counter], memory_order_relaxed);
+	atomic_store_explicit (&shard->counters[counter], value + amount, memory_order_relaxed);
+}
+
+void MetricsObserve (MetricsShard *shard, MetricHistogram histogram, int64_t value_us)
+{
+	if (value_us < 0)
+		value_us = 0;
+	int bucket = 0;
+	while (bucket < METRICS_BUCKETS - 1 && value_us > bucket_bounds_us[bucket])
+		bucket++;
+	_Atomic uint64_t *count = &shard->buckets[histogram][bucket];
+	atomic_store_explicit (count, atomic_load_explicit (count, memory_order_relaxed) + 1, memory_order_relaxed);
+	_Atomic int64_t *sum = &shard->sums_us[histogram];
+	atomic_store_explicit (sum, atomic_load_explicit (sum, memory_order_relaxed) + value_us, memory_order_relaxed);
+}
+
+size_t MetricsWrite (const Metrics *metrics, char *buffer, size_t size)
+{
+	size_t length = 0;
+	buffer[0] = '\0';
+	int shard_count = atomic_load ((_Atomic int *) &metrics->shard_count);
+
+	for (int counter = 0; counter < METRIC_COUNTER_COUNT; counter++)
+	{
+		uint64_t total = 0;
+		for (int i = 0; i < shard_count; i++)
+			total += atomic_load_explicit (&metrics->shards[i]->counters[counter], memory_order_relaxed);
+		Print (buffer, size, &length, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n", counter_info[counter].name, counter_info[counter].help,
+			counter_info[counter].name, counter_info[counter].name, (unsigned long long) total);
+	}
+
+	for (int histogram = 0; histogram < METRIC_HISTOGRAM_COUNT; histogram++)
+	{
+		const char *name = histogram_info[histogram].name;
+		uint64_t buckets[METRICS_BUCKETS] = {0};
+		int64_t sum_us = 0;
+		for (int i = 0; i < shard_count; i++)
+		{
+			for (int bucket = 0; bucket < METRICS_BUCKETS; bucket++)
+				buckets[bucket] += atomic_load_explicit (&metrics->shards[i]->buckets[histogram][bucket], memory_order_relaxed);
+			sum_us += atomic_load_explicit (&metrics->shards[i]->sums_us[histogram], memory_order_relaxed);
+		}
+
+		// Buckets are cumulative in the format, with bounds in seconds
+		Print (buffer, size, &length, "# HELP %s %s\n# TYPE %s histogram\n", name, histogram_info[histogram].help, name);
+		uint64_t cumulative = 0;
+		for (int bucket = 0; bucket < METRICS_BUCKETS - 1; bucket++)
+		{
+			cumulative += buckets[bucket];
+			Print (buffer, size, &length, "%s_bucket{le=\"%g\"} %llu\n", name, bucket_bounds_us[bucket] / 1e6, (unsigned long long) cumulative);
+		}
+		cumulative += buckets[METRICS_BUCKETS - 1];
+		Print (buffer, size, &length, "%s_bucket{le=\"+Inf\"} %llu\n%s_sum %.6f\n%s_count %llu\n", name, (unsigned long long) cumulative,
+			name, sum_us / 1e6, name, (unsigned long long) cumulative);
+	}
+	return length;
+}
+
+int MetricsFileStart (Metrics *metrics, const char *path)
+{
+	if (strlen (path) + 5 > sizeof (metrics->file_path))
+		return -1;
+	strcpy (metrics->file_path, path);
+	metrics->stop_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (metrics->stop_fd < 0)
+		return -1;
+	if (pthread_create (&metrics->file_thread, NULL, FileThread, metrics) != 0)
+	{
+		close (metrics->stop_fd);
+		metrics->stop_fd = -1;
+		return -1;
+	}
+	return 0;
+}
+
+void MetricsClose (Metrics *metrics)
+{
+	if (metrics->stop_fd >= 0)
+	{
+		uint64_t one = 1;
+		if (write (metrics->stop_fd, &one, sizeof (one)) == sizeof (one))
+			pthread_join (metrics->file_thread, NULL);
+		close (metrics->stop_fd);
+		metrics->stop_fd = -1;
+	}
+	int shard_count = atomic_load (&metrics->shard_count);
+	for (int i = 0; i < shard_count; i++)
+		free (metrics->shards[i]);
+	atomic_store (&metrics->shard_count, 0);
+	pthread_mutex_destroy (&metrics->lock);
+}
+
+static void *FileThread (void *data)
+{
+	Metrics *metrics = data;
+	static char text[METRICS_TEXT_MAX];
+	char temporary[sizeof (metrics->file_path) + 4];
+	snprintf (temporary, sizeof (temporary), "%s.tmp", metrics->file_path);
+
+	// Written whole and renamed over the old file, so the collector never reads half of it
+	// Once more after the stop, for the last few seconds
+	int stopping = 0;
+	while (!stopping)
+	{
+		struct pollfd stop = {metrics->stop_fd, POLLIN, 0};
+		stopping = poll (&stop, 1, METRICS_FILE_MS) > 0;
+		size_t length = MetricsWrite (metrics, text, sizeof (text));
+		FILE *file = fopen (temporary, "w");
+		if (file == NULL)
+			continue;
+		int written = fwrite (text, 1, length, file) == length;
+		if (fclose (file) == 0 && written)
+			rename (temporary, metrics->file_path);
+		else
+			remove (temporary);
+	}
+	return NULL;
+}
+
+static void Print (char *buffer, size_t size, size_t *length, const char *format, ...)
+{
+	// Stops at the end of the buffer, whatever did not fit is left out
+	if (*length + 1 >= size)
+		return;
+	va_list arguments;
+	va_start (arguments, format);
+	int printed = vsnprintf (buffer + *length, size - *length, format, arguments);
+	va_end (arguments);
+	if (printed > 0)
+		*length += (size_t) printed < size - *length ? (size_t) printed : size - *length - 1;
+}
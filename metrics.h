@@ -0,0 +1,96 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - health metrics
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Counters and latency histograms on how well the board keeps time, in the Prometheus text format:
+served on /metrics by the web server (http.h) and/or written to a file every METRICS_FILE_MS for
+node_exporter's textfile collector (--metrics-file PATH).
+
+	scoreboard_frame_seconds           buffer swap to buffer swap
+	scoreboard_missed_refreshes_total  refreshes that showed the previous frame again (pacing.h)
+	scoreboard_render_stalls_total     times the watchdog took over from a stalled render thread (watchdog.h)
+	scoreboard_tick_lateness_seconds   a tenth on the main clock going down to the frame showing it
+	scoreboard_buzzer_latency_seconds  clock running out or button pressed to the sound started
+	scoreboard_input_latency_seconds   key or button seen by the kernel to applied to the board
+
+Every thread that records gets its own shard from MetricsShardAdd (), once, and only that thread
+writes to it, so recording is a few plain stores with no locked instructions and no shared cache
+lines. Readers add the shards up; a value read while it is being written is at most one sample
+behind.
+
+**************************************************************************************************/
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define METRICS_SHARDS_MAX 8 // Threads that can record
+#define METRICS_BUCKETS 14 // Latency buckets, the last one is everything longer
+#define METRICS_TEXT_MAX 16384 // Longest MetricsWrite () output
+#define METRICS_FILE_MS 5000 // How often --metrics-file is rewritten
+
+typedef enum MetricCounter
+{
+	METRIC_MISSED_REFRESHES = 0,
+	METRIC_BUZZERS,
+	METRIC_RENDER_STALLS,
+	METRIC_COUNTER_COUNT
+} MetricCounter;
+
+typedef enum MetricHistogram
+{
+	METRIC_FRAME_TIME = 0,
+	METRIC_TICK_LATENESS,
+	METRIC_BUZZER_LATENCY,
+	METRIC_INPUT_LATENCY,
+	METRIC_HISTOGRAM_COUNT
+} MetricHistogram;
+
+typedef struct MetricsShard
+{
+	_Alignas (64) _Atomic uint64_t counters[METRIC_COUNTER_COUNT];
+	_Atomic uint64_t buckets[METRIC_HISTOGRAM_COUNT][METRICS_BUCKETS]; // Not cumulative
+	_Atomic int64_t sums_us[METRIC_HISTOGRAM_COUNT];
+} MetricsShard;
+
+typedef struct Metrics
+{
+	pthread_mutex_t lock; // Only for adding shards
+	MetricsShard *shards[METRICS_SHARDS_MAX];
+	_Atomic int shard_count;
+
+	// --metrics-file
+	pthread_t file_thread;
+	int stop_fd;
+	char file_path[256];
+} Metrics;
+
+int MetricsInit (Metrics *metrics); // Returns 0 on success
+MetricsShard *MetricsShardAdd (Metrics *metrics); // For the calling thread only; NULL if all are taken
+void MetricsCount (MetricsShard *shard, MetricCounter counter, uint64_t amount);
+void MetricsObserve (MetricsShard *shard, MetricHistogram histogram, int64_t value_us);
+size_t MetricsWrite (const Metrics *metrics, char *buffer, size_t size); // Text format, returns the length
+int MetricsFileStart (Metrics *metrics, const char *path); // Returns 0 on success
+void MetricsClose (Metrics *metrics); // Stops the file writer too
+
+#endif
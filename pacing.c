@@ -0,0 +1,129 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - frame pacing
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+**************************************************************************************************/
+
+#include <string.h>
+#include <math.h>
+#include "pacing.h"
+
+#define VSYNC_CHECK_FRAMES 120 // Frames to look at before deciding whether swaps wait for the vblank
+#define PERIOD_SMOOTHING 0.02 // Weight of each new frame in the measured period
+
+void PacingInit (PacingStats *pacing, int refresh_hz)
+{
+	memset (pacing, 0, sizeof (*pacing));
+	PacingSetRefresh (pacing, refresh_hz);
+}
+
+void PacingSetRefresh (PacingStats *pacing, int refresh_hz)
+{
+	// Monitors that do not say get the most common rate
+	if (refresh_hz <= 0)
+		refresh_hz = 60;
+	pacing->refresh_hz = refresh_hz;
+	pacing->period_us = 1e6 / refresh_hz;
+}
+
+void PacingFrame (PacingStats *pacing, int64_t swap_us)
+{
+	int64_t last = pacing->last_swap_us;
+	pacing->last_swap_us = swap_us;
+	if (last == 0)
+		return;
+
+	int64_t frame_us = swap_us - last;
+	double refreshes = frame_us / pacing->period_us;
+	double nominal = 1e6 / pacing->refresh_hz;
+
+	// Follow the real period (59.94 Hz and the like) from frames that took one refresh
+	if (refreshes > 0.75 && refreshes < 1.25)
+	{
+		pacing->period_us += (frame_us - pacing->period_us) * PERIOD_SMOOTHING;
+		if (pacing->period_us < nominal * 0.95)
+			pacing->period_us = nominal * 0.95;
+		if (pacing->period_us > nominal * 1.05)
+			pacing->period_us = nominal * 1.05;
+	}
+	if (refreshes >= 1.5)
+		pacing->missed += lround (refreshes) - 1;
+
+	pacing->frames++;
+	pacing->total_us += (double) frame_us;
+	pacing->total_squared_us += (double) frame_us * (double) frame_us;
+	if (frame_us > pacing->worst_us)
+		pacing->worst_us = frame_us;
+	int bucket = (int) (refreshes * 4 + 0.5);
+	pacing->buckets[bucket < PACING_BUCKETS ? bucket : PACING_BUCKETS - 1]++;
+
+	// Swaps that wait for the vblank can not come much faster than the refresh
+	if (!pacing->vsync_checked)
+	{
+		pacing->vsync_frames++;
+		if (refreshes < 0.5)
+			pacing->vsync_fast++;
+		if (pacing->vsync_frames >= VSYNC_CHECK_FRAMES)
+		{
+			pacing->vsync_checked = 1;
+			pacing->vsync_working = pacing->vsync_fast < pacing->vsync_frames / 4;
+		}
+	}
+}
+
+void PacingCheckVsync (PacingStats *pacing)
+{
+	pacing->vsync_checked = pacing->vsync_working = 0;
+	pacing->vsync_frames = pacing->vsync_fast = 0;
+}
+
+int64_t PacingDisplayTime (const PacingStats *pacing, int64_t now_us)
+{
+	if (pacing->last_swap_us == 0)
+		return now_us;
+
+	// The frame goes out on the first vblank after now; if this frame is late, that is a later one
+	double since = (double) (now_us - pacing->last_swap_us);
+	double refreshes = ceil (since / pacing->period_us);
+	if (refreshes < 1)
+		refreshes = 1;
+	double vblank = (double) pacing->last_swap_us + refreshes * pacing->period_us;
+
+	// Half a refresh on, so a tenth changes on whichever vblank is nearest to the real change
+	return (int64_t) (vblank + pacing->period_us / 2);
+}
+
+void PacingReport (PacingStats *pacing, FILE *file)
+{
+	if (pacing->frames == 0)
+		return;
+	double mean = pacing->total_us / pacing->frames;
+	double variance = pacing->total_squared_us / pacing->frames - mean * mean;
+	fprintf (file, "pacing: %d Hz (measured %.3f Hz), %ld frames, mean %.2f ms, jitter %.3f ms, worst %.2f ms, %ld missed refreshes%s\n",
+		pacing->refresh_hz, 1e6 / pacing->period_us, pacing->frames, mean / 1000, sqrt (variance > 0 ? variance : 0) / 1000,
+		pacing->worst_us / 1000.0, pacing->missed, pacing->vsync_checked && !pacing->vsync_working ? " (VSync not working)" : "");
+	fprintf (file, "pacing: frame times in refreshes:");
+	for (int bucket = 0; bucket < PACING_BUCKETS; bucket++)
+		if (pacing->buckets[bucket])
+			fprintf (file, " %s%.2f: %ld", bucket == PACING_BUCKETS - 1 ? ">=" : "", bucket / 4.0, pacing->buckets[bucket]);
+	fprintf (file, "\n");
+
+	pacing->frames = pacing->missed = 0;
+	pacing->total_us = pacing->total_squared_us = 0;
+	pacing->worst_us = 0;
+	memset (pacing->buckets, 0, sizeof (pacing->buckets));
+}
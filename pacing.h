@@ -0,0 +1,63 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - frame pacing
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+With target_fps = 0 the scoreboard draws one frame per display refresh and VSync paces it. The
+time each buffer swap returns is fed in here, which gives the real refresh period, where the next
+vblank will be, and statistics on how well frames kept up.
+
+Only the display uses the prediction: the clocks are drawn as they will be at the vblank nearest
+to when the frame shows up, from a copy of the board, so tenths change on the right refresh. The
+board itself is still advanced to the time of the frame (see board.h).
+
+**************************************************************************************************/
+
+#ifndef PACING_H
+#define PACING_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define PACING_BUCKETS 17 // Frame times to the nearest quarter of a refresh period, the last one is everything longer
+
+typedef struct PacingStats
+{
+	int refresh_hz; // What the monitor says
+	double period_us; // Measured refresh period
+	int64_t last_swap_us;
+	int vsync_checked; // Whether enough frames were seen to trust vsync_working
+	int vsync_working; // Swaps block until the vblank
+	long vsync_frames, vsync_fast; // Frames looked at for the check, and those much shorter than a refresh
+
+	// Since the last report
+	long frames;
+	long missed; // Refreshes that showed the previous frame again
+	double total_us, total_squared_us;
+	int64_t worst_us;
+	long buckets[PACING_BUCKETS];
+} PacingStats;
+
+void PacingInit (PacingStats *pacing, int refresh_hz);
+void PacingSetRefresh (PacingStats *pacing, int refresh_hz); // Monitor changed
+void PacingFrame (PacingStats *pacing, int64_t swap_us); // Call right after the buffer swap
+void PacingCheckVsync (PacingStats *pacing); // Start checking whether swaps wait for the vblank again
+int64_t PacingDisplayTime (const PacingStats *pacing, int64_t now_us); // Nearest vblank to when a frame drawn now is shown
+void PacingReport (PacingStats *pacing, FILE *file); // Print and start over
+
+#endif
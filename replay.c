@@ -0,0 +1,218 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - trace replay tool
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Plays a trace recorded with 'scoreboard --record' back against the board logic, without a window,
+through libscoreboard (libscoreboard.h).
+
+	replay [--speed X] [--loops N] [--verbose] [--stats DIR] TRACE
+
+--speed 0 (default) runs as fast as possible, 1 is real time, 2 twice as fast and so on.
+--loops N replays the trace N times and reports the time per replay, for profiling.
+--verbose prints every event and the board after it.
+--stats DIR adds the replayed game to a season statistics store (see stats.h), for games that
+were recorded without --stats.
+The exit status is 0 when the replayed board matches the one recorded at the end of the game.
+
+**************************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <getopt.h>
+#include <time.h>
+#include "libscoreboard.h"
+#include "trace.h"
+#include "stats.h"
+
+static int64_t NowMicroseconds (void);
+static void SleepUntil (int64_t time_us);
+static int ReplayOnce (const char *path, double speed, int verbose, TraceSummary *result, TraceReader *reader, long *events, StatsGame *game);
+static void PrintSummary (const char *label, const TraceSummary *summary);
+static void PrintTime (int tenths);
+
+int main (int argc, char *argv[])
+{
+	double speed = 0;
+	int loops = 1;
+	int verbose = 0;
+	const char *stats_dir = NULL;
+	static struct option long_options[] =
+	{
+		{"speed", required_argument, 0, 's'},
+		{"loops", required_argument, 0, 'l'},
+		{"verbose", no_argument, 0, 'v'},
+		{"stats", required_argument, 0, 'S'},
+		{0, 0, 0, 0}
+	};
+
+	int c;
+	while ((c = getopt_long (argc, argv, "s:l:v", long_options, NULL)) != -1)
+	{
+		switch (c)
+		{
+			case 's':
+				speed = atof (optarg);
+				break;
+			case 'l':
+				loops = atoi (optarg);
+				break;
+			case 'v':
+				verbose = 1;
+				break;
+			case 'S':
+				stats_dir = optarg;
+				break;
+			default:
+				fprintf (stderr, "usage: %s [--speed X] [--loops N] [--verbose] [--stats DIR] TRACE\n", argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+	if (optind != argc - 1 || loops < 1 || speed < 0)
+	{
+		fprintf (stderr, "usage: %s [--speed X] [--loops N] [--verbose] [--stats DIR] TRACE\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	TraceSummary result;
+	TraceReader reader;
+	StatsGame game;
+	long events = 0;
+	int64_t start = NowMicroseconds ();
+	for (int i = 0; i < loops; i++)
+	{
+		if (ReplayOnce (argv[optind], speed, verbose && i == 0, &result, &reader, &events, stats_dir && i == 0 ? &game : NULL) != 0)
+		{
+			fprintf (stderr, "%s: could not read trace '%s'\n", argv[0], argv[optind]);
+			return EXIT_FAILURE;
+		}
+	}
+	int64_t took = NowMicroseconds () - start;
+	if (stats_dir && StatsGamePlayed (&game) && StatsAppendGame (stats_dir, &game) != 0)
+	{
+		fprintf (stderr, "%s: could not add the game to season statistics in '%s'\n", argv[0], stats_dir);
+		return EXIT_FAILURE;
+	}
+
+	PrintSummary ("replayed", &result);
+	if (loops > 1)
+		printf ("%d replays of %ld events in %.3f ms (%.1f us per replay, %.1f M events/s)\n",
+			loops, events, took / 1000.0, (double) took / loops, (double) events * loops / took);
+	if (!reader.has_summary)
+	{
+		printf ("trace has no end record (game did not exit cleanly), nothing to compare against\n");
+		return EXIT_SUCCESS;
+	}
+	PrintSummary ("recorded", &reader.summary);
+	TraceSummary *recorded = &reader.summary;
+	int match = result.score[HOME] == recorded->score[HOME] && result.score[VISITOR] == recorded->score[VISITOR] &&
+		result.fouls[HOME] == recorded->fouls[HOME] && result.fouls[VISITOR] == recorded->fouls[VISITOR] &&
+		result.tol[HOME] == recorded->tol[HOME] && result.tol[VISITOR] == recorded->tol[VISITOR] &&
+		result.period == recorded->period && result.main_clock == recorded->main_clock &&
+		result.shot_clock == recorded->shot_clock && result.timeout_clock == recorded->timeout_clock;
+	printf ("%s\n", match ? "match" : "MISMATCH");
+	return match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int ReplayOnce (const char *path, double speed, int verbose, TraceSummary *result, TraceReader *reader, long *events, StatsGame *game)
+{
+	Scoreboard *board;
+	ScoreboardView view;
+	TraceEvent event;
+	int64_t last_us = 0;
+	int64_t start_us = NowMicroseconds ();
+	int status;
+
+	if (TraceReaderOpen (reader, path) != 0)
+		return -1;
+	board = ScoreboardNew (reader->main_clock_start, reader->shot_clock_reset, reader->timeout_short, reader->timeout_long);
+	if (board == NULL)
+	{
+		TraceReaderClose (reader);
+		return -1;
+	}
+	*events = 0;
+	if (game)
+		StatsGameStart (game, (time_t) reader->start_time);
+
+	while ((status = TraceRead (reader, &event)) == 1)
+	{
+		if (speed > 0)
+			SleepUntil (start_us + (int64_t) (event.time_us / speed));
+		// The clocks run up to the input and then it is applied; other records only run the clocks first
+		ScoreboardStep (board, event.time_us - last_us, event.type < SCOREBOARD_ACTION_COUNT ? event.type : SCOREBOARD_ACTION_NONE);
+		last_us = event.time_us;
+		if (event.type == TRACE_RESET_TIMES)
+			ScoreboardSetResetTimes (board, event.values[0], event.values[1], event.values[2]);
+		else if (event.type == TRACE_WHISTLE)
+			ScoreboardStopClocksAt (board, event.values[0]);
+		(*events)++;
+		if (game || verbose)
+			ScoreboardRead (board, &view);
+		if (game)
+			StatsGameTrack (game, &view);
+
+		if (verbose)
+		{
+			printf ("%10.3f  type %3d  main ", event.time_us / 1e6, event.type);
+			PrintTime (view.main_clock);
+			printf ("  shot ");
+			PrintTime (view.shot_clock);
+			printf ("  score %d-%d\n", view.score[HOME], view.score[VISITOR]);
+		}
+	}
+	TraceReaderClose (reader);
+	ScoreboardRead (board, &view);
+	ScoreboardFree (board);
+	if (status < 0)
+		return -1;
+	TraceSummarize (&view, result);
+	return 0;
+}
+
+static void PrintSummary (const char *label, const TraceSummary *summary)
+{
+	printf ("%s: score %d-%d  fouls %d-%d  TOL %d-%d  period %d  main ", label,
+		summary->score[HOME], summary->score[VISITOR], summary->fouls[HOME], summary->fouls[VISITOR],
+		summary->tol[HOME], summary->tol[VISITOR], summary->period);
+	PrintTime (summary->main_clock);
+	printf ("  shot ");
+	PrintTime (summary->shot_clock);
+	printf ("  timeout ");
+	PrintTime (summary->timeout_clock);
+	printf ("\n");
+}
+
+static void PrintTime (int tenths)
+{
+	printf ("%d:%02d.%d", tenths / 600, (tenths / 10) % 60, tenths % 10);
+}
+
+static int64_t NowMicroseconds (void)
+{
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static void SleepUntil (int64_t time_us)
+{
+	struct timespec until = {time_us / 1000000, (time_us % 1000000) * 1000};
+	while (clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) != 0)
+		;
+}
@@ -0,0 +1,228 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - replay ring benchmark
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Feeds simulated board frames through the replay ring (framering.h) as fast as it compresses them
+and reports what it costs: compression ratio, time per frame, how many minutes the memory cap
+holds. Every frame is also decoded again and compared, and --dump writes the .y4m a hotkey would.
+
+	ringbench [--size WxH] [--seconds S] [--fps N] [--replay-mb N] [--dump PATH]
+
+The frames look like the board: white border, blue background, black boxes, seven-segment digits
+for the clocks changing every tenth of a second and the scores now and then.
+
+**************************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+#include "framering.h"
+
+static void DrawBoard (uint32_t *pixels, int width, int height, int64_t time_us);
+static void FillRect (uint32_t *pixels, int width, int height, int x, int y, int w, int h, uint32_t color);
+static void DrawDigit (uint32_t *pixels, int width, int height, int digit, int x, int y, int size, uint32_t color);
+static uint32_t Rgb (int r, int g, int b);
+static int64_t Now (void);
+
+int main (int argc, char *argv[])
+{
+	int width = 1920, height = 1080, fps = 60, replay_mb = 256;
+	double seconds = 60;
+	const char *dump_path = NULL;
+	static struct option long_options[] =
+	{
+		{"size", required_argument, 0, 'S'},
+		{"seconds", required_argument, 0, 's'},
+		{"fps", required_argument, 0, 'f'},
+		{"replay-mb", required_argument, 0, 'm'},
+		{"dump", required_argument, 0, 'd'},
+		{0, 0, 0, 0}
+	};
+
+	int c;
+	while ((c = getopt_long (argc, argv, "", long_options, NULL)) != -1)
+	{
+		switch (c)
+		{
+			case 'S':
+				if (sscanf (optarg, "%dx%d", &width, &height) != 2)
+					width = 0;
+				break;
+			case 's': seconds = atof (optarg); break;
+			case 'f': fps = atoi (optarg); break;
+			case 'm': replay_mb = atoi (optarg); break;
+			case 'd': dump_path = optarg; break;
+			default:
+				fprintf (stderr, "usage: %s [--size WxH] [--seconds S] [--fps N] [--replay-mb N] [--dump PATH]\n", argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+	if (width < 64 || height < 64 || seconds <= 0 || fps <= 0 || replay_mb <= 0)
+	{
+		fprintf (stderr, "usage: %s [--size WxH] [--seconds S] [--fps N] [--replay-mb N] [--dump PATH]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	FrameRing ring;
+	if (FrameRingInit (&ring, (size_t) replay_mb << 20, (int64_t) 1 << 40) != 0)
+		return EXIT_FAILURE;
+
+	// Two frames in turn, the ring compresses one while the next is drawn
+	size_t count = (size_t) width * height;
+	uint32_t *drawn[2] = {malloc (count * 4), malloc (count * 4)};
+	uint32_t *check = malloc (count * 4);
+	unsigned char *encoded = malloc (count * 4 + count / 64 + 16);
+	_Atomic int done[2] = {1, 1};
+	if (!drawn[0] || !drawn[1] || !check || !encoded)
+		return EXIT_FAILURE;
+
+	long total = (long) (seconds * fps), mismatches = 0;
+	int64_t start = Now ();
+	for (long i = 0; i < total; i++)
+	{
+		int slot = (int) (i % 2);
+		while (!atomic_load (&done[slot]))
+			usleep (100);
+		int64_t time_us = i * 1000000 / fps;
+		DrawBoard (drawn[slot], width, height, time_us);
+
+		// Round trip against the frame before, the way the ring codes it between keyframes
+		if (i > 0)
+		{
+			while (!atomic_load (&done[!slot]))
+				usleep (100);
+			size_t size = FrameRingEncode (drawn[slot], drawn[!slot], count, encoded);
+			memcpy (check, drawn[!slot], count * 4);
+			if (FrameRingDecode (encoded, size, check, count) != 0 || memcmp (check, drawn[slot], count * 4) != 0)
+				mismatches++;
+		}
+
+		atomic_store (&done[slot], 0);
+		FrameRingJob job = {(const unsigned char *) drawn[slot], width, height, time_us, &done[slot]};
+		while (FrameRingSubmit (&ring, &job) != 0)
+			usleep (100);
+	}
+	while (!atomic_load (&done[0]) || !atomic_load (&done[1]))
+		usleep (100);
+	double elapsed = (Now () - start) / 1e6;
+
+	pthread_mutex_lock (&ring.lock);
+	unsigned long frames = ring.frames, keyframes = ring.keyframes, evicted = ring.evicted;
+	size_t bytes = ring.bytes;
+	uint64_t raw_bytes = ring.raw_bytes;
+	int64_t compress_us = ring.compress_us;
+	pthread_mutex_unlock (&ring.lock);
+	int held = FrameRingSeconds (&ring);
+
+	printf ("%lu frames of %dx%d (%lu keyframes) in %.1f s, %.2f ms each to compress\n", frames, width, height, keyframes, elapsed, compress_us / 1000.0 / frames);
+	printf ("%.1f MB raw to %.2f MB held, %.0f:1; %.2f MB per minute of game\n", raw_bytes / 1048576.0, bytes / 1048576.0,
+		(double) raw_bytes * (frames - evicted) / frames / bytes, bytes / 1048576.0 / ((held + 1.0) / 60));
+	printf ("%d s held, %lu frames evicted, %d MB holds about %.0f minutes\n", held, evicted, replay_mb, replay_mb * ((held + 1.0) / 60) / (bytes / 1048576.0));
+	printf ("%ld round trip mismatches\n", mismatches);
+
+	if (dump_path)
+	{
+		int64_t dump_start = Now ();
+		if (FrameRingDump (&ring, dump_path) != 0)
+			return EXIT_FAILURE;
+		while (atomic_load (&ring.dumping))
+			usleep (1000);
+		printf ("dump took %.2f s\n", (Now () - dump_start) / 1e6);
+	}
+
+	FrameRingClose (&ring);
+	free (drawn[0]);
+	free (drawn[1]);
+	free (check);
+	free (encoded);
+	return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static void DrawBoard (uint32_t *pixels, int width, int height, int64_t time_us)
+{
+	int border = width / 96;
+	FillRect (pixels, width, height, 0, 0, width, height, Rgb (255, 255, 255));
+	FillRect (pixels, width, height, border, border, width - border * 2, height - border * 2, Rgb (0, 82, 172));
+
+	// Main clock counting down from 8:00, shot clock from 35, scores every 30 s
+	int tenths = (int) (4800 - time_us / 100000 % 4800);
+	int shot = (int) (350 - time_us / 100000 % 350);
+	int score = (int) (time_us / 30000000);
+	int main_digits[4] = {tenths / 600, tenths / 10 % 60 / 10, tenths / 10 % 10, tenths % 10};
+	int shot_digits[2] = {shot / 100, shot / 10 % 10};
+	int score_digits[2][2] = {{score * 2 / 10 % 10, score * 2 % 10}, {score * 3 / 10 % 10, score * 3 % 10}};
+
+	int x = width / 2 - border * 15, y = border * 4;
+	FillRect (pixels, width, height, x - border, y - border, border * 31, border * 13, Rgb (255, 255, 255));
+	FillRect (pixels, width, height, x, y, border * 29, border * 11, 0xff000000);
+	for (int i = 0; i < 4; i++)
+		DrawDigit (pixels, width, height, main_digits[i], x + border + i * border * 7, y + border, border * 5, Rgb (253, 249, 0));
+
+	y = height / 2;
+	FillRect (pixels, width, height, x + border * 7, y, border * 15, border * 11, 0xff000000);
+	for (int i = 0; i < 2; i++)
+		DrawDigit (pixels, width, height, shot_digits[i], x + border * 8 + i * border * 7, y + border, border * 5, Rgb (230, 41, 55));
+	for (int team = 0; team < 2; team++)
+	{
+		int box_x = team == 0 ? border * 6 : width - border * 22;
+		FillRect (pixels, width, height, box_x, y, border * 15, border * 11, 0xff000000);
+		for (int i = 0; i < 2; i++)
+			DrawDigit (pixels, width, height, score_digits[team][i], box_x + border + i * border * 7, y + border, border * 5, Rgb (253, 249, 0));
+	}
+}
+
+static void DrawDigit (uint32_t *pixels, int width, int height, int digit, int x, int y, int size, uint32_t color)
+{
+	// Segments a-g, the same layout DrawDigit () in main.c uses
+	static const unsigned char segments[10] = {0x3f, 0x06, 0x5b, 0x4f, 0x66, 0x6d, 0x7d, 0x07, 0x7f, 0x6f};
+	int t = size / 5 > 0 ? size / 5 : 1;
+	int rects[7][4] =
+	{
+		{x, y, size, t}, {x + size - t, y, t, size}, {x + size - t, y + size, t, size},
+		{x, y + size * 2 - t, size, t}, {x, y + size, t, size}, {x, y, t, size}, {x, y + size - t / 2, size, t}
+	};
+	for (int i = 0; i < 7; i++)
+		FillRect (pixels, width, height, rects[i][0], rects[i][1], rects[i][2], rects[i][3], segments[digit] & (1 << i) ? color : Rgb (40, 40, 40));
+}
+
+static void FillRect (uint32_t *pixels, int width, int height, int x, int y, int w, int h, uint32_t color)
+{
+	for (int row = y < 0 ? 0 : y; row < y + h && row < height; row++)
+		for (int column = x < 0 ? 0 : x; column < x + w && column < width; column++)
+			pixels[(size_t) row * width + column] = color;
+}
+
+static uint32_t Rgb (int r, int g, int b)
+{
+	// Bytes in memory R, G, B, A, as glReadPixels returns them
+	unsigned char rgba[4] = {(unsigned char) r, (unsigned char) g, (unsigned char) b, 255};
+	uint32_t pixel;
+	memcpy (&pixel, rgba, 4);
+	return pixel;
+}
+
+static int64_t Now (void)
+{
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
@@ -0,0 +1,112 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - signed distance field font maker
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Makes the glyph atlas the board's labels are drawn from (label.h) out of a TrueType or OpenType
+font, once, so the scoreboard never has to rasterize a font itself.
+
+	sdffont [--size PX] [--out NAME] FONT
+
+Every printable ASCII character is rendered as a signed distance field --size pixels high (default
+64) and packed into NAME.png, with where each one is and how it is placed in NAME.glyphs (default
+labels, the names the scoreboard loads). Bigger sizes keep sharper corners when the labels are
+drawn large; the atlas grows with the square of the size.
+
+**************************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <getopt.h>
+#include "raylib.h"
+#include "label.h"
+
+#define ATLAS_PADDING 2 // Between glyphs in the atlas, so bilinear filtering does not bleed
+
+int main (int argc, char *argv[])
+{
+	int size = 64;
+	const char *name = LABEL_FONT_NAME;
+	static struct option long_options[] =
+	{
+		{"size", required_argument, 0, 's'},
+		{"out", required_argument, 0, 'o'},
+		{0, 0, 0, 0}
+	};
+
+	int c;
+	while ((c = getopt_long (argc, argv, "", long_options, NULL)) != -1)
+	{
+		switch (c)
+		{
+			case 's': size = atoi (optarg); break;
+			case 'o': name = optarg; break;
+			default:
+				fprintf (stderr, "usage: %s [--size PX] [--out NAME] FONT\n", argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+	if (optind != argc - 1 || size < 8 || size > 512)
+	{
+		fprintf (stderr, "usage: %s [--size PX] [--out NAME] FONT\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	SetTraceLogLevel (LOG_WARNING);
+	unsigned int bytes = 0;
+	unsigned char *data = LoadFileData (argv[optind], &bytes);
+	if (data == NULL)
+	{
+		fprintf (stderr, "%s: could not read '%s'\n", argv[0], argv[optind]);
+		return EXIT_FAILURE;
+	}
+	// NULL = the 95 characters from ' '
+	CharInfo *chars = LoadFontData (data, (int) bytes, size, NULL, LABEL_CHAR_COUNT, FONT_SDF);
+	UnloadFileData (data);
+	if (chars == NULL)
+	{
+		fprintf (stderr, "%s: '%s' is not a font\n", argv[0], argv[optind]);
+		return EXIT_FAILURE;
+	}
+	Rectangle *recs = NULL;
+	Image atlas = GenImageFontAtlas (chars, &recs, LABEL_CHAR_COUNT, size, ATLAS_PADDING, 1);
+
+	char png_path[512], glyphs_path[512];
+	snprintf (png_path, sizeof (png_path), "%s.png", name);
+	snprintf (glyphs_path, sizeof (glyphs_path), "%s.glyphs", name);
+	FILE *file = fopen (glyphs_path, "w");
+	if (atlas.data == NULL || file == NULL || !ExportImage (atlas, png_path))
+	{
+		fprintf (stderr, "%s: could not write '%s' and '%s'\n", argv[0], png_path, glyphs_path);
+		return EXIT_FAILURE;
+	}
+
+	// Rectangles with the padding, so a glyph's quad covers all of its distance field
+	fprintf (file, "sdffont %d\n", size);
+	for (int i = 0; i < LABEL_CHAR_COUNT; i++)
+		fprintf (file, "%d %g %g %g %g %d %d %d\n", chars[i].value,
+			recs[i].x - ATLAS_PADDING, recs[i].y - ATLAS_PADDING, recs[i].width + ATLAS_PADDING * 2, recs[i].height + ATLAS_PADDING * 2,
+			chars[i].offsetX - ATLAS_PADDING, chars[i].offsetY - ATLAS_PADDING, chars[i].advanceX ? chars[i].advanceX : (int) recs[i].width);
+	fclose (file);
+	printf ("%d characters at %d px: %s (%dx%d), %s\n", LABEL_CHAR_COUNT, size, png_path, atlas.width, atlas.height, glyphs_path);
+
+	UnloadImage (atlas);
+	MemFree (recs);
+	UnloadFontData (chars, LABEL_CHAR_COUNT);
+	return EXIT_SUCCESS;
+}
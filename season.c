@@ -0,0 +1,202 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - season statistics queries
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Answers season queries from a store written with --stats (see stats.h).
+
+	season DIR [summary|periods|fouls|margin|all]...
+
+Each query only decodes the columns it needs.
+
+**************************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "stats.h"
+
+#define COLUMN(c) (1u << (c))
+
+typedef struct Query
+{
+	const char *name;
+	unsigned int columns;
+	void (*run) (const StatsStore *store);
+} Query;
+
+static void Summary (const StatsStore *store);
+static void Periods (const StatsStore *store);
+static void Fouls (const StatsStore *store);
+static void Margin (const StatsStore *store);
+static double Now (void);
+
+static const Query queries[] =
+{
+	{"summary", COLUMN (STATS_DATE), Summary},
+	{"periods", COLUMN (STATS_PERIOD) | COLUMN (STATS_HOME_POINTS) | COLUMN (STATS_VISITOR_POINTS), Periods},
+	{"fouls", COLUMN (STATS_PERIOD) | COLUMN (STATS_HOME_FOULS) | COLUMN (STATS_VISITOR_FOULS), Fouls},
+	{"margin", COLUMN (STATS_GAME) | COLUMN (STATS_HOME_POINTS) | COLUMN (STATS_VISITOR_POINTS), Margin},
+};
+#define QUERY_COUNT (int) (sizeof (queries) / sizeof (queries[0]))
+
+int main (int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		fprintf (stderr, "usage: %s DIR [summary|periods|fouls|margin|all]...\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	const char *dir = argv[1];
+	const char *all[] = {"all"};
+	const char **names = argc > 2 ? (const char **) argv + 2 : all;
+	int name_count = argc > 2 ? argc - 2 : 1;
+
+	for (int n = 0; n < name_count; n++)
+	{
+		int found = 0;
+		for (int q = 0; q < QUERY_COUNT; q++)
+		{
+			if (strcmp (names[n], queries[q].name) != 0 && strcmp (names[n], "all") != 0)
+				continue;
+			found = 1;
+
+			StatsStore store;
+			double start = Now ();
+			if (StatsOpen (&store, dir, queries[q].columns) != 0)
+			{
+				fprintf (stderr, "%s: could not read season statistics in '%s'\n", argv[0], dir);
+				return EXIT_FAILURE;
+			}
+			double loaded = Now ();
+			printf ("== %s ==\n", queries[q].name);
+			queries[q].run (&store);
+			printf ("(%lld games, %.2f ms to load, %.2f ms to query)\n\n", (long long) store.games, (loaded - start) * 1e3, (Now () - loaded) * 1e3);
+			StatsClose (&store);
+		}
+		if (!found)
+		{
+			fprintf (stderr, "%s: unknown query '%s'\n", argv[0], names[n]);
+			return EXIT_FAILURE;
+		}
+	}
+	return EXIT_SUCCESS;
+}
+
+static void Summary (const StatsStore *store)
+{
+	printf ("games: %lld\nperiods: %lld\n", (long long) store->games, (long long) store->rows);
+	if (store->rows == 0)
+		return;
+
+	const int64_t *date = store->columns[STATS_DATE];
+	int64_t first = date[0], last = date[0];
+	for (int64_t row = 1; row < store->rows; row++)
+	{
+		if (date[row] < first)
+			first = date[row];
+		if (date[row] > last)
+			last = date[row];
+	}
+	char first_text[32], last_text[32];
+	time_t first_time = (time_t) first, last_time = (time_t) last;
+	strftime (first_text, sizeof (first_text), "%Y-%m-%d", localtime (&first_time));
+	strftime (last_text, sizeof (last_text), "%Y-%m-%d", localtime (&last_time));
+	printf ("first game: %s\nlast game: %s\n", first_text, last_text);
+}
+
+static void Periods (const StatsStore *store)
+{
+	int64_t count[STATS_PERIODS] = {0}, home[STATS_PERIODS] = {0}, visitor[STATS_PERIODS] = {0};
+	const int64_t *period = store->columns[STATS_PERIOD];
+	const int64_t *home_points = store->columns[STATS_HOME_POINTS];
+	const int64_t *visitor_points = store->columns[STATS_VISITOR_POINTS];
+
+	for (int64_t row = 0; row < store->rows; row++)
+	{
+		int p = (int) period[row];
+		count[p]++;
+		home[p] += home_points[row];
+		visitor[p] += visitor_points[row];
+	}
+	printf ("period  games    home  visitor   total   (average points)\n");
+	for (int p = 0; p < STATS_PERIODS; p++)
+		if (count[p])
+			printf ("%6d %6lld %7.2f %8.2f %7.2f\n", p, (long long) count[p],
+				(double) home[p] / count[p], (double) visitor[p] / count[p], (double) (home[p] + visitor[p]) / count[p]);
+}
+
+static void Fouls (const StatsStore *store)
+{
+	int64_t count[STATS_PERIODS] = {0}, home[STATS_PERIODS] = {0}, visitor[STATS_PERIODS] = {0};
+	const int64_t *period = store->columns[STATS_PERIOD];
+	const int64_t *home_fouls = store->columns[STATS_HOME_FOULS];
+	const int64_t *visitor_fouls = store->columns[STATS_VISITOR_FOULS];
+
+	for (int64_t row = 0; row < store->rows; row++)
+	{
+		int p = (int) period[row];
+		count[p]++;
+		home[p] += home_fouls[row];
+		visitor[p] += visitor_fouls[row];
+	}
+	printf ("period  games    home  visitor   (average team fouls at the end of the period)\n");
+	for (int p = 0; p < STATS_PERIODS; p++)
+		if (count[p])
+			printf ("%6d %6lld %7.2f %8.2f\n", p, (long long) count[p], (double) home[p] / count[p], (double) visitor[p] / count[p]);
+}
+
+static void Margin (const StatsStore *store)
+{
+	const int64_t *game = store->columns[STATS_GAME];
+	const int64_t *home_points = store->columns[STATS_HOME_POINTS];
+	const int64_t *visitor_points = store->columns[STATS_VISITOR_POINTS];
+	int64_t games = 0, home_wins = 0, visitor_wins = 0, total = 0, total_absolute = 0, largest = 0;
+
+	// Rows of a game are next to each other, so a game ends where the game number changes
+	int64_t margin = 0;
+	for (int64_t row = 0; row < store->rows; row++)
+	{
+		margin += home_points[row] - visitor_points[row];
+		if (row + 1 < store->rows && game[row + 1] == game[row])
+			continue;
+		games++;
+		total += margin;
+		total_absolute += margin < 0 ? -margin : margin;
+		if (margin > 0)
+			home_wins++;
+		else if (margin < 0)
+			visitor_wins++;
+		if ((margin < 0 ? -margin : margin) > largest)
+			largest = margin < 0 ? -margin : margin;
+		margin = 0;
+	}
+	if (games == 0)
+		return;
+	printf ("home wins: %lld\nvisitor wins: %lld\nties: %lld\n", (long long) home_wins, (long long) visitor_wins, (long long) (games - home_wins - visitor_wins));
+	printf ("average margin (home - visitor): %.2f\naverage winning margin: %.2f\nlargest margin: %lld\n",
+		(double) total / games, (double) total_absolute / games, (long long) largest);
+}
+
+static double Now (void)
+{
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
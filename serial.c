@@ -0,0 +1,392 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - serial controller output
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+**************************************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include "serial.h"
+
+#define TICK_NS (1000000000L / SERIAL_RATE_HZ)
+#define ONE_FIELD_LINE_MAX (1 + (3 + 3 + 2) * 2) // A frame of one clock field with every byte escaped
+#define REFRESH_PER_TICK ((SERIAL_FIELD_COUNT - 1 + SERIAL_RATE_HZ * SERIAL_REFRESH_MS / 1000 - 1) / (SERIAL_RATE_HZ * SERIAL_REFRESH_MS / 1000))
+
+typedef struct BaudRate { int baud; speed_t speed; } BaudRate;
+
+static const BaudRate baud_rates[] =
+{
+	{1200, B1200}, {2400, B2400}, {4800, B4800}, {9600, B9600}, {19200, B19200},
+	{38400, B38400}, {57600, B57600}, {115200, B115200}, {230400, B230400}, {0, 0}
+};
+
+static void *SerialThread (void *data);
+static size_t SendFrame (SerialOutput *output, SerialFrameType type, const int32_t *values, const int *fields, int count);
+static int FieldsThatFit (const SerialOutput *output, SerialFrameType type, const int32_t *values, const int *fields, int count, long room);
+static size_t FrameLine (const SerialOutput *output, SerialFrameType type, const int32_t *values, const int *fields, int count, unsigned char *line);
+static size_t PutField (unsigned char *p, int field, int32_t value);
+static int FieldSize (int field);
+static uint16_t Crc16 (const unsigned char *data, size_t length);
+static void ApplyFrame (SerialDecoder *decoder);
+
+int SerialStart (SerialOutput *output, const ShmPublisher *publisher, const char *path, int baud)
+{
+	memset (output, 0, sizeof (*output));
+	output->fd = -1;
+	output->baud = baud;
+	output->refresh_field = 1;
+
+	speed_t speed = 0;
+	for (int i = 0; baud_rates[i].baud != 0; i++)
+		if (baud_rates[i].baud == baud)
+			speed = baud_rates[i].speed;
+	if (speed == 0)
+		return -1;
+
+	// Raw 8N1, no flow control, no modem lines; writes block until the UART takes the bytes
+	// Opened without blocking, as a port without CLOCAL set yet would wait for carrier, and blocking again once CLOCAL is
+	output->fd = open (path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+	if (output->fd < 0)
+		return -1;
+	struct termios settings;
+	if (tcgetattr (output->fd, &settings) != 0)
+	{
+		close (output->fd);
+		return -1;
+	}
+	cfmakeraw (&settings);
+	settings.c_cflag &= ~(CSTOPB | PARENB | CRTSCTS);
+	settings.c_cflag |= CLOCAL | CREAD | CS8;
+	settings.c_iflag &= ~(IXON | IXOFF | IXANY);
+	cfsetispeed (&settings, speed);
+	cfsetospeed (&settings, speed);
+	int flags = fcntl (output->fd, F_GETFL);
+	if (tcsetattr (output->fd, TCSANOW, &settings) != 0 || flags < 0 || fcntl (output->fd, F_SETFL, flags & ~O_NONBLOCK) != 0 ||
+		ShmReaderAttach (&output->reader, publisher) != 0)
+	{
+		close (output->fd);
+		return -1;
+	}
+
+	atomic_store (&output->running, 1);
+	if (pthread_create (&output->thread, NULL, SerialThread, output) != 0)
+	{
+		output->thread = 0;
+		SerialStop (output);
+		return -1;
+	}
+	return 0;
+}
+
+void SerialStop (SerialOutput *output)
+{
+	atomic_store (&output->running, 0);
+	if (output->thread)
+	{
+		pthread_join (output->thread, NULL);
+		output->thread = 0;
+	}
+	if (output->fd >= 0)
+		close (output->fd);
+	output->fd = -1;
+	ShmReaderClose (&output->reader);
+}
+
+void SerialFields (const ScoreboardState *state, int32_t *values)
+{
+	memset (values, 0, sizeof (int32_t) * SERIAL_FIELD_COUNT);
+	values[SERIAL_MAIN_CLOCK] = state->main_clock;
+	values[SERIAL_SHOT_CLOCK] = state->shot_clock_showing ? state->shot_clock : state->timeout_clock;
+	values[SERIAL_FLAGS] = (state->main_clock_running ? SERIAL_MAIN_RUNNING : 0) |
+		(state->shot_clock_running ? SERIAL_SHOT_RUNNING : 0) |
+		(!state->shot_clock_showing ? SERIAL_TIMEOUT_SHOWING : 0) |
+		(!state->shot_clock_enabled ? SERIAL_SHOT_DISABLED : 0) |
+		(state->main_clock_tenths ? SERIAL_MAIN_TENTHS : 0) |
+		(state->shot_clock_tenths ? SERIAL_SHOT_TENTHS : 0) |
+		(state->buzzer ? SERIAL_BUZZER : 0) |
+		(state->mode != 0 ? SERIAL_EDITING : 0);
+	values[SERIAL_HOME_SCORE] = state->score[0];
+	values[SERIAL_VISITOR_SCORE] = state->score[1];
+	values[SERIAL_HOME_FOULS] = state->fouls[0];
+	values[SERIAL_VISITOR_FOULS] = state->fouls[1];
+	values[SERIAL_HOME_TOL] = state->tol[0];
+	values[SERIAL_VISITOR_TOL] = state->tol[1];
+	values[SERIAL_PERIOD] = state->period;
+}
+
+static void *SerialThread (void *data)
+{
+	SerialOutput *output = data;
+	ScoreboardState state;
+	int32_t values[SERIAL_FIELD_COUNT];
+	int fields[SERIAL_FIELD_COUNT];
+	int sent_now[SERIAL_FIELD_COUNT];
+	struct timespec next;
+	clock_gettime (CLOCK_MONOTONIC, &next);
+
+	while (atomic_load (&output->running))
+	{
+		// Fixed ticks; after a long stall start again from now instead of sending a burst
+		next.tv_nsec += TICK_NS;
+		if (next.tv_nsec >= 1000000000L)
+		{
+			next.tv_sec++;
+			next.tv_nsec -= 1000000000L;
+		}
+		struct timespec now;
+		clock_gettime (CLOCK_MONOTONIC, &now);
+		if ((now.tv_sec - next.tv_sec) * 1000000000L + (now.tv_nsec - next.tv_nsec) > TICK_NS)
+			next = now;
+		clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+		if (ShmRead (&output->reader, &state) != 0)
+			continue;
+		SerialFields (&state, values);
+
+		// What the line takes in a tick, and what slower ticks left over, up to one small frame more; at low
+		// baud rates a frame is bigger than a tick and goes out every few
+		long per_tick = output->baud / 10 / SERIAL_RATE_HZ;
+		output->credit += per_tick;
+		if (output->credit > per_tick + ONE_FIELD_LINE_MAX)
+			output->credit = per_tick + ONE_FIELD_LINE_MAX;
+
+		// Changes first, the whole state on the first tick; in field order so the clocks lead, and what does not fit waits
+		int count = 0;
+		memset (sent_now, 0, sizeof (sent_now));
+		for (int field = 1; field < SERIAL_FIELD_COUNT; field++)
+			if (!(output->sent_known & (1u << field)) || values[field] != output->sent[field])
+				fields[count++] = field;
+		int fit = FieldsThatFit (output, SERIAL_CHANGES, values, fields, count, output->credit);
+		if (fit > 0)
+			output->credit -= (long) SendFrame (output, SERIAL_CHANGES, values, fields, fit);
+		for (int i = 0; i < fit; i++)
+			sent_now[fields[i]] = 1;
+		if (fit < count)
+		{
+			output->over_budget++;
+			continue;
+		}
+
+		// Then the next few fields of the rolling refresh, if the tick still has room for them
+		count = 0;
+		int field = output->refresh_field;
+		int wrapped = 0;
+		for (int looked = 0; looked < SERIAL_FIELD_COUNT - 1 && count < REFRESH_PER_TICK; looked++)
+		{
+			if (!sent_now[field])
+				fields[count++] = field;
+			if (++field == SERIAL_FIELD_COUNT)
+			{
+				field = 1;
+				wrapped = 1;
+			}
+		}
+		if (FieldsThatFit (output, SERIAL_REFRESH, values, fields, count, output->credit) < count)
+		{
+			output->over_budget++;
+			continue;
+		}
+		if (count > 0)
+			output->credit -= (long) SendFrame (output, SERIAL_REFRESH, values, fields, count);
+		output->refresh_field = field;
+		output->refreshes += (unsigned long) wrapped;
+	}
+	return NULL;
+}
+
+static size_t SendFrame (SerialOutput *output, SerialFrameType type, const int32_t *values, const int *fields, int count)
+{
+	unsigned char line[1 + SERIAL_FRAME_MAX * 2];
+	size_t line_length = FrameLine (output, type, values, fields, count, line);
+	output->sequence++;
+	for (int i = 0; i < count; i++)
+	{
+		output->sent[fields[i]] = values[fields[i]];
+		output->sent_known |= 1u << fields[i];
+	}
+
+	for (size_t written = 0; written < line_length; )
+	{
+		ssize_t result = write (output->fd, line + written, line_length - written);
+		if (result < 0 && errno == EINTR)
+			continue;
+		if (result <= 0)
+			break;
+		written += (size_t) result;
+	}
+	output->frames++;
+	output->bytes += line_length;
+	return line_length;
+}
+
+static int FieldsThatFit (const SerialOutput *output, SerialFrameType type, const int32_t *values, const int *fields, int count, long room)
+{
+	// How many of the fields, from the first, make a frame of at most room bytes on the line, escapes and all
+	unsigned char line[1 + SERIAL_FRAME_MAX * 2];
+	int fit = 0;
+	while (fit < count && (long) FrameLine (output, type, values, fields, fit + 1, line) <= room)
+		fit++;
+	return fit;
+}
+
+static size_t FrameLine (const SerialOutput *output, SerialFrameType type, const int32_t *values, const int *fields, int count, unsigned char *line)
+{
+	unsigned char frame[SERIAL_FRAME_MAX];
+	size_t length = 3;
+	frame[0] = output->sequence;
+	frame[1] = (unsigned char) type;
+	for (int i = 0; i < count; i++)
+		length += PutField (frame + length, fields[i], values[fields[i]]);
+	frame[2] = (unsigned char) (length - 3);
+	uint16_t crc = Crc16 (frame, length);
+	frame[length++] = (unsigned char) (crc >> 8);
+	frame[length++] = (unsigned char) crc;
+
+	// Escape everything after the start byte
+	size_t line_length = 0;
+	line[line_length++] = SERIAL_START;
+	for (size_t i = 0; i < length; i++)
+	{
+		if (frame[i] == SERIAL_START || frame[i] == SERIAL_ESCAPE)
+		{
+			line[line_length++] = SERIAL_ESCAPE;
+			line[line_length++] = frame[i] ^ 0x20;
+		}
+		else
+			line[line_length++] = frame[i];
+	}
+	return line_length;
+}
+
+static size_t PutField (unsigned char *p, int field, int32_t value)
+{
+	p[0] = (unsigned char) field;
+	if (FieldSize (field) == 2)
+	{
+		uint16_t clamped = value < 0 ? 0 : value > 0xffff ? 0xffff : (uint16_t) value;
+		p[1] = (unsigned char) (clamped >> 8);
+		p[2] = (unsigned char) clamped;
+		return 3;
+	}
+	p[1] = value < 0 ? 0 : value > 0xff ? 0xff : (unsigned char) value;
+	return 2;
+}
+
+static int FieldSize (int field)
+{
+	return field == SERIAL_MAIN_CLOCK || field == SERIAL_SHOT_CLOCK ? 2 : 1;
+}
+
+// CRC-16/CCITT-FALSE: polynomial 0x1021, starts at 0xFFFF, not reflected
+static uint16_t Crc16 (const unsigned char *data, size_t length)
+{
+	uint16_t crc = 0xFFFF;
+	for (size_t i = 0; i < length; i++)
+	{
+		crc ^= (uint16_t) (data[i] << 8);
+		for (int bit = 0; bit < 8; bit++)
+			crc = (uint16_t) (crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1);
+	}
+	return crc;
+}
+
+void SerialDecoderInit (SerialDecoder *decoder)
+{
+	memset (decoder, 0, sizeof (*decoder));
+}
+
+int SerialDecode (SerialDecoder *decoder, const unsigned char *data, size_t length)
+{
+	int good = 0;
+	for (size_t i = 0; i < length; i++)
+	{
+		unsigned char byte = data[i];
+		if (byte == SERIAL_START)
+		{
+			// A frame cut short by a new one is lost
+			if (decoder->in_frame && decoder->length > 0)
+				decoder->bad_frames++;
+			decoder->in_frame = 1;
+			decoder->length = 0;
+			decoder->escape = 0;
+			continue;
+		}
+		if (!decoder->in_frame)
+			continue;
+		if (byte == SERIAL_ESCAPE)
+		{
+			decoder->escape = 1;
+			continue;
+		}
+		if (decoder->escape)
+		{
+			byte ^= 0x20;
+			decoder->escape = 0;
+		}
+		if (decoder->length == SERIAL_FRAME_MAX)
+		{
+			decoder->bad_frames++;
+			decoder->in_frame = 0;
+			continue;
+		}
+		decoder->frame[decoder->length++] = byte;
+
+		// Complete once the length byte says so
+		if (decoder->length >= 3 && decoder->length == (size_t) decoder->frame[2] + 5)
+		{
+			decoder->in_frame = 0;
+			uint16_t crc = (uint16_t) (decoder->frame[decoder->length - 2] << 8 | decoder->frame[decoder->length - 1]);
+			if (crc != Crc16 (decoder->frame, decoder->length - 2))
+			{
+				decoder->bad_frames++;
+				continue;
+			}
+			ApplyFrame (decoder);
+			good++;
+		}
+	}
+	return good;
+}
+
+static void ApplyFrame (SerialDecoder *decoder)
+{
+	uint8_t sequence = decoder->frame[0];
+	if (decoder->have_sequence)
+		decoder->lost_frames += (uint8_t) (sequence - decoder->sequence - 1);
+	decoder->have_sequence = 1;
+	decoder->sequence = sequence;
+	decoder->frames++;
+
+	size_t end = 3 + (size_t) decoder->frame[2];
+	for (size_t p = 3; p < end; )
+	{
+		int field = decoder->frame[p];
+		if (field < 1 || field >= SERIAL_FIELD_COUNT || p + 1 + (size_t) FieldSize (field) > end)
+			return;
+		if (FieldSize (field) == 2)
+			decoder->values[field] = decoder->frame[p + 1] << 8 | decoder->frame[p + 2];
+		else
+			decoder->values[field] = decoder->frame[p + 1];
+		decoder->known |= 1u << field;
+		p += 1 + (size_t) FieldSize (field);
+	}
+}
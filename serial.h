@@ -0,0 +1,125 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - serial controller output
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Streams the board to a hardware scoreboard or shot clock controller on a serial port (--serial
+PATH, RS-232 or an RS-485 adapter), raw 8N1 at --serial-baud. A thread of its own reads the
+published state (shm.h) SERIAL_RATE_HZ times a second and sends one frame:
+
+	0x7E  sequence  type  length  fields...  crc-hi  crc-lo
+
+Each field is its SerialField number followed by its value, big-endian: two bytes for clocks
+(tenths of seconds), one for everything else. The CRC is CRC-16/CCITT-FALSE over sequence to the
+last field. 0x7E only ever starts a frame: 0x7E and 0x7D anywhere else go out as 0x7D followed by
+the byte XOR 0x20, so a receiver that comes in halfway or hits line noise finds the next frame.
+The sequence counts frames so receivers can tell one was lost.
+
+Fields that changed since they were last sent go first (SERIAL_CHANGES). Whatever the baud rate
+leaves of the tick goes to a refresh of the other fields in turn (SERIAL_REFRESH), so a receiver
+that was switched on late or lost a frame has everything again within SERIAL_REFRESH_MS. At 9600
+baud a tick has 48 bytes; the clocks changing take 12 of them. Nothing is sent past what the line
+takes: changes that do not fit wait for the next tick, lowest field numbers (the clocks) first,
+and at 1200 baud, where a tick has 6 bytes and no frame is that small, what ticks leave over adds
+up until a frame fits.
+
+SerialDecoder is the receiving side, for controllers and tests.
+
+**************************************************************************************************/
+
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "shm.h"
+
+#define SERIAL_RATE_HZ 20 // Frames per second
+#define SERIAL_REFRESH_MS 1000 // Every field is sent at least this often
+#define SERIAL_FRAME_MAX 128 // Before escaping
+#define SERIAL_START 0x7E
+#define SERIAL_ESCAPE 0x7D
+
+typedef enum SerialFrameType { SERIAL_CHANGES = 1, SERIAL_REFRESH = 2 } SerialFrameType;
+
+typedef enum SerialField
+{
+	SERIAL_MAIN_CLOCK = 1, // Two bytes, tenths of seconds
+	SERIAL_SHOT_CLOCK, // Two bytes, shot or timeout clock, whichever is showing
+	SERIAL_FLAGS, // SerialFlag bits
+	SERIAL_HOME_SCORE,
+	SERIAL_VISITOR_SCORE,
+	SERIAL_HOME_FOULS,
+	SERIAL_VISITOR_FOULS,
+	SERIAL_HOME_TOL,
+	SERIAL_VISITOR_TOL,
+	SERIAL_PERIOD,
+	SERIAL_FIELD_COUNT // One past the last field
+} SerialField;
+
+typedef enum SerialFlag
+{
+	SERIAL_MAIN_RUNNING = 1,
+	SERIAL_SHOT_RUNNING = 2,
+	SERIAL_TIMEOUT_SHOWING = 4, // SERIAL_SHOT_CLOCK is the timeout clock
+	SERIAL_SHOT_DISABLED = 8, // Shot clock display blanked
+	SERIAL_MAIN_TENTHS = 16, // Clocks show tenths of seconds
+	SERIAL_SHOT_TENTHS = 32,
+	SERIAL_BUZZER = 64,
+	SERIAL_EDITING = 128 // Operator is correcting the clocks
+} SerialFlag;
+
+typedef struct SerialOutput
+{
+	int fd;
+	pthread_t thread;
+	_Atomic int running;
+	ShmReader reader;
+	int baud;
+	int32_t sent[SERIAL_FIELD_COUNT]; // Last value sent of each field
+	uint32_t sent_known; // Bit per field sent at least once
+	long credit; // Bytes the line can take now, topped up every tick
+	int refresh_field; // Next field the refresh sends
+	uint8_t sequence;
+
+	// Counters, only written by the serial thread
+	unsigned long frames, bytes, refreshes, over_budget; // over_budget = ticks that left changes or the refresh for later
+} SerialOutput;
+
+typedef struct SerialDecoder
+{
+	unsigned char frame[SERIAL_FRAME_MAX];
+	size_t length;
+	int in_frame, escape;
+	int have_sequence;
+	uint8_t sequence;
+	int32_t values[SERIAL_FIELD_COUNT];
+	uint32_t known; // Bit per field received at least once
+	unsigned long frames, bad_frames, lost_frames;
+} SerialDecoder;
+
+int SerialStart (SerialOutput *output, const ShmPublisher *publisher, const char *path, int baud); // Returns 0 on success
+void SerialStop (SerialOutput *output);
+void SerialFields (const ScoreboardState *state, int32_t *values); // State to field values, values[SERIAL_FIELD_COUNT]
+
+void SerialDecoderInit (SerialDecoder *decoder);
+int SerialDecode (SerialDecoder *decoder, const unsigned char *data, size_t length); // Returns the number of good frames
+
+#endif
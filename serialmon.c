@@ -0,0 +1,285 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - serial output monitor
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Decodes the serial controller feed (serial.h) and checks it.
+
+	serialmon [--seconds S] [--quiet] PATH
+	serialmon --serve [--baud N] [--seconds S] [--noise P] [--quiet]
+
+With PATH it reads a serial port or pseudo-terminal the scoreboard (--serial) writes to and prints
+the board whenever it changes. --serve needs no scoreboard or hardware: it opens a pseudo-terminal,
+runs the serial output on one end with a simulated game and decodes the other end. --noise flips
+that fraction of the bytes on the way, like a bad RS-485 line. At the end the game stops, noise
+stops, and after one refresh the decoded board has to match the published one. More bytes sent
+than --baud carries in the time it ran is a failure too.
+
+**************************************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "serial.h"
+
+#define CLOCK_VALUES 4801 // Main clock values a game goes through
+
+static ShmPublisher publisher;
+static _Atomic int playing = 1;
+static _Atomic int64_t first_shown[CLOCK_VALUES]; // When each main clock value was first published
+
+static void *GameThread (void *data);
+static void PrintBoard (const SerialDecoder *decoder, double seconds);
+static int64_t Now (void);
+
+int main (int argc, char *argv[])
+{
+	int serve = 0, quiet = 0;
+	int baud = 19200;
+	double seconds = 10, noise = 0;
+	static struct option long_options[] =
+	{
+		{"serve", no_argument, 0, 'S'},
+		{"baud", required_argument, 0, 'b'},
+		{"seconds", required_argument, 0, 's'},
+		{"noise", required_argument, 0, 'n'},
+		{"quiet", no_argument, 0, 'q'},
+		{0, 0, 0, 0}
+	};
+
+	int c;
+	while ((c = getopt_long (argc, argv, "", long_options, NULL)) != -1)
+	{
+		switch (c)
+		{
+			case 'S': serve = 1; break;
+			case 'b': baud = atoi (optarg); break;
+			case 's': seconds = atof (optarg); break;
+			case 'n': noise = atof (optarg); break;
+			case 'q': quiet = 1; break;
+			default:
+				fprintf (stderr, "usage: %s [--seconds S] [--quiet] PATH\n       %s --serve [--baud N] [--seconds S] [--noise P] [--quiet]\n", argv[0], argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+	if (serve == (optind < argc) || seconds <= 0 || noise < 0 || noise >= 1)
+	{
+		fprintf (stderr, "usage: %s [--seconds S] [--quiet] PATH\n       %s --serve [--baud N] [--seconds S] [--noise P] [--quiet]\n", argv[0], argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	// The end that is read, set raw so nothing is translated
+	int fd;
+	SerialOutput output;
+	pthread_t game;
+	if (serve)
+	{
+		fd = posix_openpt (O_RDWR | O_NOCTTY);
+		if (fd < 0 || grantpt (fd) != 0 || unlockpt (fd) != 0)
+		{
+			fprintf (stderr, "%s: could not open a pseudo-terminal\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+		if (ShmPublisherOpen (&publisher, NULL) != 0)
+			return EXIT_FAILURE;
+		pthread_create (&game, NULL, GameThread, NULL);
+		if (SerialStart (&output, &publisher, ptsname (fd), baud) != 0)
+		{
+			fprintf (stderr, "%s: could not start serial output at %d baud on %s\n", argv[0], baud, ptsname (fd));
+			return EXIT_FAILURE;
+		}
+	}
+	else
+	{
+		fd = open (argv[optind], O_RDONLY | O_NOCTTY);
+		if (fd < 0)
+		{
+			fprintf (stderr, "%s: could not open '%s'\n", argv[0], argv[optind]);
+			return EXIT_FAILURE;
+		}
+	}
+	struct termios settings;
+	if (tcgetattr (fd, &settings) == 0)
+	{
+		cfmakeraw (&settings);
+		tcsetattr (fd, TCSANOW, &settings);
+	}
+
+	SerialDecoder decoder;
+	SerialDecoderInit (&decoder);
+	unsigned char buffer[512];
+	int32_t last[SERIAL_FIELD_COUNT];
+	memset (last, 0xff, sizeof (last));
+	long long bytes = 0;
+	unsigned long flipped = 0;
+	int64_t latency_sum = 0, latency_max = 0;
+	long latency_samples = 0;
+	int64_t start = Now ();
+	int64_t all_known_us = -1;
+	int64_t settle_us = serve ? start + (int64_t) (seconds * 1e6) : -1;
+	int64_t end = start + (int64_t) (seconds * 1e6) + (serve ? SERIAL_REFRESH_MS * 1500 : 0);
+	while (Now () < end)
+	{
+		if (serve && settle_us >= 0 && Now () >= settle_us)
+		{
+			// Stop the game and the noise: one refresh later everything has to be right
+			atomic_store (&playing, 0);
+			noise = 0;
+			settle_us = -1;
+		}
+
+		struct pollfd fds = {fd, POLLIN, 0};
+		if (poll (&fds, 1, 50) <= 0)
+			continue;
+		ssize_t got = read (fd, buffer, sizeof (buffer));
+		if (got <= 0)
+			break;
+		bytes += got;
+		for (ssize_t i = 0; i < got; i++)
+			if (noise > 0 && (double) rand () / RAND_MAX < noise)
+			{
+				buffer[i] ^= (unsigned char) (1 << (rand () % 8));
+				flipped++;
+			}
+		if (SerialDecode (&decoder, buffer, (size_t) got) == 0)
+			continue;
+
+		int64_t now = Now ();
+		if (all_known_us < 0 && decoder.known == ((1u << SERIAL_FIELD_COUNT) - 2))
+			all_known_us = now - start;
+		int32_t clock = decoder.values[SERIAL_MAIN_CLOCK];
+		if (serve && clock != last[SERIAL_MAIN_CLOCK] && clock >= 0 && clock < CLOCK_VALUES && atomic_load (&first_shown[clock]) > 0)
+		{
+			int64_t latency = now - atomic_load (&first_shown[clock]);
+			latency_sum += latency;
+			latency_samples++;
+			if (latency > latency_max)
+				latency_max = latency;
+		}
+		if (!quiet && memcmp (last, decoder.values, sizeof (last)) != 0)
+			PrintBoard (&decoder, (now - start) / 1e6);
+		memcpy (last, decoder.values, sizeof (last));
+	}
+
+	int passed = 1;
+	if (serve)
+	{
+		SerialStop (&output);
+		pthread_join (game, NULL);
+		ScoreboardState state;
+		ShmReader reader;
+		ShmReaderAttach (&reader, &publisher);
+		ShmRead (&reader, &state);
+		int32_t expected[SERIAL_FIELD_COUNT];
+		SerialFields (&state, expected);
+		for (int field = 1; field < SERIAL_FIELD_COUNT; field++)
+			if (decoder.values[field] != expected[field])
+			{
+				printf ("field %d decoded as %d, published %d\n", field, decoder.values[field], expected[field]);
+				passed = 0;
+			}
+		ShmReaderClose (&reader);
+		ShmPublisherClose (&publisher);
+		// 10 bits a byte, and the one frame the output may send ahead of the line
+		double line_bytes = baud / 10.0 * ((Now () - start) / 1e6) + 2 * SERIAL_FRAME_MAX + 1;
+		if (output.bytes > line_bytes)
+		{
+			printf ("sent %lu bytes, more than %d baud carries\n", output.bytes, baud);
+			passed = 0;
+		}
+		printf ("sent %lu frames, %lu bytes (%.0f%% of %d baud), %lu full refreshes, %lu ticks that left fields for later\n",
+			output.frames, output.bytes, output.bytes * 10.0 / ((Now () - start) / 1e6) / baud * 100, baud, output.refreshes, output.over_budget);
+	}
+	close (fd);
+
+	double elapsed = (Now () - start) / 1e6;
+	printf ("received %lld bytes (%.0f bytes/s), %lu good frames, %lu bad, %lu lost", bytes, bytes / elapsed, decoder.frames, decoder.bad_frames, decoder.lost_frames);
+	if (flipped)
+		printf (", %lu bytes flipped", flipped);
+	printf ("\n");
+	if (all_known_us >= 0)
+		printf ("whole board known after %.0f ms\n", all_known_us / 1000.0);
+	if (latency_samples)
+		printf ("main clock publish to decode: mean %.1f ms, max %.1f ms\n", latency_sum / 1000.0 / latency_samples, latency_max / 1000.0);
+	if (serve)
+		printf ("decoded board %s the published one\n", passed ? "matches" : "DOES NOT MATCH");
+	return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void PrintBoard (const SerialDecoder *decoder, double seconds)
+{
+	const int32_t *v = decoder->values;
+	int flags = v[SERIAL_FLAGS];
+	printf ("%8.2f  %2d:%02d.%d %c  %s %2d.%d %c  %3d-%-3d  fouls %d-%d  TOL %d-%d  period %d%s%s\n", seconds,
+		v[SERIAL_MAIN_CLOCK] / 600, v[SERIAL_MAIN_CLOCK] / 10 % 60, v[SERIAL_MAIN_CLOCK] % 10, flags & SERIAL_MAIN_RUNNING ? '>' : ' ',
+		flags & SERIAL_TIMEOUT_SHOWING ? "timeout" : "shot", v[SERIAL_SHOT_CLOCK] / 10, v[SERIAL_SHOT_CLOCK] % 10, flags & SERIAL_SHOT_RUNNING ? '>' : ' ',
+		v[SERIAL_HOME_SCORE], v[SERIAL_VISITOR_SCORE], v[SERIAL_HOME_FOULS], v[SERIAL_VISITOR_FOULS],
+		v[SERIAL_HOME_TOL], v[SERIAL_VISITOR_TOL], v[SERIAL_PERIOD],
+		flags & SERIAL_BUZZER ? "  BUZZER" : "", flags & SERIAL_EDITING ? "  editing" : "");
+}
+
+static void *GameThread (void *data)
+{
+	(void) data;
+	ScoreboardState state;
+	memset (&state, 0, sizeof (state));
+	state.main_clock = 4800;
+	state.shot_clock = 350;
+	state.timeout_clock = 300;
+	state.main_clock_running = state.shot_clock_running = 1;
+	state.shot_clock_showing = state.shot_clock_enabled = 1;
+	state.tol[0] = state.tol[1] = 5;
+	state.period = 1;
+
+	// A frame every 1/60 s, the clocks going down a tenth every 100 ms, a basket or foul now and then
+	int64_t start = Now ();
+	for (long frame = 0; atomic_load (&playing); frame++)
+	{
+		int64_t tenths = (Now () - start) / 100000;
+		state.main_clock = (int32_t) (4800 - tenths % 4800);
+		state.shot_clock = (int32_t) (350 - tenths % 350);
+		state.main_clock_tenths = state.main_clock < 600;
+		state.shot_clock_tenths = state.shot_clock < 100;
+		if (frame % 90 == 0)
+			state.score[frame / 90 % 2] += 2;
+		if (frame % 250 == 0)
+			state.fouls[frame / 250 % 2]++;
+		int64_t expected = 0;
+		atomic_compare_exchange_strong (&first_shown[state.main_clock], &expected, Now ());
+		ShmPublish (&publisher, &state);
+		usleep (16667);
+	}
+	return NULL;
+}
+
+static int64_t Now (void)
+{
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
@@ -0,0 +1,217 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - shared memory state
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+**************************************************************************************************/
+
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "shm.h"
+
+#define SHM_MAGIC 0x53425348 // "SBSH"
+#define STATE_WORDS (sizeof (ScoreboardState) / sizeof (uint64_t))
+#define READ_ATTEMPTS 1000000 // A writer that died halfway leaves the sequence odd forever
+
+_Static_assert (sizeof (ScoreboardState) % sizeof (uint64_t) == 0, "ScoreboardState must be whole 64-bit words");
+
+// The state is kept as words so both sides can copy it with plain atomic loads and stores
+struct ShmSegment
+{
+	uint32_t magic;
+	uint32_t layout_version;
+	uint32_t state_size;
+	uint32_t reserved;
+	_Alignas (64) _Atomic uint64_t sequence; // Odd while the writer is busy
+	_Alignas (64) _Atomic uint64_t words[STATE_WORDS];
+};
+
+static void CpuRelax (void);
+static int64_t Now (void);
+
+int ShmPublisherOpen (ShmPublisher *publisher, const char *name)
+{
+	memset (publisher, 0, sizeof (*publisher));
+	if (name == NULL)
+	{
+		publisher->segment = mmap (NULL, sizeof (struct ShmSegment), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+		if (publisher->segment == MAP_FAILED)
+		{
+			publisher->segment = NULL;
+			return -1;
+		}
+	}
+	else
+	{
+		if (strlen (name) >= sizeof (publisher->name))
+			return -1;
+		int fd = shm_open (name, O_RDWR | O_CREAT, 0644);
+		if (fd < 0)
+			return -1;
+		if (ftruncate (fd, sizeof (struct ShmSegment)) != 0)
+		{
+			close (fd);
+			return -1;
+		}
+		publisher->segment = mmap (NULL, sizeof (struct ShmSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close (fd);
+		if (publisher->segment == MAP_FAILED)
+		{
+			publisher->segment = NULL;
+			return -1;
+		}
+		strcpy (publisher->name, name);
+	}
+
+	// A segment left by a scoreboard that crashed keeps its sequence, so readers never see it go back
+	struct ShmSegment *segment = publisher->segment;
+	uint64_t sequence = atomic_load_explicit (&segment->sequence, memory_order_relaxed);
+	atomic_store_explicit (&segment->sequence, sequence + (sequence & 1), memory_order_release);
+	segment->layout_version = SHM_LAYOUT_VERSION;
+	segment->state_size = sizeof (ScoreboardState);
+	atomic_thread_fence (memory_order_release);
+	segment->magic = SHM_MAGIC;
+	return 0;
+}
+
+void ShmPublish (ShmPublisher *publisher, ScoreboardState *state)
+{
+	struct ShmSegment *segment = publisher->segment;
+	uint64_t words[STATE_WORDS];
+
+	state->tick = ++publisher->tick;
+	state->time_us = Now ();
+	memcpy (words, state, sizeof (words));
+
+	uint64_t sequence = atomic_load_explicit (&segment->sequence, memory_order_relaxed);
+	atomic_store_explicit (&segment->sequence, sequence + 1, memory_order_relaxed);
+	atomic_thread_fence (memory_order_release);
+	for (size_t i = 0; i < STATE_WORDS; i++)
+		atomic_store_explicit (&segment->words[i], words[i], memory_order_relaxed);
+	atomic_store_explicit (&segment->sequence, sequence + 2, memory_order_release);
+}
+
+void ShmPublisherClose (ShmPublisher *publisher)
+{
+	if (publisher->segment == NULL)
+		return;
+	munmap (publisher->segment, sizeof (struct ShmSegment));
+	if (publisher->name[0])
+		shm_unlink (publisher->name);
+	publisher->segment = NULL;
+}
+
+int ShmReaderOpen (ShmReader *reader, const char *name)
+{
+	struct stat info;
+
+	memset (reader, 0, sizeof (*reader));
+	int fd = shm_open (name, O_RDONLY, 0);
+	if (fd < 0)
+		return -1;
+	if (fstat (fd, &info) != 0 || info.st_size < (off_t) sizeof (struct ShmSegment))
+	{
+		close (fd);
+		return -1;
+	}
+	const struct ShmSegment *segment = mmap (NULL, sizeof (struct ShmSegment), PROT_READ, MAP_SHARED, fd, 0);
+	close (fd);
+	if (segment == MAP_FAILED)
+		return -1;
+	reader->segment = segment;
+	reader->mapped = 1;
+
+	// Only read states laid out the way this reader was built for
+	if (segment->magic != SHM_MAGIC || segment->layout_version != SHM_LAYOUT_VERSION || segment->state_size != sizeof (ScoreboardState))
+	{
+		ShmReaderClose (reader);
+		return -1;
+	}
+	atomic_thread_fence (memory_order_acquire);
+	return 0;
+}
+
+int ShmReaderAttach (ShmReader *reader, const ShmPublisher *publisher)
+{
+	memset (reader, 0, sizeof (*reader));
+	if (publisher->segment == NULL)
+		return -1;
+	reader->segment = publisher->segment;
+	return 0;
+}
+
+int ShmRead (ShmReader *reader, ScoreboardState *state)
+{
+	const struct ShmSegment *segment = reader->segment;
+	uint64_t words[STATE_WORDS];
+
+	for (int attempt = 0; attempt < READ_ATTEMPTS; attempt++)
+	{
+		uint64_t before = atomic_load_explicit (&segment->sequence, memory_order_acquire);
+		if (before == 0)
+			return -1;
+		if (before & 1)
+		{
+			reader->retries++;
+			CpuRelax ();
+			continue;
+		}
+		for (size_t i = 0; i < STATE_WORDS; i++)
+			words[i] = atomic_load_explicit (&segment->words[i], memory_order_relaxed);
+		atomic_thread_fence (memory_order_acquire);
+		if (atomic_load_explicit (&segment->sequence, memory_order_relaxed) == before)
+		{
+			memcpy (state, words, sizeof (words));
+			return 0;
+		}
+		reader->retries++;
+	}
+	return -1;
+}
+
+uint64_t ShmSequence (const ShmReader *reader)
+{
+	return atomic_load_explicit (&reader->segment->sequence, memory_order_acquire);
+}
+
+void ShmReaderClose (ShmReader *reader)
+{
+	if (reader->mapped)
+		munmap ((void *) reader->segment, sizeof (struct ShmSegment));
+	reader->segment = NULL;
+	reader->mapped = 0;
+}
+
+static void CpuRelax (void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause ();
+#elif defined(__aarch64__)
+	__asm__ __volatile__ ("yield");
+#endif
+}
+
+static int64_t Now (void)
+{
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
@@ -0,0 +1,89 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - shared memory state
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+The scoreboard publishes its whole state every frame into a POSIX shared memory segment
+(--shm NAME, e.g. /scoreboard) for overlay and announcer programs on the same machine. Readers
+only need this header and shm.c:
+
+	ShmReader reader;
+	ScoreboardState state;
+	if (ShmReaderOpen (&reader, "/scoreboard") == 0 && ShmRead (&reader, &state) == 0)
+		printf ("%d - %d\n", state.score[0], state.score[1]);
+
+The state sits under a seqlock: the writer makes the sequence odd, writes, and makes it even
+again; a reader copies the state and retries if the sequence was odd or changed meanwhile. Readers
+never block the scoreboard and need no system calls once the segment is mapped, and any number
+of them can read at once. Without --shm the same thing is kept in private memory, for readers
+inside the scoreboard itself.
+
+**************************************************************************************************/
+
+#ifndef SHM_H
+#define SHM_H
+
+#include <stdint.h>
+
+#define SHM_LAYOUT_VERSION 1 // Bump whenever ScoreboardState changes
+#define SHM_NAME_LENGTH 32
+
+// Everything on the board; all clocks are in tenths of seconds
+typedef struct ScoreboardState
+{
+	uint64_t tick; // Number of states published so far
+	int64_t time_us; // CLOCK_MONOTONIC time it was published
+	int32_t main_clock, shot_clock, timeout_clock;
+	int32_t main_clock_elapsed_us, shot_clock_elapsed_us, timeout_clock_elapsed_us; // Into the current tenth, for smooth readers
+	int32_t main_clock_running, shot_clock_running;
+	int32_t shot_clock_showing; // 0 = timeout clock showing
+	int32_t shot_clock_enabled;
+	int32_t main_clock_tenths, shot_clock_tenths; // Whether the clocks show tenths of seconds
+	int32_t mode; // 0 = clock mode, 1 = edit mode
+	int32_t buzzer; // Buzzer sounding
+	int32_t score[2], fouls[2], tol[2]; // Home, visitor
+	int32_t period;
+	int32_t reserved;
+	char team_names[2][SHM_NAME_LENGTH];
+} ScoreboardState;
+
+typedef struct ShmPublisher
+{
+	struct ShmSegment *segment;
+	char name[256]; // Empty for private memory
+	uint64_t tick;
+} ShmPublisher;
+
+typedef struct ShmReader
+{
+	const struct ShmSegment *segment;
+	uint64_t retries; // Reads that had to start again because the writer was busy
+	int mapped; // 0 when attached to a publisher in the same process
+} ShmReader;
+
+int ShmPublisherOpen (ShmPublisher *publisher, const char *name); // NULL name = private memory; returns 0 on success
+void ShmPublish (ShmPublisher *publisher, ScoreboardState *state); // Sets tick and time_us
+void ShmPublisherClose (ShmPublisher *publisher); // Removes the segment
+
+int ShmReaderOpen (ShmReader *reader, const char *name); // Returns 0 on success
+int ShmReaderAttach (ShmReader *reader, const ShmPublisher *publisher); // Read a publisher in the same process
+int ShmRead (ShmReader *reader, ScoreboardState *state); // Latest consistent state; 0 on success, -1 if nothing published yet
+uint64_t ShmSequence (const ShmReader *reader); // Changes whenever a new state is published
+void ShmReaderClose (ShmReader *reader);
+
+#endif
@@ -0,0 +1,270 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - shared memory benchmark
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Measures the shared memory state (shm.h): a writer thread publishes into a segment of its own
+while reader threads poll it, and every state read is checked for tearing.
+
+	shmbench [--readers N] [--rate HZ] [--seconds S]
+	shmbench --attach NAME [--seconds S]
+
+--rate 0 publishes as fast as possible (default 1000 per second, well above any frame rate).
+Reported: latency from publish to a reader holding the new state, the cost of one read, and how
+often readers had to retry because the writer was busy. --attach only reads a running
+scoreboard's segment (e.g. /scoreboard) and reports the read cost and how old states were.
+
+**************************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "shm.h"
+
+#define LATENCY_BUCKETS 4096 // 50 ns buckets
+#define BUCKET_NS 50
+#define PUBLISH_TIMES 4096 // Ring of publish times, indexed by tick
+
+typedef struct ReaderStats
+{
+	long reads;
+	long new_states;
+	long torn;
+	uint64_t retries;
+	int64_t read_ns; // Total time spent in ShmRead ()
+	int64_t max_latency_ns;
+	int64_t max_age_us; // --attach: how old a state was when read
+	long latency[LATENCY_BUCKETS];
+} ReaderStats;
+
+static ShmPublisher publisher;
+static const char *attach_name = NULL;
+static _Atomic int running = 1;
+static _Atomic int64_t publish_ns[PUBLISH_TIMES];
+
+static void *WriterThread (void *data);
+static void *ReaderThread (void *data);
+static int64_t NowNs (void);
+static int64_t Percentile (const ReaderStats *stats, double fraction);
+
+int main (int argc, char *argv[])
+{
+	int readers = 4;
+	double rate = 1000;
+	double seconds = 5;
+	static struct option long_options[] =
+	{
+		{"readers", required_argument, 0, 'r'},
+		{"rate", required_argument, 0, 'h'},
+		{"seconds", required_argument, 0, 's'},
+		{"attach", required_argument, 0, 'a'},
+		{0, 0, 0, 0}
+	};
+
+	int c;
+	while ((c = getopt_long (argc, argv, "", long_options, NULL)) != -1)
+	{
+		switch (c)
+		{
+			case 'r': readers = atoi (optarg); break;
+			case 'h': rate = atof (optarg); break;
+			case 's': seconds = atof (optarg); break;
+			case 'a': attach_name = optarg; break;
+			default:
+				fprintf (stderr, "usage: %s [--readers N] [--rate HZ] [--seconds S] | --attach NAME [--seconds S]\n", argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+	if (readers < 1 || rate < 0 || seconds <= 0)
+	{
+		fprintf (stderr, "%s: bad option value\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (attach_name)
+		readers = 1;
+
+	pthread_t writer;
+	char name[64];
+	if (!attach_name)
+	{
+		snprintf (name, sizeof (name), "/scoreboard-bench-%d", (int) getpid ());
+		if (ShmPublisherOpen (&publisher, name) != 0)
+		{
+			fprintf (stderr, "%s: could not create shared memory '%s'\n", argv[0], name);
+			return EXIT_FAILURE;
+		}
+		pthread_create (&writer, NULL, WriterThread, &rate);
+	}
+
+	pthread_t *threads = calloc ((size_t) readers, sizeof (pthread_t));
+	ReaderStats *stats = calloc ((size_t) readers, sizeof (ReaderStats));
+	for (int i = 0; i < readers; i++)
+		pthread_create (&threads[i], NULL, ReaderThread, &stats[i]);
+	usleep ((useconds_t) (seconds * 1e6));
+	atomic_store (&running, 0);
+	for (int i = 0; i < readers; i++)
+		pthread_join (threads[i], NULL);
+	if (!attach_name)
+	{
+		pthread_join (writer, NULL);
+		ShmPublisherClose (&publisher);
+	}
+
+	// Everything together
+	ReaderStats total;
+	memset (&total, 0, sizeof (total));
+	for (int i = 0; i < readers; i++)
+	{
+		total.reads += stats[i].reads;
+		total.new_states += stats[i].new_states;
+		total.torn += stats[i].torn;
+		total.retries += stats[i].retries;
+		total.read_ns += stats[i].read_ns;
+		if (stats[i].max_latency_ns > total.max_latency_ns)
+			total.max_latency_ns = stats[i].max_latency_ns;
+		if (stats[i].max_age_us > total.max_age_us)
+			total.max_age_us = stats[i].max_age_us;
+		for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+			total.latency[bucket] += stats[i].latency[bucket];
+	}
+	free (threads);
+	free (stats);
+	if (total.reads == 0)
+	{
+		fprintf (stderr, "%s: nothing was read%s\n", argv[0], attach_name ? " (is the scoreboard running with --shm?)" : "");
+		return EXIT_FAILURE;
+	}
+
+	if (attach_name)
+		printf ("%s: %ld reads, %ld new states, %.1f ns per read, %llu retries, oldest state %.3f ms\n", attach_name,
+			total.reads, total.new_states, (double) total.read_ns / total.reads, (unsigned long long) total.retries, total.max_age_us / 1000.0);
+	else
+	{
+		printf ("%llu states published, %d readers, %ld reads (%ld new states)\n", (unsigned long long) publisher.tick, readers, total.reads, total.new_states);
+		printf ("read: %.1f ns, retries: %llu (%.4f%%), torn states: %ld\n", (double) total.read_ns / total.reads,
+			(unsigned long long) total.retries, 100.0 * (double) total.retries / total.reads, total.torn);
+		printf ("latency: p50 %lld ns, p99 %lld ns, p99.9 %lld ns, max %lld ns\n", (long long) Percentile (&total, 0.5),
+			(long long) Percentile (&total, 0.99), (long long) Percentile (&total, 0.999), (long long) total.max_latency_ns);
+	}
+	return total.torn == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void *WriterThread (void *data)
+{
+	double rate = *(double *) data;
+	int64_t period_ns = rate > 0 ? (int64_t) (1e9 / rate) : 0;
+	int64_t next = NowNs ();
+	ScoreboardState state;
+	memset (&state, 0, sizeof (state));
+
+	while (atomic_load_explicit (&running, memory_order_relaxed))
+	{
+		if (period_ns)
+		{
+			next += period_ns;
+			struct timespec until = {next / 1000000000, next % 1000000000};
+			clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL);
+		}
+		// Fields that must always agree with each other, so a torn read shows
+		int32_t value = (int32_t) (publisher.tick + 1);
+		state.score[0] = value;
+		state.score[1] = value * 3;
+		state.fouls[0] = state.fouls[1] = value;
+		state.main_clock = state.shot_clock = state.timeout_clock = -value;
+		snprintf (state.team_names[0], SHM_NAME_LENGTH, "home %d", value);
+		atomic_store_explicit (&publish_ns[(publisher.tick + 1) % PUBLISH_TIMES], NowNs (), memory_order_relaxed);
+		ShmPublish (&publisher, &state);
+	}
+	return NULL;
+}
+
+static void *ReaderThread (void *data)
+{
+	ReaderStats *stats = data;
+	ShmReader reader;
+	ScoreboardState state;
+	uint64_t last_sequence = 0;
+	char expected[SHM_NAME_LENGTH];
+
+	if (attach_name ? ShmReaderOpen (&reader, attach_name) != 0 : ShmReaderAttach (&reader, &publisher) != 0)
+		return NULL;
+	while (atomic_load_explicit (&running, memory_order_relaxed))
+	{
+		// Readers poll the sequence, which costs one load, and only copy the state when it changed
+		uint64_t sequence = ShmSequence (&reader);
+		if (sequence == last_sequence || (sequence & 1))
+			continue;
+		int64_t start = NowNs ();
+		if (ShmRead (&reader, &state) != 0)
+			continue;
+		int64_t end = NowNs ();
+		stats->reads++;
+		stats->read_ns += end - start;
+		last_sequence = sequence;
+
+		if (attach_name)
+		{
+			stats->new_states++;
+			int64_t age = end / 1000 - state.time_us;
+			if (age > stats->max_age_us)
+				stats->max_age_us = age;
+			continue;
+		}
+		int32_t value = state.score[0];
+		snprintf (expected, sizeof (expected), "home %d", value);
+		if (state.score[1] != value * 3 || state.fouls[0] != value || state.fouls[1] != value ||
+			state.main_clock != -value || state.shot_clock != -value || state.timeout_clock != -value ||
+			strcmp (state.team_names[0], expected) != 0)
+			stats->torn++;
+		stats->new_states++;
+		int64_t latency = end - atomic_load_explicit (&publish_ns[state.tick % PUBLISH_TIMES], memory_order_relaxed);
+		if (latency > stats->max_latency_ns)
+			stats->max_latency_ns = latency;
+		long bucket = (long) (latency / BUCKET_NS);
+		stats->latency[bucket < 0 ? 0 : bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1]++;
+	}
+	stats->retries = reader.retries;
+	ShmReaderClose (&reader);
+	return NULL;
+}
+
+static int64_t Percentile (const ReaderStats *stats, double fraction)
+{
+	long samples = 0, seen = 0;
+	for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+		samples += stats->latency[bucket];
+	for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+	{
+		seen += stats->latency[bucket];
+		if (seen > (long) (samples * fraction))
+			return (int64_t) (bucket + 1) * BUCKET_NS;
+	}
+	return (int64_t) LATENCY_BUCKETS * BUCKET_NS;
+}
+
+static int64_t NowNs (void)
+{
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
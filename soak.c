@@ -0,0 +1,461 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - clock soak test
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Runs simulated games in real time through the same timing path as the frame loop (advance the
+board to CLOCK_MONOTONIC "now", then apply the frame's inputs) while injecting frame stalls,
+scheduler jitter and CPU contention, and checks the main, shot and timeout clocks against
+CLOCK_MONOTONIC the whole time.
+
+	soak [--duration S] [--fps N] [--stall-chance P] [--stall-max MS] [--jitter MS]
+	     [--load N] [--pin] [--seed N] [--max-error US]
+
+For every clock the harness keeps a reference: the exact time left when the clock was last
+started or changed, and the CLOCK_MONOTONIC time of that moment. Reported numbers:
+	display error --- how far behind the number on screen was when the next frame came (stalls)
+	expiry error ---- how late the board reached 0:00.0 compared to the reference
+	drift ----------- time left on the board minus time left by the reference, after each frame
+A frame can only show what the board was when it was drawn, so both errors may be as large as the
+gap to the next frame. The exit status is non-zero if either ever exceeds that gap by more than
+--max-error (default 1000 us). The board and the reference are both run to the same "now", so
+the drift is a consistency check of the harness and libscoreboard's arithmetic rather than a
+measure of timing; it is printed but does not decide the result.
+
+**************************************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include "libscoreboard.h"
+
+#define CLOCKS 3
+#define MAIN 0
+#define SHOT 1
+#define TIMEOUT 2
+#define TENTH_SECOND_US 100000
+#define ERROR_BUCKETS 5001 // Display error histogram, 1 ms buckets
+
+typedef struct Reference
+{
+	int running; // Whether the clock is counting down from the reference
+	int64_t time_us; // CLOCK_MONOTONIC time of the reference
+	int64_t left_us; // Exact time left on the clock at that time
+	int64_t zero_us; // When the clock should stop counting down (only if running)
+	int expired; // Expiry already measured for this reference
+} Reference;
+
+typedef struct ClockStats
+{
+	int64_t max_drift_us;
+	int64_t max_display_error_us;
+	int64_t max_display_excess_us; // Past the gap to the next frame
+	long expiries;
+	int64_t max_expiry_error_us;
+	int64_t max_expiry_excess_us;
+	int64_t total_expiry_error_us;
+	long display_errors[ERROR_BUCKETS];
+	long samples;
+} ClockStats;
+
+typedef enum Phase { PHASE_STOPPED = 0, PHASE_RUNNING, PHASE_TIMEOUT } Phase;
+
+static const char *clock_names[CLOCKS] = {"main", "shot", "timeout"};
+static volatile int load_running = 1;
+
+static int64_t Now (void);
+static void SleepUntil (int64_t time_us);
+static int64_t Random (int64_t low, int64_t high);
+static void *LoadThread (void *data);
+static void PinToFirstCpu (void);
+static int64_t TimeLeft (const ScoreboardView *view, int clock);
+static void Rebase (const ScoreboardView *view, Reference *references, int64_t now);
+static int64_t Expected (const Reference *reference, int64_t now);
+static int64_t Percentile (const ClockStats *stats, double fraction);
+
+int main (int argc, char *argv[])
+{
+	double duration = 3600;
+	int fps = 30;
+	double stall_chance = 0.002; // Per frame
+	int stall_max_ms = 1500;
+	int jitter_ms = 5;
+	int load = 0;
+	int pin = 0;
+	unsigned int seed = (unsigned int) time (NULL);
+	int64_t max_error = 1000;
+	static struct option long_options[] =
+	{
+		{"duration", required_argument, 0, 'd'},
+		{"fps", required_argument, 0, 'f'},
+		{"stall-chance", required_argument, 0, 'c'},
+		{"stall-max", required_argument, 0, 's'},
+		{"jitter", required_argument, 0, 'j'},
+		{"load", required_argument, 0, 'l'},
+		{"pin", no_argument, 0, 'p'},
+		{"seed", required_argument, 0, 'r'},
+		{"max-error", required_argument, 0, 'm'},
+		{0, 0, 0, 0}
+	};
+
+	int c;
+	while ((c = getopt_long (argc, argv, "", long_options, NULL)) != -1)
+	{
+		switch (c)
+		{
+			case 'd': duration = atof (optarg); break;
+			case 'f': fps = atoi (optarg); break;
+			case 'c': stall_chance = atof (optarg); break;
+			case 's': stall_max_ms = atoi (optarg); break;
+			case 'j': jitter_ms = atoi (optarg); break;
+			case 'l': load = atoi (optarg); break;
+			case 'p': pin = 1; break;
+			case 'r': seed = (unsigned int) strtoul (optarg, NULL, 10); break;
+			case 'm': max_error = atoll (optarg); break;
+			default:
+				fprintf (stderr, "usage: %s [--duration S] [--fps N] [--stall-chance P] [--stall-max MS] [--jitter MS] [--load N] [--pin] [--seed N] [--max-error US]\n", argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+	if (fps < 1 || duration <= 0 || stall_max_ms < 1 || jitter_ms < 0 || load < 0)
+	{
+		fprintf (stderr, "%s: bad option value\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	srand (seed);
+	printf ("soak: %.0f s at %d FPS, stall chance %g up to %d ms, jitter %d ms, %d load threads%s, seed %u\n",
+		duration, fps, stall_chance, stall_max_ms, jitter_ms, load, pin ? " (pinned)" : "", seed);
+
+	// CPU contention: busy threads, optionally all on the same CPU as the frame loop
+	if (pin)
+		PinToFirstCpu ();
+	pthread_t *load_threads = calloc ((size_t) load + 1, sizeof (pthread_t));
+	for (int i = 0; i < load; i++)
+		pthread_create (&load_threads[i], NULL, LoadThread, &pin);
+
+	// The board through libscoreboard, as any program embedding it would
+	if (ScoreboardAbiVersion () != SCOREBOARD_ABI_VERSION)
+	{
+		fprintf (stderr, "%s: libscoreboard is ABI version %u, built for %d\n", argv[0], ScoreboardAbiVersion (), SCOREBOARD_ABI_VERSION);
+		return EXIT_FAILURE;
+	}
+	Scoreboard *board = ScoreboardNew (4800, 350, 300, 600);
+	ScoreboardView view;
+	ScoreboardRead (board, &view);
+	Reference references[CLOCKS];
+	ClockStats stats[CLOCKS];
+	memset (stats, 0, sizeof (stats));
+	int shown[CLOCKS] = {view.main_clock, view.shot_clock, view.timeout_clock};
+
+	int64_t frame_us = 1000000 / fps;
+	int64_t start = Now ();
+	int64_t end = start + (int64_t) (duration * 1e6);
+	int64_t last = start;
+	int64_t next_frame = start;
+	int64_t next_report = start + 60000000;
+	int64_t next_event = start + Random (1000000, 3000000);
+	int64_t next_shot_reset = 0;
+	Rebase (&view, references, start);
+	Phase phase = PHASE_STOPPED;
+	long frames = 0, stalls = 0, actions = 0, periods = 1;
+	int64_t worst_frame = 0;
+
+	while (1)
+	{
+		// Frame pacing with injected jitter and stalls
+		next_frame += frame_us;
+		int64_t wake = next_frame + Random (0, (int64_t) jitter_ms * 1000);
+		if ((double) rand () / RAND_MAX < stall_chance)
+		{
+			wake += Random (frame_us, (int64_t) stall_max_ms * 1000);
+			stalls++;
+		}
+		SleepUntil (wake);
+		int64_t now = Now ();
+		if (now >= end)
+			break;
+		if (now - last > worst_frame)
+			worst_frame = now - last;
+		// A stall can make the loop fall behind; do not try to catch up with a burst of frames
+		if (now > next_frame + frame_us)
+			next_frame = now;
+		frames++;
+		int64_t gap = now - last;
+
+		// What was on screen until now, before this frame updates it
+		for (int clock = 0; clock < CLOCKS; clock++)
+		{
+			int64_t expected = Expected (&references[clock], now);
+			int64_t behind = (int64_t) shown[clock] * TENTH_SECOND_US - expected - TENTH_SECOND_US;
+			if (behind < 0)
+				behind = 0;
+			if (behind > stats[clock].max_display_error_us)
+				stats[clock].max_display_error_us = behind;
+			if (references[clock].running)
+			{
+				if (behind - gap > stats[clock].max_display_excess_us)
+					stats[clock].max_display_excess_us = behind - gap;
+				long bucket = (long) (behind / 1000);
+				stats[clock].display_errors[bucket < ERROR_BUCKETS ? bucket : ERROR_BUCKETS - 1]++;
+				stats[clock].samples++;
+			}
+		}
+
+		// Same order as the frame loop: clocks first, then this frame's inputs
+		ScoreboardStep (board, gap, SCOREBOARD_ACTION_NONE);
+		ScoreboardRead (board, &view);
+		last = now;
+
+		for (int clock = 0; clock < CLOCKS; clock++)
+		{
+			Reference *reference = &references[clock];
+			if (!reference->running)
+				continue;
+			int64_t drift = TimeLeft (&view, clock) - Expected (reference, now);
+			if (drift < 0)
+				drift = -drift;
+			if (drift > stats[clock].max_drift_us)
+				stats[clock].max_drift_us = drift;
+			if (!reference->expired && TimeLeft (&view, clock) == 0)
+			{
+				int64_t late = now - reference->zero_us;
+				reference->expired = 1;
+				stats[clock].expiries++;
+				stats[clock].total_expiry_error_us += late;
+				if (late > stats[clock].max_expiry_error_us)
+					stats[clock].max_expiry_error_us = late;
+				if (late - gap > stats[clock].max_expiry_excess_us)
+					stats[clock].max_expiry_excess_us = late - gap;
+			}
+		}
+
+		// Simulated game: runs of play, whistles, shot clock resets, timeouts and new periods
+		int changed = 0;
+		if (phase == PHASE_RUNNING && next_shot_reset != 0 && now >= next_shot_reset && view.shot_clock != 0)
+		{
+			ScoreboardStep (board, 0, SCOREBOARD_ACTION_RESET_SHOT_CLOCK);
+			next_shot_reset = now + Random (5000000, 40000000);
+			changed = 1;
+		}
+		if (now >= next_event)
+		{
+			switch (phase)
+			{
+				case PHASE_STOPPED:
+					if (view.main_clock == 0)
+					{
+						// New period; the harness sets the clock directly instead of typing it in edit mode
+						ScoreboardSetClock (board, SCOREBOARD_CLOCK_MAIN, 4800);
+						periods++;
+					}
+					if (view.shot_clock == 0 || rand () % 2)
+						ScoreboardStep (board, 0, SCOREBOARD_ACTION_RESET_SHOT_CLOCK);
+					if (rand () % 8 == 0)
+					{
+						ScoreboardStep (board, 0, SCOREBOARD_ACTION_SWITCH_SHOT_CLOCK);
+						ScoreboardStep (board, 0, SCOREBOARD_ACTION_RESET_SHOT_CLOCK);
+						ScoreboardStep (board, 0, SCOREBOARD_ACTION_START_STOP_SHOT_CLOCK);
+						phase = PHASE_TIMEOUT;
+						next_event = now + Random (20000000, 40000000);
+					}
+					else
+					{
+						ScoreboardStep (board, 0, SCOREBOARD_ACTION_START_STOP_CLOCKS);
+						phase = PHASE_RUNNING;
+						next_event = now + Random (2000000, 45000000);
+						next_shot_reset = now + Random (5000000, 40000000);
+					}
+					break;
+				case PHASE_RUNNING:
+					ScoreboardStep (board, 0, SCOREBOARD_ACTION_START_STOP_CLOCKS);
+					phase = PHASE_STOPPED;
+					next_event = now + Random (1000000, 10000000);
+					break;
+				case PHASE_TIMEOUT:
+					ScoreboardStep (board, 0, SCOREBOARD_ACTION_START_STOP_SHOT_CLOCK);
+					ScoreboardStep (board, 0, SCOREBOARD_ACTION_SWITCH_SHOT_CLOCK);
+					phase = PHASE_STOPPED;
+					next_event = now + Random (1000000, 5000000);
+					break;
+			}
+			changed = 1;
+		}
+		// The board is exact at "now", so any input starts fresh references
+		if (changed)
+		{
+			ScoreboardRead (board, &view);
+			Rebase (&view, references, now);
+			actions++;
+		}
+		shown[MAIN] = view.main_clock;
+		shown[SHOT] = view.shot_clock;
+		shown[TIMEOUT] = view.timeout_clock;
+
+		if (now >= next_report)
+		{
+			printf ("%6.0f s: %ld frames, %ld stalls, worst frame %.1f ms, display error past gap %lld/%lld/%lld us\n",
+				(now - start) / 1e6, frames, stalls, worst_frame / 1000.0, (long long) stats[MAIN].max_display_excess_us,
+				(long long) stats[SHOT].max_display_excess_us, (long long) stats[TIMEOUT].max_display_excess_us);
+			fflush (stdout);
+			next_report += 60000000;
+		}
+	}
+
+	load_running = 0;
+	for (int i = 0; i < load; i++)
+		pthread_join (load_threads[i], NULL);
+	free (load_threads);
+	ScoreboardFree (board);
+
+	printf ("\n%ld frames, %ld injected stalls, worst frame %.1f ms, %ld inputs, %ld periods\n\n",
+		frames, stalls, worst_frame / 1000.0, actions, periods);
+	printf ("clock     display error p50/p99/max   past gap   expiries   expiry error mean/max   past gap   max drift\n");
+	int64_t worst_excess = 0, worst_drift = 0;
+	for (int clock = 0; clock < CLOCKS; clock++)
+	{
+		ClockStats *s = &stats[clock];
+		printf ("%-8s %6lld / %6lld / %6lld ms   %5lld us   %8ld   %8.1f / %6.1f ms   %5lld us   %6lld us\n", clock_names[clock],
+			(long long) Percentile (s, 0.5), (long long) Percentile (s, 0.99), (long long) (s->max_display_error_us / 1000),
+			(long long) s->max_display_excess_us, s->expiries,
+			s->expiries ? (double) s->total_expiry_error_us / s->expiries / 1000.0 : 0.0, s->max_expiry_error_us / 1000.0,
+			(long long) s->max_expiry_excess_us, (long long) s->max_drift_us);
+		if (s->max_display_excess_us > worst_excess)
+			worst_excess = s->max_display_excess_us;
+		if (s->max_expiry_excess_us > worst_excess)
+			worst_excess = s->max_expiry_excess_us;
+		if (s->max_drift_us > worst_drift)
+			worst_drift = s->max_drift_us;
+	}
+	printf ("\nconsistency check: max drift %lld us between the board and the reference\n", (long long) worst_drift);
+	printf ("%s: display and expiry errors at most %lld us past the frame gap (limit %lld us)\n",
+		worst_excess <= max_error ? "PASS" : "FAIL", (long long) worst_excess, (long long) max_error);
+	return worst_excess <= max_error ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int64_t TimeLeft (const ScoreboardView *view, int clock)
+{
+	// Exact time left: whole tenths on the clock minus the part of the current tenth already gone
+	switch (clock)
+	{
+		case MAIN:
+			return (int64_t) view->main_clock * TENTH_SECOND_US - (view->main_clock ? view->main_clock_elapsed_us : 0);
+		case SHOT:
+			return (int64_t) view->shot_clock * TENTH_SECOND_US - (view->shot_clock ? view->shot_clock_elapsed_us : 0);
+		default:
+			return (int64_t) view->timeout_clock * TENTH_SECOND_US - (view->timeout_clock ? view->timeout_clock_elapsed_us : 0);
+	}
+}
+
+static void Rebase (const ScoreboardView *view, Reference *references, int64_t now)
+{
+	for (int clock = 0; clock < CLOCKS; clock++)
+	{
+		references[clock].time_us = now;
+		references[clock].left_us = TimeLeft (view, clock);
+		references[clock].expired = 0;
+	}
+	// Which clocks the board will run from here
+	int clock_mode = view->mode == SCOREBOARD_MODE_CLOCK, showing = (view->flags & SCOREBOARD_SHOT_SHOWING) != 0;
+	int game_clocks = clock_mode && showing && view->main_clock != 0 && view->shot_clock != 0;
+	references[MAIN].running = game_clocks && (view->flags & SCOREBOARD_MAIN_RUNNING);
+	references[SHOT].running = game_clocks && (view->flags & SCOREBOARD_SHOT_RUNNING);
+	references[TIMEOUT].running = clock_mode && !showing && (view->flags & SCOREBOARD_SHOT_RUNNING) && view->timeout_clock != 0;
+
+	// Both game clocks stop when either of them reaches zero
+	int64_t stop = INT64_MAX;
+	for (int clock = MAIN; clock <= SHOT; clock++)
+		if (references[clock].running && references[clock].left_us < stop)
+			stop = references[clock].left_us;
+	for (int clock = MAIN; clock <= SHOT; clock++)
+	{
+		if (!references[clock].running)
+			continue;
+		references[clock].zero_us = now + stop;
+		// A clock stopped by the other one reaching zero never expires itself
+		if (references[clock].left_us > stop)
+			references[clock].expired = 1;
+	}
+	references[TIMEOUT].zero_us = now + references[TIMEOUT].left_us;
+}
+
+static int64_t Expected (const Reference *reference, int64_t now)
+{
+	if (!reference->running)
+		return reference->left_us;
+	int64_t counting = (now < reference->zero_us ? now : reference->zero_us) - reference->time_us;
+	return reference->left_us - counting;
+}
+
+static int64_t Percentile (const ClockStats *stats, double fraction)
+{
+	if (stats->samples == 0)
+		return 0;
+	long target = (long) (stats->samples * fraction);
+	long seen = 0;
+	for (int bucket = 0; bucket < ERROR_BUCKETS; bucket++)
+	{
+		seen += stats->display_errors[bucket];
+		if (seen > target)
+			return bucket;
+	}
+	return ERROR_BUCKETS - 1;
+}
+
+static void *LoadThread (void *data)
+{
+	if (*(int *) data)
+		PinToFirstCpu ();
+	volatile unsigned long spin = 0;
+	while (load_running)
+		spin++;
+	return NULL;
+}
+
+static void PinToFirstCpu (void)
+{
+	cpu_set_t cpus;
+	CPU_ZERO (&cpus);
+	CPU_SET (0, &cpus);
+	sched_setaffinity (0, sizeof (cpus), &cpus);
+}
+
+static int64_t Random (int64_t low, int64_t high)
+{
+	if (high <= low)
+		return low;
+	return low + (int64_t) ((double) rand () / ((double) RAND_MAX + 1) * (double) (high - low));
+}
+
+static int64_t Now (void)
+{
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static void SleepUntil (int64_t time_us)
+{
+	struct timespec until = {time_us / 1000000, (time_us % 1000000) * 1000};
+	while (clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) != 0)
+		;
+}
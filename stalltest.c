@@ -0,0 +1,218 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - render stall test
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Runs a pretend render thread through the watchdog (watchdog.h) and stalls it, then checks from a
+reader of the published state (shm.h) that the clocks never stopped.
+
+	stalltest [--seconds S] [--fps N] [--stall-ms MS]
+
+The render thread runs the main clock down from S seconds and publishes the board every frame,
+but every 2 seconds it stops for --stall-ms (default 1000), as if stuck in the buffer swap. The
+clock runs out in the middle of the last stall, and the buzzer button is held going into the first.
+Prints how late the published main clock was at worst in going down a tenth, and how late the
+buzzer started after the clock ran out. Fails if a tenth was published more than a frame plus
+WATCHDOG_STALL_MS late, the buzzer more than a frame plus 10 ms, the watchdog stopped a horn it
+had not started, or it touched the horn while the render thread was back in a frame.
+
+**************************************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "watchdog.h"
+
+#define STALL_EVERY_US 2000000
+
+static int fps = 60, stall_ms = 1000;
+static int64_t start_us, end_us;
+static ShmPublisher publisher;
+static Watchdog watchdog;
+static _Atomic int64_t buzzer_us; // When the buzzer was started
+static _Atomic int buzzer_by_watchdog;
+static _Atomic int buzzer_stolen; // Stops of a horn the watchdog had not started
+static _Atomic int in_frame; // The render thread is between WatchdogResume () and WatchdogPublish ()
+static _Atomic int buzzer_overlapped; // The callback ran while it was
+static _Atomic long stalls_seen; // Stalls the render thread was told about
+
+static void *RenderThread (void *data);
+static void Buzzer (int on, void *data);
+static void SleepUntil (int64_t time_us);
+static int64_t Now (void);
+
+int main (int argc, char *argv[])
+{
+	double seconds = 0;
+	static struct option long_options[] =
+	{
+		{"seconds", required_argument, 0, 's'},
+		{"fps", required_argument, 0, 'f'},
+		{"stall-ms", required_argument, 0, 'S'},
+		{0, 0, 0, 0}
+	};
+
+	int c;
+	while ((c = getopt_long (argc, argv, "", long_options, NULL)) != -1)
+	{
+		switch (c)
+		{
+			case 's': seconds = atof (optarg); break;
+			case 'f': fps = atoi (optarg); break;
+			case 'S': stall_ms = atoi (optarg); break;
+			default:
+				fprintf (stderr, "usage: %s [--seconds S] [--fps N] [--stall-ms MS]\n", argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+	// By default the clock runs out halfway through the fourth stall
+	if (seconds == 0)
+		seconds = (3 * STALL_EVERY_US + stall_ms * 500) / 1e6;
+	if (optind < argc || seconds < 1 || fps <= 0 || stall_ms <= WATCHDOG_STALL_MS || stall_ms * 1000 >= STALL_EVERY_US)
+	{
+		fprintf (stderr, "usage: %s [--seconds S] [--fps N] [--stall-ms MS]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	int tenths = (int) (seconds * 10);
+	if (ShmPublisherOpen (&publisher, NULL) != 0 || WatchdogStart (&watchdog, &publisher, Buzzer, NULL, NULL, NULL) != 0)
+	{
+		fprintf (stderr, "%s: could not start the watchdog\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	ShmReader reader;
+	ShmReaderAttach (&reader, &publisher);
+
+	start_us = Now () + 100000;
+	end_us = start_us + (int64_t) tenths * 100000 + 1000000;
+	pthread_t render;
+	pthread_create (&render, NULL, RenderThread, &tenths);
+
+	// Read like the web server would, and see when every tenth the main clock goes down shows up
+	int last = -1;
+	int64_t worst_late_us = 0, out_us = start_us + (int64_t) tenths * 100000;
+	ScoreboardState state;
+	while (Now () < end_us)
+	{
+		if (ShmRead (&reader, &state) == 0 && state.main_clock != last && state.main_clock_running)
+		{
+			int64_t late_us = Now () - (start_us + (int64_t) (tenths - state.main_clock) * 100000);
+			if (last >= 0 && late_us > worst_late_us)
+				worst_late_us = late_us;
+			last = state.main_clock;
+		}
+		usleep (200);
+	}
+	pthread_join (render, NULL);
+	WatchdogStop (&watchdog);
+	ShmReaderClose (&reader);
+	ShmPublisherClose (&publisher);
+
+	int64_t horn_us = atomic_load (&buzzer_us);
+	printf ("%ld stalls of %d ms: tenths published at most %.1f ms late, ", atomic_load (&stalls_seen), stall_ms, worst_late_us / 1000.0);
+	if (horn_us)
+		printf ("buzzer %.3f ms after the clock ran out, started by the %s\n", (horn_us - out_us) / 1000.0, atomic_load (&buzzer_by_watchdog) ? "watchdog" : "render thread");
+	else
+		printf ("buzzer not started\n");
+	if (atomic_load (&buzzer_stolen))
+		printf ("the watchdog stopped a horn the render thread was sounding\n");
+	if (atomic_load (&buzzer_overlapped))
+		printf ("the watchdog sounded the horn while the render thread was back\n");
+	int64_t frame_us = 1000000 / fps;
+	int ok = last == 0 && worst_late_us <= frame_us + WATCHDOG_STALL_MS * 1000 && horn_us >= out_us && horn_us - out_us <= frame_us + 10000 && !atomic_load (&buzzer_stolen) && !atomic_load (&buzzer_overlapped);
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void *RenderThread (void *data)
+{
+	Scoreboard *board = ScoreboardNew (*(int *) data, 300, 300, 600);
+	if (board == NULL)
+		return NULL;
+	ScoreboardStep (board, 0, SCOREBOARD_ACTION_START_STOP_MAIN_CLOCK);
+	SleepUntil (start_us);
+
+	int64_t last_us = start_us, next_stall = start_us + STALL_EVERY_US, period = 1000000 / fps;
+	for (long frame = 0; ; frame++)
+	{
+		WatchdogResume (&watchdog);
+		atomic_store (&in_frame, 1);
+		int64_t now = Now ();
+		if (now >= end_us)
+			break;
+		ScoreboardStep (board, now - last_us, SCOREBOARD_ACTION_NONE);
+		last_us = now;
+		ScoreboardView view;
+		ScoreboardRead (board, &view);
+		ScoreboardState state;
+		memset (&state, 0, sizeof (state));
+		state.main_clock = view.main_clock;
+		state.main_clock_running = (view.flags & SCOREBOARD_MAIN_RUNNING) != 0;
+		state.buzzer = (view.flags & SCOREBOARD_BUZZER) != 0;
+		if (state.buzzer && atomic_load (&buzzer_us) == 0)
+			atomic_store (&buzzer_us, now);
+		// The button held on the frame the first stall starts, so the horn is the render thread's
+		if (now >= next_stall && next_stall == start_us + STALL_EVERY_US)
+			state.buzzer = 1;
+		atomic_store (&in_frame, 0);
+		if (WatchdogPublish (&watchdog, board, now, now, &state) > 0)
+			atomic_fetch_add (&stalls_seen, 1);
+
+		// Stuck in the swap
+		if (now >= next_stall)
+		{
+			usleep ((useconds_t) stall_ms * 1000);
+			next_stall += STALL_EVERY_US;
+		}
+		SleepUntil (start_us + (frame + 1) * period);
+	}
+	ScoreboardFree (board);
+	return NULL;
+}
+
+static void Buzzer (int on, void *data)
+{
+	(void) data;
+	if (atomic_load (&in_frame))
+		atomic_store (&buzzer_overlapped, 1);
+	if (!on && !atomic_load (&buzzer_by_watchdog))
+		atomic_store (&buzzer_stolen, 1);
+	if (on && atomic_load (&buzzer_us) == 0)
+	{
+		atomic_store (&buzzer_us, Now ());
+		atomic_store (&buzzer_by_watchdog, 1);
+	}
+}
+
+static void SleepUntil (int64_t time_us)
+{
+	struct timespec until = {(time_t) (time_us / 1000000), (long) (time_us % 1000000) * 1000};
+	clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL);
+}
+
+static int64_t Now (void)
+{
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
@@ -0,0 +1,335 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - season statistics
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+**************************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "stats.h"
+
+#define COLUMN_MAGIC "SBCOL\x01"
+#define COLUMN_MAGIC_LENGTH 6
+#define MANIFEST_MAGIC "SBSTATS\x01"
+#define MANIFEST_MAGIC_LENGTH 8
+#define MANIFEST_SIZE (MANIFEST_MAGIC_LENGTH + (2 + STATS_COLUMN_COUNT) * 10) // Largest possible manifest
+#define VARINT_SIZE 10 // Bytes in the longest varint
+
+const char *stats_column_names[STATS_COLUMN_COUNT] =
+{
+	"game", "date", "period", "home_points", "visitor_points", "home_fouls", "visitor_fouls", "home_tol", "visitor_tol"
+};
+
+typedef struct Manifest
+{
+	int64_t rows;
+	int64_t games;
+	int64_t lengths[STATS_COLUMN_COUNT]; // Committed bytes of each column file
+} Manifest;
+
+static int ReadManifest (const char *dir, Manifest *manifest);
+static int WriteManifest (const char *dir, const Manifest *manifest);
+static int AppendBlock (const char *dir, int column, int64_t committed, const int64_t *values, int rows, int64_t *length);
+static int DecodeColumn (const char *dir, int column, int64_t length, int64_t rows, int64_t *values);
+static void ColumnPath (char *path, size_t size, const char *dir, int column);
+static size_t PutVarint (uint8_t *buffer, uint64_t value);
+static int GetVarint (const uint8_t **data, const uint8_t *end, uint64_t *value);
+
+void StatsGameStart (StatsGame *game, time_t start)
+{
+	memset (game, 0, sizeof (*game));
+	game->start = start;
+}
+
+void StatsGameTrack (StatsGame *game, const ScoreboardView *view)
+{
+	if (view->period < 0 || view->period >= STATS_PERIODS)
+		return;
+	StatsPeriod *period = &game->periods[view->period];
+	period->played = 1;
+	for (int team = HOME; team <= VISITOR; team++)
+	{
+		period->score[team] = view->score[team];
+		period->fouls[team] = view->fouls[team];
+		period->tol[team] = view->tol[team];
+	}
+}
+
+int StatsGamePlayed (const StatsGame *game)
+{
+	for (int period = 0; period < STATS_PERIODS; period++)
+		if (game->periods[period].score[HOME] || game->periods[period].score[VISITOR])
+			return 1;
+	return 0;
+}
+
+int StatsAppendGame (const char *dir, const StatsGame *game)
+{
+	Manifest manifest;
+	int64_t values[STATS_COLUMN_COUNT][STATS_PERIODS];
+	int rows = 0;
+
+	if (mkdir (dir, 0777) != 0 && errno != EEXIST)
+		return -1;
+	if (ReadManifest (dir, &manifest) != 0)
+		return -1;
+
+	// One row per period played; points are what the score went up by since the period before
+	int previous_score[2] = {0, 0};
+	for (int period = 0; period < STATS_PERIODS; period++)
+	{
+		const StatsPeriod *played = &game->periods[period];
+		if (!played->played)
+			continue;
+		values[STATS_GAME][rows] = manifest.games;
+		values[STATS_DATE][rows] = (int64_t) game->start;
+		values[STATS_PERIOD][rows] = period;
+		values[STATS_HOME_POINTS][rows] = played->score[HOME] - previous_score[HOME];
+		values[STATS_VISITOR_POINTS][rows] = played->score[VISITOR] - previous_score[VISITOR];
+		values[STATS_HOME_FOULS][rows] = played->fouls[HOME];
+		values[STATS_VISITOR_FOULS][rows] = played->fouls[VISITOR];
+		values[STATS_HOME_TOL][rows] = played->tol[HOME];
+		values[STATS_VISITOR_TOL][rows] = played->tol[VISITOR];
+		previous_score[HOME] = played->score[HOME];
+		previous_score[VISITOR] = played->score[VISITOR];
+		rows++;
+	}
+	if (rows == 0)
+		return 0;
+
+	// Columns first, then the manifest that makes them count
+	Manifest updated = manifest;
+	for (int column = 0; column < STATS_COLUMN_COUNT; column++)
+		if (AppendBlock (dir, column, manifest.lengths[column], values[column], rows, &updated.lengths[column]) != 0)
+			return -1;
+	updated.rows += rows;
+	updated.games++;
+	return WriteManifest (dir, &updated);
+}
+
+int StatsOpen (StatsStore *store, const char *dir, unsigned int columns)
+{
+	Manifest manifest;
+
+	memset (store, 0, sizeof (*store));
+	if (ReadManifest (dir, &manifest) != 0)
+		return -1;
+	store->rows = manifest.rows;
+	store->games = manifest.games;
+
+	for (int column = 0; column < STATS_COLUMN_COUNT; column++)
+	{
+		if (!(columns & (1u << column)))
+			continue;
+		store->columns[column] = malloc ((size_t) (manifest.rows ? manifest.rows : 1) * sizeof (int64_t));
+		if (store->columns[column] == NULL || DecodeColumn (dir, column, manifest.lengths[column], manifest.rows, store->columns[column]) != 0)
+		{
+			StatsClose (store);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+void StatsClose (StatsStore *store)
+{
+	for (int column = 0; column < STATS_COLUMN_COUNT; column++)
+	{
+		free (store->columns[column]);
+		store->columns[column] = NULL;
+	}
+}
+
+static int AppendBlock (const char *dir, int column, int64_t committed, const int64_t *values, int rows, int64_t *length)
+{
+	char path[4096];
+	uint8_t data[STATS_PERIODS * VARINT_SIZE];
+	uint8_t block[COLUMN_MAGIC_LENGTH + 2 * VARINT_SIZE + sizeof (data)];
+	size_t data_size = 0, size = 0;
+
+	for (int row = 0; row < rows; row++)
+	{
+		int64_t value = row == 0 ? values[0] : values[row] - values[row - 1];
+		data_size += PutVarint (data + data_size, ((uint64_t) value << 1) ^ (uint64_t) (value >> 63));
+	}
+	if (committed == 0)
+	{
+		memcpy (block, COLUMN_MAGIC, COLUMN_MAGIC_LENGTH);
+		size = COLUMN_MAGIC_LENGTH;
+	}
+	size += PutVarint (block + size, (uint64_t) rows);
+	size += PutVarint (block + size, data_size);
+	memcpy (block + size, data, data_size);
+	size += data_size;
+
+	ColumnPath (path, sizeof (path), dir, column);
+	int fd = open (path, O_WRONLY | O_CREAT, 0666);
+	if (fd < 0)
+		return -1;
+	// Anything past the committed length is from a game that never made it into the manifest
+	int failed = ftruncate (fd, committed) != 0 || pwrite (fd, block, size, committed) != (ssize_t) size || fsync (fd) != 0;
+	close (fd);
+	*length = committed + (int64_t) size;
+	return failed ? -1 : 0;
+}
+
+static int DecodeColumn (const char *dir, int column, int64_t length, int64_t rows, int64_t *values)
+{
+	char path[4096];
+	int64_t decoded = 0;
+
+	if (rows == 0)
+		return 0;
+	ColumnPath (path, sizeof (path), dir, column);
+	int fd = open (path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	struct stat info;
+	if (fstat (fd, &info) != 0 || info.st_size < length || length < COLUMN_MAGIC_LENGTH)
+	{
+		close (fd);
+		return -1;
+	}
+	const uint8_t *map = mmap (NULL, (size_t) length, PROT_READ, MAP_PRIVATE, fd, 0);
+	close (fd);
+	if (map == MAP_FAILED)
+		return -1;
+	madvise ((void *) map, (size_t) length, MADV_SEQUENTIAL);
+
+	const uint8_t *data = map + COLUMN_MAGIC_LENGTH;
+	const uint8_t *end = map + length;
+	int failed = memcmp (map, COLUMN_MAGIC, COLUMN_MAGIC_LENGTH) != 0;
+	while (!failed && data < end)
+	{
+		uint64_t block_rows, block_size, raw;
+		if (GetVarint (&data, end, &block_rows) != 0 || GetVarint (&data, end, &block_size) != 0 ||
+			block_size > (uint64_t) (end - data) || block_rows > (uint64_t) (rows - decoded))
+		{
+			failed = 1;
+			break;
+		}
+		const uint8_t *block_end = data + block_size;
+		int64_t value = 0;
+		for (uint64_t row = 0; row < block_rows; row++)
+		{
+			if (GetVarint (&data, block_end, &raw) != 0)
+			{
+				failed = 1;
+				break;
+			}
+			value += (int64_t) (raw >> 1) ^ -(int64_t) (raw & 1);
+			values[decoded++] = value;
+		}
+		data = block_end;
+	}
+	munmap ((void *) map, (size_t) length);
+	return failed || decoded != rows ? -1 : 0;
+}
+
+static int ReadManifest (const char *dir, Manifest *manifest)
+{
+	char path[4096];
+	uint8_t buffer[MANIFEST_SIZE];
+	uint64_t value;
+
+	memset (manifest, 0, sizeof (*manifest));
+	snprintf (path, sizeof (path), "%s/manifest", dir);
+	FILE *file = fopen (path, "rb");
+	// No manifest yet is an empty store
+	if (file == NULL)
+		return errno == ENOENT ? 0 : -1;
+	size_t size = fread (buffer, 1, sizeof (buffer), file);
+	fclose (file);
+
+	const uint8_t *data = buffer + MANIFEST_MAGIC_LENGTH;
+	const uint8_t *end = buffer + size;
+	if (size < MANIFEST_MAGIC_LENGTH || memcmp (buffer, MANIFEST_MAGIC, MANIFEST_MAGIC_LENGTH) != 0)
+		return -1;
+	if (GetVarint (&data, end, &value) != 0)
+		return -1;
+	manifest->rows = (int64_t) value;
+	if (GetVarint (&data, end, &value) != 0)
+		return -1;
+	manifest->games = (int64_t) value;
+	for (int column = 0; column < STATS_COLUMN_COUNT; column++)
+	{
+		if (GetVarint (&data, end, &value) != 0)
+			return -1;
+		manifest->lengths[column] = (int64_t) value;
+	}
+	return 0;
+}
+
+static int WriteManifest (const char *dir, const Manifest *manifest)
+{
+	char path[4096], temporary[4096];
+	uint8_t buffer[MANIFEST_SIZE];
+	size_t size = MANIFEST_MAGIC_LENGTH;
+
+	memcpy (buffer, MANIFEST_MAGIC, MANIFEST_MAGIC_LENGTH);
+	size += PutVarint (buffer + size, (uint64_t) manifest->rows);
+	size += PutVarint (buffer + size, (uint64_t) manifest->games);
+	for (int column = 0; column < STATS_COLUMN_COUNT; column++)
+		size += PutVarint (buffer + size, (uint64_t) manifest->lengths[column]);
+
+	snprintf (path, sizeof (path), "%s/manifest", dir);
+	snprintf (temporary, sizeof (temporary), "%s/manifest.tmp", dir);
+	int fd = open (temporary, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0)
+		return -1;
+	int failed = write (fd, buffer, size) != (ssize_t) size || fsync (fd) != 0;
+	close (fd);
+	if (failed || rename (temporary, path) != 0)
+		return -1;
+	return 0;
+}
+
+static void ColumnPath (char *path, size_t size, const char *dir, int column)
+{
+	snprintf (path, size, "%s/%s.col", dir, stats_column_names[column]);
+}
+
+static size_t PutVarint (uint8_t *buffer, uint64_t value)
+{
+	size_t size = 0;
+	while (value >= 0x80)
+	{
+		buffer[size++] = (uint8_t) (value & 0x7F) | 0x80;
+		value >>= 7;
+	}
+	buffer[size++] = (uint8_t) value;
+	return size;
+}
+
+static int GetVarint (const uint8_t **data, const uint8_t *end, uint64_t *value)
+{
+	*value = 0;
+	for (int shift = 0; shift < 64 && *data < end; shift += 7)
+	{
+		uint8_t byte = *(*data)++;
+		*value |= (uint64_t) (byte & 0x7F) << shift;
+		if (!(byte & 0x80))
+			return 0;
+	}
+	return -1;
+}
@@ -0,0 +1,93 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - season statistics
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Finished games go into an append-only column store: a directory with one file per column and a
+manifest. There is one row per period played, so season queries only decode the columns they use.
+
+Column file: "SBCOL" 0x01, then one block per appended game:
+	[rows] [data bytes] [first value] [difference to the previous value]...
+All integers are LEB128 varints, values are zigzag encoded. Game numbers, dates and periods barely
+change from row to row, so most values take one byte.
+
+The manifest ("manifest") holds the committed row and game counts and the committed length of
+every column. It is replaced with rename () after the columns are written, so a game that was cut
+off halfway is ignored by readers and cut off the columns by the next writer.
+
+**************************************************************************************************/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <time.h>
+#include "board.h"
+#include "libscoreboard.h"
+
+#define STATS_PERIODS 10 // Periods 0-9, as far as the board goes
+
+typedef enum StatsColumn
+{
+	STATS_GAME = 0, // Game number, from 0
+	STATS_DATE, // Unix seconds when the game started
+	STATS_PERIOD,
+	STATS_HOME_POINTS, // Points scored in the period
+	STATS_VISITOR_POINTS,
+	STATS_HOME_FOULS, // Team fouls when the period ended
+	STATS_VISITOR_FOULS,
+	STATS_HOME_TOL, // Timeouts left when the period ended
+	STATS_VISITOR_TOL,
+	STATS_COLUMN_COUNT
+} StatsColumn;
+
+// Totals last seen in one period
+typedef struct StatsPeriod
+{
+	int played;
+	int score[2];
+	int fouls[2];
+	int tol[2];
+} StatsPeriod;
+
+// One game being followed
+typedef struct StatsGame
+{
+	time_t start;
+	StatsPeriod periods[STATS_PERIODS];
+} StatsGame;
+
+// Decoded columns of a store
+typedef struct StatsStore
+{
+	int64_t rows;
+	int64_t games;
+	int64_t *columns[STATS_COLUMN_COUNT]; // NULL for columns not asked for
+} StatsStore;
+
+extern const char *stats_column_names[STATS_COLUMN_COUNT];
+
+void StatsGameStart (StatsGame *game, time_t start);
+void StatsGameTrack (StatsGame *game, const ScoreboardView *view); // Call after every change to the board
+int StatsGamePlayed (const StatsGame *game); // Whether there is anything worth saving
+int StatsAppendGame (const char *dir, const StatsGame *game); // Returns 0 on success
+
+int StatsOpen (StatsStore *store, const char *dir, unsigned int columns); // Bit mask of (1 << StatsColumn), returns 0 on success
+void StatsClose (StatsStore *store);
+
+#endif
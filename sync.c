@@ -0,0 +1,433 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - clock synchronization
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+**************************************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include "sync.h"
+
+#define SYNC_MAGIC 0x53425301u // "SBS" and the packet version
+#define PACKET_SIZE 32 // magic, sequence, t1, t2, t3
+#define FAST_INTERVAL_US 100000 // Between exchanges while the first SYNC_FIT picks come in
+#define INTERVAL_US 250000 // Between exchanges after that
+#define FIT_MIN_SPAN_US 2000000 // Drift is only fitted over at least this much time
+#define SYNCED_EXCHANGES 4
+
+static void *ServerThread (void *data);
+static void *ClientThread (void *data);
+static void Exchange (SyncClient *client, int64_t t1, int64_t t2, int64_t t3, int64_t t4, uint32_t sequence);
+static int64_t ReadClock (SyncClock clock, void *clock_data);
+static void Put32 (unsigned char *p, uint32_t value);
+static void Put64 (unsigned char *p, int64_t value);
+static uint32_t Get32 (const unsigned char *p);
+static int64_t Get64 (const unsigned char *p);
+
+int SyncServerStart (SyncServer *server, int port, SyncClock clock, void *clock_data)
+{
+	memset (server, 0, sizeof (*server));
+	server->clock = clock;
+	server->clock_data = clock_data;
+
+	struct sockaddr_in address;
+	memset (&address, 0, sizeof (address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl (INADDR_ANY);
+	address.sin_port = htons ((uint16_t) port);
+
+	server->fd = socket (AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	server->stop_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (server->fd < 0 || server->stop_fd < 0 ||
+		bind (server->fd, (struct sockaddr *) &address, sizeof (address)) != 0 ||
+		pthread_create (&server->thread, NULL, ServerThread, server) != 0)
+	{
+		server->thread = 0;
+		SyncServerStop (server);
+		return -1;
+	}
+	return 0;
+}
+
+void SyncServerStop (SyncServer *server)
+{
+	if (server->thread)
+	{
+		uint64_t one = 1;
+		if (write (server->stop_fd, &one, sizeof (one)) == sizeof (one))
+			pthread_join (server->thread, NULL);
+		server->thread = 0;
+	}
+	if (server->fd >= 0)
+		close (server->fd);
+	if (server->stop_fd >= 0)
+		close (server->stop_fd);
+	server->fd = server->stop_fd = -1;
+}
+
+static void *ServerThread (void *data)
+{
+	SyncServer *server = data;
+	struct pollfd fds[2] = {{server->fd, POLLIN, 0}, {server->stop_fd, POLLIN, 0}};
+	unsigned char packet[PACKET_SIZE];
+
+	while (1)
+	{
+		if (poll (fds, 2, -1) < 0 && errno != EINTR)
+			break;
+		if (fds[1].revents)
+			break;
+		if (!(fds[0].revents & POLLIN))
+			continue;
+
+		struct sockaddr_storage from;
+		socklen_t from_size = sizeof (from);
+		ssize_t got = recvfrom (server->fd, packet, sizeof (packet), 0, (struct sockaddr *) &from, &from_size);
+		int64_t t2 = ReadClock (server->clock, server->clock_data);
+		if (got != PACKET_SIZE || Get32 (packet) != SYNC_MAGIC)
+			continue;
+
+		// The request's t1 comes back untouched, so the secondary needs no state to match it
+		Put64 (packet + 16, t2);
+		Put64 (packet + 24, ReadClock (server->clock, server->clock_data));
+		sendto (server->fd, packet, sizeof (packet), 0, (struct sockaddr *) &from, from_size);
+		server->requests++;
+	}
+	return NULL;
+}
+
+int SyncClientStart (SyncClient *client, const char *host, int port, SyncClock clock, void *clock_data)
+{
+	memset (client, 0, sizeof (*client));
+	client->clock = clock;
+	client->clock_data = clock_data;
+	client->fd = client->stop_fd = -1;
+
+	struct addrinfo hints, *found;
+	memset (&hints, 0, sizeof (hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	char service[16];
+	snprintf (service, sizeof (service), "%d", port);
+	if (getaddrinfo (host, service, &hints, &found) != 0)
+		return -1;
+
+	// Connected, so replies from anyone else are dropped by the kernel
+	client->fd = socket (AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	int connected = client->fd >= 0 && connect (client->fd, found->ai_addr, found->ai_addrlen) == 0;
+	freeaddrinfo (found);
+	client->stop_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (!connected || client->stop_fd < 0)
+	{
+		SyncClientStop (client);
+		return -1;
+	}
+
+	pthread_mutex_init (&client->lock, NULL);
+	if (pthread_create (&client->thread, NULL, ClientThread, client) != 0)
+	{
+		client->thread = 0;
+		pthread_mutex_destroy (&client->lock);
+		SyncClientStop (client);
+		return -1;
+	}
+	return 0;
+}
+
+void SyncClientStop (SyncClient *client)
+{
+	if (client->thread)
+	{
+		uint64_t one = 1;
+		if (write (client->stop_fd, &one, sizeof (one)) == sizeof (one))
+			pthread_join (client->thread, NULL);
+		client->thread = 0;
+		pthread_mutex_destroy (&client->lock);
+	}
+	if (client->fd >= 0)
+		close (client->fd);
+	if (client->stop_fd >= 0)
+		close (client->stop_fd);
+	client->fd = client->stop_fd = -1;
+}
+
+int SyncWait (SyncClient *client, int timeout_ms)
+{
+	for (int waited = 0; waited < timeout_ms; waited += 10)
+	{
+		if (SyncGetStatus (client).synced)
+			return 0;
+		usleep (10000);
+	}
+	return SyncGetStatus (client).synced ? 0 : -1;
+}
+
+SyncStatus SyncGetStatus (SyncClient *client)
+{
+	pthread_mutex_lock (&client->lock);
+	SyncStatus status = client->status;
+	pthread_mutex_unlock (&client->lock);
+	return status;
+}
+
+int64_t SyncTime (SyncClient *client, int64_t local_us)
+{
+	SyncStatus status = SyncGetStatus (client);
+	if (!status.synced)
+		return local_us;
+	int64_t target = local_us + (int64_t) (status.offset_us + status.drift_ppm * 1e-6 * (double) (local_us - status.reference_us));
+
+	// The first synced time is taken as it is, wherever it lands
+	if (!client->started)
+	{
+		client->started = 1;
+		client->last_local_us = local_us;
+		client->last_time_us = target;
+		return target;
+	}
+
+	// Run on from the last time returned and close the gap to the estimate a little every frame
+	int64_t elapsed = local_us - client->last_local_us;
+	if (elapsed < 0)
+		elapsed = 0;
+	int64_t time = client->last_time_us + elapsed + (int64_t) (status.drift_ppm * 1e-6 * (double) elapsed);
+	int64_t error = target - time;
+	if (error >= -SYNC_STEP_US)
+		client->behind = 0;
+	else if (!client->behind)
+	{
+		client->behind = 1;
+		client->behind_since_us = local_us;
+	}
+	else if (local_us - client->behind_since_us >= SYNC_BACK_AFTER_US)
+	{
+		// Still far behind after several exchanges: a restarted primary, not a bad one
+		fprintf (stderr, "Clock sync: the primary's time went back %.1f s (restarted?), following it\n", (double) -error / 1e6);
+		client->behind = 0;
+		client->steps_back++;
+		client->last_local_us = local_us;
+		client->last_time_us = target;
+		return target;
+	}
+	if (error > SYNC_STEP_US || error < -SYNC_STEP_US)
+		time = target;
+	else
+	{
+		int64_t limit = (int64_t) (elapsed * SYNC_SLEW);
+		time += error > limit ? limit : error < -limit ? -limit : error;
+	}
+
+	// A big step back holds the time still instead, until it has lasted SYNC_BACK_AFTER_US
+	if (time < client->last_time_us)
+		time = client->last_time_us;
+	client->last_local_us = local_us;
+	client->last_time_us = time;
+	return time;
+}
+
+static void *ClientThread (void *data)
+{
+	SyncClient *client = data;
+	struct pollfd fds[2] = {{client->fd, POLLIN, 0}, {client->stop_fd, POLLIN, 0}};
+	unsigned char packet[PACKET_SIZE];
+	int waiting = 0; // An answer to the last request has not come yet
+	int64_t next_us = ReadClock (client->clock, client->clock_data);
+
+	while (1)
+	{
+		int64_t now = ReadClock (client->clock, client->clock_data);
+		if (now >= next_us)
+		{
+			if (waiting)
+			{
+				pthread_mutex_lock (&client->lock);
+				client->status.lost++;
+				pthread_mutex_unlock (&client->lock);
+			}
+			client->sequence++;
+			Put32 (packet, SYNC_MAGIC);
+			Put32 (packet + 4, client->sequence);
+			Put64 (packet + 8, now);
+			Put64 (packet + 16, 0);
+			Put64 (packet + 24, 0);
+			waiting = send (client->fd, packet, sizeof (packet), 0) == PACKET_SIZE;
+			next_us = now + (client->fit_count < SYNC_FIT ? FAST_INTERVAL_US : INTERVAL_US);
+			continue;
+		}
+
+		if (poll (fds, 2, (int) ((next_us - now + 999) / 1000)) < 0 && errno != EINTR)
+			break;
+		if (fds[1].revents)
+			break;
+		if (!(fds[0].revents & POLLIN))
+			continue;
+
+		ssize_t got = recv (client->fd, packet, sizeof (packet), 0);
+		int64_t t4 = ReadClock (client->clock, client->clock_data);
+
+		// Late answers to older requests are dropped, their delay would be wrong anyway
+		if (got != PACKET_SIZE || Get32 (packet) != SYNC_MAGIC || Get32 (packet + 4) != client->sequence || !waiting)
+			continue;
+		waiting = 0;
+		Exchange (client, Get64 (packet + 8), Get64 (packet + 16), Get64 (packet + 24), t4, client->sequence);
+	}
+	return NULL;
+}
+
+static void Exchange (SyncClient *client, int64_t t1, int64_t t2, int64_t t3, int64_t t4, uint32_t sequence)
+{
+	struct SyncSample sample;
+	sample.local_us = t1 + (t4 - t1) / 2;
+	sample.offset_us = ((t2 - t1) + (t3 - t4)) / 2;
+	sample.delay_us = (t4 - t1) - (t3 - t2);
+	if (sample.delay_us < 0)
+		sample.delay_us = 0;
+	sample.sequence = sequence;
+
+	// Clock filter: trust the quickest of the last few exchanges
+	client->samples[client->sample_count % SYNC_FILTER] = sample;
+	client->sample_count++;
+	int count = client->sample_count < SYNC_FILTER ? client->sample_count : SYNC_FILTER;
+	const struct SyncSample *best = &client->samples[0];
+	for (int i = 1; i < count; i++)
+		if (client->samples[i].delay_us < best->delay_us)
+			best = &client->samples[i];
+	if (client->fit_count > 0 && best->sequence == client->last_fitted)
+	{
+		pthread_mutex_lock (&client->lock);
+		client->status.exchanges++;
+		pthread_mutex_unlock (&client->lock);
+		return;
+	}
+
+	SyncStatus status;
+	pthread_mutex_lock (&client->lock);
+	status = client->status;
+	pthread_mutex_unlock (&client->lock);
+
+	// A pick far off the line is a primary that restarted on another clock: the old picks are of no use
+	double expected_us = status.offset_us + status.drift_ppm * 1e-6 * (double) (best->local_us - status.reference_us);
+	double jump_us = (double) best->offset_us - expected_us;
+	if (status.synced && (jump_us > SYNC_STEP_US || jump_us < -SYNC_STEP_US))
+	{
+		client->samples[0] = *best;
+		best = &client->samples[0];
+		client->sample_count = 1;
+		client->fit_count = 0;
+	}
+
+	client->fit[client->fit_count % SYNC_FIT] = *best;
+	client->fit_count++;
+	client->last_fitted = best->sequence;
+
+	// Least squares line through the picks: the slope is the drift, the middle is the offset
+	int n = client->fit_count < SYNC_FIT ? client->fit_count : SYNC_FIT;
+	int64_t first = best->local_us, last = best->local_us;
+	double mean_x = 0, mean_y = 0;
+	for (int i = 0; i < n; i++)
+	{
+		const struct SyncSample *point = &client->fit[i];
+		if (point->local_us < first)
+			first = point->local_us;
+		if (point->local_us > last)
+			last = point->local_us;
+		mean_x += (double) (point->local_us - best->local_us);
+		mean_y += (double) (point->offset_us - best->offset_us);
+	}
+	mean_x /= n;
+	mean_y /= n;
+
+	if (last - first >= FIT_MIN_SPAN_US)
+	{
+		double sxy = 0, sxx = 0;
+		for (int i = 0; i < n; i++)
+		{
+			double dx = (double) (client->fit[i].local_us - best->local_us) - mean_x;
+			double dy = (double) (client->fit[i].offset_us - best->offset_us) - mean_y;
+			sxy += dx * dy;
+			sxx += dx * dx;
+		}
+		status.drift_ppm = sxx > 0 ? sxy / sxx * 1e6 : 0;
+		status.reference_us = best->local_us + (int64_t) mean_x;
+		status.offset_us = (double) best->offset_us + mean_y;
+	}
+	else
+	{
+		// Too short to tell drift from jitter yet, go by the latest pick
+		status.drift_ppm = 0;
+		status.reference_us = best->local_us;
+		status.offset_us = (double) best->offset_us;
+	}
+	status.delay_us = best->delay_us;
+	status.exchanges++;
+	status.synced = status.exchanges >= SYNCED_EXCHANGES;
+
+	pthread_mutex_lock (&client->lock);
+	status.lost = client->status.lost;
+	client->status = status;
+	pthread_mutex_unlock (&client->lock);
+}
+
+static int64_t ReadClock (SyncClock clock, void *clock_data)
+{
+	if (clock)
+		return clock (clock_data);
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+// Packets are big-endian
+
+static void Put32 (unsigned char *p, uint32_t value)
+{
+	for (int i = 3; i >= 0; i--, value >>= 8)
+		p[i] = (unsigned char) value;
+}
+
+static void Put64 (unsigned char *p, int64_t value)
+{
+	uint64_t bits = (uint64_t) value;
+	for (int i = 7; i >= 0; i--, bits >>= 8)
+		p[i] = (unsigned char) bits;
+}
+
+static uint32_t Get32 (const unsigned char *p)
+{
+	uint32_t value = 0;
+	for (int i = 0; i < 4; i++)
+		value = value << 8 | p[i];
+	return value;
+}
+
+static int64_t Get64 (const unsigned char *p)
+{
+	uint64_t bits = 0;
+	for (int i = 0; i < 8; i++)
+		bits = bits << 8 | p[i];
+	return (int64_t) bits;
+}
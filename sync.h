@@ -0,0 +1,107 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - clock synchronization
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Keeps the time base of several scoreboards (main board, shot clocks over each basket) together.
+One instance is the primary (--sync-serve PORT) and answers UDP requests with its own clock; the
+others (--sync HOST:PORT) ask it a few times a second and run their frames on its time instead of
+their own (see BoardAdvance (), which only ever sees frame times).
+
+Every exchange is four timestamps, like NTP: t1 request sent (secondary), t2 received and t3 reply
+sent (primary), t4 reply received (secondary). Then
+	offset = ((t2 - t1) + (t3 - t4)) / 2        primary clock minus secondary clock
+	delay  = (t4 - t1) - (t3 - t2)              round trip on the wire
+Of the last SYNC_FILTER exchanges only the one with the smallest delay is trusted, since queueing
+only ever adds delay. A line fitted through those offsets over time gives the drift between the two
+crystals, so the time base stays right between exchanges. The first synced SyncTime () steps to
+the primary's time, which may be far from the local one (CLOCK_MONOTONIC starts at boot), so
+callers wait for it with SyncWait () before they start counting. After that it slews towards the
+estimate instead of jumping, and never goes back on its own: when the primary is restarted its
+clock starts somewhere else, and only once the estimate has stayed well behind for
+SYNC_BACK_AFTER_US does SyncTime () step back to it (and say so on stderr), rather than holding
+every secondary's clocks still until the primary catches up.
+
+**************************************************************************************************/
+
+#ifndef SYNC_H
+#define SYNC_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#define SYNC_FILTER 8 // Exchanges the smallest delay is picked from
+#define SYNC_FIT 64 // Picked offsets the drift is fitted over
+#define SYNC_STEP_US 100000 // Errors bigger than this are stepped instead of slewed (first sync)
+#define SYNC_SLEW 0.05 // Fastest slew, in seconds corrected per second
+#define SYNC_BACK_AFTER_US 2000000 // How long the estimate stays over SYNC_STEP_US behind before it is followed back (8 exchanges)
+
+typedef int64_t (*SyncClock) (void *data); // Microseconds; NULL means CLOCK_MONOTONIC
+
+typedef struct SyncServer
+{
+	int fd, stop_fd;
+	pthread_t thread;
+	SyncClock clock;
+	void *clock_data;
+	unsigned long requests;
+} SyncServer;
+
+// Current estimate of the primary's clock, as seen from here
+typedef struct SyncStatus
+{
+	int synced; // Enough exchanges to go by
+	int64_t reference_us; // Local time the estimate is centred on
+	double offset_us; // Primary minus local at reference_us
+	double drift_ppm; // How much faster the primary's clock runs
+	int64_t delay_us; // Round trip of the exchange trusted last
+	unsigned long exchanges, lost;
+} SyncStatus;
+
+typedef struct SyncClient
+{
+	int fd, stop_fd;
+	pthread_t thread;
+	SyncClock clock;
+	void *clock_data;
+	pthread_mutex_t lock; // Guards status
+	SyncStatus status;
+
+	// Owned by the sync thread
+	struct SyncSample { int64_t local_us; int64_t offset_us; int64_t delay_us; uint32_t sequence; } samples[SYNC_FILTER], fit[SYNC_FIT];
+	int sample_count, fit_count;
+	uint32_t sequence, last_fitted;
+
+	// Owned by whoever calls SyncTime ()
+	int64_t last_local_us, last_time_us;
+	int started;
+	int behind; // Estimate more than SYNC_STEP_US behind the time returned, since behind_since_us (local)
+	int64_t behind_since_us;
+	unsigned long steps_back;
+} SyncClient;
+
+int SyncServerStart (SyncServer *server, int port, SyncClock clock, void *clock_data); // Returns 0 on success
+void SyncServerStop (SyncServer *server);
+
+int SyncClientStart (SyncClient *client, const char *host, int port, SyncClock clock, void *clock_data); // Returns 0 on success
+int SyncWait (SyncClient *client, int timeout_ms); // Returns 0 once synced, -1 if the primary did not answer in time
+SyncStatus SyncGetStatus (SyncClient *client);
+int64_t SyncTime (SyncClient *client, int64_t local_us); // The primary's time now, from one thread only; local_us until synced
+void SyncClientStop (SyncClient *client);
+
+#endif
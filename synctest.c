@@ -0,0 +1,340 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - clock synchronization test
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Runs a primary and a secondary (sync.h) in one process over loopback, with a relay in between that
+holds every packet back to simulate a busy venue network.
+
+	synctest [--seconds S] [--delay MS] [--jitter MS] [--asymmetry MS] [--loss P]
+	         [--offset MS] [--drift PPM] [--settle S] [--max-error MS] [--restart S] [--port P] [--seed N]
+
+The primary runs on CLOCK_MONOTONIC. The secondary's clock starts --offset away from it and runs
+--drift parts per million fast, so the exact primary time is always known and the error of
+SyncTime () can be printed twice a second while it converges. Every packet is held back --delay
+plus up to --jitter (uniform), replies another --asymmetry on top; asymmetry can not be seen from
+the secondary and leaves an error of half of it. Fails if the error goes over --max-error after
+--settle seconds. --restart stops the primary after S seconds and starts it again with its clock
+RESTART_BACK_US behind, like one that was rebooted; the secondary has to follow it back exactly
+once, and the error counts again --settle seconds after the restart.
+
+**************************************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "sync.h"
+
+#define HELD_MAX 256 // Packets the relay can hold at once
+#define PACKET_MAX 64
+#define RESTART_BACK_US 30000000 // How far back a restarted primary's clock is
+
+typedef struct HeldPacket
+{
+	int64_t release_us;
+	int to_primary;
+	size_t length;
+	unsigned char data[PACKET_MAX];
+} HeldPacket;
+
+typedef struct Relay
+{
+	int outside_fd; // Where the secondary sends
+	int inside_fd; // Connected to the primary
+	struct sockaddr_in secondary;
+	int64_t delay_us, jitter_us, asymmetry_us;
+	double loss;
+	HeldPacket held[HELD_MAX];
+	int held_count;
+	unsigned long relayed, dropped;
+} Relay;
+
+static _Atomic int relaying = 1;
+static int64_t clock_start_us;
+static int64_t clock_offset_us;
+static double clock_drift_ppm;
+static int64_t primary_back_us; // Only changed while the primary is stopped
+
+static void *RelayThread (void *data);
+static void Hold (Relay *relay, int to_primary, const unsigned char *data, size_t length);
+static int64_t PrimaryClock (void *data);
+static int64_t SecondaryClock (void *data);
+static int64_t Now (void);
+
+int main (int argc, char *argv[])
+{
+	double seconds = 60;
+	double delay_ms = 2, jitter_ms = 5, asymmetry_ms = 0, loss = 0;
+	double offset_ms = 5000, drift_ppm = 50;
+	double settle = 10, max_error_ms = 5, restart = 0;
+	int port = 45678;
+	unsigned int seed = (unsigned int) time (NULL);
+	static struct option long_options[] =
+	{
+		{"seconds", required_argument, 0, 's'},
+		{"delay", required_argument, 0, 'd'},
+		{"jitter", required_argument, 0, 'j'},
+		{"asymmetry", required_argument, 0, 'a'},
+		{"loss", required_argument, 0, 'l'},
+		{"offset", required_argument, 0, 'o'},
+		{"drift", required_argument, 0, 'D'},
+		{"settle", required_argument, 0, 'S'},
+		{"max-error", required_argument, 0, 'm'},
+		{"restart", required_argument, 0, 'R'},
+		{"port", required_argument, 0, 'p'},
+		{"seed", required_argument, 0, 'r'},
+		{0, 0, 0, 0}
+	};
+
+	int c;
+	while ((c = getopt_long (argc, argv, "", long_options, NULL)) != -1)
+	{
+		switch (c)
+		{
+			case 's': seconds = atof (optarg); break;
+			case 'd': delay_ms = atof (optarg); break;
+			case 'j': jitter_ms = atof (optarg); break;
+			case 'a': asymmetry_ms = atof (optarg); break;
+			case 'l': loss = atof (optarg); break;
+			case 'o': offset_ms = atof (optarg); break;
+			case 'D': drift_ppm = atof (optarg); break;
+			case 'S': settle = atof (optarg); break;
+			case 'm': max_error_ms = atof (optarg); break;
+			case 'R': restart = atof (optarg); break;
+			case 'p': port = atoi (optarg); break;
+			case 'r': seed = (unsigned int) strtoul (optarg, NULL, 10); break;
+			default:
+				fprintf (stderr, "usage: %s [--seconds S] [--delay MS] [--jitter MS] [--asymmetry MS] [--loss P]\n"
+					"       [--offset MS] [--drift PPM] [--settle S] [--max-error MS] [--restart S] [--port P] [--seed N]\n", argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+	if (seconds <= 0 || delay_ms < 0 || jitter_ms < 0 || asymmetry_ms < 0 || loss < 0 || loss >= 1 || restart < 0 || restart >= seconds || port < 1 || port > 65534)
+	{
+		fprintf (stderr, "%s: bad option value\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	srand (seed);
+	clock_start_us = Now ();
+	clock_offset_us = (int64_t) (offset_ms * 1000);
+	clock_drift_ppm = drift_ppm;
+
+	// Primary on port, relay on port + 1
+	SyncServer primary;
+	if (SyncServerStart (&primary, port, PrimaryClock, NULL) != 0)
+	{
+		fprintf (stderr, "%s: could not start the primary on port %d\n", argv[0], port);
+		return EXIT_FAILURE;
+	}
+	Relay *relay = calloc (1, sizeof (Relay));
+	relay->delay_us = (int64_t) (delay_ms * 1000);
+	relay->jitter_us = (int64_t) (jitter_ms * 1000);
+	relay->asymmetry_us = (int64_t) (asymmetry_ms * 1000);
+	relay->loss = loss;
+	struct sockaddr_in address;
+	memset (&address, 0, sizeof (address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+	address.sin_port = htons ((uint16_t) (port + 1));
+	relay->outside_fd = socket (AF_INET, SOCK_DGRAM, 0);
+	relay->inside_fd = socket (AF_INET, SOCK_DGRAM, 0);
+	if (bind (relay->outside_fd, (struct sockaddr *) &address, sizeof (address)) != 0)
+	{
+		fprintf (stderr, "%s: could not start the relay on port %d\n", argv[0], port + 1);
+		return EXIT_FAILURE;
+	}
+	address.sin_port = htons ((uint16_t) port);
+	connect (relay->inside_fd, (struct sockaddr *) &address, sizeof (address));
+	pthread_t relay_thread;
+	pthread_create (&relay_thread, NULL, RelayThread, relay);
+
+	SyncClient secondary;
+	if (SyncClientStart (&secondary, "127.0.0.1", port + 1, SecondaryClock, NULL) != 0)
+	{
+		fprintf (stderr, "%s: could not start the secondary\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	printf ("secondary starts %.1f ms off, %+.1f ppm; delay %.1f ms, jitter %.1f ms, asymmetry %.1f ms, loss %.0f%%\n",
+		offset_ms, drift_ppm, delay_ms, jitter_ms, asymmetry_ms, loss * 100);
+	printf ("%7s %12s %12s %10s %10s %10s\n", "time s", "offset ms", "drift ppm", "delay ms", "exchanges", "error ms");
+
+	// A frame every 1/60 s, like the render loop, and a line every half second
+	int64_t start = Now ();
+	int64_t end = start + (int64_t) (seconds * 1e6);
+	int64_t next_line = start;
+	int64_t restart_at = restart > 0 ? start + (int64_t) (restart * 1e6) : end;
+	int64_t settled_from = start + (int64_t) (settle * 1e6);
+	double worst_ms = 0, sum_ms = 0;
+	long settled_frames = 0;
+	while (1)
+	{
+		int64_t now = Now ();
+		if (now >= end)
+			break;
+		if (now >= restart_at)
+		{
+			SyncServerStop (&primary);
+			primary_back_us = RESTART_BACK_US;
+			if (SyncServerStart (&primary, port, PrimaryClock, NULL) != 0)
+			{
+				fprintf (stderr, "%s: could not restart the primary on port %d\n", argv[0], port);
+				return EXIT_FAILURE;
+			}
+			printf ("primary restarted, its clock now %.0f s back\n", RESTART_BACK_US / 1e6);
+			restart_at = end;
+			settled_from = now + (int64_t) (settle * 1e6);
+		}
+		SyncStatus status = SyncGetStatus (&secondary);
+		double error_ms = (SyncTime (&secondary, SecondaryClock (NULL)) - PrimaryClock (NULL)) / 1000.0;
+		if (status.synced && now >= settled_from)
+		{
+			double size = error_ms < 0 ? -error_ms : error_ms;
+			if (size > worst_ms)
+				worst_ms = size;
+			sum_ms += size;
+			settled_frames++;
+		}
+		if (now >= next_line)
+		{
+			if (status.synced)
+				printf ("%7.1f %12.3f %12.2f %10.3f %10lu %10.3f\n", (now - start) / 1e6, status.offset_us / 1000.0,
+					status.drift_ppm, status.delay_us / 1000.0, status.exchanges, error_ms);
+			else
+				printf ("%7.1f %12s %12s %10s %10lu %10s\n", (now - start) / 1e6, "-", "-", "-", status.exchanges, "-");
+			fflush (stdout);
+			next_line += 500000;
+		}
+		usleep (16667);
+	}
+
+	SyncStatus status = SyncGetStatus (&secondary);
+	SyncClientStop (&secondary);
+	atomic_store (&relaying, 0);
+	pthread_join (relay_thread, NULL);
+	SyncServerStop (&primary);
+
+	printf ("%lu exchanges, %lu lost, %lu requests answered, %lu packets relayed, %lu dropped\n",
+		status.exchanges, status.lost, primary.requests, relay->relayed, relay->dropped);
+	printf ("drift estimated %+.2f ppm, actual %+.2f ppm\n", status.drift_ppm, 1e6 / (1 + drift_ppm * 1e-6) - 1e6);
+	unsigned long steps_wanted = restart > 0 ? 1 : 0;
+	printf ("stepped back %lu times (want %lu)\n", secondary.steps_back, steps_wanted);
+	int passed = settled_frames > 0 && worst_ms <= max_error_ms && secondary.steps_back == steps_wanted;
+	if (settled_frames)
+		printf ("after %.0f s: mean error %.3f ms, worst %.3f ms (limit %.1f ms) - %s\n", settle, sum_ms / settled_frames, worst_ms, max_error_ms, passed ? "ok" : "FAILED");
+	else
+		printf ("never settled, run longer than --settle - FAILED\n");
+	free (relay);
+	return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void *RelayThread (void *data)
+{
+	Relay *relay = data;
+	struct pollfd fds[2] = {{relay->outside_fd, POLLIN, 0}, {relay->inside_fd, POLLIN, 0}};
+	unsigned char buffer[PACKET_MAX];
+
+	while (atomic_load (&relaying))
+	{
+		// Send whatever is due, then wait until the next one is or a packet comes in
+		int64_t now = Now ();
+		int64_t next = now + 50000;
+		for (int i = 0; i < relay->held_count; )
+		{
+			HeldPacket *packet = &relay->held[i];
+			if (packet->release_us > now)
+			{
+				if (packet->release_us < next)
+					next = packet->release_us;
+				i++;
+				continue;
+			}
+			if (packet->to_primary)
+				send (relay->inside_fd, packet->data, packet->length, 0);
+			else
+				sendto (relay->outside_fd, packet->data, packet->length, 0, (struct sockaddr *) &relay->secondary, sizeof (relay->secondary));
+			relay->relayed++;
+			*packet = relay->held[--relay->held_count];
+		}
+
+		if (poll (fds, 2, (int) ((next - now + 999) / 1000)) < 0 && errno != EINTR)
+			break;
+		if (fds[0].revents & POLLIN)
+		{
+			socklen_t size = sizeof (relay->secondary);
+			ssize_t got = recvfrom (relay->outside_fd, buffer, sizeof (buffer), 0, (struct sockaddr *) &relay->secondary, &size);
+			if (got > 0)
+				Hold (relay, 1, buffer, (size_t) got);
+		}
+		if (fds[1].revents & POLLIN)
+		{
+			ssize_t got = recv (relay->inside_fd, buffer, sizeof (buffer), 0);
+			if (got > 0)
+				Hold (relay, 0, buffer, (size_t) got);
+		}
+	}
+	return NULL;
+}
+
+static void Hold (Relay *relay, int to_primary, const unsigned char *data, size_t length)
+{
+	if (relay->held_count == HELD_MAX || (double) rand () / RAND_MAX < relay->loss)
+	{
+		relay->dropped++;
+		return;
+	}
+	HeldPacket *packet = &relay->held[relay->held_count++];
+	packet->release_us = Now () + relay->delay_us + (int64_t) ((double) rand () / RAND_MAX * relay->jitter_us);
+	if (!to_primary)
+		packet->release_us += relay->asymmetry_us;
+	packet->to_primary = to_primary;
+	packet->length = length;
+	memcpy (packet->data, data, length);
+}
+
+static int64_t PrimaryClock (void *data)
+{
+	(void) data;
+	return Now () - primary_back_us;
+}
+
+// The secondary's own clock: off by clock_offset_us and running clock_drift_ppm fast
+static int64_t SecondaryClock (void *data)
+{
+	(void) data;
+	int64_t elapsed = Now () - clock_start_us;
+	return clock_start_us + clock_offset_us + elapsed + (int64_t) (elapsed * clock_drift_ppm * 1e-6);
+}
+
+static int64_t Now (void)
+{
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
@@ -0,0 +1,282 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - terminal board
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+**************************************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "term.h"
+#include "digit.h"
+
+// raylib's colours, as the window draws them
+#define WHITE 255, 255, 255
+#define BLACK 0, 0, 0
+#define RED 230, 41, 55
+#define GREEN 0, 228, 48
+#define GOLD 255, 203, 0
+#define ORANGE 255, 161, 0
+#define YELLOW 253, 249, 0
+#define DARKBLUE 0, 82, 172
+#define DARKDARKGRAY 25, 25, 25
+
+static void Rect (TermScreen *screen, int x, int y, int width, int height, unsigned char color);
+static void Box (TermScreen *screen, int x, int y, int width, int height, unsigned char ring);
+static void Digit (TermScreen *screen, int digit, int x, int y, unsigned char color, int use_all);
+static void Text (TermScreen *screen, const char *text, int center_x, int row);
+static unsigned char Palette (int r, int g, int b);
+
+void TermInit (TermScreen *screen)
+{
+	memset (screen, 0, sizeof (*screen));
+	screen->sgr_fg = screen->sgr_bg = -1;
+}
+
+void TermRedraw (TermScreen *screen)
+{
+	screen->front_valid = 0;
+}
+
+void TermDrawBoard (TermScreen *screen, const ScoreboardState *state)
+{
+	// Same layout as the window with border = 1 unit, 96 x 54 units, rounded to whole units
+	unsigned char dark = Palette (DARKDARKGRAY);
+	Rect (screen, 0, 0, TERM_COLUMNS, TERM_ROWS * 2, Palette (WHITE));
+	Rect (screen, 1, 1, TERM_COLUMNS - 2, TERM_ROWS * 2 - 2, Palette (DARKBLUE));
+
+	// Main clock
+	unsigned char red = Palette (RED);
+	int main_clock = state->main_clock;
+	Box (screen, 33, 1, 30, 11, state->main_clock_running ? Palette (WHITE) : red);
+	if (state->main_clock_tenths)
+	{
+		Digit (screen, main_clock / 100 % 6 == 0 ? -1 : main_clock / 100 % 6, 34, 2, red, 1);
+		Digit (screen, main_clock / 10 % 10, 41, 2, red, 1);
+		Digit (screen, main_clock % 10, 50, 2, red, 1);
+		Digit (screen, -1, 57, 2, red, 1);
+		Rect (screen, 47, 4, 1, 1, dark);
+	}
+	else
+	{
+		Digit (screen, main_clock / 6000 == 0 ? -1 : main_clock / 6000, 34, 2, red, 1);
+		Digit (screen, main_clock / 600 % 10, 41, 2, red, 1);
+		Digit (screen, main_clock / 100 % 6, 50, 2, red, 1);
+		Digit (screen, main_clock / 10 % 10, 57, 2, red, 1);
+		Rect (screen, 47, 4, 1, 1, red);
+	}
+	Rect (screen, 47, 8, 1, 1, red);
+
+	// Shot clock, or the timeout clock in gold
+	unsigned char shot_color = Palette (GREEN);
+	if (!state->shot_clock_showing)
+		shot_color = Palette (GOLD);
+	int shot_clock = state->shot_clock_showing ? state->shot_clock : state->timeout_clock;
+	Box (screen, 41, 38, 15, 11, state->shot_clock_running ? Palette (WHITE) : shot_color);
+	if (!state->shot_clock_enabled)
+	{
+		Digit (screen, -1, 42, 39, shot_color, 1);
+		Digit (screen, -1, 50, 39, shot_color, 1);
+		Rect (screen, 48, 46, 1, 1, dark);
+	}
+	else if (state->shot_clock_tenths)
+	{
+		Digit (screen, shot_clock / 10 % 10, 42, 39, shot_color, 1);
+		Digit (screen, shot_clock % 10, 50, 39, shot_color, 1);
+		Rect (screen, 48, 46, 1, 1, shot_color);
+	}
+	else
+	{
+		Digit (screen, shot_clock / 100, 42, 39, shot_color, 1);
+		Digit (screen, shot_clock / 10 % 10, 50, 39, shot_color, 1);
+		Rect (screen, 48, 46, 1, 1, dark);
+	}
+
+	// Period
+	Box (screen, 45, 21, 7, 11, Palette (WHITE));
+	Digit (screen, state->period, 46, 22, Palette (ORANGE), 1);
+
+	// Scores, fouls and TOL, home on the left
+	static const int score_x[2] = {8, 71}, label_x[2] = {16, 79}, fouls_x[2] = {8, 77}, tol_x[2] = {23, 65};
+	for (int team = 0; team < 2; team++)
+	{
+		int score = state->score[team], fouls = state->fouls[team];
+		Box (screen, score_x[team], 14, 16, 11, Palette (WHITE));
+		Digit (screen, score / 100, score_x[team] - 3, 15, Palette (GOLD), 0);
+		Digit (screen, score < 10 ? -1 : score % 100 / 10, score_x[team] + 4, 15, Palette (GOLD), 1);
+		Digit (screen, score % 10, score_x[team] + 10, 15, Palette (GOLD), 1);
+
+		Box (screen, fouls_x[team], 34, 10, 11, Palette (WHITE));
+		Digit (screen, fouls < 10 ? -1 : fouls % 100 / 10, fouls_x[team] - 3, 35, Palette (YELLOW), 0);
+		Digit (screen, fouls % 10, fouls_x[team] + 4, 35, Palette (YELLOW), 1);
+
+		Box (screen, tol_x[team], 34, 7, 11, Palette (WHITE));
+		Digit (screen, state->tol[team], tol_x[team] + 1, 35, Palette (YELLOW), 1);
+	}
+
+	// Two pixels a cell, then the labels over them
+	for (int row = 0; row < TERM_ROWS; row++)
+		for (int column = 0; column < TERM_COLUMNS; column++)
+		{
+			TermCell *cell = &screen->back[row][column];
+			unsigned char top = screen->pixels[row * 2][column], bottom = screen->pixels[row * 2 + 1][column];
+			memset (cell, 0, sizeof (*cell));
+			cell->bg = bottom;
+			if (top == bottom)
+			{
+				cell->glyph[0] = ' ';
+				cell->any_fg = 1;
+			}
+			else
+			{
+				memcpy (cell->glyph, "\xe2\x96\x80", 3); // Upper half block
+				cell->fg = top;
+			}
+		}
+	for (int team = 0; team < 2; team++)
+	{
+		char name[SHM_NAME_LENGTH];
+		memcpy (name, state->team_names[team], SHM_NAME_LENGTH);
+		name[SHM_NAME_LENGTH - 1] = '\0';
+		Text (screen, name, label_x[team], 2);
+		Text (screen, "FOULS", fouls_x[team] + 5, 14);
+		Text (screen, "T.O.L.", tol_x[team] + 4, 14);
+	}
+	Text (screen, "PERIOD", 48, 9);
+}
+
+size_t TermFlush (TermScreen *screen, char *out)
+{
+	char *p = out;
+	if (!screen->front_valid)
+	{
+		p += sprintf (p, "\033[0m\033[2J");
+		screen->sgr_fg = screen->sgr_bg = -1;
+	}
+
+	int cursor_row = -1, cursor_column = -1; // -1 = not known
+	for (int row = 0; row < TERM_ROWS; row++)
+		for (int column = 0; column < TERM_COLUMNS; column++)
+		{
+			TermCell *cell = &screen->back[row][column];
+			if (screen->front_valid && memcmp (cell, &screen->front[row][column], sizeof (*cell)) == 0)
+				continue;
+
+			// Move only when the last cell written is not the one before this one
+			if (cursor_row == row && column > cursor_column)
+				p += sprintf (p, "\033[%dC", column - cursor_column);
+			else if (cursor_row != row || cursor_column != column)
+				p += sprintf (p, "\033[%d;%dH", row + 1, column + 1);
+
+			int set_fg = !cell->any_fg && cell->fg != screen->sgr_fg;
+			int set_bg = cell->bg != screen->sgr_bg;
+			if (set_fg && set_bg)
+				p += sprintf (p, "\033[38;5;%d;48;5;%dm", cell->fg, cell->bg);
+			else if (set_fg)
+				p += sprintf (p, "\033[38;5;%dm", cell->fg);
+			else if (set_bg)
+				p += sprintf (p, "\033[48;5;%dm", cell->bg);
+			if (set_fg)
+				screen->sgr_fg = cell->fg;
+			if (set_bg)
+				screen->sgr_bg = cell->bg;
+
+			size_t length = strnlen (cell->glyph, sizeof (cell->glyph));
+			memcpy (p, cell->glyph, length);
+			p += length;
+			screen->front[row][column] = *cell;
+
+			// After the last column terminals differ on where the cursor is
+			cursor_row = column + 1 < TERM_COLUMNS ? row : -1;
+			cursor_column = column + 1;
+		}
+	screen->front_valid = 1;
+	screen->bytes += (unsigned long) (p - out);
+	screen->flushes++;
+	return (size_t) (p - out);
+}
+
+static void Rect (TermScreen *screen, int x, int y, int width, int height, unsigned char color)
+{
+	for (int row = y < 0 ? 0 : y; row < y + height && row < TERM_ROWS * 2; row++)
+		for (int column = x < 0 ? 0 : x; column < x + width && column < TERM_COLUMNS; column++)
+			screen->pixels[row][column] = color;
+}
+
+static void Box (TermScreen *screen, int x, int y, int width, int height, unsigned char ring)
+{
+	Rect (screen, x - 1, y - 1, width + 2, height + 2, ring);
+	Rect (screen, x, y, width, height, Palette (BLACK));
+}
+
+static void Digit (TermScreen *screen, int digit, int x, int y, unsigned char color, int use_all)
+{
+	unsigned int lit = DigitLitParts (digit, use_all);
+	unsigned char dark = Palette (DARKDARKGRAY);
+	for (int part = 0; part < DIGIT_PART_COUNT; part++)
+		if (DigitPartShown (part, use_all))
+		{
+			DigitRect rect = DigitPartRect (part);
+			Rect (screen, x + rect.x, y + rect.y, rect.width, rect.height, (lit & (1u << part)) ? color : dark);
+		}
+}
+
+static void Text (TermScreen *screen, const char *text, int center_x, int row)
+{
+	// Printable ASCII only, anything else would throw the columns off
+	int length = (int) strlen (text);
+	int column = center_x - length / 2;
+	unsigned char white = Palette (WHITE);
+	for (int i = 0; i < length; i++, column++)
+	{
+		if (column < 0 || column >= TERM_COLUMNS)
+			continue;
+		TermCell *cell = &screen->back[row][column];
+		memset (cell->glyph, 0, sizeof (cell->glyph));
+		cell->glyph[0] = (text[i] >= ' ' && text[i] < 127) ? text[i] : '?';
+		cell->fg = white;
+		cell->any_fg = 0;
+		cell->bg = screen->pixels[row * 2][column];
+	}
+}
+
+static unsigned char Palette (int r, int g, int b)
+{
+	// Nearest of the 6 x 6 x 6 colour cube (16-231) and the gray ramp (232-255)
+	static const int levels[6] = {0, 95, 135, 175, 215, 255};
+	int rgb[3] = {r, g, b}, index[3];
+	for (int i = 0; i < 3; i++)
+	{
+		index[i] = 0;
+		for (int level = 1; level < 6; level++)
+			if (abs (rgb[i] - levels[level]) < abs (rgb[i] - levels[index[i]]))
+				index[i] = level;
+	}
+	int cube_distance = 0;
+	for (int i = 0; i < 3; i++)
+		cube_distance += (rgb[i] - levels[index[i]]) * (rgb[i] - levels[index[i]]);
+
+	int gray = ((r + g + b) / 3 - 8 + 5) / 10;
+	gray = gray < 0 ? 0 : gray > 23 ? 23 : gray;
+	int gray_level = 8 + gray * 10, gray_distance = 0;
+	for (int i = 0; i < 3; i++)
+		gray_distance += (rgb[i] - gray_level) * (rgb[i] - gray_level);
+
+	if (gray_distance < cube_distance)
+		return (unsigned char) (232 + gray);
+	return (unsigned char) (16 + index[0] * 36 + index[1] * 6 + index[2]);
+}
@@ -0,0 +1,65 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - terminal board
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Draws the board in a terminal, for watching over SSH or on a text console. The layout is the
+window's at one unit per column, TERM_COLUMNS x TERM_ROWS, with the same digits (digit.h) and
+colours. Each character cell is two pixels stacked, drawn as an upper half block with the top
+pixel as foreground and the bottom one as background, in the 256 colour palette.
+
+TermDrawBoard () draws into the back buffer. TermFlush () compares it with what the terminal shows
+and writes only the cells that changed: a cursor move where the changed cells are not next to each
+other, a colour change only when the colour differs from the last one written. A tenth of a second
+on the main clock is one digit, a few hundred bytes.
+
+**************************************************************************************************/
+
+#ifndef TERM_H
+#define TERM_H
+
+#include <stddef.h>
+#include "shm.h"
+
+#define TERM_COLUMNS 96
+#define TERM_ROWS 27
+#define TERM_OUTPUT_MAX (TERM_COLUMNS * TERM_ROWS * 32) // Worst case of a full redraw
+
+typedef struct TermCell
+{
+	char glyph[4]; // UTF-8, zero terminated unless 4 bytes long
+	unsigned char fg, bg; // Palette indices
+	unsigned char any_fg; // Glyph is a space, the foreground does not matter
+} TermCell;
+
+typedef struct TermScreen
+{
+	unsigned char pixels[TERM_ROWS * 2][TERM_COLUMNS];
+	TermCell back[TERM_ROWS][TERM_COLUMNS]; // Being drawn
+	TermCell front[TERM_ROWS][TERM_COLUMNS]; // On the terminal
+	int front_valid; // 0 = everything is written on the next flush
+	int sgr_fg, sgr_bg; // Colours the terminal is set to, -1 = not known
+	unsigned long bytes, flushes; // Written so far
+} TermScreen;
+
+void TermInit (TermScreen *screen);
+void TermDrawBoard (TermScreen *screen, const ScoreboardState *state);
+size_t TermFlush (TermScreen *screen, char *out); // Returns bytes written to out, at most TERM_OUTPUT_MAX
+void TermRedraw (TermScreen *screen); // Next flush clears and writes everything, e.g. after a resize
+
+#endif
@@ -0,0 +1,242 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - terminal board
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Shows a running scoreboard's board (--shm NAME) in the terminal (term.h), over SSH or on a text
+console of the same machine.
+
+	termboard [--rate HZ] [--seconds S] [--stats] NAME
+	termboard --demo [--rate HZ] [--seconds S] [--stats]
+
+--demo shows a simulated game instead. --stats prints what was written when it stops, with
+Ctrl-C or after --seconds. The terminal needs UTF-8, 256 colours and 96 x 27 characters.
+
+**************************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/ioctl.h>
+#include "shm.h"
+#include "term.h"
+
+static volatile sig_atomic_t interrupted = 0;
+static volatile sig_atomic_t resized = 1;
+static ShmPublisher publisher;
+static _Atomic int playing = 1;
+
+static int FitsTerminal (void);
+static void WriteAll (const char *data, size_t length);
+static void *GameThread (void *data);
+static void OnInterrupt (int signal_number);
+static void OnResize (int signal_number);
+static int64_t Now (void);
+
+int main (int argc, char *argv[])
+{
+	int demo = 0, stats = 0;
+	double rate = 20, seconds = 0;
+	static struct option long_options[] =
+	{
+		{"demo", no_argument, 0, 'd'},
+		{"rate", required_argument, 0, 'r'},
+		{"seconds", required_argument, 0, 's'},
+		{"stats", no_argument, 0, 'S'},
+		{0, 0, 0, 0}
+	};
+
+	int c;
+	while ((c = getopt_long (argc, argv, "", long_options, NULL)) != -1)
+	{
+		switch (c)
+		{
+			case 'd': demo = 1; break;
+			case 'r': rate = atof (optarg); break;
+			case 's': seconds = atof (optarg); break;
+			case 'S': stats = 1; break;
+			default:
+				fprintf (stderr, "usage: %s [--rate HZ] [--seconds S] [--stats] NAME\n       %s --demo [--rate HZ] [--seconds S] [--stats]\n", argv[0], argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+	if (demo == (optind < argc) || rate <= 0 || seconds < 0)
+	{
+		fprintf (stderr, "usage: %s [--rate HZ] [--seconds S] [--stats] NAME\n       %s --demo [--rate HZ] [--seconds S] [--stats]\n", argv[0], argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	ShmReader reader;
+	pthread_t game;
+	if (demo)
+	{
+		if (ShmPublisherOpen (&publisher, NULL) != 0)
+			return EXIT_FAILURE;
+		ShmReaderAttach (&reader, &publisher);
+		pthread_create (&game, NULL, GameThread, NULL);
+	}
+	else if (ShmReaderOpen (&reader, argv[optind]) != 0)
+	{
+		fprintf (stderr, "%s: no scoreboard publishing to '%s' (start it with --shm %s)\n", argv[0], argv[optind], argv[optind]);
+		return EXIT_FAILURE;
+	}
+
+	signal (SIGINT, OnInterrupt);
+	signal (SIGTERM, OnInterrupt);
+	signal (SIGWINCH, OnResize);
+	WriteAll ("\033[?25l", 6); // Hide the cursor
+
+	static TermScreen screen;
+	static char output[TERM_OUTPUT_MAX];
+	TermInit (&screen);
+	uint64_t shown_sequence = 0;
+	int fits = 1;
+	unsigned long updates = 0, first = 0, largest = 0;
+	int64_t start = Now ();
+	while (!interrupted && (seconds == 0 || Now () - start < (int64_t) (seconds * 1e6)))
+	{
+		if (resized)
+		{
+			resized = 0;
+			fits = FitsTerminal ();
+			TermRedraw (&screen);
+			if (!fits)
+			{
+				const char *message = "\033[0m\033[2J\033[Hmake the terminal at least 96 x 27";
+				WriteAll (message, strlen (message));
+			}
+		}
+
+		// Only when something was published, and only the cells that changed
+		ScoreboardState state;
+		uint64_t sequence = ShmSequence (&reader);
+		if (fits && (sequence != shown_sequence || !screen.front_valid) && ShmRead (&reader, &state) == 0)
+		{
+			shown_sequence = sequence;
+			TermDrawBoard (&screen, &state);
+			size_t length = TermFlush (&screen, output);
+			if (length > 0)
+			{
+				WriteAll (output, length);
+				if (updates++ == 0)
+					first = length;
+				else if (length > largest)
+					largest = length;
+			}
+		}
+		usleep ((useconds_t) (1e6 / rate));
+	}
+
+	WriteAll ("\033[0m\033[?25h\033[28;1H\n", 18);
+	if (demo)
+	{
+		atomic_store (&playing, 0);
+		pthread_join (game, NULL);
+	}
+	ShmReaderClose (&reader);
+	if (demo)
+		ShmPublisherClose (&publisher);
+
+	if (stats)
+	{
+		double elapsed = (Now () - start) / 1e6;
+		fprintf (stderr, "%lu updates in %.1f s, %lu bytes (%.0f bytes/s); after the first, %.0f bytes per update on average, %lu at most\n",
+			updates, elapsed, screen.bytes, screen.bytes / elapsed, updates > 1 ? (double) (screen.bytes - first) / (updates - 1) : 0.0, largest);
+	}
+	return EXIT_SUCCESS;
+}
+
+static int FitsTerminal (void)
+{
+	// Not a terminal (redirected to a file): write the board anyway
+	struct winsize size;
+	if (ioctl (STDOUT_FILENO, TIOCGWINSZ, &size) != 0 || size.ws_col == 0)
+		return 1;
+	return size.ws_col >= TERM_COLUMNS && size.ws_row >= TERM_ROWS;
+}
+
+static void WriteAll (const char *data, size_t length)
+{
+	while (length > 0)
+	{
+		ssize_t written = write (STDOUT_FILENO, data, length);
+		if (written <= 0)
+			return;
+		data += written;
+		length -= (size_t) written;
+	}
+}
+
+static void *GameThread (void *data)
+{
+	(void) data;
+	ScoreboardState state;
+	memset (&state, 0, sizeof (state));
+	state.main_clock = 4800;
+	state.shot_clock = 350;
+	state.timeout_clock = 300;
+	state.main_clock_running = state.shot_clock_running = 1;
+	state.shot_clock_showing = state.shot_clock_enabled = 1;
+	state.tol[0] = state.tol[1] = 5;
+	state.period = 1;
+	strcpy (state.team_names[0], "HOME");
+	strcpy (state.team_names[1], "VISITOR");
+
+	// A frame every 1/60 s, the clocks going down a tenth every 100 ms, a basket or foul now and then
+	int64_t start = Now ();
+	for (long frame = 0; atomic_load (&playing); frame++)
+	{
+		int64_t tenths = (Now () - start) / 100000;
+		state.main_clock = (int32_t) (4800 - tenths % 4800);
+		state.shot_clock = (int32_t) (350 - tenths % 350);
+		state.main_clock_tenths = state.main_clock < 600;
+		state.shot_clock_tenths = state.shot_clock < 100;
+		if (frame % 300 == 0)
+			state.score[frame / 300 % 2] += 2;
+		if (frame % 900 == 0)
+			state.fouls[frame / 900 % 2]++;
+		ShmPublish (&publisher, &state);
+		usleep (16667);
+	}
+	return NULL;
+}
+
+static void OnInterrupt (int signal_number)
+{
+	(void) signal_number;
+	interrupted = 1;
+}
+
+static void OnResize (int signal_number)
+{
+	(void) signal_number;
+	resized = 1;
+}
+
+static int64_t Now (void)
+{
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
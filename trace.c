@@ -0,0 +1,231 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - input traces
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+**************************************************************************************************/
+
+#include <string.h>
+#include <time.h>
+#include "trace.h"
+
+#define TRACE_MAGIC "SBTRACE\x01"
+#define TRACE_MAGIC_LENGTH 8
+#define TRACE_FLUSH_US 1000000 // Flush at most once a second so a crash loses little
+
+static void WriteVarint (FILE *file, uint64_t value);
+static void WriteSigned (FILE *file, int64_t value);
+static int ReadVarint (FILE *file, uint64_t *value);
+static int ReadSigned (FILE *file, int *value);
+static void WriteRecord (TraceWriter *writer, int64_t time_us, int type);
+
+int TraceOpen (TraceWriter *writer, const char *path, int main_clock_start, int shot_clock_reset, int timeout_short, int timeout_long, int64_t start_us)
+{
+	writer->file = fopen (path, "wb");
+	if (writer->file == NULL)
+		return -1;
+	writer->last_us = start_us;
+	writer->flushed_us = start_us;
+
+	fwrite (TRACE_MAGIC, 1, TRACE_MAGIC_LENGTH, writer->file);
+	WriteVarint (writer->file, (uint64_t) time (NULL));
+	WriteSigned (writer->file, main_clock_start);
+	WriteSigned (writer->file, shot_clock_reset);
+	WriteSigned (writer->file, timeout_short);
+	WriteSigned (writer->file, timeout_long);
+	return 0;
+}
+
+void TraceRecord (TraceWriter *writer, int64_t time_us, int type)
+{
+	WriteRecord (writer, time_us, type);
+}
+
+void TraceRecordResetTimes (TraceWriter *writer, int64_t time_us, int shot_clock_reset, int timeout_short, int timeout_long)
+{
+	WriteRecord (writer, time_us, TRACE_RESET_TIMES);
+	WriteSigned (writer->file, shot_clock_reset);
+	WriteSigned (writer->file, timeout_short);
+	WriteSigned (writer->file, timeout_long);
+}
+
+void TraceRecordWhistle (TraceWriter *writer, int64_t time_us, int ago_us)
+{
+	WriteRecord (writer, time_us, TRACE_WHISTLE);
+	WriteSigned (writer->file, ago_us);
+}
+
+void TraceClose (TraceWriter *writer, const ScoreboardView *view, int64_t end_us)
+{
+	TraceSummary summary;
+	TraceSummarize (view, &summary);
+
+	WriteRecord (writer, end_us, TRACE_END);
+	for (int team = HOME; team <= VISITOR; team++)
+	{
+		WriteSigned (writer->file, summary.score[team]);
+		WriteSigned (writer->file, summary.fouls[team]);
+		WriteSigned (writer->file, summary.tol[team]);
+	}
+	WriteSigned (writer->file, summary.period);
+	WriteSigned (writer->file, summary.main_clock);
+	WriteSigned (writer->file, summary.shot_clock);
+	WriteSigned (writer->file, summary.timeout_clock);
+	fclose (writer->file);
+	writer->file = NULL;
+}
+
+int TraceReaderOpen (TraceReader *reader, const char *path)
+{
+	char magic[TRACE_MAGIC_LENGTH];
+	uint64_t start_time;
+
+	memset (reader, 0, sizeof (*reader));
+	reader->file = fopen (path, "rb");
+	if (reader->file == NULL)
+		return -1;
+	if (fread (magic, 1, TRACE_MAGIC_LENGTH, reader->file) != TRACE_MAGIC_LENGTH || memcmp (magic, TRACE_MAGIC, TRACE_MAGIC_LENGTH) != 0 ||
+		ReadVarint (reader->file, &start_time) != 0 ||
+		ReadSigned (reader->file, &reader->main_clock_start) != 0 ||
+		ReadSigned (reader->file, &reader->shot_clock_reset) != 0 ||
+		ReadSigned (reader->file, &reader->timeout_short) != 0 ||
+		ReadSigned (reader->file, &reader->timeout_long) != 0)
+	{
+		TraceReaderClose (reader);
+		return -1;
+	}
+	reader->start_time = (int64_t) start_time;
+	return 0;
+}
+
+int TraceRead (TraceReader *reader, TraceEvent *event)
+{
+	uint64_t delta;
+	if (reader->has_summary)
+		return 0;
+	int type = fgetc (reader->file);
+
+	// A trace from a game that crashed has no end record, everything up to there is still good
+	if (type == EOF)
+		return 0;
+	if (ReadVarint (reader->file, &delta) != 0)
+		return -1;
+	reader->time_us += (int64_t) delta;
+	event->time_us = reader->time_us;
+	event->type = type;
+
+	if (type == TRACE_RESET_TIMES)
+	{
+		for (int i = 0; i < 3; i++)
+			if (ReadSigned (reader->file, &event->values[i]) != 0)
+				return -1;
+	}
+	else if (type == TRACE_WHISTLE)
+	{
+		if (ReadSigned (reader->file, &event->values[0]) != 0)
+			return -1;
+	}
+	else if (type == TRACE_END)
+	{
+		TraceSummary *summary = &reader->summary;
+		for (int team = HOME; team <= VISITOR; team++)
+			if (ReadSigned (reader->file, &summary->score[team]) != 0 ||
+				ReadSigned (reader->file, &summary->fouls[team]) != 0 ||
+				ReadSigned (reader->file, &summary->tol[team]) != 0)
+				return -1;
+		if (ReadSigned (reader->file, &summary->period) != 0 ||
+			ReadSigned (reader->file, &summary->main_clock) != 0 ||
+			ReadSigned (reader->file, &summary->shot_clock) != 0 ||
+			ReadSigned (reader->file, &summary->timeout_clock) != 0)
+			return -1;
+		reader->has_summary = 1;
+	}
+	else if (type >= ACTION_COUNT && type != TRACE_BUZZER_DOWN && type != TRACE_BUZZER_UP)
+		return -1;
+	return 1;
+}
+
+void TraceReaderClose (TraceReader *reader)
+{
+	if (reader->file != NULL)
+		fclose (reader->file);
+	reader->file = NULL;
+}
+
+void TraceSummarize (const ScoreboardView *view, TraceSummary *summary)
+{
+	for (int team = HOME; team <= VISITOR; team++)
+	{
+		summary->score[team] = view->score[team];
+		summary->fouls[team] = view->fouls[team];
+		summary->tol[team] = view->tol[team];
+	}
+	summary->period = view->period;
+	summary->main_clock = view->main_clock;
+	summary->shot_clock = view->shot_clock;
+	summary->timeout_clock = view->timeout_clock;
+}
+
+static void WriteRecord (TraceWriter *writer, int64_t time_us, int type)
+{
+	fputc (type, writer->file);
+	WriteVarint (writer->file, (uint64_t) (time_us - writer->last_us));
+	writer->last_us = time_us;
+	if (time_us - writer->flushed_us >= TRACE_FLUSH_US)
+	{
+		fflush (writer->file);
+		writer->flushed_us = time_us;
+	}
+}
+
+static void WriteVarint (FILE *file, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		fputc ((int) (value & 0x7F) | 0x80, file);
+		value >>= 7;
+	}
+	fputc ((int) value, file);
+}
+
+static void WriteSigned (FILE *file, int64_t value)
+{
+	WriteVarint (file, ((uint64_t) value << 1) ^ (uint64_t) (value >> 63));
+}
+
+static int ReadVarint (FILE *file, uint64_t *value)
+{
+	*value = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		int byte = fgetc (file);
+		if (byte == EOF)
+			return -1;
+		*value |= (uint64_t) (byte & 0x7F) << shift;
+		if (!(byte & 0x80))
+			return 0;
+	}
+	return -1;
+}
+
+static int ReadSigned (FILE *file, int *value)
+{
+	uint64_t raw;
+	if (ReadVarint (file, &raw) != 0)
+		return -1;
+	*value = (int) ((int64_t) (raw >> 1) ^ -(int64_t) (raw & 1));
+	return 0;
+}
@@ -0,0 +1,94 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - input traces
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+A trace is every operator input of a game with its time, which is all it takes to rebuild the
+board exactly (see BoardAdvance ()). Recorded with --record, played back with the 'replay' tool.
+
+File layout, all integers are LEB128 varints (signed ones zigzag encoded):
+	"SBTRACE" 0x01
+	start time (unix seconds), main clock start, shot clock reset, timeout short, timeout long
+	records: [type byte] [microseconds since the previous record] [payload]
+Record types below ACTION_COUNT are Actions with no payload. TRACE_RESET_TIMES carries the three
+reset times, TRACE_WHISTLE how long before the record the whistle started (BoardStopClocksAt ())
+and TRACE_END carries the final board (TraceSummary) so a replay can check itself.
+
+**************************************************************************************************/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "board.h"
+#include "libscoreboard.h"
+
+#define TRACE_BUZZER_DOWN 0xF0
+#define TRACE_BUZZER_UP   0xF1
+#define TRACE_RESET_TIMES 0xF2
+#define TRACE_WHISTLE     0xF3
+#define TRACE_END         0xFF
+
+// What has to match at the end of a replay
+typedef struct TraceSummary
+{
+	int score[2];
+	int fouls[2];
+	int tol[2];
+	int period;
+	int main_clock, shot_clock, timeout_clock; // Tenths of seconds
+} TraceSummary;
+
+typedef struct TraceWriter
+{
+	FILE *file;
+	int64_t last_us; // Time of the previous record
+	int64_t flushed_us; // Time of the last flush
+} TraceWriter;
+
+typedef struct TraceEvent
+{
+	int64_t time_us; // Since the start of the trace
+	int type; // Action or TRACE_*
+	int values[3]; // TRACE_RESET_TIMES or TRACE_WHISTLE payload
+} TraceEvent;
+
+typedef struct TraceReader
+{
+	FILE *file;
+	int64_t time_us;
+	int64_t start_time; // Unix seconds
+	int main_clock_start, shot_clock_reset, timeout_short, timeout_long;
+	int has_summary; // Set once TRACE_END has been read
+	TraceSummary summary;
+} TraceReader;
+
+int TraceOpen (TraceWriter *writer, const char *path, int main_clock_start, int shot_clock_reset, int timeout_short, int timeout_long, int64_t start_us); // Returns 0 on success
+void TraceRecord (TraceWriter *writer, int64_t time_us, int type);
+void TraceRecordResetTimes (TraceWriter *writer, int64_t time_us, int shot_clock_reset, int timeout_short, int timeout_long);
+void TraceRecordWhistle (TraceWriter *writer, int64_t time_us, int ago_us);
+void TraceClose (TraceWriter *writer, const ScoreboardView *view, int64_t end_us);
+
+int TraceReaderOpen (TraceReader *reader, const char *path); // Returns 0 on success
+int TraceRead (TraceReader *reader, TraceEvent *event); // 1 = event, 0 = end of trace, -1 = corrupt
+void TraceReaderClose (TraceReader *reader);
+
+void TraceSummarize (const ScoreboardView *view, TraceSummary *summary);
+
+#endif
@@ -0,0 +1,353 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - video wall
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+**************************************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include "wall.h"
+
+#define WALL_MAGIC 0x53425701u // "SBW" and the packet version
+#define HEADER_SIZE 12 // magic, type, frame
+#define FIELDS_START offsetof (ScoreboardState, main_clock)
+#define FIELDS_SIZE (offsetof (ScoreboardState, team_names) - FIELDS_START) // All 32-bit
+#define STATE_SIZE (HEADER_SIZE + FIELDS_SIZE + 2 * SHM_NAME_LENGTH)
+#define HELLO_INTERVAL_US 1000000
+
+typedef enum PacketType { PACKET_HELLO = 1, PACKET_READY, PACKET_STATE, PACKET_GO } PacketType;
+
+static void LeadReceive (WallLead *lead, int timeout_ms);
+static void LeadSendAll (WallLead *lead, const unsigned char *packet, size_t size);
+static int Live (const WallPeer *tile, int64_t now);
+static void TileReceive (WallTile *tile, int timeout_ms);
+static void TileSend (WallTile *tile, PacketType type, uint32_t frame);
+static void PutHeader (unsigned char *packet, PacketType type, uint32_t frame);
+static void Put32 (unsigned char *p, uint32_t value);
+static uint32_t Get32 (const unsigned char *p);
+static int RemainingMs (int64_t deadline_us);
+static int64_t Now (void);
+
+int WallLeadStart (WallLead *lead, int port)
+{
+	memset (lead, 0, sizeof (*lead));
+	struct sockaddr_in address;
+	memset (&address, 0, sizeof (address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl (INADDR_ANY);
+	address.sin_port = htons ((uint16_t) port);
+
+	lead->fd = socket (AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (lead->fd < 0 || bind (lead->fd, (struct sockaddr *) &address, sizeof (address)) != 0)
+	{
+		WallLeadStop (lead);
+		return -1;
+	}
+	return 0;
+}
+
+void WallLeadSend (WallLead *lead, const ScoreboardState *state)
+{
+	// Tiles that joined since the last frame get this one too
+	LeadReceive (lead, 0);
+	lead->frame++;
+
+	unsigned char packet[STATE_SIZE];
+	PutHeader (packet, PACKET_STATE, lead->frame);
+	const unsigned char *fields = (const unsigned char *) state + FIELDS_START;
+	for (size_t i = 0; i < FIELDS_SIZE; i += 4)
+	{
+		int32_t value;
+		memcpy (&value, fields + i, 4);
+		Put32 (packet + HEADER_SIZE + i, (uint32_t) value);
+	}
+	memcpy (packet + HEADER_SIZE + FIELDS_SIZE, state->team_names, 2 * SHM_NAME_LENGTH);
+	LeadSendAll (lead, packet, sizeof (packet));
+}
+
+void WallLeadBarrier (WallLead *lead)
+{
+	int64_t deadline = Now () + WALL_TIMEOUT_MS * 1000;
+	while (1)
+	{
+		int64_t now = Now ();
+		int waiting = 0;
+		for (int i = 0; i < lead->tile_count; i++)
+			if (Live (&lead->tiles[i], now) && !lead->tiles[i].late && lead->tiles[i].ready_frame != lead->frame)
+				waiting++;
+		if (waiting == 0 || now >= deadline)
+			break;
+		LeadReceive (lead, RemainingMs (deadline));
+	}
+
+	// Whoever is not ready by now is left behind until it catches up
+	int64_t now = Now ();
+	for (int i = 0; i < lead->tile_count; i++)
+		if (Live (&lead->tiles[i], now) && lead->tiles[i].ready_frame != lead->frame)
+		{
+			lead->tiles[i].late = 1;
+			lead->late++;
+		}
+	unsigned char packet[HEADER_SIZE];
+	PutHeader (packet, PACKET_GO, lead->frame);
+	LeadSendAll (lead, packet, sizeof (packet));
+	lead->frames++;
+}
+
+int WallLeadTiles (const WallLead *lead)
+{
+	int64_t now = Now ();
+	int count = 0;
+	for (int i = 0; i < lead->tile_count; i++)
+		count += Live (&lead->tiles[i], now);
+	return count;
+}
+
+void WallLeadStop (WallLead *lead)
+{
+	if (lead->fd >= 0)
+		close (lead->fd);
+	lead->fd = -1;
+}
+
+int WallTileStart (WallTile *tile, const char *host, int port)
+{
+	memset (tile, 0, sizeof (*tile));
+	struct addrinfo hints, *found;
+	memset (&hints, 0, sizeof (hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	char service[16];
+	snprintf (service, sizeof (service), "%d", port);
+	if (getaddrinfo (host, service, &hints, &found) != 0)
+		return -1;
+
+	// Connected, so packets from anyone but the lead are dropped by the kernel
+	tile->fd = socket (AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	int connected = tile->fd >= 0 && connect (tile->fd, found->ai_addr, found->ai_addrlen) == 0;
+	freeaddrinfo (found);
+	if (!connected)
+	{
+		WallTileStop (tile);
+		return -1;
+	}
+	return 0;
+}
+
+int WallTileState (WallTile *tile, ScoreboardState *state)
+{
+	// Without the lead, ask to join now and then and do not wait for it
+	int64_t now = Now ();
+	int gone = now - tile->heard_us > WALL_GONE_MS * 1000;
+	if (gone && now - tile->hello_us >= HELLO_INTERVAL_US)
+	{
+		TileSend (tile, PACKET_HELLO, 0);
+		tile->hello_us = now;
+	}
+
+	int64_t deadline = now + (gone ? 0 : WALL_TIMEOUT_MS * 1000);
+	TileReceive (tile, 0);
+	while (tile->state_frame == tile->drawn_frame && Now () < deadline)
+		TileReceive (tile, RemainingMs (deadline));
+
+	tile->drawing = tile->state_frame != tile->drawn_frame;
+	if (!tile->drawing)
+	{
+		tile->stale++;
+		return -1;
+	}
+	tile->drawn_frame = tile->state_frame;
+	tile->frames++;
+	*state = tile->state;
+	return 0;
+}
+
+void WallTileBarrier (WallTile *tile)
+{
+	if (!tile->drawing)
+		return;
+	TileSend (tile, PACKET_READY, tile->drawn_frame);
+	int64_t deadline = Now () + WALL_TIMEOUT_MS * 1000;
+	while (tile->go_frame != tile->drawn_frame)
+	{
+		if (Now () >= deadline)
+		{
+			tile->unlocked++;
+			break;
+		}
+		TileReceive (tile, RemainingMs (deadline));
+	}
+}
+
+void WallTileStop (WallTile *tile)
+{
+	if (tile->fd >= 0)
+		close (tile->fd);
+	tile->fd = -1;
+}
+
+static void LeadReceive (WallLead *lead, int timeout_ms)
+{
+	struct pollfd fd = {lead->fd, POLLIN, 0};
+	if (poll (&fd, 1, timeout_ms) <= 0)
+		return;
+
+	unsigned char packet[HEADER_SIZE];
+	struct sockaddr_in from;
+	socklen_t from_size = sizeof (from);
+	ssize_t got;
+	while ((got = recvfrom (lead->fd, packet, sizeof (packet), 0, (struct sockaddr *) &from, &from_size)) >= 0)
+	{
+		from_size = sizeof (from);
+		if (got != HEADER_SIZE || Get32 (packet) != WALL_MAGIC)
+			continue;
+		PacketType type = (PacketType) Get32 (packet + 4);
+		if (type != PACKET_HELLO && type != PACKET_READY)
+			continue;
+
+		// Tiles are known by their address, a new one takes the place of one that is gone
+		int64_t now = Now ();
+		WallPeer *tile = NULL;
+		for (int i = 0; i < lead->tile_count && tile == NULL; i++)
+			if (lead->tiles[i].address.sin_addr.s_addr == from.sin_addr.s_addr && lead->tiles[i].address.sin_port == from.sin_port)
+				tile = &lead->tiles[i];
+		for (int i = 0; i < lead->tile_count && tile == NULL; i++)
+			if (!Live (&lead->tiles[i], now))
+				tile = &lead->tiles[i];
+		if (tile == NULL && lead->tile_count < WALL_TILES_MAX)
+			tile = &lead->tiles[lead->tile_count++];
+		if (tile == NULL)
+			continue;
+		if (tile->address.sin_addr.s_addr != from.sin_addr.s_addr || tile->address.sin_port != from.sin_port)
+		{
+			memset (tile, 0, sizeof (*tile));
+			tile->address = from;
+		}
+		tile->heard_us = now;
+		if (type == PACKET_READY)
+		{
+			tile->ready_frame = Get32 (packet + 8);
+			if (tile->ready_frame == lead->frame)
+				tile->late = 0;
+		}
+	}
+}
+
+static void LeadSendAll (WallLead *lead, const unsigned char *packet, size_t size)
+{
+	int64_t now = Now ();
+	for (int i = 0; i < lead->tile_count; i++)
+		if (Live (&lead->tiles[i], now))
+			sendto (lead->fd, packet, size, 0, (const struct sockaddr *) &lead->tiles[i].address, sizeof (lead->tiles[i].address));
+}
+
+static int Live (const WallPeer *tile, int64_t now)
+{
+	return tile->heard_us != 0 && now - tile->heard_us <= WALL_GONE_MS * 1000;
+}
+
+static void TileReceive (WallTile *tile, int timeout_ms)
+{
+	struct pollfd fd = {tile->fd, POLLIN, 0};
+	if (poll (&fd, 1, timeout_ms) <= 0)
+		return;
+
+	unsigned char packet[STATE_SIZE];
+	ssize_t got;
+	while ((got = recv (tile->fd, packet, sizeof (packet), 0)) >= 0)
+	{
+		if (got < HEADER_SIZE || Get32 (packet) != WALL_MAGIC)
+			continue;
+		PacketType type = (PacketType) Get32 (packet + 4);
+		uint32_t frame = Get32 (packet + 8);
+		int64_t now = Now ();
+		if (type == PACKET_GO)
+			tile->go_frame = frame;
+		else if (type == PACKET_STATE && got == STATE_SIZE)
+		{
+			// Only newer frames, unless the lead was gone and has started counting again
+			if ((int32_t) (frame - tile->state_frame) <= 0 && now - tile->heard_us <= WALL_GONE_MS * 1000)
+				continue;
+			unsigned char *fields = (unsigned char *) &tile->state + FIELDS_START;
+			for (size_t i = 0; i < FIELDS_SIZE; i += 4)
+			{
+				int32_t value = (int32_t) Get32 (packet + HEADER_SIZE + i);
+				memcpy (fields + i, &value, 4);
+			}
+			memcpy (tile->state.team_names, packet + HEADER_SIZE + FIELDS_SIZE, 2 * SHM_NAME_LENGTH);
+			tile->state.team_names[0][SHM_NAME_LENGTH - 1] = tile->state.team_names[1][SHM_NAME_LENGTH - 1] = '\0';
+			tile->state.tick = frame;
+			tile->state.time_us = now;
+			tile->state_frame = frame;
+			// Frame numbers start over with a new lead
+			if ((int32_t) (frame - tile->drawn_frame) <= 0)
+				tile->drawn_frame = frame - 1;
+		}
+		else
+			continue;
+		tile->heard_us = now;
+	}
+}
+
+static void TileSend (WallTile *tile, PacketType type, uint32_t frame)
+{
+	unsigned char packet[HEADER_SIZE];
+	PutHeader (packet, type, frame);
+	send (tile->fd, packet, sizeof (packet), 0);
+}
+
+static void PutHeader (unsigned char *packet, PacketType type, uint32_t frame)
+{
+	Put32 (packet, WALL_MAGIC);
+	Put32 (packet + 4, (uint32_t) type);
+	Put32 (packet + 8, frame);
+}
+
+static void Put32 (unsigned char *p, uint32_t value)
+{
+	for (int i = 3; i >= 0; i--, value >>= 8)
+		p[i] = (unsigned char) value;
+}
+
+static uint32_t Get32 (const unsigned char *p)
+{
+	uint32_t value = 0;
+	for (int i = 0; i < 4; i++)
+		value = value << 8 | p[i];
+	return value;
+}
+
+static int RemainingMs (int64_t deadline_us)
+{
+	int64_t remaining = deadline_us - Now ();
+	return remaining <= 0 ? 0 : (int) ((remaining + 999) / 1000);
+}
+
+static int64_t Now (void)
+{
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
@@ -0,0 +1,96 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - video wall
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Runs a wall of screens, each driven by its own computer, as one board. Every tile lays the board
+out for the whole wall and draws only its own part of it; the lead (--wall-lead PORT) is the one
+with the operator, and sends every frame what it shows to the other tiles (--wall HOST:PORT) over
+UDP. All tiles then swap together, so a digit that spans two screens never shows two values.
+
+Each frame, on the render thread:
+
+	lead                                     tile
+	WallLeadSend ()  ---- STATE n ---->      WallTileState ()   draws the lead's state n
+	                 <--- READY n -----      WallTileBarrier () once drawn
+	WallLeadBarrier ()  waits for every tile's READY n, up to WALL_TIMEOUT_MS
+	                 ---- GO n ------->      returns
+	swap                                     swap
+
+A tile that misses the timeout is not waited for again until it is ready in time, so one broken
+tile does not slow the wall down; one not heard from in WALL_GONE_MS is forgotten. Tiles join by
+sending HELLO and can start in any order. Without the lead a tile keeps running on its own clock.
+
+Packets: magic, type and frame number (32 bits each, big-endian), then for STATE the published
+state (shm.h): each 32-bit field from main_clock on, big-endian, then the two team names.
+
+Tiles swap on their own display's vblank, so without genlocked displays they can still be up to a
+refresh apart; what the barrier makes sure of is that it is always the same frame.
+
+**************************************************************************************************/
+
+#ifndef WALL_H
+#define WALL_H
+
+#include <stdint.h>
+#include <netinet/in.h>
+#include "shm.h"
+
+#define WALL_TILES_MAX 64 // Tiles following one lead
+#define WALL_TIMEOUT_MS 50 // Longest wait for the other side in one frame
+#define WALL_GONE_MS 2000 // A tile or lead not heard from this long is not waited for
+
+typedef struct WallPeer
+{
+	struct sockaddr_in address;
+	int64_t heard_us;
+	uint32_t ready_frame; // Last frame it was ready to swap
+	int late; // Missed the last barrier, not waited for until it catches up
+} WallPeer;
+
+typedef struct WallLead
+{
+	int fd;
+	uint32_t frame;
+	WallPeer tiles[WALL_TILES_MAX];
+	int tile_count;
+	unsigned long frames, late; // Tiles that missed a barrier, counted per frame and tile
+} WallLead;
+
+typedef struct WallTile
+{
+	int fd;
+	ScoreboardState state; // Newest from the lead
+	uint32_t state_frame, drawn_frame, go_frame;
+	int drawing; // State drawn this frame came from the lead, so the barrier is waited for
+	int64_t heard_us, hello_us;
+	unsigned long frames, stale, unlocked; // Frames drawn on the lead's state, without one, swapped without GO
+} WallTile;
+
+int WallLeadStart (WallLead *lead, int port); // Returns 0 on success
+void WallLeadSend (WallLead *lead, const ScoreboardState *state); // What this frame shows
+void WallLeadBarrier (WallLead *lead); // Right before the swap
+int WallLeadTiles (const WallLead *lead); // Tiles heard from lately
+void WallLeadStop (WallLead *lead);
+
+int WallTileStart (WallTile *tile, const char *host, int port); // Returns 0 on success
+int WallTileState (WallTile *tile, ScoreboardState *state); // 0 = state is the lead's for this frame, -1 = none came in time
+void WallTileBarrier (WallTile *tile); // Right before the swap
+void WallTileStop (WallTile *tile);
+
+#endif
@@ -0,0 +1,258 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - video wall test
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Runs a lead and a number of tiles (wall.h) in one process over loopback, each on its own thread
+with a render loop that takes a random time to draw, and measures how well they stay together.
+
+	walltest [--tiles N] [--seconds S] [--fps N] [--draw-ms MS] [--stall-ms MS] [--port P]
+
+Every frame each thread draws for up to --draw-ms (uniform), then waits at the barrier. The lead
+puts its frame number in the state, so a tile drawing anything but the frame it was sent is
+counted as a mismatch. With --stall-ms the last tile stops for that long every 5 seconds, to show
+the others going on without it and it catching up. Prints how far apart the threads left the
+barrier and fails on mismatches, or without --stall-ms if less than 99% of frames were locked.
+
+**************************************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "wall.h"
+
+#define TILES_MAX 32
+#define STALL_EVERY_US 5000000
+
+typedef struct TileThread
+{
+	pthread_t thread;
+	int index;
+	WallTile tile;
+	unsigned long mismatches;
+	unsigned int seed;
+} TileThread;
+
+static int tile_count = 4, fps = 60, port = 47300;
+static double seconds = 10, draw_ms = 4, stall_ms = 0;
+static long frames_max;
+static int64_t *released; // Per frame and thread (lead last), when it left the barrier, 0 = did not lock
+static _Atomic int running = 1;
+
+static void *LeadThread (void *data);
+static void *TileThreadMain (void *data);
+static void Draw (unsigned int *seed);
+static void SleepUntil (int64_t time_us);
+static int CompareTimes (const void *a, const void *b);
+static int64_t Now (void);
+
+int main (int argc, char *argv[])
+{
+	static struct option long_options[] =
+	{
+		{"tiles", required_argument, 0, 't'},
+		{"seconds", required_argument, 0, 's'},
+		{"fps", required_argument, 0, 'f'},
+		{"draw-ms", required_argument, 0, 'd'},
+		{"stall-ms", required_argument, 0, 'S'},
+		{"port", required_argument, 0, 'p'},
+		{0, 0, 0, 0}
+	};
+
+	int c;
+	while ((c = getopt_long (argc, argv, "", long_options, NULL)) != -1)
+	{
+		switch (c)
+		{
+			case 't': tile_count = atoi (optarg); break;
+			case 's': seconds = atof (optarg); break;
+			case 'f': fps = atoi (optarg); break;
+			case 'd': draw_ms = atof (optarg); break;
+			case 'S': stall_ms = atof (optarg); break;
+			case 'p': port = atoi (optarg); break;
+			default:
+				fprintf (stderr, "usage: %s [--tiles N] [--seconds S] [--fps N] [--draw-ms MS] [--stall-ms MS] [--port P]\n", argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+	if (optind < argc || tile_count < 1 || tile_count > TILES_MAX || seconds <= 0 || fps <= 0 || draw_ms < 0 || draw_ms * fps >= 1000 || stall_ms < 0)
+	{
+		fprintf (stderr, "usage: %s [--tiles N] [--seconds S] [--fps N] [--draw-ms MS] [--stall-ms MS] [--port P]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	frames_max = (long) (seconds * fps) + 1;
+	released = calloc ((size_t) frames_max * (size_t) (tile_count + 1), sizeof (int64_t));
+	WallLead lead;
+	static TileThread tiles[TILES_MAX];
+	if (released == NULL || WallLeadStart (&lead, port) != 0)
+	{
+		fprintf (stderr, "%s: could not start a lead on port %d\n", argv[0], port);
+		return EXIT_FAILURE;
+	}
+	for (int i = 0; i < tile_count; i++)
+	{
+		tiles[i].index = i;
+		tiles[i].seed = (unsigned int) i + 1;
+		if (WallTileStart (&tiles[i].tile, "127.0.0.1", port) != 0)
+		{
+			fprintf (stderr, "%s: could not start tile %d\n", argv[0], i);
+			return EXIT_FAILURE;
+		}
+		pthread_create (&tiles[i].thread, NULL, TileThreadMain, &tiles[i]);
+	}
+
+	// Give the tiles a moment to join, as they would at a venue before the game
+	usleep (200000);
+	pthread_t lead_thread;
+	pthread_create (&lead_thread, NULL, LeadThread, &lead);
+	pthread_join (lead_thread, NULL);
+	atomic_store (&running, 0);
+
+	unsigned long mismatches = 0, stale = 0, unlocked = 0;
+	for (int i = 0; i < tile_count; i++)
+	{
+		pthread_join (tiles[i].thread, NULL);
+		mismatches += tiles[i].mismatches;
+		stale += tiles[i].tile.stale;
+		unlocked += tiles[i].tile.unlocked;
+		WallTileStop (&tiles[i].tile);
+	}
+
+	// How far apart the threads that locked a frame left its barrier
+	long locked = 0, counted = 0;
+	int64_t *spreads = malloc ((size_t) frames_max * sizeof (int64_t));
+	for (long frame = 1; frame < frames_max; frame++)
+	{
+		int64_t *times = released + frame * (tile_count + 1);
+		int64_t first = 0, last = 0;
+		int all = 1;
+		for (int i = 0; i <= tile_count; i++)
+		{
+			if (times[i] == 0)
+			{
+				all = 0;
+				continue;
+			}
+			if (first == 0 || times[i] < first)
+				first = times[i];
+			if (times[i] > last)
+				last = times[i];
+		}
+		if (times[tile_count] == 0)
+			continue;
+		counted++;
+		if (all)
+			spreads[locked++] = last - first;
+	}
+	qsort (spreads, (size_t) locked, sizeof (int64_t), CompareTimes);
+	printf ("%d tiles, %ld frames: %ld locked (%.2f%%), lead left %lu tiles behind, tiles drew %lu frames without a state and swapped %lu without GO\n",
+		tile_count, counted, locked, counted ? 100.0 * locked / counted : 0.0, lead.late, stale, unlocked);
+	if (locked > 0)
+		printf ("barrier release spread: median %.3f ms, 99%% %.3f ms, worst %.3f ms\n",
+			spreads[locked / 2] / 1000.0, spreads[locked * 99 / 100] / 1000.0, spreads[locked - 1] / 1000.0);
+	printf ("%lu mismatched frames\n", mismatches);
+	WallLeadStop (&lead);
+	free (spreads);
+	free (released);
+	return mismatches == 0 && counted > 0 && (stall_ms > 0 || locked * 100 >= counted * 99) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void *LeadThread (void *data)
+{
+	WallLead *lead = data;
+	ScoreboardState state;
+	memset (&state, 0, sizeof (state));
+	strcpy (state.team_names[0], "HOME");
+	strcpy (state.team_names[1], "VISITOR");
+	unsigned int seed = 0;
+
+	// Frames on a steady beat, like swaps paced by VSync
+	int64_t start = Now (), period = 1000000 / fps;
+	for (long frame = 1; frame < frames_max; frame++)
+	{
+		state.main_clock = (int32_t) frame;
+		state.score[frame / 300 % 2] = (int32_t) (frame / 150);
+		WallLeadSend (lead, &state);
+		Draw (&seed);
+		WallLeadBarrier (lead);
+		released[frame * (tile_count + 1) + tile_count] = Now ();
+		SleepUntil (start + frame * period);
+	}
+	return NULL;
+}
+
+static void *TileThreadMain (void *data)
+{
+	TileThread *thread = data;
+	ScoreboardState state;
+	int64_t next_stall = Now () + STALL_EVERY_US;
+	while (atomic_load (&running))
+	{
+		// No lead yet: wait for the next refresh, as a real tile would
+		if (WallTileState (&thread->tile, &state) != 0)
+		{
+			usleep ((useconds_t) (1000000 / fps));
+			continue;
+		}
+		if (state.main_clock != (int32_t) state.tick || strcmp (state.team_names[1], "VISITOR") != 0)
+			thread->mismatches++;
+		Draw (&thread->seed);
+		if (stall_ms > 0 && thread->index == tile_count - 1 && Now () >= next_stall)
+		{
+			usleep ((useconds_t) (stall_ms * 1000));
+			next_stall = Now () + STALL_EVERY_US;
+		}
+		unsigned long unlocked = thread->tile.unlocked;
+		WallTileBarrier (&thread->tile);
+		long frame = (long) state.tick;
+		if (thread->tile.unlocked == unlocked && frame > 0 && frame < frames_max)
+			released[frame * (tile_count + 1) + thread->index] = Now ();
+	}
+	return NULL;
+}
+
+static void Draw (unsigned int *seed)
+{
+	usleep ((useconds_t) (draw_ms * 1000 * rand_r (seed) / RAND_MAX));
+}
+
+static void SleepUntil (int64_t time_us)
+{
+	struct timespec until = {(time_t) (time_us / 1000000), (long) (time_us % 1000000) * 1000};
+	clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL);
+}
+
+static int CompareTimes (const void *a, const void *b)
+{
+	int64_t x = *(const int64_t *) a, y = *(const int64_t *) b;
+	return (x > y) - (x < y);
+}
+
+static int64_t Now (void)
+{
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
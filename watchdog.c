@@ -0,0 +1,264 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - render watchdog
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+**************************************************************************************************/
+
+#define _GNU_SOURCE
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include "watchdog.h"
+#include "board.h"
+
+#define FRAME_GAP_MAX_US 1000000 // Slower frame rates than this still count as stalled after a second
+#define CLOCK_OUT_GRACE_US 5000 // On top of a frame, for the render thread to sound the horn itself
+
+static void *WatchdogThread (void *data);
+static int64_t StallDeadline (const Watchdog *watchdog);
+static int64_t UntilNextTenth (const ScoreboardView *view);
+static void UpdateClocks (ScoreboardState *state, const ScoreboardView *view, int buzzer);
+static int64_t Now (void);
+
+int WatchdogStart (Watchdog *watchdog, ShmPublisher *publisher, WatchdogBuzzer buzzer, void *buzzer_data, Logger *logger, Metrics *metrics)
+{
+	memset (watchdog, 0, sizeof (*watchdog));
+	watchdog->publisher = publisher;
+	watchdog->buzzer_callback = buzzer;
+	watchdog->buzzer_data = buzzer_data;
+	watchdog->logger = logger;
+	watchdog->metrics = metrics;
+	watchdog->board = ScoreboardNew (0, 0, 0, 0);
+	if (watchdog->board == NULL)
+		return -1;
+	watchdog->stop_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (watchdog->stop_fd < 0)
+	{
+		ScoreboardFree (watchdog->board);
+		return -1;
+	}
+	if (pthread_mutex_init (&watchdog->lock, NULL) != 0)
+	{
+		close (watchdog->stop_fd);
+		ScoreboardFree (watchdog->board);
+		return -1;
+	}
+	if (pthread_create (&watchdog->thread, NULL, WatchdogThread, watchdog) != 0)
+	{
+		pthread_mutex_destroy (&watchdog->lock);
+		close (watchdog->stop_fd);
+		ScoreboardFree (watchdog->board);
+		return -1;
+	}
+	return 0;
+}
+
+int WatchdogResume (Watchdog *watchdog)
+{
+	int64_t now = Now ();
+	pthread_mutex_lock (&watchdog->lock);
+	// Back from a stall, the watchdog stops publishing and sounding the horn as soon as this has the lock
+	if (watchdog->stalled)
+	{
+		watchdog->stalled = 0;
+		watchdog->stalled_us = now - watchdog->kicked_us;
+		watchdog->resumed_after_us = watchdog->stalled_us;
+	}
+	// And stays out of it until the frame is published
+	watchdog->resuming = 1;
+	int horn = watchdog->buzzer_started;
+	watchdog->buzzer_started = 0;
+	pthread_mutex_unlock (&watchdog->lock);
+	return horn;
+}
+
+int64_t WatchdogPublish (Watchdog *watchdog, const Scoreboard *board, int64_t board_us, int64_t local_us, ScoreboardState *state)
+{
+	int64_t now = Now (), stalled_us = 0;
+	pthread_mutex_lock (&watchdog->lock);
+	if (watchdog->stalled)
+	{
+		stalled_us = now - watchdog->kicked_us;
+		watchdog->stalled = 0;
+		watchdog->resumed_after_us = stalled_us;
+	}
+	else if (watchdog->stalled_us != 0)
+	{
+		stalled_us = watchdog->stalled_us;
+		watchdog->stalled_us = 0;
+	}
+	else if (watchdog->kicked_us != 0)
+		watchdog->frame_gap_us = now - watchdog->kicked_us < FRAME_GAP_MAX_US ? now - watchdog->kicked_us : FRAME_GAP_MAX_US;
+	watchdog->kicked_us = now;
+	watchdog->resuming = 0;
+
+	ShmPublish (watchdog->publisher, state);
+	ScoreboardCopy (watchdog->board, board);
+	watchdog->board_us = board_us;
+	watchdog->offset_us = board_us - local_us;
+	watchdog->state = *state;
+	pthread_mutex_unlock (&watchdog->lock);
+	return stalled_us;
+}
+
+void WatchdogStop (Watchdog *watchdog)
+{
+	uint64_t one = 1;
+	if (write (watchdog->stop_fd, &one, sizeof (one)) == sizeof (one))
+		pthread_join (watchdog->thread, NULL);
+	close (watchdog->stop_fd);
+	pthread_mutex_destroy (&watchdog->lock);
+	ScoreboardFree (watchdog->board);
+}
+
+static void *WatchdogThread (void *data)
+{
+	Watchdog *watchdog = data;
+	LogRing *log_ring = watchdog->logger ? LogRingAdd (watchdog->logger, "watchdog") : NULL;
+	MetricsShard *shard = watchdog->metrics ? MetricsShardAdd (watchdog->metrics) : NULL;
+	int64_t wait_us = WATCHDOG_CHECK_MS * 1000;
+
+	while (1)
+	{
+		struct pollfd stop = {watchdog->stop_fd, POLLIN, 0};
+		struct timespec timeout = {(time_t) (wait_us / 1000000), (long) (wait_us % 1000000) * 1000};
+		if (ppoll (&stop, 1, &timeout, NULL) > 0)
+			break;
+
+		pthread_mutex_lock (&watchdog->lock);
+		int64_t now = Now ();
+		if (watchdog->resumed_after_us)
+		{
+			if (log_ring)
+				LogWrite (log_ring, LOG_RENDER_RESUME, (int) (watchdog->resumed_after_us / 1000), 0, 0);
+			watchdog->resumed_after_us = 0;
+		}
+
+		int64_t deadline = watchdog->kicked_us != 0 ? StallDeadline (watchdog) : now + WATCHDOG_CHECK_MS * 1000;
+		if (!watchdog->stalled && !watchdog->resuming && now >= deadline)
+		{
+			watchdog->stalled = 1;
+			watchdog->buzzer = watchdog->state.buzzer;
+			watchdog->buzzer_started = 0;
+			if (log_ring)
+				LogWrite (log_ring, LOG_RENDER_STALL, (int) ((now - watchdog->kicked_us) / 1000), 0, 0);
+			if (shard)
+				MetricsCount (shard, METRIC_RENDER_STALLS, 1);
+		}
+
+		if (watchdog->stalled)
+		{
+			// The same board the render thread would have, run up to now
+			int64_t board_now = now + watchdog->offset_us;
+			if (board_now > watchdog->board_us)
+			{
+				ScoreboardStep (watchdog->board, board_now - watchdog->board_us, SCOREBOARD_ACTION_NONE);
+				watchdog->board_us = board_now;
+			}
+			ScoreboardView view;
+			ScoreboardRead (watchdog->board, &view);
+			// Only a horn this thread started is stopped, one the render thread left sounding (a button held) is its own
+			int buzzer = watchdog->buzzer_callback && (view.flags & SCOREBOARD_BUZZER);
+			if (buzzer && !watchdog->buzzer)
+			{
+				watchdog->buzzer = 1;
+				watchdog->buzzer_started = 1;
+				watchdog->buzzer_callback (1, watchdog->buzzer_data);
+				if (log_ring)
+					LogWrite (log_ring, LOG_BUZZER_START, LOG_BUZZER_CLOCK, 0, 0);
+				if (shard)
+					MetricsCount (shard, METRIC_BUZZERS, 1);
+			}
+			else if (!buzzer && watchdog->buzzer_started)
+			{
+				watchdog->buzzer = 0;
+				watchdog->buzzer_started = 0;
+				watchdog->buzzer_callback (0, watchdog->buzzer_data);
+				if (log_ring)
+					LogWrite (log_ring, LOG_BUZZER_STOP, 0, 0, 0);
+			}
+			else if (!buzzer)
+				watchdog->buzzer = 0; // Left to play out
+			UpdateClocks (&watchdog->state, &view, watchdog->buzzer);
+			ShmPublish (watchdog->publisher, &watchdog->state);
+
+			// Up again for the next tenth, which is also when a clock runs out
+			wait_us = UntilNextTenth (&view);
+		}
+		else
+			wait_us = deadline - now;
+		if (wait_us > WATCHDOG_CHECK_MS * 1000)
+			wait_us = WATCHDOG_CHECK_MS * 1000;
+		pthread_mutex_unlock (&watchdog->lock);
+	}
+	return NULL;
+}
+
+static int64_t StallDeadline (const Watchdog *watchdog)
+{
+	// A frame later than the one before by WATCHDOG_STALL_MS
+	int64_t deadline = watchdog->kicked_us + watchdog->frame_gap_us + WATCHDOG_STALL_MS * 1000;
+
+	// Or missing right after a clock ran out, as the horn cannot wait
+	int64_t clock_out_us = ScoreboardUntilClockOut (watchdog->board);
+	if (clock_out_us >= 0)
+	{
+		int64_t horn = watchdog->board_us - watchdog->offset_us + clock_out_us + watchdog->frame_gap_us + CLOCK_OUT_GRACE_US;
+		if (horn < deadline)
+			deadline = horn;
+	}
+	return deadline;
+}
+
+static int64_t UntilNextTenth (const ScoreboardView *view)
+{
+	// Of whichever running clock goes down first
+	int64_t until = WATCHDOG_CHECK_MS * 1000;
+	int shot_showing = (view->flags & SCOREBOARD_SHOT_SHOWING) != 0;
+	if (view->mode != SCOREBOARD_MODE_CLOCK)
+		return until;
+	if ((view->flags & SCOREBOARD_MAIN_RUNNING) && view->main_clock != 0 && TENTH_SECOND_US - view->main_clock_elapsed_us < until)
+		until = TENTH_SECOND_US - view->main_clock_elapsed_us;
+	if ((view->flags & SCOREBOARD_SHOT_RUNNING) && shot_showing && view->shot_clock != 0 && TENTH_SECOND_US - view->shot_clock_elapsed_us < until)
+		until = TENTH_SECOND_US - view->shot_clock_elapsed_us;
+	if ((view->flags & SCOREBOARD_SHOT_RUNNING) && !shot_showing && view->timeout_clock != 0 && TENTH_SECOND_US - view->timeout_clock_elapsed_us < until)
+		until = TENTH_SECOND_US - view->timeout_clock_elapsed_us;
+	return until;
+}
+
+static void UpdateClocks (ScoreboardState *state, const ScoreboardView *view, int buzzer)
+{
+	// Only the clocks move while nobody is pressing keys
+	state->main_clock = view->main_clock;
+	state->shot_clock = view->shot_clock;
+	state->timeout_clock = view->timeout_clock;
+	state->main_clock_elapsed_us = view->main_clock_elapsed_us;
+	state->shot_clock_elapsed_us = view->shot_clock_elapsed_us;
+	state->timeout_clock_elapsed_us = view->timeout_clock_elapsed_us;
+	state->main_clock_tenths = (view->flags & SCOREBOARD_MAIN_TENTHS) != 0;
+	state->shot_clock_tenths = (view->flags & SCOREBOARD_SHOT_TENTHS) != 0;
+	state->buzzer = buzzer;
+}
+
+static int64_t Now (void)
+{
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
@@ -0,0 +1,92 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - render watchdog
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Keeps the game going when the render thread stops, e.g. a GL driver hanging in the buffer swap or
+a frozen window manager. The render thread hands every frame's board and published state over in
+WatchdogPublish () instead of calling ShmPublish () itself. A frame that is more than
+WATCHDOG_STALL_MS later than the last one was is a stall, and so is a frame missing when a clock
+has run out, as the horn cannot wait. The watchdog thread then runs its copy of the board on
+(libscoreboard.h), publishes it on every tenth so the web page, serial controllers and terminal boards
+keep counting, and sounds the buzzer through a callback when a clock runs out.
+
+When the render thread comes back it takes over again with WatchdogResume () at the top of its
+next frame, before it touches the sound: the buzzer callback is only ever called while the render
+thread is stalled, as raylib's audio may not be used from two threads at once. Between
+WatchdogResume () and WatchdogPublish () no new stall is declared, and WatchdogPublish () returns
+how long the render thread was gone. Its own board never stopped counting: it is run up to the present
+like after any frame, and keys from --evdev devices pressed meanwhile are applied at the time they
+were pressed. After a stall of WATCHDOG_REBUILD_MS or more the caller rebuilds the window and
+everything on the GPU, which touches nothing of the game.
+
+Stalls and the horns the watchdog sounds are logged (log.h) and counted (metrics.h) from its own
+thread. It only ever stops a horn it started itself.
+
+**************************************************************************************************/
+
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "libscoreboard.h"
+#include "shm.h"
+#include "log.h"
+#include "metrics.h"
+
+#define WATCHDOG_STALL_MS 50 // Later than the frame before by this much, so a stall is caught within a tenth
+#define WATCHDOG_CHECK_MS 20 // How often the render thread is looked for
+#define WATCHDOG_REBUILD_MS 2000 // Stalls at least this long rebuild the renderer
+
+typedef void (*WatchdogBuzzer) (int on, void *data); // Called on the watchdog's thread, only during a stall
+
+typedef struct Watchdog
+{
+	pthread_t thread;
+	int stop_fd;
+	pthread_mutex_t lock; // Guards everything below
+
+	// Handed over every frame
+	Scoreboard *board; // A copy of the render thread's
+	int64_t board_us; // Time the board is run up to, on the board's clock
+	int64_t offset_us; // Board's clock less this machine's, with --sync
+	ScoreboardState state;
+	int64_t kicked_us, frame_gap_us;
+
+	// During a stall
+	int stalled;
+	int resuming; // The render thread is between WatchdogResume () and WatchdogPublish ()
+	int64_t stalled_us; // How long, kept from WatchdogResume () for WatchdogPublish () to return
+	int buzzer; // Sounding, as far as the watchdog knows
+	int buzzer_started; // By the watchdog, so it is the one to stop it
+	int64_t resumed_after_us; // Set when the render thread takes over again, for the log
+
+	ShmPublisher *publisher;
+	WatchdogBuzzer buzzer_callback;
+	void *buzzer_data;
+	Logger *logger; // NULL = not logging
+	Metrics *metrics; // NULL = not counting
+} Watchdog;
+
+int WatchdogStart (Watchdog *watchdog, ShmPublisher *publisher, WatchdogBuzzer buzzer, void *buzzer_data, Logger *logger, Metrics *metrics); // Returns 0 on success
+int WatchdogResume (Watchdog *watchdog); // First thing every frame, before any sound is touched; returns 1 if the watchdog left its horn sounding
+int64_t WatchdogPublish (Watchdog *watchdog, const Scoreboard *board, int64_t board_us, int64_t local_us, ScoreboardState *state); // Returns how long the render thread was stalled, 0 = it was not
+void WatchdogStop (Watchdog *watchdog);
+
+#endif
@@ -0,0 +1,116 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - timer wheel
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+**************************************************************************************************/
+
+#include <string.h>
+#include "wheel.h"
+
+#define SLOT_MASK (WHEEL_SLOTS - 1)
+
+static void Place (TimerWheel *wheel, int timer);
+static void Unlink (TimerWheel *wheel, int timer);
+static void Cascade (TimerWheel *wheel, int level);
+
+void WheelInit (TimerWheel *wheel)
+{
+	memset (wheel, 0, sizeof (*wheel));
+	memset (wheel->slots, -1, sizeof (wheel->slots));
+	for (int timer = 0; timer < WHEEL_TIMERS_MAX; timer++)
+		wheel->timers[timer].level = wheel->timers[timer].slot = wheel->timers[timer].prev = wheel->timers[timer].next = -1;
+}
+
+void WheelSchedule (TimerWheel *wheel, int timer, uint32_t ticks)
+{
+	// Past the highest level it would come round before it is due, so it is kept within reach
+	if (ticks >= WHEEL_RANGE)
+		ticks = WHEEL_RANGE - 1;
+	Unlink (wheel, timer);
+	wheel->timers[timer].deadline = wheel->now + (ticks == 0 ? 1 : ticks);
+	Place (wheel, timer);
+}
+
+void WheelCancel (TimerWheel *wheel, int timer)
+{
+	Unlink (wheel, timer);
+}
+
+int WheelTick (TimerWheel *wheel, int *fired)
+{
+	wheel->now++;
+
+	// Coming round to a new slot of a higher level moves its timers down, highest level first
+	for (int level = WHEEL_LEVELS - 1; level > 0; level--)
+		if ((wheel->now & ((1u << (WHEEL_BITS * level)) - 1)) == 0)
+			Cascade (wheel, level);
+
+	// Everything left in this slot of the first level is due now
+	int count = 0;
+	int8_t *slot = &wheel->slots[0][wheel->now & SLOT_MASK];
+	while (*slot >= 0)
+	{
+		int timer = *slot;
+		Unlink (wheel, timer);
+		fired[count++] = timer;
+	}
+	return count;
+}
+
+static void Place (TimerWheel *wheel, int timer)
+{
+	// The lowest level whose slots are fine enough to still tell the deadline apart from now
+	WheelTimer *entry = &wheel->timers[timer];
+	uint32_t ahead = entry->deadline - wheel->now;
+	int level = 0;
+	while (level < WHEEL_LEVELS - 1 && ahead >= (1u << (WHEEL_BITS * (level + 1))))
+		level++;
+	int slot = (int) ((entry->deadline >> (WHEEL_BITS * level)) & SLOT_MASK);
+
+	entry->level = (int8_t) level;
+	entry->slot = (int8_t) slot;
+	entry->prev = -1;
+	entry->next = wheel->slots[level][slot];
+	if (entry->next >= 0)
+		wheel->timers[entry->next].prev = (int8_t) timer;
+	wheel->slots[level][slot] = (int8_t) timer;
+}
+
+static void Unlink (TimerWheel *wheel, int timer)
+{
+	WheelTimer *entry = &wheel->timers[timer];
+	if (entry->level < 0)
+		return;
+	if (entry->prev >= 0)
+		wheel->timers[entry->prev].next = entry->next;
+	else
+		wheel->slots[entry->level][entry->slot] = entry->next;
+	if (entry->next >= 0)
+		wheel->timers[entry->next].prev = entry->prev;
+	entry->level = entry->slot = entry->prev = entry->next = -1;
+}
+
+static void Cascade (TimerWheel *wheel, int level)
+{
+	int8_t *slot = &wheel->slots[level][(wheel->now >> (WHEEL_BITS * level)) & SLOT_MASK];
+	while (*slot >= 0)
+	{
+		int timer = *slot;
+		Unlink (wheel, timer);
+		Place (wheel, timer);
+	}
+}
@@ -0,0 +1,66 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - timer wheel
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+A hierarchical timer wheel, for the board's timed cues (board.h). Time is counted in ticks, which
+the owner advances one at a time; for the board a tick is a clock going down by a tenth, so a
+stopped clock stops its timers too.
+
+There are WHEEL_LEVELS levels of WHEEL_SLOTS slots. A timer due in less than WHEEL_SLOTS ticks
+goes into the first level at its exact tick; one due later goes into a higher level at a coarser
+slot, and is moved down when the wheel comes round to that slot. A tick only looks at one slot of
+the first level, plus every WHEEL_SLOTS ticks one slot of the next level up, so it costs the same
+however many timers are waiting or how far away they are. Scheduling and cancelling are O(1).
+
+Timers are known by a number below WHEEL_TIMERS_MAX and kept in lists linked by index, not
+pointer, so a wheel can be copied like any other value (the board is copied every frame).
+
+**************************************************************************************************/
+
+#ifndef WHEEL_H
+#define WHEEL_H
+
+#include <stdint.h>
+
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_LEVELS 3
+#define WHEEL_RANGE (1u << (WHEEL_BITS * WHEEL_LEVELS)) // Ticks ahead a timer can be, 7 hours in tenths
+#define WHEEL_TIMERS_MAX 16
+
+typedef struct WheelTimer
+{
+	uint32_t deadline; // Tick it fires on
+	int8_t prev, next; // In its slot's list, -1 = end
+	int8_t level, slot; // -1 = not scheduled
+} WheelTimer;
+
+typedef struct TimerWheel
+{
+	uint32_t now; // Ticks so far
+	int8_t slots[WHEEL_LEVELS][WHEEL_SLOTS]; // First timer in each, -1 = empty
+	WheelTimer timers[WHEEL_TIMERS_MAX];
+} TimerWheel;
+
+void WheelInit (TimerWheel *wheel);
+void WheelSchedule (TimerWheel *wheel, int timer, uint32_t ticks); // Fire after this many ticks (1 to WHEEL_RANGE - 1), replacing any earlier schedule
+void WheelCancel (TimerWheel *wheel, int timer);
+int WheelTick (TimerWheel *wheel, int *fired); // Advance one tick; returns how many fired, their numbers in fired (WHEEL_TIMERS_MAX long)
+
+#endif
@@ -0,0 +1,366 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - whistle detection
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+**************************************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include "whistle.h"
+
+#define READ_FRAMES 1024 // Samples read at once from a pipe
+#define PLAYBACK_FRAMES 128 // and from a file, each once it is due
+
+static int AnalyseBlock (WhistleDetector *detector); // Returns the strongest bin of a tonal block, -1 if it is not one
+static void *WhistleThread (void *data);
+static void Queue (WhistleInput *input, const WhistleEvent *event);
+static uint32_t Read32 (const unsigned char *bytes);
+static int64_t Now (void);
+
+int WhistleDetectorInit (WhistleDetector *detector, int sample_rate)
+{
+	memset (detector, 0, sizeof (*detector));
+	if (sample_rate < WHISTLE_RATE_MIN || sample_rate > WHISTLE_RATE_MAX)
+		return -1;
+	detector->sample_rate = sample_rate;
+	detector->block_length = (sample_rate + WHISTLE_BIN_HZ / 2) / WHISTLE_BIN_HZ;
+	int n = detector->block_length;
+
+	// Bins k / n of the sample rate, from the one nearest WHISTLE_FIRST_HZ
+	int first = (int) lround ((double) WHISTLE_FIRST_HZ * n / sample_rate);
+	float coefficients[WHISTLE_BINS];
+	for (int bin = 0; bin < WHISTLE_BINS; bin++)
+	{
+		int k = first + bin;
+		coefficients[bin] = (float) (2 * cos (2 * M_PI * k / n));
+		double hz = (double) k * sample_rate / n;
+		if (hz >= WHISTLE_LOW_HZ && detector->low_bin == 0)
+			detector->low_bin = bin;
+		if (hz <= WHISTLE_HIGH_HZ)
+			detector->high_bin = bin;
+	}
+	memcpy (detector->coefficients, coefficients, sizeof (coefficients));
+	for (int i = 0; i < n; i++)
+		detector->window[i] = (float) (0.5 - 0.5 * cos (2 * M_PI * i / n));
+
+	// A full scale sine's windowed block has 3/16 of n * 32768^2 in it
+	detector->tonality = WHISTLE_TONALITY;
+	detector->share = WHISTLE_SHARE;
+	detector->level_min = (float) (3.0 / 16 * n * 32768.0 * 32768.0 * pow (10, WHISTLE_LEVEL_DB / 10.0));
+	int block_ms = 1000 / WHISTLE_BIN_HZ;
+	detector->min_blocks = WHISTLE_MIN_MS / block_ms;
+	detector->miss_blocks = WHISTLE_MISS_MS / block_ms;
+	detector->rearm_blocks = WHISTLE_REARM_MS / block_ms;
+	detector->spread_bins = (int) ((double) WHISTLE_SPREAD_HZ * n / sample_rate);
+	detector->armed = 1;
+	return 0;
+}
+
+int WhistleDetectorFeed (WhistleDetector *detector, const int16_t *samples, int count, WhistleHit *hits, int hits_max)
+{
+	int found = 0;
+	for (int i = 0; i < count; i++)
+	{
+		detector->block[detector->filled] = samples[i] * detector->window[detector->filled];
+		detector->filled++;
+		detector->position++;
+		if (detector->filled < detector->block_length)
+			continue;
+		detector->filled = 0;
+
+		int64_t block_start = detector->position - detector->block_length;
+		int peak = AnalyseBlock (detector);
+		if (peak >= 0)
+		{
+			// A tone that wandered off is something else starting
+			int low = peak < detector->run_low ? peak : detector->run_low, high = peak > detector->run_high ? peak : detector->run_high;
+			if (detector->run_blocks > 0 && high - low > detector->spread_bins)
+				detector->run_blocks = 0;
+			if (detector->run_blocks == 0)
+			{
+				detector->run_start = block_start;
+				low = high = peak;
+			}
+			detector->run_low = low;
+			detector->run_high = high;
+			detector->run_blocks++;
+			detector->missed_blocks = 0;
+			detector->quiet_blocks = 0;
+			if (detector->armed && detector->run_blocks >= detector->min_blocks)
+			{
+				detector->armed = 0;
+				if (found < hits_max)
+					hits[found++] = (WhistleHit){detector->run_start, detector->position - 1};
+			}
+		}
+		else
+		{
+			if (++detector->missed_blocks > detector->miss_blocks)
+				detector->run_blocks = 0;
+			if (++detector->quiet_blocks >= detector->rearm_blocks)
+				detector->armed = 1;
+		}
+	}
+	return found;
+}
+
+int WhistleReadWavHeader (int fd, int *sample_rate, int *channels)
+{
+	unsigned char header[12], chunk[8], format[16];
+	if (read (fd, header, sizeof (header)) != sizeof (header) || memcmp (header, "RIFF", 4) != 0 || memcmp (header + 8, "WAVE", 4) != 0)
+		return -1;
+
+	// Chunks up to the samples, the format has to come first
+	int have_format = 0;
+	while (read (fd, chunk, sizeof (chunk)) == sizeof (chunk))
+	{
+		uint32_t size = Read32 (chunk + 4);
+		if (memcmp (chunk, "data", 4) == 0)
+			return have_format ? 0 : -1;
+		if (memcmp (chunk, "fmt ", 4) == 0 && size >= sizeof (format))
+		{
+			if (read (fd, format, sizeof (format)) != sizeof (format))
+				return -1;
+			// PCM, or WAVE_FORMAT_EXTENSIBLE which is PCM as far as 16 bits go
+			int tag = format[0] | format[1] << 8, bits = format[14] | format[15] << 8;
+			*channels = format[2] | format[3] << 8;
+			*sample_rate = (int) Read32 (format + 4);
+			if ((tag != 1 && tag != 0xFFFE) || bits != 16 || *channels < 1 || *channels > 2)
+				return -1;
+			have_format = 1;
+			size -= sizeof (format);
+		}
+		// Chunks are padded to an even size
+		if (lseek (fd, (off_t) (size + (size & 1)), SEEK_CUR) < 0)
+			return -1;
+	}
+	return -1;
+}
+
+int WhistleStart (WhistleInput *input, const char *path)
+{
+	memset (input, 0, sizeof (*input));
+	input->channels = 1;
+	input->stop_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+	input->fd = open (path, O_RDONLY | O_CLOEXEC);
+	struct stat info;
+	if (input->fd < 0 || input->stop_fd < 0 || fstat (input->fd, &info) != 0)
+	{
+		fprintf (stderr, "Could not open whistle input '%s': %s\n", path, strerror (errno));
+		WhistleStop (input);
+		return -1;
+	}
+
+	// A file is a WAV or raw samples like the pipe's, played back as if it was live
+	int sample_rate = WHISTLE_RATE;
+	char magic[4];
+	input->recorded = S_ISREG (info.st_mode);
+	if (input->recorded && pread (input->fd, magic, sizeof (magic), 0) == sizeof (magic) && memcmp (magic, "RIFF", 4) == 0 &&
+		WhistleReadWavHeader (input->fd, &sample_rate, &input->channels) != 0)
+	{
+		fprintf (stderr, "Whistle input '%s' is not a 16-bit PCM WAV file\n", path);
+		WhistleStop (input);
+		return -1;
+	}
+	if (WhistleDetectorInit (&input->detector, sample_rate) != 0)
+	{
+		fprintf (stderr, "Whistle input '%s' is at %d Hz, it has to be %d to %d\n", path, sample_rate, WHISTLE_RATE_MIN, WHISTLE_RATE_MAX);
+		WhistleStop (input);
+		return -1;
+	}
+	if (pthread_create (&input->thread, NULL, WhistleThread, input) != 0)
+	{
+		WhistleStop (input);
+		return -1;
+	}
+	return 0;
+}
+
+int WhistlePoll (WhistleInput *input, WhistleEvent *event)
+{
+	unsigned int tail = atomic_load_explicit (&input->tail, memory_order_relaxed);
+	if (tail == atomic_load_explicit (&input->head, memory_order_acquire))
+		return 0;
+	*event = input->queue[tail % WHISTLE_QUEUE];
+	atomic_store_explicit (&input->tail, tail + 1, memory_order_release);
+	return 1;
+}
+
+void WhistleStop (WhistleInput *input)
+{
+	if (input->thread)
+	{
+		uint64_t one = 1;
+		if (write (input->stop_fd, &one, sizeof (one)) == sizeof (one))
+			pthread_join (input->thread, NULL);
+		input->thread = 0;
+	}
+	if (input->fd >= 0)
+		close (input->fd);
+	if (input->stop_fd >= 0)
+		close (input->stop_fd);
+	input->fd = -1;
+	input->stop_fd = -1;
+}
+
+static int AnalyseBlock (WhistleDetector *detector)
+{
+	// All the bins' Goertzel filters side by side, a vector of bins per step
+	WhistleVector s1[WHISTLE_VECTORS], s2[WHISTLE_VECTORS];
+	memset (s1, 0, sizeof (s1));
+	memset (s2, 0, sizeof (s2));
+	float energy = 0;
+	for (int i = 0; i < detector->block_length; i++)
+	{
+		float x = detector->block[i];
+		energy += x * x;
+		for (int v = 0; v < WHISTLE_VECTORS; v++)
+		{
+			WhistleVector s0 = x + detector->coefficients[v] * s1[v] - s2[v];
+			s2[v] = s1[v];
+			s1[v] = s0;
+		}
+	}
+	if (energy < detector->level_min)
+		return -1;
+
+	float power[WHISTLE_BINS];
+	for (int v = 0; v < WHISTLE_VECTORS; v++)
+	{
+		WhistleVector p = s1[v] * s1[v] + s2[v] * s2[v] - detector->coefficients[v] * s1[v] * s2[v];
+		memcpy (&power[v * WHISTLE_LANES], &p, sizeof (p));
+	}
+	int peak = detector->low_bin;
+	float bins = 0;
+	for (int bin = 0; bin < WHISTLE_BINS; bin++)
+	{
+		bins += power[bin];
+		if (bin >= detector->low_bin && bin <= detector->high_bin && power[bin] > power[peak])
+			peak = bin;
+	}
+
+	// All n bins hold n times the block's energy (Parseval), a tone's half of it in the mirrored bins
+	float lobe = power[peak - 1] + power[peak] + power[peak + 1];
+	if (lobe < detector->tonality * bins || 2 * lobe < detector->share * detector->block_length * energy)
+		return -1;
+	return peak;
+}
+
+static void *WhistleThread (void *data)
+{
+	WhistleInput *input = data;
+	WhistleDetector *detector = &input->detector;
+	unsigned char bytes[READ_FRAMES * 4];
+	int16_t samples[READ_FRAMES];
+	size_t kept = 0, frame_bytes = (size_t) input->channels * 2;
+	int64_t start_us = Now ();
+
+	while (1)
+	{
+		struct pollfd fds[2] = {{input->stop_fd, POLLIN, 0}, {input->fd, POLLIN, 0}};
+		size_t want;
+		if (input->recorded)
+		{
+			// The next few samples once the last of them is due
+			int64_t due = start_us + (detector->position + PLAYBACK_FRAMES) * 1000000 / detector->sample_rate, wait_us = due - Now ();
+			struct timespec timeout = {0, 0};
+			if (wait_us > 0)
+				timeout = (struct timespec) {(time_t) (wait_us / 1000000), (long) (wait_us % 1000000) * 1000};
+			if (ppoll (fds, 1, &timeout, NULL) != 0)
+				break;
+			want = PLAYBACK_FRAMES * frame_bytes - kept;
+		}
+		else
+		{
+			if (poll (fds, 2, -1) < 0 && errno != EINTR)
+				break;
+			if (fds[0].revents)
+				break;
+			if (!fds[1].revents)
+				continue;
+			want = READ_FRAMES * frame_bytes - kept; // No more frames than samples holds
+		}
+
+		ssize_t got = read (input->fd, bytes + kept, want);
+		int64_t now = Now ();
+		if (got < 0 && errno == EINTR)
+			continue;
+		if (got <= 0)
+			break;
+
+		// Whole frames, stereo mixed down
+		size_t total = kept + (size_t) got;
+		int frames = (int) (total / frame_bytes);
+		for (int i = 0; i < frames; i++)
+		{
+			const unsigned char *frame = bytes + (size_t) i * frame_bytes;
+			int left = (int16_t) (frame[0] | frame[1] << 8);
+			samples[i] = (int16_t) (input->channels == 2 ? (left + (int16_t) (frame[2] | frame[3] << 8)) / 2 : left);
+		}
+		kept = total % frame_bytes;
+		memmove (bytes, bytes + total - kept, kept);
+
+		WhistleHit hits[4];
+		int count = WhistleDetectorFeed (detector, samples, frames, hits, 4);
+
+		// The last sample read was heard just now, or is due now in a file
+		int64_t end_us = input->recorded ? start_us + detector->position * 1000000 / detector->sample_rate : now;
+		for (int i = 0; i < count; i++)
+		{
+			WhistleEvent event;
+			event.onset_us = end_us - (detector->position - hits[i].onset) * 1000000 / detector->sample_rate;
+			event.detected_us = end_us - (detector->position - 1 - hits[i].detected) * 1000000 / detector->sample_rate;
+			Queue (input, &event);
+		}
+	}
+	atomic_store (&input->finished, 1);
+	return NULL;
+}
+
+static void Queue (WhistleInput *input, const WhistleEvent *event)
+{
+	unsigned int head = atomic_load_explicit (&input->head, memory_order_relaxed);
+	if (head - atomic_load_explicit (&input->tail, memory_order_acquire) >= WHISTLE_QUEUE)
+	{
+		atomic_fetch_add (&input->dropped, 1);
+		return;
+	}
+	input->queue[head % WHISTLE_QUEUE] = *event;
+	atomic_store_explicit (&input->head, head + 1, memory_order_release);
+}
+
+static uint32_t Read32 (const unsigned char *bytes)
+{
+	return (uint32_t) bytes[0] | (uint32_t) bytes[1] << 8 | (uint32_t) bytes[2] << 16 | (uint32_t) bytes[3] << 24;
+}
+
+static int64_t Now (void)
+{
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
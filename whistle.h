@@ -0,0 +1,128 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - whistle detection
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Listens for the referee's whistle (--whistle PATH) so the clocks stop when it blows, not a
+reaction time later when the operator gets to the key, and gives back the time they ran since.
+
+The detector cuts the sound into blocks of 8 ms and runs a Goertzel filter for each 125 Hz bin
+from WHISTLE_FIRST_HZ up, WHISTLE_LANES bins at a time in vector registers (SSE on x86, NEON on
+ARM), over a Hann window. A block is tonal when it is loud enough and the strongest bin between
+WHISTLE_LOW_HZ and WHISTLE_HIGH_HZ holds, with its neighbours, WHISTLE_TONALITY of the energy in
+the bins and WHISTLE_SHARE of all the block's: a whistle is nearly one tone, crowd noise spreads
+out, voices and the buzzer have most of their energy lower down. Tonal blocks for WHISTLE_MIN_MS
+with their strongest bins within WHISTLE_SPREAD_HZ are a whistle, which started at the first of
+them; squeaking shoes are as tonal, but shorter or sweeping. Another whistle only counts after
+WHISTLE_REARM_MS without one.
+
+The detector knows nothing of time or files, only sample numbers, so the whistlebench tool runs
+the same code over recorded WAV files. WhistleStart () reads raw signed 16-bit little-endian mono
+samples at WHISTLE_RATE from a pipe (e.g. arecord's) on its own thread, or plays a WAV or raw file
+back in real time, and queues every whistle with the CLOCK_MONOTONIC time (the clock of
+InputNow ()) its onset was heard at, for the render thread to take with WhistlePoll ().
+
+**************************************************************************************************/
+
+#ifndef WHISTLE_H
+#define WHISTLE_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define WHISTLE_RATE 16000 // Samples a second from a pipe
+#define WHISTLE_RATE_MIN 11025 // Rates files can have
+#define WHISTLE_RATE_MAX 48000
+#define WHISTLE_BIN_HZ 125 // A block is 1 / WHISTLE_BIN_HZ seconds
+#define WHISTLE_BLOCK_MAX (WHISTLE_RATE_MAX / WHISTLE_BIN_HZ)
+#define WHISTLE_FIRST_HZ 1750 // Lowest bin, below the band so the band's edges have neighbours
+#define WHISTLE_LOW_HZ 2000 // Referee whistles are in here
+#define WHISTLE_HIGH_HZ 4500
+#define WHISTLE_LANES 4 // Bins per vector
+#define WHISTLE_VECTORS 7 // 28 bins, up to 5125 Hz
+#define WHISTLE_BINS (WHISTLE_LANES * WHISTLE_VECTORS)
+#define WHISTLE_TONALITY 0.6f // Share of the bins' energy in the strongest bin and the two beside it
+#define WHISTLE_SHARE 0.2f // Share of the whole block's energy in them
+#define WHISTLE_LEVEL_DB -50 // Quieter blocks are never tonal, in dB below a full scale sine
+#define WHISTLE_MIN_MS 96 // Two squeaks back to back can make 80
+#define WHISTLE_SPREAD_HZ 400 // A pea whistle warbles by 300 Hz or so
+#define WHISTLE_MISS_MS 16 // A pea whistle warbles, so a run may miss this long
+#define WHISTLE_REARM_MS 250
+#define WHISTLE_LOOKBACK_MS 500 // Most the clocks are given back
+#define WHISTLE_QUEUE 16 // Power of two
+
+typedef float WhistleVector __attribute__ ((vector_size (WHISTLE_LANES * sizeof (float))));
+
+typedef struct WhistleHit
+{
+	int64_t onset; // Sample numbers from the start of the stream
+	int64_t detected; // Last sample of the block it was found in
+} WhistleHit;
+
+typedef struct WhistleDetector
+{
+	int sample_rate, block_length;
+	int low_bin, high_bin; // Band the strongest bin has to be in, counted from the first bin
+
+	// Thresholds, WHISTLE_* unless changed after WhistleDetectorInit ()
+	float tonality, share;
+	float level_min; // Energy of a windowed block
+	int min_blocks, miss_blocks, rearm_blocks, spread_bins;
+
+	WhistleVector coefficients[WHISTLE_VECTORS];
+	float window[WHISTLE_BLOCK_MAX];
+	float block[WHISTLE_BLOCK_MAX];
+	int filled;
+	int64_t position; // Samples fed so far
+
+	// Current run of tonal blocks
+	int64_t run_start;
+	int run_blocks, missed_blocks, quiet_blocks, armed;
+	int run_low, run_high; // Strongest bins seen in the run
+} WhistleDetector;
+
+typedef struct WhistleEvent
+{
+	int64_t onset_us; // CLOCK_MONOTONIC
+	int64_t detected_us;
+} WhistleEvent;
+
+typedef struct WhistleInput
+{
+	pthread_t thread;
+	int fd, stop_fd;
+	int recorded; // A file played back, not a pipe
+	int channels;
+	WhistleDetector detector;
+	WhistleEvent queue[WHISTLE_QUEUE];
+	_Atomic unsigned int head; // Written by the whistle thread
+	_Atomic unsigned int tail; // Written by the render thread
+	_Atomic unsigned long dropped; // Queue was full
+	_Atomic int finished; // Pipe closed or file played to the end
+} WhistleInput;
+
+int WhistleDetectorInit (WhistleDetector *detector, int sample_rate); // Returns 0 on success, -1 for a rate out of range
+int WhistleDetectorFeed (WhistleDetector *detector, const int16_t *samples, int count, WhistleHit *hits, int hits_max); // Returns how many whistles were found in these samples
+int WhistleReadWavHeader (int fd, int *sample_rate, int *channels); // Leaves fd at the samples; returns 0 for 16-bit PCM, mono or stereo
+
+int WhistleStart (WhistleInput *input, const char *path); // Returns 0 on success
+int WhistlePoll (WhistleInput *input, WhistleEvent *event); // Takes the oldest whistle, returns 0 if there is none
+void WhistleStop (WhistleInput *input);
+
+#endif
@@ -0,0 +1,531 @@
+/**************************************************************************************************
+
+Basketball Scoreboard - whistle detection benchmark
+Copyright (c) 2021 Cyrus Lee
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+***************************************************************************************************
+
+Runs the whistle detector (whistle.h) over recorded games and reports how soon it finds the
+whistles, how close it puts their onsets, how many it misses and how often it hears one that was
+not there.
+
+	whistlebench [--tonality T] [--level DB] [--min-ms MS] FILE.wav...
+	whistlebench --synth MINUTES [--seed N] [--write NAME] [--pipe] [--tonality T] [--level DB] [--min-ms MS]
+
+Files are 16-bit PCM WAV, mono or stereo, 11025 to 48000 Hz. Where the whistles are is read from
+a label file next to each one with the same name ending in .txt, as Audacity exports a label track:
+"start<TAB>end<TAB>text" in seconds per line. A file without one is taken to have no whistles, so
+everything found in it is a false positive; recordings of crowd noise, the buzzer and squeaking
+shoes are the useful ones. --synth makes a game's worth of such sound instead, with whistles at
+random times, and --write saves it as NAME.wav and NAME.txt, for --whistle or to listen to.
+--pipe also sends it through a pipe to WhistleStart () as fast as the pipe takes it, the way
+arecord feeds --whistle, and checks that as many whistles come out as when it is fed directly.
+
+WHISTLE_* in whistle.h were tuned with --synth only; no labelled recordings of real games were
+available, so the numbers for those are still to be measured.
+
+The samples are fed in blocks of 10 ms, as from a pipe. A whistle is found if an onset falls between
+100 ms before its labelled start and its end. Fails if any whistle was missed or anything else
+was taken for one.
+
+**************************************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "whistle.h"
+
+#define LABELS_MAX 4096
+#define HITS_MAX 8192
+#define EARLY_US 100000 // An onset this far before the labelled start still counts
+#define SYNTH_RATE WHISTLE_RATE
+
+typedef struct Label { double start, end; } Label;
+typedef struct PipeWriter { int fd; const int16_t *samples; long count; } PipeWriter;
+
+typedef struct Result
+{
+	double seconds;
+	int labelled, found, missed, false_positives;
+	double latency_ms[LABELS_MAX]; // From the labelled start to found
+	double onset_ms[LABELS_MAX]; // Onset found less the labelled start
+	int64_t detector_ns;
+	long blocks;
+} Result;
+
+static float tonality = WHISTLE_TONALITY;
+static double level_db = WHISTLE_LEVEL_DB;
+static int min_ms = WHISTLE_MIN_MS;
+
+static int RunFile (const char *path, Result *result);
+static void Run (const int16_t *samples, long count, int sample_rate, const Label *labels, int label_count, Result *result);
+static long Synthesize (int16_t *samples, long count, Label *labels, int *label_count);
+static int WriteWav (const char *path, const int16_t *samples, long count, int sample_rate);
+static int RunPipe (const int16_t *samples, long count); // Returns 0 if the pipe gave the same whistles
+static void *WritePipe (void *data);
+static void Report (const char *name, const Result *result);
+static double Uniform (double low, double high);
+static int CompareDoubles (const void *a, const void *b);
+static int64_t NowNs (void);
+
+int main (int argc, char *argv[])
+{
+	double synth_minutes = 0;
+	unsigned int seed = (unsigned int) time (NULL);
+	const char *write_name = NULL;
+	int through_pipe = 0;
+	static struct option long_options[] =
+	{
+		{"synth", required_argument, 0, 'S'},
+		{"seed", required_argument, 0, 'r'},
+		{"write", required_argument, 0, 'w'},
+		{"pipe", no_argument, 0, 'p'},
+		{"tonality", required_argument, 0, 't'},
+		{"level", required_argument, 0, 'l'},
+		{"min-ms", required_argument, 0, 'm'},
+		{0, 0, 0, 0}
+	};
+
+	int c;
+	while ((c = getopt_long (argc, argv, "", long_options, NULL)) != -1)
+	{
+		switch (c)
+		{
+			case 'S': synth_minutes = atof (optarg); break;
+			case 'r': seed = (unsigned int) strtoul (optarg, NULL, 10); break;
+			case 'w': write_name = optarg; break;
+			case 'p': through_pipe = 1; break;
+			case 't': tonality = (float) atof (optarg); break;
+			case 'l': level_db = atof (optarg); break;
+			case 'm': min_ms = atoi (optarg); break;
+			default:
+				fprintf (stderr, "usage: %s [--tonality T] [--level DB] [--min-ms MS] FILE.wav...\n"
+					"       %s --synth MINUTES [--seed N] [--write NAME] [--pipe] [--tonality T] [--level DB] [--min-ms MS]\n", argv[0], argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+	if ((synth_minutes > 0) == (optind < argc) || synth_minutes < 0 || (through_pipe && synth_minutes == 0) || tonality <= 0 || min_ms < 1000 / WHISTLE_BIN_HZ)
+	{
+		fprintf (stderr, "usage: %s [--tonality T] [--level DB] [--min-ms MS] FILE.wav...\n"
+			"       %s --synth MINUTES [--seed N] [--write NAME] [--pipe] [--tonality T] [--level DB] [--min-ms MS]\n", argv[0], argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	static Result total, result;
+	int pipe_failed = 0;
+	if (synth_minutes > 0)
+	{
+		long count = (long) (synth_minutes * 60 * SYNTH_RATE);
+		int16_t *samples = malloc ((size_t) count * sizeof (int16_t));
+		static Label labels[LABELS_MAX];
+		int label_count;
+		srand (seed);
+		Synthesize (samples, count, labels, &label_count);
+		printf ("synthesized %.1f min of game sound with %d whistles, seed %u\n", synth_minutes, label_count, seed);
+		if (write_name)
+		{
+			char path[512];
+			snprintf (path, sizeof (path), "%s.wav", write_name);
+			int written = WriteWav (path, samples, count, SYNTH_RATE) == 0;
+			snprintf (path, sizeof (path), "%s.txt", write_name);
+			FILE *file = fopen (path, "w");
+			if (file)
+			{
+				for (int i = 0; i < label_count; i++)
+					fprintf (file, "%.6f\t%.6f\twhistle\n", labels[i].start, labels[i].end);
+				fclose (file);
+			}
+			if (!written || file == NULL)
+				fprintf (stderr, "%s: could not write '%s.wav' and '%s.txt'\n", argv[0], write_name, write_name);
+		}
+		Run (samples, count, SYNTH_RATE, labels, label_count, &total);
+		if (through_pipe)
+			pipe_failed = RunPipe (samples, count) != 0;
+		free (samples);
+	}
+	for (int i = optind; i < argc; i++)
+	{
+		memset (&result, 0, sizeof (result));
+		if (RunFile (argv[i], &result) != 0)
+		{
+			fprintf (stderr, "%s: could not read '%s' as a 16-bit PCM WAV file\n", argv[0], argv[i]);
+			return EXIT_FAILURE;
+		}
+		if (argc - optind > 1)
+			Report (argv[i], &result);
+
+		// Everything into the total, the found ones' times as well
+		for (int j = 0; j < result.found && total.found + j < LABELS_MAX; j++)
+		{
+			total.latency_ms[total.found + j] = result.latency_ms[j];
+			total.onset_ms[total.found + j] = result.onset_ms[j];
+		}
+		total.seconds += result.seconds;
+		total.labelled += result.labelled;
+		total.found += result.found < LABELS_MAX - total.found ? result.found : LABELS_MAX - total.found;
+		total.missed += result.missed;
+		total.false_positives += result.false_positives;
+		total.detector_ns += result.detector_ns;
+		total.blocks += result.blocks;
+	}
+	Report ("all", &total);
+	return total.missed == 0 && total.false_positives == 0 && !pipe_failed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int RunFile (const char *path, Result *result)
+{
+	int fd = open (path, O_RDONLY | O_CLOEXEC), sample_rate, channels;
+	if (fd < 0)
+		return -1;
+	if (WhistleReadWavHeader (fd, &sample_rate, &channels) != 0 || sample_rate < WHISTLE_RATE_MIN || sample_rate > WHISTLE_RATE_MAX)
+	{
+		close (fd);
+		return -1;
+	}
+
+	// All of it, mixed down to mono
+	size_t size = 0, capacity = 1 << 20;
+	unsigned char *bytes = malloc (capacity);
+	ssize_t got;
+	while ((got = read (fd, bytes + size, capacity - size)) > 0)
+	{
+		size += (size_t) got;
+		if (size == capacity)
+			bytes = realloc (bytes, capacity *= 2);
+	}
+	close (fd);
+	long count = (long) (size / ((size_t) channels * 2));
+	int16_t *samples = malloc ((size_t) (count > 0 ? count : 1) * sizeof (int16_t));
+	for (long i = 0; i < count; i++)
+	{
+		const unsigned char *frame = bytes + (size_t) i * channels * 2;
+		int left = (int16_t) (frame[0] | frame[1] << 8);
+		samples[i] = (int16_t) (channels == 2 ? (left + (int16_t) (frame[2] | frame[3] << 8)) / 2 : left);
+	}
+	free (bytes);
+
+	// Labels from NAME.txt, if there are any
+	static Label labels[LABELS_MAX];
+	int label_count = 0;
+	char label_path[512];
+	snprintf (label_path, sizeof (label_path), "%s", path);
+	char *dot = strrchr (label_path, '.');
+	if (dot && strchr (dot, '/') == NULL)
+		*dot = '\0';
+	strncat (label_path, ".txt", sizeof (label_path) - strlen (label_path) - 1);
+	FILE *file = fopen (label_path, "r");
+	if (file)
+	{
+		char line[256];
+		while (fgets (line, sizeof (line), file) && label_count < LABELS_MAX)
+			if (sscanf (line, "%lf %lf", &labels[label_count].start, &labels[label_count].end) == 2)
+				label_count++;
+		fclose (file);
+	}
+
+	Run (samples, count, sample_rate, labels, label_count, result);
+	free (samples);
+	return 0;
+}
+
+static void Run (const int16_t *samples, long count, int sample_rate, const Label *labels, int label_count, Result *result)
+{
+	WhistleDetector detector;
+	WhistleDetectorInit (&detector, sample_rate);
+	detector.tonality = tonality;
+	detector.level_min *= (float) pow (10, (level_db - WHISTLE_LEVEL_DB) / 10);
+	detector.min_blocks = min_ms * WHISTLE_BIN_HZ / 1000;
+
+	// As from a pipe, 10 ms at a time
+	static WhistleHit hits[HITS_MAX];
+	int hit_count = 0;
+	long chunk = sample_rate / 100;
+	for (long i = 0; i < count; i += chunk)
+	{
+		int n = (int) (count - i < chunk ? count - i : chunk);
+		int64_t start = NowNs ();
+		hit_count += WhistleDetectorFeed (&detector, samples + i, n, hits + hit_count, HITS_MAX - hit_count);
+		result->detector_ns += NowNs () - start;
+	}
+	result->seconds = (double) count / sample_rate;
+	result->blocks = count / detector.block_length;
+
+	// Each label takes the first whistle found in it, any other whistle is a false positive
+	static char used[HITS_MAX];
+	memset (used, 0, sizeof (used));
+	result->labelled = label_count;
+	for (int l = 0; l < label_count; l++)
+	{
+		int found = -1;
+		for (int h = 0; h < hit_count && found < 0; h++)
+		{
+			double onset = (double) hits[h].onset / sample_rate;
+			if (!used[h] && onset >= labels[l].start - EARLY_US / 1e6 && onset <= labels[l].end)
+				found = h;
+		}
+		if (found < 0)
+		{
+			result->missed++;
+			continue;
+		}
+		used[found] = 1;
+		result->latency_ms[result->found] = ((double) hits[found].detected / sample_rate - labels[l].start) * 1000;
+		result->onset_ms[result->found] = ((double) hits[found].onset / sample_rate - labels[l].start) * 1000;
+		result->found++;
+	}
+	for (int h = 0; h < hit_count; h++)
+		result->false_positives += !used[h];
+}
+
+static int RunPipe (const int16_t *samples, long count)
+{
+	// With the detector's own thresholds, as --whistle has no others
+	static WhistleHit hits[HITS_MAX];
+	WhistleDetector detector;
+	WhistleDetectorInit (&detector, SYNTH_RATE);
+	int direct = WhistleDetectorFeed (&detector, samples, (int) count, hits, HITS_MAX);
+
+	// Full pipe buffers, so every read gets all it asks for
+	int fds[2];
+	char path[64];
+	WhistleInput input;
+	if (pipe (fds) != 0)
+		return -1;
+	snprintf (path, sizeof (path), "/dev/fd/%d", fds[0]);
+	if (WhistleStart (&input, path) != 0)
+	{
+		close (fds[0]);
+		close (fds[1]);
+		return -1;
+	}
+	PipeWriter writer = {fds[1], samples, count};
+	pthread_t thread;
+	pthread_create (&thread, NULL, WritePipe, &writer);
+
+	int piped = 0, finished = 0;
+	WhistleEvent event;
+	while (!finished)
+	{
+		finished = atomic_load (&input.finished);
+		while (WhistlePoll (&input, &event))
+			piped++;
+		if (!finished)
+			usleep (1000);
+	}
+	pthread_join (thread, NULL);
+	unsigned long dropped = atomic_load (&input.dropped);
+	WhistleStop (&input);
+	close (fds[0]);
+	printf ("pipe: %d whistles read through a pipe, %d fed directly, %lu dropped\n", piped, direct, dropped);
+	return piped == direct && dropped == 0 ? 0 : -1;
+}
+
+static void *WritePipe (void *data)
+{
+	PipeWriter *writer = data;
+	unsigned char bytes[65536];
+	long i = 0;
+	while (i < writer->count)
+	{
+		// Little-endian, whatever this machine is
+		size_t length = 0;
+		for (; i < writer->count && length < sizeof (bytes); i++)
+		{
+			bytes[length++] = (unsigned char) (writer->samples[i] & 0xFF);
+			bytes[length++] = (unsigned char) ((uint16_t) writer->samples[i] >> 8);
+		}
+		for (size_t done = 0; done < length; )
+		{
+			ssize_t written = write (writer->fd, bytes + done, length - done);
+			if (written <= 0)
+			{
+				close (writer->fd);
+				return NULL;
+			}
+			done += (size_t) written;
+		}
+	}
+	close (writer->fd);
+	return NULL;
+}
+
+static long Synthesize (int16_t *samples, long count, Label *labels, int *label_count)
+{
+	/**********************************************************************************************
+
+	A rough gym: crowd noise rising and falling, voices (a low fundamental and its harmonics),
+	shoes squeaking (short loud chirps right in the whistle band), the buzzer (a square wave,
+	its odd harmonics in the band too) and, every 8 to 25 seconds, a pea whistle: 2.8 to 3.6 kHz,
+	warbling by 150 Hz 30-odd times a second, 0.25 to 1.2 seconds long, 0 to 15 dB over the crowd
+	or what a quiet gym's would be.
+
+	**********************************************************************************************/
+
+	const double rate = SYNTH_RATE;
+	double noise = 0, crowd = 0.03, crowd_target = 0.03;
+	double voice_f0 = 0, voice_phase = 0, squeak_phase = 0, whistle_phase = 0, warble_phase = 0;
+	long voice_end = 0, squeak_end = 0, buzzer_end = 0, whistle_start = 0, whistle_end = 0;
+	double squeak_hz = 0, squeak_sweep = 0, whistle_hz = 0, warble_hz = 0, whistle_gain = 0;
+	long next_whistle = (long) (Uniform (3, 10) * rate);
+	*label_count = 0;
+
+	for (long i = 0; i < count; i++)
+	{
+		// Crowd: low passed noise, its level wandering
+		if (i % (long) rate == 0)
+			crowd_target = Uniform (0.01, 0.08);
+		crowd += (crowd_target - crowd) / rate;
+		double white = Uniform (-1, 1);
+		noise += 0.35 * (white - noise);
+		double x = crowd * (noise * 2 + white * 0.15);
+
+		// Voices
+		if (i >= voice_end && Uniform (0, 1) < 1.5 / rate)
+		{
+			voice_f0 = Uniform (110, 320);
+			voice_end = i + (long) (Uniform (0.2, 1.5) * rate);
+		}
+		if (i < voice_end)
+		{
+			voice_phase += 2 * M_PI * voice_f0 * (1 + 0.05 * sin (i / rate * 5)) / rate;
+			double voice = 0;
+			for (int h = 1; h <= 20 && voice_f0 * h < rate / 2; h++)
+				voice += sin (voice_phase * h) / h;
+			x += 0.06 * voice;
+		}
+
+		// Shoes
+		if (i >= squeak_end && Uniform (0, 1) < 0.8 / rate)
+		{
+			squeak_hz = Uniform (2000, 4500);
+			squeak_sweep = Uniform (-8000, 8000);
+			squeak_end = i + (long) (Uniform (0.015, 0.045) * rate);
+		}
+		if (i < squeak_end)
+		{
+			squeak_hz += squeak_sweep / rate;
+			squeak_phase += 2 * M_PI * squeak_hz / rate;
+			x += 0.25 * sin (squeak_phase);
+		}
+
+		// The buzzer, now and then
+		if (i >= buzzer_end && Uniform (0, 1) < 0.02 / rate)
+			buzzer_end = i + (long) (Uniform (1, 3) * rate);
+		if (i < buzzer_end)
+			x += 0.15 * (fmod (i * 680.0 / rate, 1) < 0.5 ? 1 : -1);
+
+		// Whistles, not over the buzzer: the clock has run out then
+		if (i == next_whistle && i < buzzer_end)
+			next_whistle = buzzer_end + (long) (rate / 2);
+		if (i == next_whistle && *label_count < LABELS_MAX)
+		{
+			whistle_start = i;
+			whistle_end = i + (long) (Uniform (0.25, 1.2) * rate);
+			whistle_hz = Uniform (2800, 3600);
+			warble_hz = Uniform (25, 40);
+			// Blown as hard in a quiet gym
+			whistle_gain = (crowd > 0.04 ? crowd : 0.04) * 2.5 * pow (10, Uniform (0, 15) / 20);
+			labels[*label_count] = (Label){whistle_start / rate, whistle_end / rate};
+			(*label_count)++;
+			next_whistle = whistle_end + (long) (Uniform (8, 25) * rate);
+		}
+		if (i >= whistle_start && i < whistle_end)
+		{
+			// Rising over 15 ms, dying away over 30
+			double t = (i - whistle_start) / rate, left = (whistle_end - i) / rate;
+			double envelope = (t < 0.015 ? t / 0.015 : 1) * (left < 0.03 ? left / 0.03 : 1);
+			warble_phase += 2 * M_PI * warble_hz / rate;
+			whistle_phase += 2 * M_PI * (whistle_hz + 150 * sin (warble_phase)) / rate;
+			double pea = 1 - 0.4 * (0.5 + 0.5 * sin (warble_phase));
+			x += whistle_gain * envelope * pea * (sin (whistle_phase) + 0.25 * sin (whistle_phase * 2));
+		}
+
+		double sample = x * 32767;
+		samples[i] = (int16_t) (sample > 32767 ? 32767 : sample < -32768 ? -32768 : sample);
+	}
+	return count;
+}
+
+static int WriteWav (const char *path, const int16_t *samples, long count, int sample_rate)
+{
+	FILE *file = fopen (path, "wb");
+	if (file == NULL)
+		return -1;
+	uint32_t data = (uint32_t) count * 2, riff = data + 36, format = 16, byte_rate = (uint32_t) sample_rate * 2, rate = (uint32_t) sample_rate;
+	uint16_t pcm = 1, channels = 1, align = 2, bits = 16;
+	fwrite ("RIFF", 1, 4, file);
+	fwrite (&riff, 4, 1, file);
+	fwrite ("WAVEfmt ", 1, 8, file);
+	fwrite (&format, 4, 1, file);
+	fwrite (&pcm, 2, 1, file);
+	fwrite (&channels, 2, 1, file);
+	fwrite (&rate, 4, 1, file);
+	fwrite (&byte_rate, 4, 1, file);
+	fwrite (&align, 2, 1, file);
+	fwrite (&bits, 2, 1, file);
+	fwrite ("data", 1, 4, file);
+	fwrite (&data, 4, 1, file);
+	fwrite (samples, 2, (size_t) count, file);
+	return fclose (file) == 0 ? 0 : -1;
+}
+
+static void Report (const char *name, const Result *result)
+{
+	double hours = result->seconds / 3600;
+	printf ("%s: %.1f min, %d whistles: %d found, %d missed, %d false positives (%.1f an hour)\n",
+		name, result->seconds / 60, result->labelled, result->found, result->missed, result->false_positives,
+		hours > 0 ? result->false_positives / hours : 0);
+	if (result->found > 0)
+	{
+		static double sorted[LABELS_MAX];
+		int n = result->found;
+		memcpy (sorted, result->latency_ms, (size_t) n * sizeof (double));
+		qsort (sorted, (size_t) n, sizeof (double), CompareDoubles);
+		printf ("  found %.0f ms after the whistle started (median), %.0f ms at worst\n", sorted[n / 2], sorted[n - 1]);
+		for (int i = 0; i < n; i++)
+			sorted[i] = fabs (result->onset_ms[i]);
+		qsort (sorted, (size_t) n, sizeof (double), CompareDoubles);
+		printf ("  onset off by %.1f ms (median), %.1f ms at worst\n", sorted[n / 2], sorted[n - 1]);
+	}
+	if (result->blocks > 0)
+		printf ("  detector: %.0f ns a block, %.0f times faster than real time\n",
+			(double) result->detector_ns / result->blocks, result->seconds * 1e9 / (result->detector_ns > 0 ? result->detector_ns : 1));
+}
+
+static double Uniform (double low, double high)
+{
+	return low + (high - low) * rand () / ((double) RAND_MAX + 1);
+}
+
+static int CompareDoubles (const void *a, const void *b)
+{
+	double x = *(const double *) a, y = *(const double *) b;
+	return (x > y) - (x < y);
+}
+
+static int64_t NowNs (void)
+{
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}